@@ -49,6 +49,7 @@ SimulationMaster::SimulationMaster(hemelb::configuration::CommandLine & options,
   propertyDataSource = NULL;
   visualisationControl = NULL;
   propertyExtractor = NULL;
+  reductionExtractor = NULL;
   simulationState = NULL;
   stepManager = NULL;
   netConcern = NULL;
@@ -99,6 +100,7 @@ SimulationMaster::~SimulationMaster()
   delete steeringCpt;
   delete visualisationControl;
   delete propertyExtractor;
+  delete reductionExtractor;
   delete propertyDataSource;
   delete stabilityTester;
   delete entropyTester;
@@ -164,7 +166,11 @@ void SimulationMaster::Initialise()
   }
 
   // Create a new lattice based on that info and return it.
-  latticeData = new hemelb::geometry::LatticeData(LatticeType::GetLatticeInfo(), readGeometryData, ioComms);
+  latticeData = new hemelb::geometry::LatticeData(LatticeType::GetLatticeInfo(),
+                                                  readGeometryData,
+                                                  ioComms,
+                                                  simConfig->UseInPlaceStreaming(),
+                                                  simConfig->GetSiteOrdering());
 
   timings[hemelb::reporting::Timers::latDatInitialise].Stop();
 
@@ -321,6 +327,23 @@ void SimulationMaster::Initialise()
                                                               timings, ioComms);
   }
 
+  if (simConfig->GetReductionOutput() != NULL)
+  {
+    simConfig->GetReductionOutput()->filename = fileManager->GetDataExtractionPath()
+        + simConfig->GetReductionOutput()->filename;
+
+    reductionExtractor =
+        new hemelb::extraction::ReductionActor(*simulationState,
+                                               *simConfig->GetReductionOutput(),
+                                               *latticeData,
+                                               latticeBoltzmannModel->GetPropertyCache(),
+                                               simConfig->GetInlets(),
+                                               simConfig->GetOutlets(),
+                                               *unitConverter,
+                                               timings,
+                                               ioComms);
+  }
+
   imagesPeriod = OutputPeriod(imagesPerSimulation);
 
   stepManager = new hemelb::net::phased::StepManager(2,
@@ -362,6 +385,11 @@ void SimulationMaster::Initialise()
     stepManager->RegisterIteratedActorSteps(*propertyExtractor, 1);
   }
 
+  if (reductionExtractor != NULL)
+  {
+    stepManager->RegisterIteratedActorSteps(*reductionExtractor, 1);
+  }
+
   if (ioComms.OnIORank())
   {
     stepManager->RegisterIteratedActorSteps(*network, 1);
@@ -636,6 +664,12 @@ void SimulationMaster::RecalculatePropertyRequirements()
     propertyExtractor->SetRequiredProperties(propertyCache);
   }
 
+  // Likewise for the reduced quantities.
+  if (reductionExtractor != NULL)
+  {
+    reductionExtractor->SetRequiredProperties(propertyCache);
+  }
+
   // If using streaklines, the velocity will be needed.
 #ifndef NO_STREAKLINES
   propertyCache.velocityCache.SetRefreshFlag();
@@ -8,6 +8,7 @@
 #define HEMELB_SIMULATIONMASTER_H
 #include "lb/lattices/Lattices.h"
 #include "extraction/PropertyActor.h"
+#include "extraction/ReductionActor.h"
 #include "lb/lb.hpp"
 #include "lb/StabilityTester.h"
 #include "net/net.h"
@@ -109,6 +110,7 @@ class SimulationMaster
     hemelb::vis::Control* visualisationControl;
     hemelb::extraction::IterableDataSource* propertyDataSource;
     hemelb::extraction::PropertyActor* propertyExtractor;
+    hemelb::extraction::ReductionActor* reductionExtractor;
 
     hemelb::net::phased::StepManager* stepManager;
     hemelb::net::phased::NetConcern* netConcern;
@@ -81,10 +81,12 @@ hemelb_option(HEMELB_STATIC_ASSERT "Use simple compile-time assertions" ON)
 hemelb_option(HEMELB_WAIT_ON_CONNECT "Wait for steering client" OFF)
 hemelb_option(HEMELB_IMAGES_TO_NULL "Write images to null" OFF)
 hemelb_option(HEMELB_USE_SSE3 "Use SSE3 intrinsics" ON)
+hemelb_option(HEMELB_USE_AVX "Use AVX2/AVX-512 intrinsics when the CPU supports them (checked at run time)" ON)
 hemelb_option(HEMELB_USE_VELOCITY_WEIGHTS_FILE "Use Velocity weights file" OFF)
 hemelb_option(HEMELB_SEPARATE_CONCERNS "Communicate for each concern separately" OFF)
 hemelb_option(HEMELB_LATTICE_INCOMPRESSIBLE "Use an incompressible lattice" OFF)
 hemelb_option(HEMELB_CUDA_AWARE_MPI "Use CUDA-aware MPI" ON)
+hemelb_option(HEMELB_WIDE_STREAMING_INDICES "Store streaming indices in 64 bits, for ranks with more than 2^32 distributions" OFF)
 
 #
 # Specify the variables
@@ -111,7 +113,7 @@ hemelb_cachevar(HEMELB_PROFILING ""
 hemelb_cachevar(HEMELB_LATTICE "D3Q15"
   STRING "Select the lattice type to use (D3Q15,D3Q19,D3Q27)")
 hemelb_cachevar(HEMELB_KERNEL "LBGK"
-  STRING "Select the kernel to use (LBGK,EntropicAnsumali,EntropicChik,MRT,TRT,NNCY,NNCYMOUSE,NNC,NNTPL)")
+  STRING "Select the kernel to use (LBGK,EntropicAnsumali,EntropicChik,MRT,TRT,Regularised,Cumulant,NNCY,NNCYMOUSE,NNC,NNTPL)")
 hemelb_cachevar(HEMELB_WALL_BOUNDARY "SIMPLEBOUNCEBACK"
   STRING "Select the boundary conditions to be used at the walls (BFL,GZS,SIMPLEBOUNCEBACK,JUNKYANG)")
 hemelb_cachevar(HEMELB_INLET_BOUNDARY "NASHZEROTHORDERPRESSUREIOLET"
@@ -124,6 +126,10 @@ hemelb_cachevar(HEMELB_WALL_INLET_BOUNDARY "NASHZEROTHORDERPRESSURESBB"
   STRING "Select the boundary conditions to be used at corners between walls and inlets (NASHZEROTHORDERPRESSURESBB,NASHZEROTHORDERPRESSUREBFL,LADDIOLETSBB,LADDIOLETBFL)")
 hemelb_cachevar(HEMELB_WALL_OUTLET_BOUNDARY "NASHZEROTHORDERPRESSURESBB"
   STRING "Select the boundary conditions to be used at corners between walls and outlets (NASHZEROTHORDERPRESSURESBB,NASHZEROTHORDERPRESSUREBFL,LADDIOLETSBB,LADDIOLETBFL)")
+hemelb_cachevar(HEMELB_RUNTIME_KERNELS "${HEMELB_KERNEL}"
+  STRING "Kernels that can be selected at run time with <kernel> in the XML (semicolon-separated list; HEMELB_KERNEL is always included)")
+hemelb_cachevar(HEMELB_RUNTIME_STREAMERS "${HEMELB_WALL_INLET_BOUNDARY}"
+  STRING "Boundary condition combinations that can be selected at run time with <wall_boundary> and the iolet conditions in the XML (semicolon-separated list; HEMELB_WALL_INLET_BOUNDARY is always included)")
 hemelb_cachevar(HEMELB_POINTPOINT_IMPLEMENTATION Coalesce
   STRING "Point to point comms implementation, choose 'Coalesce', 'Separated', or 'Immediate'" )
 hemelb_cachevar(HEMELB_GATHERS_IMPLEMENTATION Separated
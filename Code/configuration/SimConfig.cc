@@ -14,6 +14,9 @@
 #include "logging/Logger.h"
 #include "util/FileUtils.h"
 
+#define QUOTE_RAW(x) #x
+#define QUOTE_CONTENTS(x) QUOTE_RAW(x)
+
 namespace hemelb
 {
   namespace configuration
@@ -28,9 +31,14 @@ namespace hemelb
     SimConfig::SimConfig(const std::string& path) :
         xmlFilePath(path),
         rawXmlDoc(NULL),
+        reductionOutput(NULL),
         hasColloidSection(false),
         useGPU(false),
         gpuBlockSize(0),
+        inPlaceStreaming(false),
+        siteOrdering(geometry::BLOCK_ORDER),
+        kernelName(QUOTE_CONTENTS(HEMELB_KERNEL)),
+        wallBoundaryName(QUOTE_CONTENTS(HEMELB_WALL_BOUNDARY)),
         warmUpSteps(0),
         unitConverter(NULL)
     {
@@ -54,6 +62,7 @@ namespace hemelb
       {
         delete propertyOutputs[outputNumber];
       }
+      delete reductionOutput;
 
       delete rawXmlDoc;
       rawXmlDoc = NULL;
@@ -163,6 +172,38 @@ namespace hemelb
             gpuBlockSize = 16;
           }
       }
+
+      // Optional element
+      // <in_place_streaming value="false|true" />
+      const io::xml::Element inPlaceEl = simEl.GetChildOrNull("in_place_streaming");
+      if (inPlaceEl != io::xml::Element::Missing())
+      {
+        inPlaceEl.GetAttributeOrThrow("value", inPlaceStreaming);
+      }
+
+      // Optional element
+      // <site_ordering value="block|morton|hilbert" />
+      const io::xml::Element orderingEl = simEl.GetChildOrNull("site_ordering");
+      if (orderingEl != io::xml::Element::Missing())
+      {
+        siteOrdering = geometry::GetSiteOrderingFromName(orderingEl.GetAttributeOrThrow("value"));
+      }
+
+      // Optional element, defaulting to the compile-time choice
+      // <kernel value="LBGK|TRT|MRT|..." />
+      const io::xml::Element kernelEl = simEl.GetChildOrNull("kernel");
+      if (kernelEl != io::xml::Element::Missing())
+      {
+        kernelName = kernelEl.GetAttributeOrThrow("value");
+      }
+
+      // Optional element, defaulting to the compile-time choice
+      // <wall_boundary value="SIMPLEBOUNCEBACK|BFL|GZS" />
+      const io::xml::Element wallEl = simEl.GetChildOrNull("wall_boundary");
+      if (wallEl != io::xml::Element::Missing())
+      {
+        wallBoundaryName = wallEl.GetAttributeOrThrow("value");
+      }
     }
 
     void SimConfig::DoIOForGeometry(const io::xml::Element geometryEl)
@@ -185,34 +226,24 @@ namespace hemelb
     }
 
     /**
-     * Helper function to ensure that the iolet being created matches the compiled
-     * iolet BC.
+     * Helper function to record the boundary condition needed by the iolet
+     * being created. All iolets share one streamer so they must agree.
      * @param ioletEl
      * @param requiredBC
      */
-    void SimConfig::CheckIoletMatchesCMake(const io::xml::Element& ioletEl,
-                                           const std::string& requiredBC)
+    void SimConfig::CheckIoletBoundary(const io::xml::Element& ioletEl,
+                                       const std::string& requiredBC)
     {
-      // Check that HEMELB_*LET_BOUNDARY is consistent with this
-      const std::string& ioletTypeName = ioletEl.GetName();
-      std::string hemeIoletBC;
-
-#define QUOTE_RAW(x) #x
-#define QUOTE_CONTENTS(x) QUOTE_RAW(x)
-      if (ioletTypeName == "inlet")
-        hemeIoletBC = QUOTE_CONTENTS(HEMELB_INLET_BOUNDARY);
-      else if (ioletTypeName == "outlet")
-        hemeIoletBC = QUOTE_CONTENTS(HEMELB_OUTLET_BOUNDARY);
-      else
-        throw Exception() << "Unexpected element name '" << ioletTypeName
-            << "'. Expected 'inlet' or 'outlet'";
-
-      if (requiredBC != hemeIoletBC)
+      if (ioletBoundaryName.empty())
       {
-        throw Exception() << "XML configuration for " << ioletTypeName << " (line "
-            << ioletEl.GetLine()
-            << ") not consistent with compile-time choice of boundary condition '" << hemeIoletBC
-            << "'";
+        ioletBoundaryName = requiredBC;
+      }
+      else if (requiredBC != ioletBoundaryName)
+      {
+        throw Exception() << "XML configuration for " << ioletEl.GetName() << " (line "
+            << ioletEl.GetLine() << ") needs boundary condition '" << requiredBC
+            << "' but other iolets use '" << ioletBoundaryName
+            << "'; all inlets and outlets must use the same boundary condition";
       }
     }
 
@@ -252,7 +283,7 @@ namespace hemelb
 
     lb::iolets::InOutLet* SimConfig::DoIOForPressureInOutlet(const io::xml::Element& ioletEl)
     {
-      CheckIoletMatchesCMake(ioletEl, "NASHZEROTHORDERPRESSUREIOLET");
+      CheckIoletBoundary(ioletEl, "NASHZEROTHORDERPRESSUREIOLET");
       io::xml::Element conditionEl = ioletEl.GetChildOrThrow("condition");
       const std::string& conditionSubtype = conditionEl.GetAttributeOrThrow("subtype");
 
@@ -280,7 +311,7 @@ namespace hemelb
 
     lb::iolets::InOutLet* SimConfig::DoIOForVelocityInOutlet(const io::xml::Element& ioletEl)
     {
-      CheckIoletMatchesCMake(ioletEl, "LADDIOLET");
+      CheckIoletBoundary(ioletEl, "LADDIOLET");
       io::xml::Element conditionEl = ioletEl.GetChildOrThrow("condition");
       const std::string& conditionSubtype = conditionEl.GetAttributeOrThrow("subtype");
 
@@ -331,6 +362,15 @@ namespace hemelb
       {
         propertyOutputs.push_back(DoIOForPropertyOutputFile(*poPtr));
       }
+
+      // Optional element <reductionoutput file="..." period="..." />
+      const io::xml::Element reductionEl = propertiesEl.GetChildOrNull("reductionoutput");
+      if (reductionEl != io::xml::Element::Missing())
+      {
+        reductionOutput = new extraction::ReductionOutputFile();
+        reductionOutput->filename = reductionEl.GetAttributeOrThrow("file");
+        reductionEl.GetAttributeOrThrow("period", reductionOutput->frequency);
+      }
     }
 
     extraction::PropertyOutputFile* SimConfig::DoIOForPropertyOutputFile(
@@ -341,6 +381,67 @@ namespace hemelb
 
       propertyoutputEl.GetAttributeOrThrow("period", file->frequency);
 
+      // The number of writes to this file that may be in progress at once.
+      propertyoutputEl.GetAttributeOrNull("buffers", file->bufferCount);
+      if (file->bufferCount == 0)
+      {
+        throw Exception() << "Property output needs at least one buffer, in element "
+            << propertyoutputEl.GetPath();
+      }
+
+      // Whether the sites' coordinates are written in each record or once, after
+      // the headers.
+      const std::string* coordinates = propertyoutputEl.GetAttributeOrNull("coordinates");
+      if (coordinates != NULL)
+      {
+        if (*coordinates == "header")
+        {
+          file->staticGeometry = true;
+        }
+        else if (*coordinates != "record")
+        {
+          throw Exception() << "Unrecognised property output coordinates '" << *coordinates
+              << "' in element " << propertyoutputEl.GetPath();
+        }
+      }
+
+      // Whether to compress the records; their coordinates are then written once.
+      const std::string* compression = propertyoutputEl.GetAttributeOrNull("compression");
+      if (compression != NULL)
+      {
+        if (*compression == "zlib")
+        {
+          file->compressed = true;
+          file->staticGeometry = true;
+        }
+        else if (*compression != "none")
+        {
+          throw Exception() << "Unrecognised property output compression '" << *compression
+              << "' in element " << propertyoutputEl.GetPath();
+        }
+      }
+
+      // How many cores do the writing, gathering the others' parts; by default,
+      // every core writes its own.
+      propertyoutputEl.GetAttributeOrNull("aggregators", file->aggregatorCount);
+
+      // The size of the blocks to average the sites' values over, along each axis;
+      // by default, each site is written.
+      propertyoutputEl.GetAttributeOrNull("coarsen", file->coarsening);
+      if (file->coarsening == 0)
+      {
+        throw Exception() << "Property output coarsening must be positive, in element "
+            << propertyoutputEl.GetPath();
+      }
+
+      // How often to sample any fields written as statistics over time.
+      propertyoutputEl.GetAttributeOrNull("sampleperiod", file->samplingPeriod);
+      if (file->samplingPeriod == 0)
+      {
+        throw Exception() << "Property output sampling period must be positive, in element "
+            << propertyoutputEl.GetPath();
+      }
+
       io::xml::Element geometryEl = propertyoutputEl.GetChildOrThrow("geometry");
       const std::string& type = geometryEl.GetAttributeOrThrow("type");
 
@@ -364,6 +465,10 @@ namespace hemelb
       {
         file->geometry = DoIOForSurfacePoint(geometryEl);
       }
+      else if (type == "strided")
+      {
+        file->geometry = DoIOForStridedGeometry(geometryEl);
+      }
       else
       {
         throw Exception() << "Unrecognised property output geometry selector '" << type
@@ -392,6 +497,19 @@ namespace hemelb
       return new extraction::StraightLineGeometrySelector(point1, point2);
     }
 
+    extraction::StridedGeometrySelector* SimConfig::DoIOForStridedGeometry(
+        const io::xml::Element& geometryEl)
+    {
+      unsigned stride;
+      geometryEl.GetAttributeOrThrow("stride", stride);
+      if (stride == 0)
+      {
+        throw Exception() << "Strided geometry selector needs a positive stride, in element "
+            << geometryEl.GetPath();
+      }
+      return new extraction::StridedGeometrySelector(stride);
+    }
+
     extraction::PlaneGeometrySelector* SimConfig::DoIOForPlaneGeometry(
         const io::xml::Element& geometryEl)
     {
@@ -486,6 +604,85 @@ namespace hemelb
       {
         throw Exception() << "Unrecognised field type '" << type << "' in " << fieldEl.GetPath();
       }
+
+      // Optionally, a statistic of the field over time rather than its value.
+      const std::string* statistic = fieldEl.GetAttributeOrNull("statistic");
+      if (statistic != NULL)
+      {
+        if (*statistic == "mean")
+        {
+          field.statistic = extraction::OutputField::Mean;
+        }
+        else if (*statistic == "rms")
+        {
+          field.statistic = extraction::OutputField::RootMeanSquare;
+        }
+        else if (*statistic == "min")
+        {
+          field.statistic = extraction::OutputField::Minimum;
+        }
+        else if (*statistic == "max")
+        {
+          field.statistic = extraction::OutputField::Maximum;
+        }
+        else if (*statistic == "tawss")
+        {
+          field.statistic = extraction::OutputField::TimeAveragedMagnitude;
+        }
+        else if (*statistic == "osi")
+        {
+          field.statistic = extraction::OutputField::OscillatoryIndex;
+        }
+        else
+        {
+          throw Exception() << "Unrecognised field statistic '" << *statistic << "' in "
+              << fieldEl.GetPath();
+        }
+
+        // TAWSS and OSI are of the wall shear stress vector.
+        if ( (field.statistic == extraction::OutputField::TimeAveragedMagnitude
+            || field.statistic == extraction::OutputField::OscillatoryIndex)
+            && field.type != extraction::OutputField::TangentialProjectionTraction)
+        {
+          throw Exception() << "Field statistic '" << *statistic
+              << "' needs the type 'tangentialprojectiontraction' in " << fieldEl.GetPath();
+        }
+        if (field.type == extraction::OutputField::MpiRank)
+        {
+          throw Exception() << "The MPI rank doesn't have statistics, in " << fieldEl.GetPath();
+        }
+      }
+
+      // Optionally, write the values in two bytes rather than four.
+      const std::string* quantisation = fieldEl.GetAttributeOrNull("quantisation");
+      if (quantisation != NULL)
+      {
+        if (*quantisation == "half")
+        {
+          field.quantisation = extraction::OutputField::HalfPrecision;
+        }
+        else if (*quantisation == "fixed")
+        {
+          field.quantisation = extraction::OutputField::FixedPoint;
+          fieldEl.GetAttributeOrThrow("errorbound", field.errorBound);
+          if (! (field.errorBound > 0))
+          {
+            throw Exception() << "Fixed point quantisation needs a positive error bound, in "
+                << fieldEl.GetPath();
+          }
+        }
+        else if (*quantisation != "none")
+        {
+          throw Exception() << "Unrecognised field quantisation '" << *quantisation << "' in "
+              << fieldEl.GetPath();
+        }
+
+        if (field.type == extraction::OutputField::MpiRank
+            && field.quantisation != extraction::OutputField::NoQuantisation)
+        {
+          throw Exception() << "The MPI rank can't be quantised, in " << fieldEl.GetPath();
+        }
+      }
       return field;
     }
 
@@ -718,5 +915,59 @@ namespace hemelb
     {
       return gpuBlockSize;
     }
+
+    bool SimConfig::UseInPlaceStreaming() const
+    {
+      return inPlaceStreaming;
+    }
+
+    geometry::SiteOrdering SimConfig::GetSiteOrdering() const
+    {
+      return siteOrdering;
+    }
+
+    const std::string& SimConfig::GetKernelName() const
+    {
+      return kernelName;
+    }
+
+    const std::string& SimConfig::GetWallBoundaryName() const
+    {
+      return wallBoundaryName;
+    }
+
+    std::string SimConfig::GetStreamerName() const
+    {
+      const std::string ioletBC = ioletBoundaryName.empty() ?
+        QUOTE_CONTENTS(HEMELB_INLET_BOUNDARY) :
+        ioletBoundaryName;
+
+      // Keep the compile-time streamer (which may be one, like
+      // VIRTUALSITEIOLETSBB, not named after a wall/iolet pair) unless the
+      // configuration asks for something else.
+      if (wallBoundaryName == QUOTE_CONTENTS(HEMELB_WALL_BOUNDARY)
+          && ioletBC == QUOTE_CONTENTS(HEMELB_INLET_BOUNDARY))
+      {
+        return QUOTE_CONTENTS(HEMELB_WALL_INLET_BOUNDARY);
+      }
+
+      std::string streamerName;
+      if (ioletBC == "NASHZEROTHORDERPRESSUREIOLET")
+        streamerName = "NASHZEROTHORDERPRESSURE";
+      else if (ioletBC == "LADDIOLET")
+        streamerName = "LADDIOLET";
+      else
+        throw Exception() << "No streamer for iolet boundary condition '" << ioletBC << "'";
+
+      if (wallBoundaryName == "SIMPLEBOUNCEBACK")
+        streamerName += "SBB";
+      else if (wallBoundaryName == "BFL" || wallBoundaryName == "GZS")
+        streamerName += wallBoundaryName;
+      else
+        throw Exception() << "No streamer for wall boundary condition '" << wallBoundaryName
+            << "' with iolet boundary condition '" << ioletBC << "'";
+
+      return streamerName;
+    }
   }
 }
@@ -12,7 +12,9 @@
 #include "lb/LbmParameters.h"
 #include "lb/iolets/InOutLets.h"
 #include "extraction/PropertyOutputFile.h"
+#include "extraction/ReductionOutputFile.h"
 #include "extraction/GeometrySelectors.h"
+#include "geometry/SiteOrdering.h"
 #include "io/xml/XmlAbstractionLayer.h"
 
 namespace hemelb
@@ -141,6 +143,14 @@ namespace hemelb
         {
           return propertyOutputs;
         }
+        /**
+         * The quantities to reduce over the domain and write, or NULL if none.
+         * @return
+         */
+        extraction::ReductionOutputFile* GetReductionOutput() const
+        {
+          return reductionOutput;
+        }
         const std::string GetColloidConfigPath() const
         {
           return colloidConfigPath;
@@ -169,6 +179,43 @@ namespace hemelb
 
         int GPUBlockSize() const;
 
+        /**
+         * Whether to stream the distributions in place, in a single array,
+         * rather than between two (see geometry::LatticeData::IsInPlaceStreaming).
+         * @return
+         */
+        bool UseInPlaceStreaming() const;
+
+        /**
+         * The order in which to number each rank's sites within a collision type
+         * (see geometry::SiteOrdering).
+         * @return
+         */
+        geometry::SiteOrdering GetSiteOrdering() const;
+
+        /**
+         * The collision kernel to use, as named in lb/BuildSystemInterface.h.
+         * Defaults to the compile-time HEMELB_KERNEL.
+         * @return kernel name
+         */
+        const std::string& GetKernelName() const;
+
+        /**
+         * The wall boundary condition to use (SIMPLEBOUNCEBACK, BFL, GZS, ...).
+         * Defaults to the compile-time HEMELB_WALL_BOUNDARY.
+         * @return wall boundary condition name
+         */
+        const std::string& GetWallBoundaryName() const;
+
+        /**
+         * The streamer, i.e. the combination of wall and iolet boundary
+         * conditions, as named in lb/BuildSystemInterface.h. If neither the
+         * wall nor the iolet condition differs from the compile-time choice,
+         * this is HEMELB_WALL_INLET_BOUNDARY.
+         * @return streamer name
+         */
+        std::string GetStreamerName() const;
+
       protected:
         /**
          * Create the unit converter - virtual so that mocks can override it.
@@ -176,12 +223,13 @@ namespace hemelb
         virtual void CreateUnitConverter();
 
         /**
-         * Check that the iolet is OK for the CMake configuration.
+         * Record the boundary condition needed by the iolet, checking that it
+         * matches that of the iolets already read.
          * @param ioletEl
          * @param requiredBC
          */
-        virtual void CheckIoletMatchesCMake(const io::xml::Element& ioletEl,
-                                            const std::string& requiredBC);
+        virtual void CheckIoletBoundary(const io::xml::Element& ioletEl,
+                                        const std::string& requiredBC);
 
         template<typename T>
         void GetDimensionalValueInLatticeUnits(const io::xml::Element& elem,
@@ -246,6 +294,7 @@ namespace hemelb
             const io::xml::Element& xmlNode);
         extraction::PlaneGeometrySelector* DoIOForPlaneGeometry(const io::xml::Element&);
         extraction::SurfacePointSelector* DoIOForSurfacePoint(const io::xml::Element&);
+        extraction::StridedGeometrySelector* DoIOForStridedGeometry(const io::xml::Element&);
 
         void DoIOForInitialConditions(io::xml::Element parent);
         void DoIOForVisualisation(const io::xml::Element& visEl);
@@ -284,6 +333,7 @@ namespace hemelb
         float maxStress;
         lb::StressTypes stressType;
         std::vector<extraction::PropertyOutputFile*> propertyOutputs;
+        extraction::ReductionOutputFile* reductionOutput;
         std::string colloidConfigPath;
         /**
          * True if the file has a colloids section.
@@ -293,6 +343,11 @@ namespace hemelb
         MonitoringConfig monitoringConfig; ///< Configuration of various checks/tests
         bool useGPU;
         int gpuBlockSize;
+        bool inPlaceStreaming;
+        geometry::SiteOrdering siteOrdering;
+        std::string kernelName;
+        std::string wallBoundaryName;
+        std::string ioletBoundaryName; ///< Empty until an iolet has been read
 
       protected:
         // These have to contain pointers because there are multiple derived types that might be
@@ -0,0 +1,269 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#include <algorithm>
+#include <map>
+#include "extraction/BlockAverager.h"
+#include "Exception.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    namespace
+    {
+      // Blocks are identified by their position, packed into one integer so every
+      // core sorts and hashes them the same way.
+      const unsigned BlockKeyBits = 21;
+
+      uint64_t GetBlockKey(const util::Vector3D<site_t>& block)
+      {
+        const site_t limit = site_t(1) << BlockKeyBits;
+        if (block.x < 0 || block.y < 0 || block.z < 0 || block.x >= limit || block.y >= limit
+            || block.z >= limit)
+        {
+          throw Exception() << "Block " << block << " is outside the range for block averaging";
+        }
+        return (uint64_t(block.x) << (2 * BlockKeyBits)) | (uint64_t(block.y) << BlockKeyBits)
+            | uint64_t(block.z);
+      }
+
+      util::Vector3D<site_t> GetBlockPosition(const uint64_t key)
+      {
+        const uint64_t mask = (uint64_t(1) << BlockKeyBits) - 1;
+        return util::Vector3D<site_t>(site_t(key >> (2 * BlockKeyBits)),
+                                      site_t( (key >> BlockKeyBits) & mask),
+                                      site_t(key & mask));
+      }
+
+      // The core that finds a block's owner. Neighbouring blocks go to different
+      // cores, to spread the work of finding them.
+      int GetBlockRendezvous(const uint64_t key, const int coreCount)
+      {
+        return int( ( (key * 0x9E3779B97F4A7C15ULL) >> 32) % uint64_t(coreCount));
+      }
+    }
+
+    BlockAverager::BlockAverager(site_t blockSize,
+                                 const std::vector<util::Vector3D<site_t> >& sitePositions,
+                                 const net::MpiCommunicator& comms) :
+      comms(comms.Duplicate())
+    {
+      // Setting up is collective, over the given communicator; averaging is over a
+      // duplicate of it, so its messages can't be confused with any others.
+      const int coreCount = comms.Size();
+      const int rank = comms.Rank();
+
+      // Find the blocks this core has sites in, and how many.
+      std::vector<uint64_t> siteKeys(sitePositions.size());
+      std::map<uint64_t, uint64_t> localSiteCounts;
+      for (size_t site = 0; site < sitePositions.size(); ++site)
+      {
+        const util::Vector3D<site_t>& position = sitePositions[site];
+        siteKeys[site] = GetBlockKey(util::Vector3D<site_t>(position.x / blockSize,
+                                                            position.y / blockSize,
+                                                            position.z / blockSize));
+        ++localSiteCounts[siteKeys[site]];
+      }
+
+      // Each block's owner is the lowest ranked core with sites in it. To find it,
+      // each core tells the block's rendezvous core it has sites there, and how
+      // many, which replies with the owner and the block's site count over all
+      // cores.
+      std::vector<std::pair<int, uint64_t> > rendezvousBlocks;
+      for (std::map<uint64_t, uint64_t>::const_iterator block = localSiteCounts.begin();
+          block != localSiteCounts.end(); ++block)
+      {
+        rendezvousBlocks.push_back(std::make_pair(GetBlockRendezvous(block->first, coreCount),
+                                                  block->first));
+      }
+      std::sort(rendezvousBlocks.begin(), rendezvousBlocks.end());
+
+      std::vector<int> sendCounts(coreCount, 0);
+      std::vector<uint64_t> sentKeys, sentSiteCounts;
+      for (size_t block = 0; block < rendezvousBlocks.size(); ++block)
+      {
+        ++sendCounts[rendezvousBlocks[block].first];
+        sentKeys.push_back(rendezvousBlocks[block].second);
+        sentSiteCounts.push_back(localSiteCounts[rendezvousBlocks[block].second]);
+      }
+      std::vector<int> receiveCounts = comms.AllToAll(sendCounts);
+      std::vector<uint64_t> receivedKeys = comms.AllToAllV(sentKeys, sendCounts, receiveCounts);
+      const std::vector<uint64_t> receivedSiteCounts = comms.AllToAllV(sentSiteCounts,
+                                                                       sendCounts,
+                                                                       receiveCounts);
+
+      // Cores' blocks arrive in rank order, so the first core to send a block is its
+      // owner.
+      std::map<uint64_t, uint64_t> rendezvousOwners, rendezvousSiteCounts;
+      size_t received = 0;
+      for (int core = 0; core < coreCount; ++core)
+      {
+        for (int block = 0; block < receiveCounts[core]; ++block, ++received)
+        {
+          rendezvousOwners.insert(std::make_pair(receivedKeys[received], uint64_t(core)));
+          rendezvousSiteCounts[receivedKeys[received]] += receivedSiteCounts[received];
+        }
+      }
+      std::vector<uint64_t> replyOwners(receivedKeys.size()), replySiteCounts(receivedKeys.size());
+      for (received = 0; received < receivedKeys.size(); ++received)
+      {
+        replyOwners[received] = rendezvousOwners[receivedKeys[received]];
+        replySiteCounts[received] = rendezvousSiteCounts[receivedKeys[received]];
+      }
+      const std::vector<uint64_t> owners = comms.AllToAllV(replyOwners, receiveCounts, sendCounts);
+      const std::vector<uint64_t> siteCounts = comms.AllToAllV(replySiteCounts,
+                                                               receiveCounts,
+                                                               sendCounts);
+
+      // Order this core's blocks by their owner, so the sums for each are together,
+      // and the blocks it owns are in the same order as their averages.
+      std::vector<std::pair<uint64_t, uint64_t> > localBlocks(sentKeys.size());
+      std::map<uint64_t, uint64_t> allSiteCounts;
+      for (size_t block = 0; block < sentKeys.size(); ++block)
+      {
+        localBlocks[block] = std::make_pair(owners[block], sentKeys[block]);
+        allSiteCounts[sentKeys[block]] = siteCounts[block];
+      }
+      std::sort(localBlocks.begin(), localBlocks.end());
+      localBlockCount = localBlocks.size();
+
+      std::map<uint64_t, size_t> localBlockIndices;
+      std::fill(sendCounts.begin(), sendCounts.end(), 0);
+      std::vector<uint64_t> keysToOwners;
+      ownedBlocksStart = localBlockCount;
+      for (size_t block = 0; block < localBlockCount; ++block)
+      {
+        const int owner = int(localBlocks[block].first);
+        const uint64_t key = localBlocks[block].second;
+        localBlockIndices[key] = block;
+        if (owner == rank)
+        {
+          ownedBlocksStart = std::min(ownedBlocksStart, block);
+          blockPositions.push_back(GetBlockPosition(key));
+          blockSiteCounts.push_back(allSiteCounts[key]);
+          continue;
+        }
+
+        if (sendCounts[owner] == 0)
+        {
+          sendRanks.push_back(owner);
+          sendBlockStarts.push_back(block);
+        }
+        ++sendCounts[owner];
+        keysToOwners.push_back(key);
+      }
+      for (size_t sendRank = 0; sendRank < sendRanks.size(); ++sendRank)
+      {
+        sendBlockCounts.push_back(sendCounts[sendRanks[sendRank]]);
+      }
+
+      siteBlocks.resize(sitePositions.size());
+      for (size_t site = 0; site < sitePositions.size(); ++site)
+      {
+        siteBlocks[site] = localBlockIndices[siteKeys[site]];
+      }
+
+      // Tell each owner which of its blocks this core will send the sums for, so
+      // that from now on the sums only go between the cores sharing blocks.
+      receiveCounts = comms.AllToAll(sendCounts);
+      receivedKeys = comms.AllToAllV(keysToOwners, sendCounts, receiveCounts);
+
+      std::map<uint64_t, size_t> ownedBlockIndices;
+      for (size_t block = 0; block < blockPositions.size(); ++block)
+      {
+        ownedBlockIndices[localBlocks[ownedBlocksStart + block].second] = block;
+      }
+      received = 0;
+      for (int core = 0; core < coreCount; ++core)
+      {
+        if (receiveCounts[core] == 0)
+        {
+          continue;
+        }
+        receiveRanks.push_back(core);
+        receiveBlockStarts.push_back(received);
+        receiveBlockCounts.push_back(receiveCounts[core]);
+        for (int block = 0; block < receiveCounts[core]; ++block, ++received)
+        {
+          receivedBlocks.push_back(ownedBlockIndices[receivedKeys[received]]);
+        }
+      }
+      requests.resize(sendRanks.size() + receiveRanks.size());
+    }
+
+    const std::vector<util::Vector3D<site_t> >& BlockAverager::GetBlockPositions() const
+    {
+      return blockPositions;
+    }
+
+    void BlockAverager::Average(const std::vector<FloatingType>& siteValues, unsigned length,
+                                std::vector<FloatingType>& blockValues)
+    {
+      // Sum this core's values in each block...
+      localSums.assign(localBlockCount * length, 0);
+      for (size_t site = 0; site < siteBlocks.size(); ++site)
+      {
+        for (unsigned component = 0; component < length; ++component)
+        {
+          localSums[siteBlocks[site] * length + component] += siteValues[site * length
+              + component];
+        }
+      }
+
+      // ...send the sums to each block's owner...
+      const int tag = 0;
+      receivedSums.resize(receivedBlocks.size() * length);
+      for (size_t receiveRank = 0; receiveRank < receiveRanks.size(); ++receiveRank)
+      {
+        HEMELB_MPI_CALL(MPI_Irecv,
+                        (&receivedSums[receiveBlockStarts[receiveRank] * length],
+                            int(receiveBlockCounts[receiveRank] * length),
+                            net::MpiDataType<FloatingType>(),
+                            receiveRanks[receiveRank],
+                            tag,
+                            comms,
+                            &requests[receiveRank]));
+      }
+      for (size_t sendRank = 0; sendRank < sendRanks.size(); ++sendRank)
+      {
+        HEMELB_MPI_CALL(MPI_Isend,
+                        (&localSums[sendBlockStarts[sendRank] * length],
+                            int(sendBlockCounts[sendRank] * length),
+                            net::MpiDataType<FloatingType>(),
+                            sendRanks[sendRank],
+                            tag,
+                            comms,
+                            &requests[receiveRanks.size() + sendRank]));
+      }
+
+      // ...which starts with its own...
+      blockValues.assign(localSums.begin() + ownedBlocksStart * length,
+                         localSums.begin() + (ownedBlocksStart + blockPositions.size()) * length);
+
+      // ...then adds up the others' and averages.
+      if (!requests.empty())
+      {
+        HEMELB_MPI_CALL(MPI_Waitall, (int(requests.size()), &requests[0], MPI_STATUSES_IGNORE));
+      }
+      for (size_t received = 0; received < receivedBlocks.size(); ++received)
+      {
+        for (unsigned component = 0; component < length; ++component)
+        {
+          blockValues[receivedBlocks[received] * length + component] += receivedSums[received
+              * length + component];
+        }
+      }
+      for (size_t block = 0; block < blockPositions.size(); ++block)
+      {
+        for (unsigned component = 0; component < length; ++component)
+        {
+          blockValues[block * length + component] /= FloatingType(blockSiteCounts[block]);
+        }
+      }
+    }
+  }
+}
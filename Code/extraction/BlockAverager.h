@@ -0,0 +1,121 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_EXTRACTION_BLOCKAVERAGER_H
+#define HEMELB_EXTRACTION_BLOCKAVERAGER_H
+
+#include <vector>
+#include "extraction/IterableDataSource.h"
+#include "net/mpi.h"
+#include "units.h"
+#include "util/Vector3D.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    /**
+     * Averages values at sites over cubic blocks of the lattice, for coarsened
+     * property output.
+     *
+     * A block's sites may be spread over several cores. Each block is owned by the
+     * lowest ranked core with sites in it. Each core sums the values at its own
+     * sites in each block, and sends the sums only to the block's owner, which adds
+     * them up and divides by the block's site count. Which cores share blocks
+     * doesn't change, so that is found once, and each average only takes messages
+     * between them.
+     */
+    class BlockAverager
+    {
+      public:
+        /**
+         * Sets up averaging the values at the given sites on this core over blocks of
+         * blockSize sites along each axis. Collective.
+         * @param blockSize
+         * @param sitePositions
+         * @param comms
+         */
+        BlockAverager(site_t blockSize,
+                      const std::vector<util::Vector3D<site_t> >& sitePositions,
+                      const net::MpiCommunicator& comms);
+
+        /**
+         * Returns the position, in blocks, of each block this core owns, in the order
+         * of their averages.
+         * @return
+         */
+        const std::vector<util::Vector3D<site_t> >& GetBlockPositions() const;
+
+        /**
+         * Averages the values at this core's sites, length values per site in the
+         * order of the sites given on construction, over each block this core owns.
+         * Exchanges sums only with the cores this one shares blocks with, which
+         * must call it too.
+         * @param siteValues
+         * @param length
+         * @param blockValues
+         */
+        void Average(const std::vector<FloatingType>& siteValues, unsigned length,
+                     std::vector<FloatingType>& blockValues);
+
+      private:
+        /**
+         * A duplicate of the communicator given, for the sums.
+         */
+        net::MpiCommunicator comms;
+
+        /**
+         * For each of this core's sites, the index of its block among those this
+         * core has sites in, which are in order of their owners.
+         */
+        std::vector<size_t> siteBlocks;
+
+        /**
+         * The number of blocks this core has sites in, and the index among them of
+         * the first it owns.
+         */
+        size_t localBlockCount;
+        size_t ownedBlocksStart;
+
+        /**
+         * The cores this core sends sums to, and for each, the index of the first
+         * block sent and the number of blocks.
+         */
+        std::vector<int> sendRanks;
+        std::vector<size_t> sendBlockStarts;
+        std::vector<size_t> sendBlockCounts;
+
+        /**
+         * The cores this core receives sums from, and for each, the index of the
+         * first block received and the number of blocks.
+         */
+        std::vector<int> receiveRanks;
+        std::vector<size_t> receiveBlockStarts;
+        std::vector<size_t> receiveBlockCounts;
+
+        /**
+         * For each block's sums received, the index of the block among those this
+         * core owns.
+         */
+        std::vector<size_t> receivedBlocks;
+
+        /**
+         * The blocks this core owns, and the number of sites in each, over all cores.
+         */
+        std::vector<util::Vector3D<site_t> > blockPositions;
+        std::vector<uint64_t> blockSiteCounts;
+
+        /**
+         * Scratch space for the sums sent and received, and their requests.
+         */
+        std::vector<FloatingType> localSums;
+        std::vector<FloatingType> receivedSums;
+        std::vector<MPI_Request> requests;
+    };
+  }
+}
+
+#endif /* HEMELB_EXTRACTION_BLOCKAVERAGER_H */
@@ -0,0 +1,199 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include "extraction/FieldStatistics.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    FieldStatistics::FieldStatistics(OutputField::StatisticType statistic, unsigned fieldLength,
+                                     size_t siteCount) :
+        statistic(statistic), fieldLength(fieldLength), siteCount(siteCount), sampleCount(0)
+    {
+      assert(statistic != OutputField::Instantaneous);
+      switch (statistic)
+      {
+        case OutputField::TimeAveragedMagnitude:
+          accumulated.resize(siteCount);
+          break;
+        case OutputField::OscillatoryIndex:
+          accumulated.resize(siteCount * (fieldLength + 1));
+          break;
+        default:
+          accumulated.resize(siteCount * fieldLength);
+          break;
+      }
+      Reset();
+    }
+
+    bool FieldStatistics::KeepsOffset(OutputField::StatisticType statistic)
+    {
+      switch (statistic)
+      {
+        case OutputField::Instantaneous:
+        case OutputField::Mean:
+        case OutputField::Minimum:
+        case OutputField::Maximum:
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    unsigned FieldStatistics::GetResultLength(OutputField::StatisticType statistic,
+                                              unsigned fieldLength)
+    {
+      switch (statistic)
+      {
+        case OutputField::TimeAveragedMagnitude:
+        case OutputField::OscillatoryIndex:
+          return 1;
+        default:
+          return fieldLength;
+      }
+    }
+
+    unsigned FieldStatistics::GetResultLength() const
+    {
+      return GetResultLength(statistic, fieldLength);
+    }
+
+    unsigned long FieldStatistics::GetSampleCount() const
+    {
+      return sampleCount;
+    }
+
+    void FieldStatistics::Reset()
+    {
+      sampleCount = 0;
+      switch (statistic)
+      {
+        case OutputField::Minimum:
+          std::fill(accumulated.begin(), accumulated.end(), std::numeric_limits<FloatingType>::max());
+          break;
+        case OutputField::Maximum:
+          std::fill(accumulated.begin(), accumulated.end(), -std::numeric_limits<FloatingType>::max());
+          break;
+        default:
+          std::fill(accumulated.begin(), accumulated.end(), FloatingType(0));
+          break;
+      }
+    }
+
+    FloatingType FieldStatistics::GetMagnitude(const FloatingType* values) const
+    {
+      FloatingType squared = 0;
+      for (unsigned component = 0; component < fieldLength; ++component)
+      {
+        squared += values[component] * values[component];
+      }
+      return std::sqrt(squared);
+    }
+
+    void FieldStatistics::Accumulate(const std::vector<FloatingType>& values)
+    {
+      assert(values.size() == siteCount * fieldLength);
+      ++sampleCount;
+
+      switch (statistic)
+      {
+        case OutputField::Mean:
+          for (size_t index = 0; index < accumulated.size(); ++index)
+          {
+            accumulated[index] += values[index];
+          }
+          break;
+        case OutputField::RootMeanSquare:
+          for (size_t index = 0; index < accumulated.size(); ++index)
+          {
+            accumulated[index] += values[index] * values[index];
+          }
+          break;
+        case OutputField::Minimum:
+          for (size_t index = 0; index < accumulated.size(); ++index)
+          {
+            accumulated[index] = std::min(accumulated[index], values[index]);
+          }
+          break;
+        case OutputField::Maximum:
+          for (size_t index = 0; index < accumulated.size(); ++index)
+          {
+            accumulated[index] = std::max(accumulated[index], values[index]);
+          }
+          break;
+        case OutputField::TimeAveragedMagnitude:
+          for (size_t site = 0; site < siteCount; ++site)
+          {
+            accumulated[site] += GetMagnitude(&values[site * fieldLength]);
+          }
+          break;
+        case OutputField::OscillatoryIndex:
+          for (size_t site = 0; site < siteCount; ++site)
+          {
+            const FloatingType* siteValues = &values[site * fieldLength];
+            FloatingType* siteAccumulated = &accumulated[site * (fieldLength + 1)];
+            for (unsigned component = 0; component < fieldLength; ++component)
+            {
+              siteAccumulated[component] += siteValues[component];
+            }
+            siteAccumulated[fieldLength] += GetMagnitude(siteValues);
+          }
+          break;
+        default:
+          assert(false);
+      }
+    }
+
+    void FieldStatistics::GetResults(std::vector<FloatingType>& results) const
+    {
+      results.resize(siteCount * GetResultLength());
+      if (sampleCount == 0)
+      {
+        std::fill(results.begin(), results.end(), FloatingType(0));
+        return;
+      }
+
+      switch (statistic)
+      {
+        case OutputField::Mean:
+        case OutputField::TimeAveragedMagnitude:
+          for (size_t index = 0; index < results.size(); ++index)
+          {
+            results[index] = accumulated[index] / sampleCount;
+          }
+          break;
+        case OutputField::RootMeanSquare:
+          for (size_t index = 0; index < results.size(); ++index)
+          {
+            results[index] = std::sqrt(accumulated[index] / sampleCount);
+          }
+          break;
+        case OutputField::Minimum:
+        case OutputField::Maximum:
+          std::copy(accumulated.begin(), accumulated.end(), results.begin());
+          break;
+        case OutputField::OscillatoryIndex:
+          for (size_t site = 0; site < siteCount; ++site)
+          {
+            const FloatingType* siteAccumulated = &accumulated[site * (fieldLength + 1)];
+            const FloatingType sumOfMagnitudes = siteAccumulated[fieldLength];
+            // With no shear stress at all, it can't be said to oscillate.
+            results[site] = sumOfMagnitudes > 0 ?
+              0.5 * (1. - GetMagnitude(siteAccumulated) / sumOfMagnitudes) :
+              0.;
+          }
+          break;
+        default:
+          assert(false);
+      }
+    }
+  }
+}
@@ -0,0 +1,107 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_EXTRACTION_FIELDSTATISTICS_H
+#define HEMELB_EXTRACTION_FIELDSTATISTICS_H
+
+#include <vector>
+#include "extraction/IterableDataSource.h"
+#include "extraction/OutputField.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    /**
+     * Accumulates a statistic of a field's values at a fixed set of sites, over
+     * the samples taken since it was last reset.
+     *
+     * For a field of n components, the mean, root mean square, minimum and maximum
+     * are of each component, so have n components. The time-averaged magnitude is
+     * the mean of the magnitude of the vector; of the wall shear stress, that's the
+     * TAWSS. The oscillatory index is
+     *
+     *   OSI = 1/2 (1 - |sum v| / sum |v|)
+     *
+     * which for the wall shear stress goes from 0, when it keeps its direction, to
+     * 1/2, when it spends as long in one direction as the opposite one.
+     */
+    class FieldStatistics
+    {
+      public:
+        /**
+         * @param statistic
+         * @param fieldLength the number of components of the field
+         * @param siteCount
+         */
+        FieldStatistics(OutputField::StatisticType statistic, unsigned fieldLength, size_t siteCount);
+
+        /**
+         * The number of components of the result at each site.
+         * @return
+         */
+        unsigned GetResultLength() const;
+
+        /**
+         * Whether the statistic is in the units of the field, so needs the same
+         * offset when written. The root mean square is of the offset values.
+         * @param statistic
+         * @return
+         */
+        static bool KeepsOffset(OutputField::StatisticType statistic);
+
+        /**
+         * The number of components of the statistic of a field with the given number.
+         * @param statistic
+         * @param fieldLength
+         * @return
+         */
+        static unsigned GetResultLength(OutputField::StatisticType statistic, unsigned fieldLength);
+
+        /**
+         * Adds a sample: the field's values at each site in turn, as from
+         * IterableDataSource::GetFieldValues.
+         * @param values
+         */
+        void Accumulate(const std::vector<FloatingType>& values);
+
+        /**
+         * Gets the statistic at each site in turn, over the samples so far; zero
+         * if there haven't been any.
+         * @param results
+         */
+        void GetResults(std::vector<FloatingType>& results) const;
+
+        /**
+         * Forgets the samples, to start a new window.
+         */
+        void Reset();
+
+        /**
+         * The number of samples since the last reset.
+         * @return
+         */
+        unsigned long GetSampleCount() const;
+
+      private:
+        FloatingType GetMagnitude(const FloatingType* values) const;
+
+        const OutputField::StatisticType statistic;
+        const unsigned fieldLength;
+        const size_t siteCount;
+        unsigned long sampleCount;
+
+        /**
+         * Per site, the running sum, sum of squares or extreme of each component,
+         * depending on the statistic; for the oscillatory index, the sum of the
+         * vector then of its magnitude.
+         */
+        std::vector<FloatingType> accumulated;
+    };
+  }
+}
+
+#endif /* HEMELB_EXTRACTION_FIELDSTATISTICS_H */
@@ -12,5 +12,6 @@
 #include "extraction/WholeGeometrySelector.h"
 #include "extraction/GeometrySurfaceSelector.h"
 #include "extraction/SurfacePointSelector.h"
+#include "extraction/StridedGeometrySelector.h"
 
 #endif /* HEMELB_EXTRACTION_GEOMETRYSELECTORS_H */
@@ -4,6 +4,7 @@
 // file AUTHORS. This software is provided under the terms of the
 // license in the file LICENSE.
 
+#include <cassert>
 #include "extraction/IterableDataSource.h"
 
 namespace hemelb
@@ -14,5 +15,84 @@ namespace hemelb
     {
 
     }
+
+    void IterableDataSource::GetFieldValues(OutputField::FieldType field,
+                                            const std::vector<site_t>& sites,
+                                            std::vector<FloatingType>& values)
+    {
+      values.clear();
+
+      std::vector<site_t>::const_iterator nextSite = sites.begin();
+      site_t site = 0;
+      Reset();
+      while (nextSite != sites.end() && ReadNext())
+      {
+        if (site == *nextSite)
+        {
+          AppendFieldValues(field, values);
+          ++nextSite;
+        }
+        ++site;
+      }
+    }
+
+    void IterableDataSource::AppendFieldValues(OutputField::FieldType field,
+                                               std::vector<FloatingType>& values) const
+    {
+      switch (field)
+      {
+        case OutputField::Pressure:
+          values.push_back(GetPressure());
+          break;
+        case OutputField::Velocity:
+        {
+          const util::Vector3D<FloatingType> velocity = GetVelocity();
+          values.push_back(velocity.x);
+          values.push_back(velocity.y);
+          values.push_back(velocity.z);
+          break;
+        }
+        case OutputField::VonMisesStress:
+          values.push_back(GetVonMisesStress());
+          break;
+        case OutputField::ShearStress:
+          values.push_back(GetShearStress());
+          break;
+        case OutputField::ShearRate:
+          values.push_back(GetShearRate());
+          break;
+        case OutputField::StressTensor:
+        {
+          const util::Matrix3D tensor = GetStressTensor();
+          values.push_back(tensor[0][0]);
+          values.push_back(tensor[0][1]);
+          values.push_back(tensor[0][2]);
+          values.push_back(tensor[1][1]);
+          values.push_back(tensor[1][2]);
+          values.push_back(tensor[2][2]);
+          break;
+        }
+        case OutputField::Traction:
+        {
+          const util::Vector3D<PhysicalStress> traction = GetTraction();
+          values.push_back(traction.x);
+          values.push_back(traction.y);
+          values.push_back(traction.z);
+          break;
+        }
+        case OutputField::TangentialProjectionTraction:
+        {
+          const util::Vector3D<PhysicalStress> traction = GetTangentialProjectionTraction();
+          values.push_back(traction.x);
+          values.push_back(traction.y);
+          values.push_back(traction.z);
+          break;
+        }
+        default:
+          // MpiRank is not a property of the data source, and any other field should
+          // have been added here.
+          assert(false);
+      }
+    }
   }
 }
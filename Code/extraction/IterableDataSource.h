@@ -7,6 +7,8 @@
 #ifndef HEMELB_EXTRACTION_ITERABLEDATASOURCE_H
 #define HEMELB_EXTRACTION_ITERABLEDATASOURCE_H
 
+#include <vector>
+#include "extraction/OutputField.h"
 #include "util/Vector3D.h"
 #include "units.h"
 #include "util/Matrix3D.h"
@@ -132,6 +134,32 @@ namespace hemelb
          * @return whether there is a boundary site at location
          */
         virtual bool IsWallSite(const util::Vector3D<site_t>& location) const = 0;
+
+        /**
+         * Gets the value of a field, in physical units, at each of the given sites.
+         * Sites are numbered from 0 in the order ReadNext visits them, and must be
+         * given in increasing order. The values are written site by site, vectors as
+         * x, y, z and the stress tensor as its upper triangle, row by row. Not
+         * defined for OutputField::MpiRank.
+         *
+         * This implementation reads through the whole data source; those that can
+         * get at a site directly should override it.
+         *
+         * @param field
+         * @param sites
+         * @param values
+         */
+        virtual void GetFieldValues(OutputField::FieldType field, const std::vector<site_t>& sites,
+                                    std::vector<FloatingType>& values);
+
+      protected:
+        /**
+         * Appends the value of the field at the current site to the vector, in the
+         * layout of GetFieldValues.
+         * @param field
+         * @param values
+         */
+        void AppendFieldValues(OutputField::FieldType field, std::vector<FloatingType>& values) const;
     };
   }
 }
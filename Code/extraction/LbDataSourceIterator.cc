@@ -5,6 +5,7 @@
 // license in the file LICENSE.
 
 #include "extraction/LbDataSourceIterator.h"
+#include "constants.h"
 
 namespace hemelb
 {
@@ -108,5 +109,91 @@ namespace hemelb
 
       return data.GetSite(localSiteId).IsWall();
     }
+
+    void LbDataSourceIterator::GetFieldValues(OutputField::FieldType field,
+                                              const std::vector<site_t>& sites,
+                                              std::vector<FloatingType>& values)
+    {
+      const size_t siteCount = sites.size();
+
+      // The conversions are all linear, so get their scales once rather than going
+      // through the converter for every site.
+      switch (field)
+      {
+        case OutputField::Pressure:
+        {
+          values.resize(siteCount);
+          const FloatingType scale = converter.ConvertPressureDifferenceToPhysicalUnits(1.0);
+          for (size_t i = 0; i < siteCount; ++i)
+          {
+            values[i] = REFERENCE_PRESSURE_mmHg
+                + (propertyCache.densityCache.Get(sites[i]) * Cs2 - Cs2) * scale;
+          }
+          break;
+        }
+        case OutputField::Velocity:
+        {
+          values.resize(3 * siteCount);
+          const FloatingType scale = converter.ConvertVelocityToPhysicalUnits(1.0);
+          for (size_t i = 0; i < siteCount; ++i)
+          {
+            const util::Vector3D<distribn_t>& velocity = propertyCache.velocityCache.Get(sites[i]);
+            values[3 * i] = velocity.x * scale;
+            values[3 * i + 1] = velocity.y * scale;
+            values[3 * i + 2] = velocity.z * scale;
+          }
+          break;
+        }
+        case OutputField::ShearStress:
+        case OutputField::VonMisesStress:
+        case OutputField::ShearRate:
+        {
+          const util::RefreshableCache<distribn_t>& cache =
+              field == OutputField::ShearStress ?
+                propertyCache.wallShearStressMagnitudeCache :
+                field == OutputField::VonMisesStress ?
+                  propertyCache.vonMisesStressCache :
+                  propertyCache.shearRateCache;
+          const FloatingType scale = field == OutputField::ShearRate ?
+            converter.ConvertShearRateToPhysicalUnits(1.0) :
+            converter.ConvertStressToPhysicalUnits(1.0);
+
+          values.resize(siteCount);
+          for (size_t i = 0; i < siteCount; ++i)
+          {
+            values[i] = cache.Get(sites[i]) * scale;
+          }
+          break;
+        }
+        case OutputField::TangentialProjectionTraction:
+        {
+          values.resize(3 * siteCount);
+          const FloatingType scale = converter.ConvertStressToPhysicalUnits(1.0);
+          for (size_t i = 0; i < siteCount; ++i)
+          {
+            const util::Vector3D<LatticeStress>& traction =
+                propertyCache.tangentialProjectionTractionCache.Get(sites[i]);
+            values[3 * i] = traction.x * scale;
+            values[3 * i + 1] = traction.y * scale;
+            values[3 * i + 2] = traction.z * scale;
+          }
+          break;
+        }
+        default:
+        {
+          // The stress tensor and traction are rarely written and have the
+          // reference pressure to add in; do them a site at a time.
+          const site_t iteratorPosition = position;
+          values.clear();
+          for (size_t i = 0; i < siteCount; ++i)
+          {
+            position = sites[i];
+            AppendFieldValues(field, values);
+          }
+          position = iteratorPosition;
+          break;
+        }
+      }
+    }
   }
 }
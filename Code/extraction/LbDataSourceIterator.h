@@ -134,6 +134,16 @@ namespace hemelb
          */
         bool IsWallSite(const util::Vector3D<site_t>& location) const;
 
+        /**
+         * Gets the field at the given sites straight from the property cache, whose
+         * indices are the order in which ReadNext visits the sites.
+         * @param field
+         * @param sites
+         * @param values
+         */
+        void GetFieldValues(OutputField::FieldType field, const std::vector<site_t>& sites,
+                            std::vector<FloatingType>& values);
+
 
       private:
         /**
@@ -4,160 +4,414 @@
 // file AUTHORS. This software is provided under the terms of the
 // license in the file LICENSE.
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <zlib.h>
 #include "extraction/LocalPropertyOutput.h"
+#include "Exception.h"
 #include "io/formats/formats.h"
 #include "io/formats/extraction.h"
 #include "io/writers/xdr/XdrMemWriter.h"
+#include "logging/Logger.h"
 #include "net/IOCommunicator.h"
+#include "util/HalfPrecision.h"
 #include "constants.h"
 
 namespace hemelb
 {
   namespace extraction
   {
+    namespace
+    {
+      // XDR stores everything big-endian, in multiples of four bytes. Encoding
+      // straight into the buffer avoids a call through the XDR library per value.
+      inline void EncodeUint32(const uint32_t value, char* const out)
+      {
+        out[0] = char(value >> 24);
+        out[1] = char(value >> 16);
+        out[2] = char(value >> 8);
+        out[3] = char(value);
+      }
+
+      inline void EncodeFloat(const float value, char* const out)
+      {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        EncodeUint32(bits, out);
+      }
+
+      inline void EncodeUint16(const uint16_t value, char* const out)
+      {
+        out[0] = char(value >> 8);
+        out[1] = char(value);
+      }
+
+      /**
+       * Quantises all of a field's values, less its offset, at once. The loops are
+       * kept free of calls and of anything but simple branches, so they vectorise.
+       * @return The number of values outside the fixed-point range, which are
+       * clamped to it.
+       */
+      size_t Quantise(const OutputField& field, const FloatingType offset,
+                      const std::vector<FloatingType>& values, std::vector<uint16_t>& quantised)
+      {
+        const size_t valueCount = values.size();
+        quantised.resize(valueCount);
+        size_t clampedCount = 0;
+        if (field.quantisation == OutputField::HalfPrecision)
+        {
+          for (size_t i = 0; i < valueCount; ++i)
+          {
+            quantised[i] = util::FloatToHalf(float(values[i] - offset));
+          }
+        }
+        else
+        {
+          // Rounding to the nearest step is within half a step.
+          const FloatingType inverseStep = 1.0 / (2.0 * field.errorBound);
+          for (size_t i = 0; i < valueCount; ++i)
+          {
+            FloatingType steps = (values[i] - offset) * inverseStep;
+            clampedCount += (steps < -32767.0) | (steps > 32767.0);
+            steps = steps < -32767.0 ?
+              -32767.0 :
+              (steps > 32767.0 ?
+                32767.0 :
+                steps);
+            quantised[i] = uint16_t(int16_t(std::floor(steps + 0.5)));
+          }
+        }
+        return clampedCount;
+      }
+    }
+
     LocalPropertyOutput::LocalPropertyOutput(IterableDataSource& dataSource,
                                              const PropertyOutputFile* outputSpec,
-                                             const net::IOCommunicator& ioComms) :
-      comms(ioComms), dataSource(dataSource), outputSpec(outputSpec)
+                                             const net::IOCommunicator& ioComms,
+                                             bool setUpFile) :
+      comms(ioComms), dataSource(dataSource), outputSpec(outputSpec), averager(NULL), nextBuffer(0)
     {
       // Open the file as write-only, create it if it doesn't exist, don't create if the file
       // already exists.
       outputFile = net::MpiFile::Open(comms, outputSpec->filename,
                                       MPI_MODE_WRONLY | MPI_MODE_CREATE | MPI_MODE_EXCL);
-      // Count sites on this task
-      uint64_t siteCount = 0;
+      // Find the sites on this task to write, once: the selection doesn't change.
+      std::vector<util::Vector3D<site_t> > selectedPositions;
+      site_t site = 0;
       dataSource.Reset();
       while (dataSource.ReadNext())
       {
-        if (outputSpec->geometry->Include(dataSource, dataSource.GetPosition()))
+        const util::Vector3D<site_t> position = dataSource.GetPosition();
+        if (outputSpec->geometry->Include(dataSource, position))
         {
-          ++siteCount;
+          selectedSites.push_back(site);
+          selectedPositions.push_back(position);
         }
+        ++site;
       }
+      const uint64_t siteCount = selectedSites.size();
+
+      // Coarsened, each core writes the averages over the blocks it owns, rather
+      // than its own sites' values.
+      const std::vector<util::Vector3D<site_t> >* recordPositions = &selectedPositions;
+      if (outputSpec->coarsening > 1)
+      {
+        averager = new BlockAverager(outputSpec->coarsening, selectedPositions, comms);
+        recordPositions = &averager->GetBlockPositions();
+      }
+      recordCount = recordPositions->size();
 
       // Calculate how long local writes need to be.
 
       // First get the length per-site
-      // Always have 3 uint32's for the position of a site
-      writeLength = 3 * 4;
+      // Have 3 uint32's for the position of a site, unless they're written once
+      siteRecordLength = HasCoordinateTable() ?
+        0 :
+        io::formats::extraction::SiteCoordinatesLength;
 
       // Then get add each field's length
       for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
       {
-        writeLength += sizeof(WrittenDataType)
-            * GetFieldLength(outputSpec->fields[outputNumber].type);
+        fieldOffsets.push_back(siteRecordLength);
+        siteRecordLength += GetEncodedLength(outputSpec->fields[outputNumber])
+            * GetWrittenLength(outputSpec->fields[outputNumber]);
+      }
+      // Keep each site's values a whole number of XDR units.
+      if (IsQuantised())
+      {
+        siteRecordLength = (siteRecordLength + 3) / 4 * 4;
       }
 
-      //  Now multiply by local site count
-      writeLength *= siteCount;
-
-      // The IO proc also writes the iteration number
-      if (comms.OnIORank())
+      // Fields written as statistics over time need somewhere to accumulate them.
+      for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
       {
-        writeLength += 8;
+        const OutputField& field = outputSpec->fields[outputNumber];
+        statistics.push_back(field.statistic == OutputField::Instantaneous ?
+          NULL :
+          new FieldStatistics(field.statistic, GetFieldLength(field.type), siteCount));
       }
 
-      //! @TODO: These two MPI calls can be replaced with one
+      //  Now multiply by local record count
+      writeLength = siteRecordLength * recordCount;
 
-      // Everyone needs to know the total length written during one iteration.
-      allCoresWriteLength = comms.AllReduce(writeLength, MPI_SUM);
+      // The IO proc also writes the iteration number, unless it goes in the
+      // compressed record's own header
+      firstRecordOffset = (comms.OnIORank() && !outputSpec->compressed) ? 8 : 0;
+      writeLength += firstRecordOffset;
 
-      // Only the root process needs to know the total number of sites written
-      // Note this has a garbage value on other procs.
-      uint64_t allSiteCount = comms.Reduce(siteCount, MPI_SUM,
-                                           comms.GetIORank());
+      // Create the buffers that we'll write each iteration's data into, and fill in
+      // the parts that are the same every time.
+      std::vector<char> buffer(writeLength);
+      if (HasCoordinateTable())
+      {
+        // The positions go in their own table, written with the headers.
+        coordinateTable.resize(recordCount * io::formats::extraction::SiteCoordinatesLength);
+      }
+      for (uint64_t selected = 0; selected < recordCount; ++selected)
+      {
+        char* const record = &buffer[firstRecordOffset + selected * siteRecordLength];
+        char* const coordinates = HasCoordinateTable() ?
+          &coordinateTable[selected * io::formats::extraction::SiteCoordinatesLength] :
+          record;
+        const util::Vector3D<site_t>& position = (*recordPositions)[selected];
+        EncodeUint32(uint32_t(position.x), coordinates);
+        EncodeUint32(uint32_t(position.y), coordinates + 4);
+        EncodeUint32(uint32_t(position.z), coordinates + 8);
 
-      unsigned totalHeaderLength = 0;
+        for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
+        {
+          if (outputSpec->fields[outputNumber].type == OutputField::MpiRank)
+          {
+            EncodeFloat(static_cast<WrittenDataType>(comms.Rank()), record + fieldOffsets[outputNumber]);
+          }
+        }
+      }
+      buffers.resize(std::max(outputSpec->bufferCount, 1u), buffer);
+      pendingWrites.resize(buffers.size(), MPI_REQUEST_NULL);
+      if (outputSpec->compressed)
+      {
+        compressedBuffers.resize(buffers.size());
+      }
 
-      // Write the header information on the IO proc.
-      if (comms.OnIORank())
+      // Where many cores have only a little to write, a few writing for groups of
+      // them make fewer, larger writes. Each group is a run of consecutive ranks,
+      // whose parts of the file follow on from one another, so its first core can
+      // write them all at once from its own offset.
+      if (outputSpec->aggregatorCount > 0)
       {
-        // Compute the length of the field header
-        unsigned fieldHeaderLength = 0;
-        for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
+        const uint64_t groupCount = std::min(uint64_t(outputSpec->aggregatorCount),
+                                             uint64_t(comms.Size()));
+        const int group = int(uint64_t(comms.Rank()) * groupCount / comms.Size());
+        aggregationComms = comms.Split(group, comms.Rank());
+        if (aggregationComms.Rank() == 0)
         {
-          // Name
-          fieldHeaderLength
-              += io::formats::extraction::GetStoredLengthOfString(outputSpec->fields[outputNumber].name);
-          // Uint32 for number of fields
-          fieldHeaderLength += 4;
-          // Double for the offset in each field
-          fieldHeaderLength += 8;
+          aggregateBuffers.resize(buffers.size());
         }
+      }
 
-        // Create a header buffer
-        totalHeaderLength = io::formats::extraction::MainHeaderLength + fieldHeaderLength;
-        std::vector<char> headerBuffer(totalHeaderLength);
+      if (setUpFile)
+      {
+        SetUpFiles(std::vector<LocalPropertyOutput*>(1, this), comms);
+      }
+    }
+
+    void LocalPropertyOutput::SetUpFiles(const std::vector<LocalPropertyOutput*>& outputs,
+                                         const net::IOCommunicator& comms)
+    {
+      if (outputs.empty())
+      {
+        return;
+      }
+
+      // Everyone needs to know where to start writing in each file, and the total
+      // length written to it in one iteration; the IO proc also needs the total
+      // number of sites for the header, and with static geometry everyone needs
+      // both where to put their sites' coordinates and the length of the whole
+      // table. For all the files, that's one scan and one sum of the local write
+      // lengths and site counts.
+      std::vector<uint64_t> localCounts(2 * outputs.size());
+      for (size_t outputNumber = 0; outputNumber < outputs.size(); ++outputNumber)
+      {
+        localCounts[2 * outputNumber] = outputs[outputNumber]->writeLength;
+        localCounts[2 * outputNumber + 1] = outputs[outputNumber]->recordCount;
+      }
+
+      // Each core's data follows that of the cores before it, starting with the IO
+      // proc's.
+      const std::vector<uint64_t> precedingCounts = comms.ExclusiveScan(localCounts, MPI_SUM);
+      const std::vector<uint64_t> totalCounts = comms.AllReduce(localCounts, MPI_SUM);
+
+      // Compressed, the records' lengths vary, so everyone writes from the start of
+      // each in turn. The IO proc needs each core's uncompressed length for the
+      // chunk index, but it doesn't change: one gather gets them for all the files.
+      std::vector<uint64_t> localCompressedLengths;
+      for (size_t outputNumber = 0; outputNumber < outputs.size(); ++outputNumber)
+      {
+        if (outputs[outputNumber]->outputSpec->compressed)
+        {
+          localCompressedLengths.push_back(outputs[outputNumber]->writeLength);
+        }
+      }
+      std::vector<uint64_t> allCompressedLengths;
+      if (!localCompressedLengths.empty())
+      {
+        allCompressedLengths = comms.Gather(localCompressedLengths, comms.GetIORank());
+      }
+      size_t compressedNumber = 0;
 
+      for (size_t outputNumber = 0; outputNumber < outputs.size(); ++outputNumber)
+      {
+        LocalPropertyOutput& output = *outputs[outputNumber];
+        const uint64_t allSiteCount = totalCounts[2 * outputNumber + 1];
+        const uint64_t fieldHeaderEnd = io::formats::extraction::MainHeaderLength
+            + output.GetFieldHeaderLength();
+
+        output.allCoresWriteLength = totalCounts[2 * outputNumber];
+        output.localDataOffsetIntoFile = fieldHeaderEnd;
+        if (!output.outputSpec->compressed)
         {
-          // Encoder for ONLY the main header (note shorter length)
-          io::writers::xdr::XdrMemWriter
-              mainHeaderWriter(&headerBuffer[0], io::formats::extraction::MainHeaderLength);
-
-          // Fill it
-          mainHeaderWriter << uint32_t(io::formats::HemeLbMagicNumber)
-              << uint32_t(io::formats::extraction::MagicNumber)
-              << uint32_t(io::formats::extraction::VersionNumber);
-          mainHeaderWriter << double(dataSource.GetVoxelSize());
-          const util::Vector3D<distribn_t> &origin = dataSource.GetOrigin();
-          mainHeaderWriter << double(origin[0]) << double(origin[1]) << double(origin[2]);
-
-          // Write the total site count and number of fields
-          mainHeaderWriter << uint64_t(allSiteCount) << uint32_t(outputSpec->fields.size())
-              << uint32_t(fieldHeaderLength);
-          // Main header now finished.
-          // Exiting the block kills the mainHeaderWriter.
+          output.localDataOffsetIntoFile += precedingCounts[2 * outputNumber];
         }
+        else
         {
-          // Create the field header writer
-          io::writers::xdr::XdrMemWriter
-              fieldHeaderWriter(&headerBuffer[io::formats::extraction::MainHeaderLength],
-                                fieldHeaderLength);
-          // Write it
-          for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
+          // The gathered lengths are by core, then by compressed file.
+          for (size_t gathered = compressedNumber; gathered < allCompressedLengths.size();
+              gathered += localCompressedLengths.size())
           {
-            fieldHeaderWriter << outputSpec->fields[outputNumber].name
-                << uint32_t(GetFieldLength(outputSpec->fields[outputNumber].type))
-                << GetOffset(outputSpec->fields[outputNumber].type);
+            output.uncompressedChunkLengths.push_back(allCompressedLengths[gathered]);
           }
-          //Exiting the block cleans up the writer
+          ++compressedNumber;
         }
 
-        // Write from the buffer
-        outputFile.WriteAt(0, headerBuffer);
-      }
+        if (output.HasCoordinateTable())
+        {
+          output.localDataOffsetIntoFile += allSiteCount
+              * io::formats::extraction::SiteCoordinatesLength;
 
-      // Calculate where each core should start writing
-      if (comms.OnIORank())
-      {
-        // For core 0 this is easy: it passes the value for core 1 to the core.
-        localDataOffsetIntoFile = totalHeaderLength;
+          const uint64_t tableOffset = fieldHeaderEnd
+              + precedingCounts[2 * outputNumber + 1]
+                  * io::formats::extraction::SiteCoordinatesLength;
+          if (output.aggregationComms)
+          {
+            output.coordinateTable = output.aggregationComms.GatherV(output.coordinateTable, 0);
+          }
+          if (!output.coordinateTable.empty())
+          {
+            output.outputFile.WriteAt(tableOffset, output.coordinateTable);
+          }
+          // Only needed the once.
+          std::vector<char>().swap(output.coordinateTable);
+        }
 
-        if (comms.Size() > 1)
+        if (comms.OnIORank())
         {
-          comms.Send(localDataOffsetIntoFile+writeLength, 1, 1);
+          output.WriteHeader(allSiteCount);
         }
       }
-      else
+    }
+
+    unsigned LocalPropertyOutput::GetFieldHeaderLength() const
+    {
+      unsigned fieldHeaderLength = 0;
+      for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
       {
-        // Receive the writing start position from the previous core.
-        comms.Receive(localDataOffsetIntoFile, comms.Rank()-1, 1);
+        // Name
+        fieldHeaderLength
+            += io::formats::extraction::GetStoredLengthOfString(outputSpec->fields[outputNumber].name);
+        // Uint32 for number of fields
+        fieldHeaderLength += 4;
+        // Double for the offset in each field
+        fieldHeaderLength += 8;
+        // Uint32 for the encoding and double for the fixed point step
+        if (IsQuantised())
+        {
+          fieldHeaderLength += 12;
+        }
+      }
+      return fieldHeaderLength;
+    }
+
+    void LocalPropertyOutput::WriteHeader(uint64_t allSiteCount)
+    {
+      const unsigned fieldHeaderLength = GetFieldHeaderLength();
+
+      // Create a header buffer
+      const unsigned totalHeaderLength = io::formats::extraction::MainHeaderLength
+          + fieldHeaderLength;
+      std::vector<char> headerBuffer(totalHeaderLength);
 
-        // Send the next core its start position.
-        if (comms.Rank() != (comms.Size() - 1))
+      {
+        // Encoder for ONLY the main header (note shorter length)
+        io::writers::xdr::XdrMemWriter
+            mainHeaderWriter(&headerBuffer[0], io::formats::extraction::MainHeaderLength);
+
+        // Fill it
+        mainHeaderWriter << uint32_t(io::formats::HemeLbMagicNumber)
+            << uint32_t(io::formats::extraction::MagicNumber)
+            << GetVersionNumber();
+        // Coarsened, the sites are the blocks, so are further apart, and the first
+        // is at the centre of the first block.
+        const distribn_t coarsening = outputSpec->coarsening;
+        const distribn_t voxelSize = dataSource.GetVoxelSize();
+        const util::Vector3D<distribn_t> origin = dataSource.GetOrigin()
+            + util::Vector3D<distribn_t>(0.5 * (coarsening - 1.0) * voxelSize);
+        mainHeaderWriter << double(coarsening * voxelSize);
+        mainHeaderWriter << double(origin[0]) << double(origin[1]) << double(origin[2]);
+
+        // Write the total site count and number of fields
+        mainHeaderWriter << uint64_t(allSiteCount) << uint32_t(outputSpec->fields.size())
+            << uint32_t(fieldHeaderLength);
+        // Main header now finished.
+        // Exiting the block kills the mainHeaderWriter.
+      }
+      {
+        // Create the field header writer
+        io::writers::xdr::XdrMemWriter
+            fieldHeaderWriter(&headerBuffer[io::formats::extraction::MainHeaderLength],
+                              fieldHeaderLength);
+        // Write it
+        for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
         {
-          comms.Send(localDataOffsetIntoFile+writeLength, comms.Rank() + 1, 1);
+          const OutputField& field = outputSpec->fields[outputNumber];
+          fieldHeaderWriter << field.name << uint32_t(GetWrittenLength(field))
+              << GetWrittenOffset(field);
+
+          if (IsQuantised())
+          {
+            switch (field.quantisation)
+            {
+              case OutputField::HalfPrecision:
+                fieldHeaderWriter << uint32_t(io::formats::extraction::HalfEncoding) << double(0);
+                break;
+              case OutputField::FixedPoint:
+                fieldHeaderWriter << uint32_t(io::formats::extraction::FixedPointEncoding)
+                    << double(2.0 * field.errorBound);
+                break;
+              default:
+                fieldHeaderWriter << uint32_t(io::formats::extraction::FloatEncoding) << double(0);
+                break;
+            }
+          }
         }
+        //Exiting the block cleans up the writer
       }
 
-      // Create the buffer that we'll write each iteration's data into.
-      buffer.resize(writeLength);
+      // Write from the buffer
+      outputFile.WriteAt(0, headerBuffer);
     }
 
     LocalPropertyOutput::~LocalPropertyOutput()
     {
+      // The buffers must outlive their writes.
+      Flush();
 
+      for (unsigned outputNumber = 0; outputNumber < statistics.size(); ++outputNumber)
+      {
+        delete statistics[outputNumber];
+      }
+      delete averager;
     }
 
     bool LocalPropertyOutput::ShouldWrite(unsigned long timestepNumber) const
@@ -165,6 +419,23 @@ namespace hemelb
       return ( (timestepNumber % outputSpec->frequency) == 0);
     }
 
+    bool LocalPropertyOutput::ShouldSample(unsigned long timestepNumber) const
+    {
+      if ( (timestepNumber % outputSpec->samplingPeriod) != 0)
+      {
+        return false;
+      }
+
+      for (unsigned outputNumber = 0; outputNumber < statistics.size(); ++outputNumber)
+      {
+        if (statistics[outputNumber] != NULL)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
     const PropertyOutputFile* LocalPropertyOutput::GetOutputSpec() const
     {
       return outputSpec;
@@ -172,102 +443,316 @@ namespace hemelb
 
     void LocalPropertyOutput::Write(unsigned long timestepNumber)
     {
+      // Add this iteration's values to any statistics.
+      if (ShouldSample(timestepNumber))
+      {
+        Sample();
+      }
+
       // Don't write if we shouldn't this iteration.
       if (!ShouldWrite(timestepNumber))
       {
         return;
       }
 
-      // Don't write if this core doesn't do anything.
-      if (writeLength <= 0)
+      // Don't write if this core doesn't do anything; when compressed, everyone
+      // still has to help find where the others write, when aggregated, to help
+      // gather their parts, and when coarsened, to help average the blocks.
+      if (writeLength <= 0 && !outputSpec->compressed && !aggregationComms && averager == NULL)
       {
         return;
       }
 
-      // Create the buffer.
-      io::writers::xdr::XdrMemWriter xdrWriter(&buffer[0], buffer.size());
+      // Make sure the last write from this buffer is finished before reusing it. If
+      // the file system can't keep up, this is where we wait for it.
+      std::vector<char>& buffer = buffers[nextBuffer];
+      HEMELB_MPI_CALL(MPI_Wait, (&pendingWrites[nextBuffer], MPI_STATUS_IGNORE));
 
       // Firstly, the IO proc must write the iteration number.
-      if (comms.OnIORank())
+      if (comms.OnIORank() && !outputSpec->compressed)
       {
-        xdrWriter << (uint64_t) timestepNumber;
+        EncodeUint32(uint32_t(uint64_t(timestepNumber) >> 32), &buffer[0]);
+        EncodeUint32(uint32_t(timestepNumber), &buffer[4]);
       }
 
-      dataSource.Reset();
-
-      while (dataSource.ReadNext())
+      // Then each field, for all the sites at once.
+      const size_t siteCount = selectedSites.size();
+      for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
       {
-        const util::Vector3D<site_t>& position = dataSource.GetPosition();
-        if (outputSpec->geometry->Include(dataSource, position))
+        const OutputField::FieldType field = outputSpec->fields[outputNumber].type;
+        if (field == OutputField::MpiRank)
         {
-          // Write the position
-          xdrWriter << (uint32_t) position.x << (uint32_t) position.y << (uint32_t) position.z;
+          // Already in the buffer.
+          continue;
+        }
+        if (siteCount == 0 && averager == NULL)
+        {
+          continue;
+        }
 
-          // Write for each field.
-          for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
+        // A statistic is of the offset values, so is written as it is, and starts
+        // again for the next window.
+        FloatingType offset = 0;
+        if (statistics[outputNumber] != NULL)
+        {
+          statistics[outputNumber]->GetResults(fieldValues);
+          statistics[outputNumber]->Reset();
+        }
+        else
+        {
+          fieldValues.clear();
+          if (siteCount > 0)
+          {
+            dataSource.GetFieldValues(field, selectedSites, fieldValues);
+          }
+          offset = GetOffset(field);
+        }
+
+        const unsigned fieldLength = GetWrittenLength(outputSpec->fields[outputNumber]);
+        if (averager != NULL)
+        {
+          // The offset is the same for the averages.
+          averager->Average(fieldValues, fieldLength, averagedValues);
+          fieldValues.swap(averagedValues);
+          if (recordCount == 0)
+          {
+            continue;
+          }
+        }
+
+        char* record = &buffer[firstRecordOffset + fieldOffsets[outputNumber]];
+        if (outputSpec->fields[outputNumber].quantisation == OutputField::NoQuantisation)
+        {
+          const FloatingType* values = &fieldValues[0];
+          for (size_t selected = 0; selected < recordCount; ++selected)
           {
-            switch (outputSpec->fields[outputNumber].type)
+            for (unsigned component = 0; component < fieldLength; ++component)
             {
-              case OutputField::Pressure:
-                xdrWriter << static_cast<WrittenDataType> (dataSource.GetPressure()
-                    - REFERENCE_PRESSURE_mmHg);
-                break;
-              case OutputField::Velocity:
-                xdrWriter << static_cast<WrittenDataType> (dataSource.GetVelocity().x)
-                    << static_cast<WrittenDataType> (dataSource.GetVelocity().y)
-                    << static_cast<WrittenDataType> (dataSource.GetVelocity().z);
-                break;
-                //! @TODO: Work out how to handle the different stresses.
-              case OutputField::VonMisesStress:
-                xdrWriter << static_cast<WrittenDataType> (dataSource.GetVonMisesStress());
-                break;
-              case OutputField::ShearStress:
-                xdrWriter << static_cast<WrittenDataType> (dataSource.GetShearStress());
-                break;
-              case OutputField::ShearRate:
-                xdrWriter << static_cast<WrittenDataType> (dataSource.GetShearRate());
-                break;
-              case OutputField::StressTensor:
-              {
-                util::Matrix3D tensor = dataSource.GetStressTensor();
-                // Only the upper triangular part of the symmetric tensor is stored. Storage is row-wise.
-                xdrWriter << static_cast<WrittenDataType> (tensor[0][0])
-                    << static_cast<WrittenDataType> (tensor[0][1])
-                    << static_cast<WrittenDataType> (tensor[0][2])
-                    << static_cast<WrittenDataType> (tensor[1][1])
-                    << static_cast<WrittenDataType> (tensor[1][2])
-                    << static_cast<WrittenDataType> (tensor[2][2]);
-                break;
-              }
-              case OutputField::Traction:
-                xdrWriter << static_cast<WrittenDataType> (dataSource.GetTraction().x)
-                    << static_cast<WrittenDataType> (dataSource.GetTraction().y)
-                    << static_cast<WrittenDataType> (dataSource.GetTraction().z);
-                break;
-              case OutputField::TangentialProjectionTraction:
-                xdrWriter
-                    << static_cast<WrittenDataType> (dataSource.GetTangentialProjectionTraction().x)
-                    << static_cast<WrittenDataType> (dataSource.GetTangentialProjectionTraction().y)
-                    << static_cast<WrittenDataType> (dataSource.GetTangentialProjectionTraction().z);
-                break;
-              case OutputField::MpiRank:
-                xdrWriter
-                    << static_cast<WrittenDataType> (comms.Rank());
-                break;
-              default:
-                // This should never trip. It only occurs when a new OutputField field is added and no
-                // implementation is provided for its serialisation.
-                assert(false);
+              EncodeFloat(static_cast<WrittenDataType>(values[component] - offset),
+                          record + component * sizeof(WrittenDataType));
             }
+            values += fieldLength;
+            record += siteRecordLength;
           }
         }
+        else
+        {
+          const size_t clampedCount = Quantise(outputSpec->fields[outputNumber],
+                                               offset,
+                                               fieldValues,
+                                               quantisedValues);
+          if (clampedCount > 0)
+          {
+            logging::Logger::Log<logging::Warning, logging::OnePerCore>("Clamped %lu values of field %s "
+                                                                            "at timestep %lu to the range "
+                                                                            "its error bound allows",
+                                                                        (unsigned long) clampedCount,
+                                                                        outputSpec->fields[outputNumber].name.c_str(),
+                                                                        timestepNumber);
+          }
+          const uint16_t* values = &quantisedValues[0];
+          for (size_t selected = 0; selected < recordCount; ++selected)
+          {
+            for (unsigned component = 0; component < fieldLength; ++component)
+            {
+              EncodeUint16(values[component], record + 2 * component);
+            }
+            values += fieldLength;
+            record += siteRecordLength;
+          }
+        }
+      }
+
+      if (outputSpec->compressed)
+      {
+        WriteCompressed(timestepNumber, buffer);
+      }
+      else
+      {
+        // Start the MPI writing, and carry on.
+        StartWrite(localDataOffsetIntoFile, buffer);
+
+        // Set the offset to the right place for writing on the next iteration.
+        localDataOffsetIntoFile += allCoresWriteLength;
+      }
+      nextBuffer = (nextBuffer + 1) % buffers.size();
+    }
+
+    void LocalPropertyOutput::WriteCompressed(unsigned long timestepNumber,
+                                              const std::vector<char>& buffer)
+    {
+      std::vector<char>& compressed = compressedBuffers[nextBuffer];
+      Compress(buffer, compressed);
+
+      // Each core's chunk follows those of the cores before it, after the record's
+      // header and index.
+      const uint64_t compressedLength = compressed.size();
+      const uint64_t precedingLength = comms.ExclusiveScan(compressedLength, MPI_SUM);
+      const uint64_t allCompressedLength = comms.AllReduce(compressedLength, MPI_SUM);
+      const std::vector<uint64_t> compressedLengths = comms.Gather(compressedLength,
+                                                                   comms.GetIORank());
+
+      const uint64_t indexLength = io::formats::extraction::CompressedRecordHeaderLength
+          + io::formats::extraction::ChunkIndexEntryLength * comms.Size();
+
+      if (comms.OnIORank())
+      {
+        std::vector<char> index(indexLength);
+        io::writers::xdr::XdrMemWriter indexWriter(&index[0], indexLength);
+        indexWriter << uint64_t(timestepNumber) << uint64_t(indexLength + allCompressedLength)
+            << uint32_t(comms.Size());
+        for (int rank = 0; rank < comms.Size(); ++rank)
+        {
+          indexWriter << uint64_t(compressedLengths[rank])
+              << uint64_t(uncompressedChunkLengths[rank]);
+        }
+        outputFile.WriteAt(localDataOffsetIntoFile, index);
       }
 
-      // Actually do the MPI writing.
-      outputFile.WriteAt(localDataOffsetIntoFile, buffer);
+      StartWrite(localDataOffsetIntoFile + indexLength + precedingLength, compressed);
 
-      // Set the offset to the right place for writing on the next iteration.
-      localDataOffsetIntoFile += allCoresWriteLength;
+      // The next record starts after this one.
+      localDataOffsetIntoFile += indexLength + allCompressedLength;
+    }
+
+    void LocalPropertyOutput::StartWrite(uint64_t offset, const std::vector<char>& local)
+    {
+      if (!aggregationComms)
+      {
+        if (!local.empty())
+        {
+          pendingWrites[nextBuffer] = outputFile.IwriteAt(offset, local);
+        }
+        return;
+      }
+
+      // The group's parts, gathered in rank order, follow on from the first's.
+      std::vector<char> gathered = aggregationComms.GatherV(local, 0);
+      if (!gathered.empty())
+      {
+        std::vector<char>& aggregate = aggregateBuffers[nextBuffer];
+        aggregate.swap(gathered);
+        pendingWrites[nextBuffer] = outputFile.IwriteAt(offset, aggregate);
+      }
+    }
+
+    void LocalPropertyOutput::Compress(const std::vector<char>& packed,
+                                       std::vector<char>& compressed)
+    {
+      compressed.clear();
+      if (packed.empty())
+      {
+        return;
+      }
+
+      // Shuffle the bytes so the first of every value come first, then the second
+      // and so on. Neighbouring sites' values tend to share their exponent and
+      // high-order bytes, which deflate does much better with when they're together.
+      const size_t elementLength = io::formats::extraction::ShuffleElementLength;
+      const size_t elementCount = packed.size() / elementLength;
+      shuffled.resize(packed.size());
+      for (size_t element = 0; element < elementCount; ++element)
+      {
+        for (size_t byte = 0; byte < elementLength; ++byte)
+        {
+          shuffled[byte * elementCount + element] = packed[element * elementLength + byte];
+        }
+      }
+
+      uLongf compressedLength = compressBound(shuffled.size());
+      compressed.resize(compressedLength);
+      const int ret = compress2(reinterpret_cast<Bytef*>(&compressed[0]),
+                                &compressedLength,
+                                reinterpret_cast<const Bytef*>(&shuffled[0]),
+                                shuffled.size(),
+                                Z_DEFAULT_COMPRESSION);
+      if (ret != Z_OK)
+      {
+        throw Exception() << "Compression error for property output file " << outputSpec->filename;
+      }
+      compressed.resize(compressedLength);
+    }
+
+    bool LocalPropertyOutput::HasCoordinateTable() const
+    {
+      return outputSpec->staticGeometry || outputSpec->compressed || IsQuantised();
+    }
+
+    bool LocalPropertyOutput::IsQuantised() const
+    {
+      for (unsigned outputNumber = 0; outputNumber < outputSpec->fields.size(); ++outputNumber)
+      {
+        if (outputSpec->fields[outputNumber].quantisation != OutputField::NoQuantisation)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    uint32_t LocalPropertyOutput::GetVersionNumber() const
+    {
+      // Each version is in its own enum, so convert each on its own.
+      if (outputSpec->compressed)
+      {
+        return IsQuantised() ?
+          uint32_t(io::formats::extraction::QuantisedCompressedVersionNumber) :
+          uint32_t(io::formats::extraction::CompressedVersionNumber);
+      }
+      if (IsQuantised())
+      {
+        return uint32_t(io::formats::extraction::QuantisedVersionNumber);
+      }
+      return outputSpec->staticGeometry ?
+        uint32_t(io::formats::extraction::StaticGeometryVersionNumber) :
+        uint32_t(io::formats::extraction::VersionNumber);
+    }
+
+    unsigned LocalPropertyOutput::GetEncodedLength(const OutputField& field)
+    {
+      return field.quantisation == OutputField::NoQuantisation ?
+        sizeof(WrittenDataType) :
+        sizeof(uint16_t);
+    }
+
+    void LocalPropertyOutput::Sample()
+    {
+      for (unsigned outputNumber = 0; outputNumber < statistics.size(); ++outputNumber)
+      {
+        if (statistics[outputNumber] == NULL)
+        {
+          continue;
+        }
+
+        const OutputField::FieldType field = outputSpec->fields[outputNumber].type;
+        fieldValues.clear();
+        if (!selectedSites.empty())
+        {
+          dataSource.GetFieldValues(field, selectedSites, fieldValues);
+        }
+
+        const FloatingType offset = GetOffset(field);
+        if (offset != 0)
+        {
+          for (size_t index = 0; index < fieldValues.size(); ++index)
+          {
+            fieldValues[index] -= offset;
+          }
+        }
+
+        statistics[outputNumber]->Accumulate(fieldValues);
+      }
+    }
+
+    void LocalPropertyOutput::Flush()
+    {
+      for (unsigned bufferNumber = 0; bufferNumber < pendingWrites.size(); ++bufferNumber)
+      {
+        if (pendingWrites[bufferNumber] != MPI_REQUEST_NULL)
+        {
+          HEMELB_MPI_CALL(MPI_Wait, (&pendingWrites[bufferNumber], MPI_STATUS_IGNORE));
+        }
+      }
     }
 
     unsigned LocalPropertyOutput::GetFieldLength(OutputField::FieldType field)
@@ -294,6 +779,18 @@ namespace hemelb
       }
     }
 
+    unsigned LocalPropertyOutput::GetWrittenLength(const OutputField& field)
+    {
+      return FieldStatistics::GetResultLength(field.statistic, GetFieldLength(field.type));
+    }
+
+    double LocalPropertyOutput::GetWrittenOffset(const OutputField& field) const
+    {
+      return FieldStatistics::KeepsOffset(field.statistic) ?
+        GetOffset(field.type) :
+        0.;
+    }
+
     double LocalPropertyOutput::GetOffset(OutputField::FieldType field) const
     {
       switch (field)
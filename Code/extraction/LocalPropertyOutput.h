@@ -7,6 +7,8 @@
 #ifndef HEMELB_EXTRACTION_LOCALPROPERTYOUTPUT_H
 #define HEMELB_EXTRACTION_LOCALPROPERTYOUTPUT_H
 
+#include "extraction/BlockAverager.h"
+#include "extraction/FieldStatistics.h"
 #include "extraction/IterableDataSource.h"
 #include "extraction/PropertyOutputFile.h"
 #include "net/mpi.h"
@@ -28,11 +30,27 @@ namespace hemelb
       public:
         /**
          * Initialises a LocalPropertyOutput. Required so we can use const reference types.
+         *
+         * Unless setUpFile is false, this also finds where each core writes and writes
+         * the header, which is collective; to do that for several outputs at once,
+         * pass false and then call SetUpFiles.
          * @param file
          * @param offset
+         * @param setUpFile
          * @return
          */
-        LocalPropertyOutput(IterableDataSource& dataSource, const PropertyOutputFile* outputSpec, const net::IOCommunicator& ioComms);
+        LocalPropertyOutput(IterableDataSource& dataSource, const PropertyOutputFile* outputSpec,
+                            const net::IOCommunicator& ioComms, bool setUpFile = true);
+
+        /**
+         * Finds where each core writes in each of the outputs' files and writes their
+         * headers, with the same collectives however many outputs there are. Must be
+         * called on all cores, with the same outputs in the same order.
+         * @param outputs
+         * @param comms
+         */
+        static void SetUpFiles(const std::vector<LocalPropertyOutput*>& outputs,
+                               const net::IOCommunicator& comms);
 
         /**
          * Tidies up the LocalPropertyOutput (close files etc).
@@ -46,6 +64,13 @@ namespace hemelb
          */
         bool ShouldWrite(unsigned long timestepNumber) const;
 
+        /**
+         * True if this property output has fields written as statistics over time
+         * and they should be sampled on the current iteration.
+         * @return
+         */
+        bool ShouldSample(unsigned long timestepNumber) const;
+
         /**
          * Returns the property output file object to be written.
          * @return
@@ -54,10 +79,22 @@ namespace hemelb
 
         /**
          * Write this core's section of the data file. Only writes if appropriate for the current
-         * iteration number
+         * iteration number.
+         *
+         * The write is started but not waited for, so it can go on while the simulation
+         * does; it is finished by a later Write needing its buffer, or by Flush.
+         *
+         * Fields written as statistics are also sampled here, if appropriate, and
+         * are written, then restarted, at the end of each window of the output's
+         * period.
          */
         void Write(unsigned long timestepNumber);
 
+        /**
+         * Waits for all writes in progress to finish.
+         */
+        void Flush();
+
       private:
         /**
          * Returns the number of floats written for the field.
@@ -72,6 +109,88 @@ namespace hemelb
          */
         double GetOffset(OutputField::FieldType field) const;
 
+        /**
+         * Returns the number of floats written for the field, which for a statistic
+         * may not be the field's length.
+         * @param field
+         * @return
+         */
+        unsigned GetWrittenLength(const OutputField& field);
+
+        /**
+         * Returns the offset written in the header for the field.
+         * @param field
+         * @return
+         */
+        double GetWrittenOffset(const OutputField& field) const;
+
+        /**
+         * Adds the current values of the fields written as statistics to them.
+         */
+        void Sample();
+
+        /**
+         * Whether the sites' coordinates are written once, in a table after the
+         * headers, rather than in each record.
+         * @return
+         */
+        bool HasCoordinateTable() const;
+
+        /**
+         * Whether any field is written in fewer bytes than a float, so the field
+         * header has each's encoding.
+         * @return
+         */
+        bool IsQuantised() const;
+
+        /**
+         * Returns the version of the extraction format the file is written in.
+         * @return
+         */
+        uint32_t GetVersionNumber() const;
+
+        /**
+         * Returns the number of bytes written for each of the field's values.
+         * @param field
+         * @return
+         */
+        static unsigned GetEncodedLength(const OutputField& field);
+
+        /**
+         * Compresses this core's part of a record and writes it, with, from the IO
+         * proc, the record's header and chunk index.
+         * @param timestepNumber
+         * @param buffer
+         */
+        void WriteCompressed(unsigned long timestepNumber, const std::vector<char>& buffer);
+
+        /**
+         * Starts writing this core's part of a record, or, when aggregated, sends it to
+         * the core writing for its group; that core starts writing them all.
+         * @param offset
+         * @param local
+         */
+        void StartWrite(uint64_t offset, const std::vector<char>& local);
+
+        /**
+         * Byte-shuffles then deflates the packed values.
+         * @param packed
+         * @param compressed
+         */
+        void Compress(const std::vector<char>& packed, std::vector<char>& compressed);
+
+        /**
+         * Returns the length, in bytes, of the field header.
+         * @return
+         */
+        unsigned GetFieldHeaderLength() const;
+
+        /**
+         * Writes the file's headers; only called on the IO proc.
+         * @param allSiteCount
+         */
+        void WriteHeader(uint64_t allSiteCount);
+
         const net::IOCommunicator& comms;
         /**
          * The MPI file to write into.
@@ -104,9 +223,113 @@ namespace hemelb
         uint64_t allCoresWriteLength;
 
         /**
-         * Buffer to write into before writing to disk.
+         * The sites written by this core, numbered in the order the data source
+         * visits them. The selection is fixed, so is found once.
+         */
+        std::vector<site_t> selectedSites;
+
+        /**
+         * When coarsened, averages the selected sites' values over the blocks; NULL
+         * otherwise.
+         */
+        BlockAverager* averager;
+
+        /**
+         * The number of records this core writes each time: one per selected site,
+         * or when coarsened, one per block it owns.
+         */
+        uint64_t recordCount;
+
+        /**
+         * The length, in bytes, of each site's record: its position, unless the
+         * geometry is static, then its fields.
+         */
+        uint64_t siteRecordLength;
+
+        /**
+         * The offset of each field within a site's record.
+         */
+        std::vector<uint64_t> fieldOffsets;
+
+        /**
+         * The offset of the first site's record in the buffer, after the iteration
+         * number on the IO rank.
+         */
+        uint64_t firstRecordOffset;
+
+        /**
+         * With static geometry, the encoded coordinates of the selected sites, until
+         * they're written with the headers.
+         */
+        std::vector<char> coordinateTable;
+
+        /**
+         * Buffers to write into before writing to disk, used in turn, one per write
+         * that may be in progress (PropertyOutputFile::bufferCount). The positions,
+         * and any MPI rank field, never change and are encoded once; each write only
+         * encodes the other fields.
+         */
+        std::vector<std::vector<char> > buffers;
+
+        /**
+         * When compressed, the compressed contents of each buffer, written from here
+         * instead.
+         */
+        std::vector<std::vector<char> > compressedBuffers;
+
+        /**
+         * When compressed, the shuffled bytes of the buffer being compressed.
+         */
+        std::vector<char> shuffled;
+
+        /**
+         * When compressed, the uncompressed length of each core's chunk; only on the
+         * IO proc.
+         */
+        std::vector<uint64_t> uncompressedChunkLengths;
+
+        /**
+         * When aggregated, the cores whose parts of each write this core's group's
+         * first core gathers and writes; otherwise null.
+         */
+        net::MpiCommunicator aggregationComms;
+
+        /**
+         * On the cores writing for a group, the group's parts of the write from each
+         * buffer, in rank order, written from here instead.
+         */
+        std::vector<std::vector<char> > aggregateBuffers;
+
+        /**
+         * The write from each buffer, or MPI_REQUEST_NULL if it has none in progress.
+         */
+        std::vector<MPI_Request> pendingWrites;
+
+        /**
+         * The buffer to use for the next write.
+         */
+        unsigned nextBuffer;
+
+        /**
+         * For each field written as a statistic over time, its accumulated values;
+         * NULL for the others.
+         */
+        std::vector<FieldStatistics*> statistics;
+
+        /**
+         * The values of one field at the selected sites, from the data source.
+         */
+        std::vector<FloatingType> fieldValues;
+
+        /**
+         * When coarsened, the values of one field averaged over the blocks.
+         */
+        std::vector<FloatingType> averagedValues;
+
+        /**
+         * The values of one quantised field, as written.
          */
-        std::vector<char> buffer;
+        std::vector<uint16_t> quantisedValues;
 
         /**
          * Type of written values
@@ -7,6 +7,8 @@
 #ifndef HEMELB_EXTRACTION_OUTPUTFIELD_H
 #define HEMELB_EXTRACTION_OUTPUTFIELD_H
 
+#include <string>
+
 namespace hemelb
 {
   namespace extraction
@@ -27,8 +29,49 @@ namespace hemelb
           MpiRank
         };
 
+        /**
+         * What is written of the field: its value at the time of the write, or a
+         * statistic of its values over the steps since the last write (see
+         * FieldStatistics).
+         */
+        enum StatisticType
+        {
+          Instantaneous,
+          Mean,
+          RootMeanSquare,
+          Minimum,
+          Maximum,
+          TimeAveragedMagnitude, //!< TAWSS, for the wall shear stress
+          OscillatoryIndex //!< OSI, for the wall shear stress
+        };
+
+        /**
+         * How the values are written: as floats, or in two bytes, either as
+         * half-precision numbers or as fixed point numbers to within errorBound.
+         */
+        enum QuantisationType
+        {
+          NoQuantisation,
+          HalfPrecision,
+          FixedPoint
+        };
+
+        OutputField() :
+            statistic(Instantaneous), quantisation(NoQuantisation), errorBound(0)
+        {
+        }
+
         std::string name;
         FieldType type;
+        StatisticType statistic;
+        QuantisationType quantisation;
+
+        /**
+         * For fixed point, the largest difference between a value and that written;
+         * values further than 32767 steps of twice this from the field's offset
+         * are clamped.
+         */
+        double errorBound;
     };
   }
 }
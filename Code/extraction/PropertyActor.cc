@@ -34,8 +34,9 @@ namespace hemelb
       {
         const LocalPropertyOutput* propertyOutput = propertyOutputs[output];
 
-        // Only consider the ones that are being written this iteration.
-        if (propertyOutput->ShouldWrite(simulationState.GetTimeStep()))
+        // Only consider the ones that are being written or sampled this iteration.
+        if (propertyOutput->ShouldWrite(simulationState.GetTimeStep())
+            || propertyOutput->ShouldSample(simulationState.GetTimeStep()))
         {
           const PropertyOutputFile* outputFile = propertyOutput->GetOutputSpec();
 
@@ -18,7 +18,9 @@ namespace hemelb
   {
     struct PropertyOutputFile
     {
-        PropertyOutputFile()
+        PropertyOutputFile() :
+            bufferCount(2), staticGeometry(false), samplingPeriod(1), compressed(false),
+            aggregatorCount(0), coarsening(1)
         {
           geometry = NULL;
         }
@@ -32,6 +34,45 @@ namespace hemelb
         unsigned long frequency;
         GeometrySelector* geometry;
         std::vector<OutputField> fields;
+
+        /**
+         * The number of buffers to write from, so the most writes that can be in
+         * progress at once. Once they are all in use, the next write waits for the
+         * oldest to finish.
+         */
+        unsigned bufferCount;
+
+        /**
+         * Whether to write the sites' coordinates once, after the headers, rather than
+         * in every site's record on every write (see io::formats::extraction).
+         */
+        bool staticGeometry;
+
+        /**
+         * For fields written as statistics over time, how often to sample them; the
+         * statistics are over the samples in each window of the output's period.
+         */
+        unsigned long samplingPeriod;
+
+        /**
+         * Whether to compress each core's part of each write (see
+         * io::formats::extraction). The coordinates are then always written once.
+         */
+        bool compressed;
+
+        /**
+         * The number of cores that write to the file, each for its share of the cores
+         * in rank order, which send it their parts of each write. If zero, every core
+         * writes its own part.
+         */
+        unsigned aggregatorCount;
+
+        /**
+         * If more than one, the selected sites' values are averaged over cubes of
+         * this many sites along each axis, and each cube written as one site, of a
+         * grid this much coarser.
+         */
+        unsigned coarsening;
     };
   }
 }
@@ -16,8 +16,13 @@ namespace hemelb
     {
       for (unsigned outputNumber = 0; outputNumber < propertyOutputs.size(); ++outputNumber)
       {
-        localPropertyOutputs.push_back(new LocalPropertyOutput(dataSource, propertyOutputs[outputNumber], ioComms));
+        localPropertyOutputs.push_back(new LocalPropertyOutput(dataSource,
+                                                               propertyOutputs[outputNumber],
+                                                               ioComms,
+                                                               false));
       }
+      // Set them all up together, to save on collectives.
+      LocalPropertyOutput::SetUpFiles(localPropertyOutputs, ioComms);
     }
 
     PropertyWriter::~PropertyWriter()
@@ -40,5 +45,13 @@ namespace hemelb
         localPropertyOutputs[outputNumber]->Write((uint64_t) iterationNumber);
       }
     }
+
+    void PropertyWriter::Flush() const
+    {
+      for (unsigned outputNumber = 0; outputNumber < localPropertyOutputs.size(); ++outputNumber)
+      {
+        localPropertyOutputs[outputNumber]->Flush();
+      }
+    }
   }
 }
@@ -39,6 +39,11 @@ namespace hemelb
          */
         void Write(unsigned long iterationNumber) const;
 
+        /**
+         * Waits for the writes in progress to each of the property output files to finish.
+         */
+        void Flush() const;
+
         /**
          * Returns a vector of all the LocalPropertyOutputs.
          * @return
@@ -0,0 +1,200 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include "extraction/ReductionActor.h"
+#include "constants.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    namespace
+    {
+      // The sites with a link across a plane lie within max_i |c_i.n| of it, so
+      // there are that many per unit of its area: each stands for 1 / max_i |c_i.n|
+      // of a voxel's area. That's one for a plane across a lattice axis, but more
+      // for one tilted to the axes. Without a normal, take the plane across an axis.
+      double GetAreaPerSite(const lb::lattices::LatticeInfo& lattice,
+                            const util::Vector3D<distribn_t>& normal)
+      {
+        const distribn_t magnitude = normal.GetMagnitude();
+        if (! (magnitude > 0.0 && magnitude < NO_VALUE))
+        {
+          return 1.0;
+        }
+
+        double depth = 0.0;
+        for (unsigned direction = 0; direction < lattice.GetNumVectors(); ++direction)
+        {
+          depth = std::max(depth,
+                           std::abs(util::Vector3D<distribn_t>(lattice.GetVector(direction)).Dot(normal))
+                               / magnitude);
+        }
+        return 1.0 / depth;
+      }
+    }
+
+    ReductionActor::ReductionActor(const lb::SimulationState& simulationState,
+                                   const ReductionOutputFile& outputSpec,
+                                   const geometry::LatticeData& latticeData,
+                                   const lb::MacroscopicPropertyCache& propertyCache,
+                                   const std::vector<lb::iolets::InOutLet*>& inlets,
+                                   const std::vector<lb::iolets::InOutLet*>& outlets,
+                                   const util::UnitConverter& unitConverter,
+                                   reporting::Timers& timers,
+                                   const net::IOCommunicator& ioComms) :
+        simulationState(simulationState), outputSpec(outputSpec), latticeData(latticeData),
+            propertyCache(propertyCache), unitConverter(unitConverter), timers(timers),
+            comms(ioComms), writer(NULL)
+    {
+      for (unsigned inlet = 0; inlet < inlets.size(); ++inlet)
+      {
+        ioletNormals.push_back(inlets[inlet]->GetNormal());
+      }
+      for (unsigned outlet = 0; outlet < outlets.size(); ++outlet)
+      {
+        ioletNormals.push_back(outlets[outlet]->GetNormal());
+      }
+      for (unsigned iolet = 0; iolet < ioletNormals.size(); ++iolet)
+      {
+        ioletAreasPerSite.push_back(GetAreaPerSite(latticeData.GetLatticeInfo(), ioletNormals[iolet]));
+      }
+
+      // The sites don't move, so find them once.
+      std::vector<site_t> localIoletSiteCounts(ioletNormals.size(), 0);
+      for (site_t siteIndex = 0; siteIndex < latticeData.GetLocalFluidSiteCount(); ++siteIndex)
+      {
+        const geometry::Site<const geometry::LatticeData> site = latticeData.GetSite(siteIndex);
+
+        if (site.GetSiteType() == geometry::INLET_TYPE || site.GetSiteType() == geometry::OUTLET_TYPE)
+        {
+          const unsigned ioletIndex = site.GetIoletId()
+              + (site.GetSiteType() == geometry::OUTLET_TYPE ? inlets.size() : 0);
+          ioletSites.push_back(siteIndex);
+          ioletIndices.push_back(ioletIndex);
+          ++localIoletSiteCounts[ioletIndex];
+        }
+
+        if (site.IsWall())
+        {
+          wallSites.push_back(siteIndex);
+          wallAreasPerSite.push_back(GetAreaPerSite(latticeData.GetLatticeInfo(),
+                                                    site.GetWallNormal()));
+        }
+      }
+
+      if (!ioletNormals.empty())
+      {
+        ioletSiteCounts = comms.Reduce(localIoletSiteCounts, MPI_SUM, comms.GetIORank());
+      }
+
+      if (comms.OnIORank())
+      {
+        writer = new io::writers::ascii::AsciiFileWriter(outputSpec.filename);
+
+        std::stringstream columns;
+        columns << "# timestep";
+        for (unsigned inlet = 0; inlet < inlets.size(); ++inlet)
+        {
+          columns << " inlet" << inlet << "_flux inlet" << inlet << "_pressure";
+        }
+        for (unsigned outlet = 0; outlet < outlets.size(); ++outlet)
+        {
+          columns << " outlet" << outlet << "_flux outlet" << outlet << "_pressure";
+        }
+        columns << " wall_force_x wall_force_y wall_force_z";
+        *writer << columns.str() << io::writers::Writer::eol;
+      }
+    }
+
+    ReductionActor::~ReductionActor()
+    {
+      delete writer;
+    }
+
+    bool ReductionActor::ShouldWrite(unsigned long timestepNumber) const
+    {
+      return (timestepNumber % outputSpec.frequency) == 0;
+    }
+
+    void ReductionActor::SetRequiredProperties(lb::MacroscopicPropertyCache& propertyCache) const
+    {
+      if (ShouldWrite(simulationState.GetTimeStep()))
+      {
+        propertyCache.densityCache.SetRefreshFlag();
+        propertyCache.velocityCache.SetRefreshFlag();
+        propertyCache.tractionCache.SetRefreshFlag();
+      }
+    }
+
+    void ReductionActor::EndIteration()
+    {
+      const unsigned long timestepNumber = simulationState.GetTimeStep();
+      if (!ShouldWrite(timestepNumber))
+      {
+        return;
+      }
+
+      timers[reporting::Timers::extractionWriting].Start();
+
+      std::vector<double> sums;
+      SumLocalSites(sums);
+      sums = comms.Reduce(sums, MPI_SUM, comms.GetIORank());
+
+      if (comms.OnIORank())
+      {
+        // All the sums are in lattice units, over the voxel areas of the sites.
+        const PhysicalDistance voxelSize = unitConverter.GetVoxelSize();
+        const double fluxScale = unitConverter.ConvertVelocityToPhysicalUnits(1.0) * voxelSize
+            * voxelSize;
+        const double pressureScale = unitConverter.ConvertPressureDifferenceToPhysicalUnits(1.0);
+        const double forceScale = unitConverter.ConvertStressToPhysicalUnits(1.0) * voxelSize
+            * voxelSize;
+
+        *writer << uint64_t(timestepNumber);
+        for (unsigned iolet = 0; iolet < ioletNormals.size(); ++iolet)
+        {
+          const double meanDensity = ioletSiteCounts[iolet] > 0 ?
+            sums[2 * iolet + 1] / ioletSiteCounts[iolet] :
+            1.0;
+          *writer << sums[2 * iolet] * fluxScale
+              << REFERENCE_PRESSURE_mmHg + (meanDensity * Cs2 - Cs2) * pressureScale;
+        }
+        const unsigned forceStart = 2 * ioletNormals.size();
+        *writer << sums[forceStart] * forceScale << sums[forceStart + 1] * forceScale
+            << sums[forceStart + 2] * forceScale << io::writers::Writer::eol;
+      }
+
+      timers[reporting::Timers::extractionWriting].Stop();
+    }
+
+    void ReductionActor::SumLocalSites(std::vector<double>& sums) const
+    {
+      sums.assign(2 * ioletNormals.size() + 3, 0.0);
+
+      for (size_t i = 0; i < ioletSites.size(); ++i)
+      {
+        const unsigned iolet = ioletIndices[i];
+        sums[2 * iolet] += propertyCache.velocityCache.Get(ioletSites[i]).Dot(ioletNormals[iolet])
+            * ioletAreasPerSite[iolet];
+        sums[2 * iolet + 1] += propertyCache.densityCache.Get(ioletSites[i]);
+      }
+
+      util::Vector3D<LatticeStress> force = util::Vector3D<LatticeStress>::Zero();
+      for (size_t i = 0; i < wallSites.size(); ++i)
+      {
+        force += propertyCache.tractionCache.Get(wallSites[i]) * wallAreasPerSite[i];
+      }
+      const unsigned forceStart = 2 * ioletNormals.size();
+      sums[forceStart] = force.x;
+      sums[forceStart + 1] = force.y;
+      sums[forceStart + 2] = force.z;
+    }
+  }
+}
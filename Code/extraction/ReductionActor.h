@@ -0,0 +1,141 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_EXTRACTION_REDUCTIONACTOR_H
+#define HEMELB_EXTRACTION_REDUCTIONACTOR_H
+
+#include <vector>
+#include "extraction/ReductionOutputFile.h"
+#include "geometry/LatticeData.h"
+#include "io/writers/ascii/AsciiFileWriter.h"
+#include "lb/MacroscopicPropertyCache.h"
+#include "lb/SimulationState.h"
+#include "lb/iolets/InOutLet.h"
+#include "net/IOCommunicator.h"
+#include "net/IteratedAction.h"
+#include "reporting/Timers.h"
+#include "util/UnitConverter.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    /**
+     * Reduces the fields to a few numbers, for when those are all that's wanted
+     * from them: for each inlet then each outlet, the flux through it and its mean
+     * pressure, then the total force on the walls. Every period, these take one
+     * reduction to the IO proc, which writes them as a line of a text file:
+     *
+     *   timestep flux pressure [flux pressure...] forceX forceY forceZ
+     *
+     * The flux (m^3/s) is the velocity along the iolet's normal at its sites, times
+     * the area of the iolet each site stands for; the mean pressure (mmHg) is over
+     * the same sites. The force (N) is the traction at the wall sites times the
+     * area of wall each stands for, less that from the reference pressure. A site
+     * by a plane stands for the voxel area divided by max_i |c_i.n|, the depth of
+     * the layer of sites with a link across it, so tilted planes aren't
+     * overcounted.
+     */
+    class ReductionActor : public net::IteratedAction
+    {
+      public:
+        /**
+         * Finds the sites of each iolet and the wall on this core, and, on the IO
+         * proc, opens the file and writes the column names.
+         * @param simulationState
+         * @param outputSpec
+         * @param latticeData
+         * @param propertyCache
+         * @param inlets
+         * @param outlets
+         * @param unitConverter
+         * @param timers
+         * @param ioComms
+         */
+        ReductionActor(const lb::SimulationState& simulationState,
+                       const ReductionOutputFile& outputSpec,
+                       const geometry::LatticeData& latticeData,
+                       const lb::MacroscopicPropertyCache& propertyCache,
+                       const std::vector<lb::iolets::InOutLet*>& inlets,
+                       const std::vector<lb::iolets::InOutLet*>& outlets,
+                       const util::UnitConverter& unitConverter,
+                       reporting::Timers& timers,
+                       const net::IOCommunicator& ioComms);
+
+        ~ReductionActor();
+
+        /**
+         * Whether the quantities are written on the given timestep.
+         * @param timestepNumber
+         * @return
+         */
+        bool ShouldWrite(unsigned long timestepNumber) const;
+
+        /**
+         * Set which properties will be required this iteration.
+         * @param propertyCache
+         */
+        void SetRequiredProperties(lb::MacroscopicPropertyCache& propertyCache) const;
+
+        /**
+         * Override the iterated actor end of iteration method to reduce and write.
+         */
+        void EndIteration();
+
+      private:
+        /**
+         * This core's sums over its sites: for each iolet, the velocity along its
+         * normal times the area each site stands for, and the density; then the
+         * traction at the walls times the area each site stands for.
+         * @param sums
+         */
+        void SumLocalSites(std::vector<double>& sums) const;
+
+        const lb::SimulationState& simulationState;
+        const ReductionOutputFile& outputSpec;
+        const geometry::LatticeData& latticeData;
+        const lb::MacroscopicPropertyCache& propertyCache;
+        const util::UnitConverter& unitConverter;
+        reporting::Timers& timers;
+        const net::IOCommunicator& comms;
+
+        /**
+         * The inlets' then the outlets' normals.
+         */
+        std::vector<util::Vector3D<Dimensionless> > ioletNormals;
+
+        /**
+         * The area of each iolet, in voxel areas, that each of its sites stands for.
+         */
+        std::vector<double> ioletAreasPerSite;
+
+        /**
+         * This core's iolet sites, and the index of each's iolet in ioletNormals.
+         */
+        std::vector<site_t> ioletSites;
+        std::vector<unsigned> ioletIndices;
+
+        /**
+         * This core's wall sites, and the area of wall, in voxel areas, that each
+         * stands for.
+         */
+        std::vector<site_t> wallSites;
+        std::vector<double> wallAreasPerSite;
+
+        /**
+         * The number of sites of each iolet over all cores; only on the IO proc.
+         */
+        std::vector<site_t> ioletSiteCounts;
+
+        /**
+         * The file written to; only on the IO proc.
+         */
+        io::writers::ascii::AsciiFileWriter* writer;
+    };
+  }
+}
+
+#endif /* HEMELB_EXTRACTION_REDUCTIONACTOR_H */
@@ -0,0 +1,30 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#include "extraction/StridedGeometrySelector.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    StridedGeometrySelector::StridedGeometrySelector(site_t stride) :
+        stride(stride)
+    {
+
+    }
+
+    site_t StridedGeometrySelector::GetStride() const
+    {
+      return stride;
+    }
+
+    bool StridedGeometrySelector::IsWithinGeometry(const extraction::IterableDataSource& data,
+                                                   const util::Vector3D<site_t>& location)
+    {
+      return (location.x % stride) == 0 && (location.y % stride) == 0 && (location.z % stride) == 0;
+    }
+  }
+}
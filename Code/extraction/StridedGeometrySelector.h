@@ -0,0 +1,55 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_EXTRACTION_STRIDEDGEOMETRYSELECTOR_H
+#define HEMELB_EXTRACTION_STRIDEDGEOMETRYSELECTOR_H
+
+#include "extraction/GeometrySelector.h"
+
+namespace hemelb
+{
+  namespace extraction
+  {
+    /**
+     * Selects every stride-th site along each axis, e.g. for previews at a fraction
+     * of the size of the whole geometry.
+     */
+    class StridedGeometrySelector : public GeometrySelector
+    {
+      public:
+        /**
+         * Constructor makes a selector for the sites whose coordinates are all
+         * multiples of the stride.
+         * @param stride
+         */
+        StridedGeometrySelector(site_t stride);
+
+        /**
+         * Returns the stride.
+         * @return
+         */
+        site_t GetStride() const;
+
+      protected:
+        /**
+         * Returns true for locations whose coordinates are all multiples of the stride.
+         *
+         * @param data
+         * @param location
+         * @return
+         */
+        bool IsWithinGeometry(const extraction::IterableDataSource& data, const util::Vector3D<site_t>& location);
+
+      private:
+        /**
+         * The distance, in lattice units, between selected sites along each axis.
+         */
+        const site_t stride;
+    };
+  }
+}
+
+#endif /* HEMELB_EXTRACTION_STRIDEDGEOMETRYSELECTOR_H */
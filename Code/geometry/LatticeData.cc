@@ -4,10 +4,13 @@
 // file AUTHORS. This software is provided under the terms of the
 // license in the file LICENSE.
 
+#include <algorithm>
+#include <cmath>
 #include <map>
 #include <limits>
 
 #include "debug/Debugger.h"
+#include "Exception.h"
 #include "logging/Logger.h"
 #include "net/IOCommunicator.h"
 #include "geometry/BlockTraverser.h"
@@ -20,7 +23,9 @@ namespace hemelb
   namespace geometry
   {
     LatticeData::LatticeData(const lb::lattices::LatticeInfo& latticeInfo, const net::IOCommunicator& comms_) :
-        latticeInfo(latticeInfo), neighbouringData(new neighbouring::NeighbouringLatticeData(latticeInfo)), comms(comms_)
+        latticeInfo(latticeInfo), inPlaceStreaming(false), oddInPlaceStep(false), siteOrdering(BLOCK_ORDER),
+            streamingDistance(0.0),
+            neighbouringData(new neighbouring::NeighbouringLatticeData(latticeInfo)), comms(comms_)
     {
     }
 
@@ -29,8 +34,14 @@ namespace hemelb
       delete neighbouringData;
     }
 
-    LatticeData::LatticeData(const lb::lattices::LatticeInfo& latticeInfo, const Geometry& readResult, const net::IOCommunicator& comms_) :
-        latticeInfo(latticeInfo), neighbouringData(new neighbouring::NeighbouringLatticeData(latticeInfo)), comms(comms_)
+    LatticeData::LatticeData(const lb::lattices::LatticeInfo& latticeInfo,
+                             const Geometry& readResult,
+                             const net::IOCommunicator& comms_,
+                             bool inPlaceStreaming,
+                             SiteOrdering siteOrdering) :
+        latticeInfo(latticeInfo), inPlaceStreaming(inPlaceStreaming), oddInPlaceStep(false),
+            siteOrdering(siteOrdering), streamingDistance(0.0),
+            neighbouringData(new neighbouring::NeighbouringLatticeData(latticeInfo)), comms(comms_)
     {
       SetBasicDetails(readResult.GetBlockDimensions(),
                       readResult.GetBlockSize());
@@ -53,6 +64,7 @@ namespace hemelb
       CollectGlobalSiteExtrema();
 
       InitialiseNeighbourLookups();
+      CollectStreamingDistance();
     }
 
     void LatticeData::InitialiseGPU()
@@ -62,12 +74,12 @@ namespace hemelb
       CUDA_SAFE_CALL(cudaMemcpyAsync(siteData_dev, siteData.data(), localFluidSites * sizeof(SiteData), cudaMemcpyHostToDevice));
 
       // initialize GPU buffer for streaming indices
-      CUDA_SAFE_CALL(cudaMalloc(&streamingIndices_dev, latticeInfo.GetNumVectors() * localFluidSites * sizeof(site_t)));
-      CUDA_SAFE_CALL(cudaMemcpyAsync(streamingIndices_dev, neighbourIndices.data(), latticeInfo.GetNumVectors() * localFluidSites * sizeof(site_t), cudaMemcpyHostToDevice));
+      CUDA_SAFE_CALL(cudaMalloc(&streamingIndices_dev, latticeInfo.GetNumVectors() * localFluidSites * sizeof(streaming_index_t)));
+      CUDA_SAFE_CALL(cudaMemcpyAsync(streamingIndices_dev, neighbourIndices.data(), latticeInfo.GetNumVectors() * localFluidSites * sizeof(streaming_index_t), cudaMemcpyHostToDevice));
 
       // initialize GPU buffer for shared streaming indices
-      CUDA_SAFE_CALL(cudaMalloc(&streamingIndicesForReceivedDistributions_dev, totalSharedFs * sizeof(site_t)));
-      CUDA_SAFE_CALL(cudaMemcpyAsync(streamingIndicesForReceivedDistributions_dev, streamingIndicesForReceivedDistributions.data(), totalSharedFs * sizeof(site_t), cudaMemcpyHostToDevice));
+      CUDA_SAFE_CALL(cudaMalloc(&streamingIndicesForReceivedDistributions_dev, totalSharedFs * sizeof(streaming_index_t)));
+      CUDA_SAFE_CALL(cudaMemcpyAsync(streamingIndicesForReceivedDistributions_dev, streamingIndicesForReceivedDistributions.data(), totalSharedFs * sizeof(streaming_index_t), cudaMemcpyHostToDevice));
 
       // prepare streaming indices
       PrepareStreamingIndicesGPU();
@@ -297,6 +309,39 @@ namespace hemelb
                            domainEdgeWallDistance);
     }
 
+    std::vector<site_t> LatticeData::GetOrderWithinCollisionType(const std::vector<site_t>& blockNumbers,
+                                                                 const std::vector<site_t>& siteNumbers) const
+    {
+      std::vector<site_t> order(blockNumbers.size());
+      if (siteOrdering == BLOCK_ORDER)
+      {
+        for (site_t position = 0; position < (site_t) order.size(); ++position)
+        {
+          order[position] = position;
+        }
+        return order;
+      }
+
+      // Sort the sites by their key along the curve.
+      std::vector<std::pair<uint64_t, site_t> > keys(blockNumbers.size());
+      for (site_t index = 0; index < (site_t) keys.size(); ++index)
+      {
+        const util::Vector3D<site_t> coords = GetGlobalCoords(blockNumbers[index],
+                                                              GetSiteCoordsFromSiteId(siteNumbers[index]));
+        keys[index].first = siteOrdering == MORTON_ORDER ?
+          GetMortonKey(coords) :
+          GetHilbertKey(coords);
+        keys[index].second = index;
+      }
+      std::sort(keys.begin(), keys.end());
+
+      for (site_t position = 0; position < (site_t) order.size(); ++position)
+      {
+        order[position] = keys[position].second;
+      }
+      return order;
+    }
+
     void LatticeData::CollectFluidSiteDistribution()
     {
       hemelb::logging::Logger::Log<hemelb::logging::Debug, hemelb::logging::Singleton>("Gathering lattice info.");
@@ -355,6 +400,37 @@ namespace hemelb
       }
     }
 
+    void LatticeData::CollectStreamingDistance()
+    {
+      // Average over the links between local fluid sites; those to other ranks and
+      // to the rubbish site say nothing about the order. The mean is geometric
+      // because a few links between collision types span most of the array
+      // whatever the order, and would swamp an arithmetic mean.
+      const site_t localDistributions = localFluidSites * latticeInfo.GetNumVectors();
+      std::vector<double> logDistanceAndLinks(2, 0.0);
+      for (site_t siteIndex = 0; siteIndex < localFluidSites; ++siteIndex)
+      {
+        for (Direction direction = 1; direction < latticeInfo.GetNumVectors(); ++direction)
+        {
+          const site_t streamedIndex = neighbourIndices[siteIndex * latticeInfo.GetNumVectors() + direction];
+          if (streamedIndex < localDistributions)
+          {
+            const site_t streamedSite = streamedIndex / latticeInfo.GetNumVectors();
+            logDistanceAndLinks[0] += std::log(1.0 + std::abs(double(streamedSite - siteIndex)));
+            logDistanceAndLinks[1] += 1.0;
+          }
+        }
+      }
+
+      logDistanceAndLinks = comms.AllReduce(logDistanceAndLinks, MPI_SUM);
+      streamingDistance = logDistanceAndLinks[1] == 0.0 ?
+        0.0 :
+        std::exp(logDistanceAndLinks[0] / logDistanceAndLinks[1]) - 1.0;
+
+      logging::Logger::Log<logging::Info, logging::Singleton>("Typical streaming distance between local sites: %.1f sites",
+                                                              streamingDistance);
+    }
+
     void LatticeData::InitialiseNeighbourLookups()
     {
       // Allocate the index in which to put the distribution functions received from the other
@@ -371,6 +447,16 @@ namespace hemelb
             + 1 + totalSharedDistributionsSoFar;
         totalSharedDistributionsSoFar += neighbouringProcs[neighbourId].SharedDistributionCount;
       }
+      // Every distribution, including the rubbish site and the shared ones, must be
+      // indexable in the streaming tables.
+      const site_t distributionCount = GetLocalFluidSiteCount() * latticeInfo.GetNumVectors() + 1
+          + totalSharedDistributionsSoFar;
+      if (uint64_t(distributionCount) > uint64_t(std::numeric_limits<streaming_index_t>::max()))
+      {
+        throw Exception() << "Rank " << comms.Rank() << " has " << distributionCount
+            << " distributions, too many for " << 8 * sizeof(streaming_index_t)
+            << "-bit streaming indices. Rebuild with HEMELB_WIDE_STREAMING_INDICES or use more ranks.";
+      }
       InitialiseNeighbourLookup(sharedDistributionLocationForEachProc);
       InitialisePointToPointComms(sharedDistributionLocationForEachProc);
       InitialiseReceiveLookup(sharedDistributionLocationForEachProc);
@@ -711,20 +797,67 @@ namespace hemelb
     {
       for (auto& proc : neighbouringProcs)
       {
+        distribn_t* receiveBuffer = GetFOld(proc.FirstSharedDistribution);
+        distribn_t* sendBuffer = GetFNew(proc.FirstSharedDistribution);
+
+        // With in-place streaming, on even steps the distributions to send are
+        // gathered into the exchange buffer (see PrepareSends) and those
+        // received go straight to where the odd step will read them. On odd
+        // steps the sites stream into the shared distributions as usual, so
+        // those are sent, and the ones received are copied to the sites from
+        // the exchange buffer (see CopyReceived).
+        if (inPlaceStreaming)
+        {
+          distribn_t* exchangeBuffer = &inPlaceExchangeBuffer[proc.FirstSharedDistribution
+              - (localFluidSites * latticeInfo.GetNumVectors() + 1)];
+          if (oddInPlaceStep)
+          {
+            receiveBuffer = exchangeBuffer;
+          }
+          else
+          {
+            sendBuffer = exchangeBuffer;
+          }
+        }
+
         // Request the receive into the appropriate bit of FOld.
-        net->RequestReceive<distribn_t>(GetFOld(proc.FirstSharedDistribution),
-                                        (int) (proc.SharedDistributionCount),
-                                        proc.Rank);
+        net->RequestReceive<distribn_t>(receiveBuffer, (int) (proc.SharedDistributionCount), proc.Rank);
 
         // Request the send from the right bit of FNew.
-        net->RequestSend<distribn_t>(GetFNew(proc.FirstSharedDistribution),
-                                     (int) (proc.SharedDistributionCount),
-                                     proc.Rank);
+        net->RequestSend<distribn_t>(sendBuffer, (int) (proc.SharedDistributionCount), proc.Rank);
+      }
+    }
+
+    void LatticeData::PrepareSends()
+    {
+      if (!inPlaceStreaming || oddInPlaceStep)
+      {
+        return;
+      }
+
+      // After an even in-place step, each distribution heading for another
+      // processor is in the sending site's slot for the opposite direction,
+      // which is where a received one would be copied to.
+      for (site_t i = 0; i < totalSharedFs; i++)
+      {
+        inPlaceExchangeBuffer[i] = *GetFNew(streamingIndicesForReceivedDistributions[i]);
       }
     }
 
     void LatticeData::CopyReceived()
     {
+      if (inPlaceStreaming)
+      {
+        if (oddInPlaceStep)
+        {
+          for (site_t i = 0; i < totalSharedFs; i++)
+          {
+            *GetFNew(streamingIndicesForReceivedDistributions[i]) = inPlaceExchangeBuffer[i];
+          }
+        }
+        return;
+      }
+
       // Copy the distribution functions received from the neighbouring
       // processors into the destination buffer "f_new".
       for (site_t i = 0; i < totalSharedFs; i++)
@@ -750,6 +883,7 @@ namespace hemelb
       dictionary.SetIntValue("SITES", GetTotalFluidSites());
       dictionary.SetIntValue("BLOCKS", blockCount);
       dictionary.SetIntValue("SITESPERBLOCK", sitesPerBlockVolumeUnit);
+      dictionary.SetFormattedValue("STREAMINGDISTANCE", "%.2lf", streamingDistance);
       for (size_t n = 0; n < fluidSitesOnEachProcessor.size(); n++)
       {
         reporting::Dict proc = dictionary.AddSectionDictionary("PROCESSOR");
@@ -23,8 +23,8 @@ using namespace hemelb::lb;
 
 __global__
 void TransposeStreamingIndicesKernel(
-  const site_t* neighbourIndices,
-  site_t* streamingIndices,
+  const streaming_index_t* neighbourIndices,
+  streaming_index_t* streamingIndices,
   site_t nSites,
   site_t nDirections
 )
@@ -63,7 +63,7 @@ void TransposeStreamingIndicesKernel(
 
 __global__
 void TransposeStreamingIndicesSharedKernel(
-  site_t* streamingIndicesForReceivedDistributions,
+  streaming_index_t* streamingIndicesForReceivedDistributions,
   site_t totalSharedFs,
   site_t nSites,
   site_t nDirections
@@ -90,7 +90,7 @@ void TransposeStreamingIndicesSharedKernel(
 
 __global__
 void PrepareStreamingIndicesKernel(
-  site_t* streamingIndices,
+  streaming_index_t* streamingIndices,
   const geometry::SiteData* siteData,
   site_t nSites,
   site_t nDirections
@@ -126,8 +126,8 @@ void LatticeData::PrepareStreamingIndicesGPU()
   int gridSize = (nSites * nDirections + blockSize - 1) / blockSize;
 
   // transpose streaming indices to match SoA memory layout
-  site_t* tempIndices_dev;
-  CUDA_SAFE_CALL(cudaMalloc(&tempIndices_dev, latticeInfo.GetNumVectors() * localFluidSites * sizeof(site_t)));
+  streaming_index_t* tempIndices_dev;
+  CUDA_SAFE_CALL(cudaMalloc(&tempIndices_dev, latticeInfo.GetNumVectors() * localFluidSites * sizeof(streaming_index_t)));
 
   TransposeStreamingIndicesKernel<<<gridSize, blockSize>>>(
     streamingIndices_dev,
@@ -163,7 +163,7 @@ void LatticeData::PrepareStreamingIndicesGPU()
 
 __global__
 void CopyReceivedKernel(
-  const site_t* streamingIndicesForReceivedDistributions,
+  const streaming_index_t* streamingIndicesForReceivedDistributions,
   const distribn_t* fOldShared,
   distribn_t* fNew,
   site_t totalSharedFs
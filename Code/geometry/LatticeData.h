@@ -19,6 +19,7 @@
 #include "geometry/Site.h"
 #include "geometry/neighbouring/NeighbouringSite.h"
 #include "geometry/SiteData.h"
+#include "geometry/SiteOrdering.h"
 #include "cuda_helper.h"
 #include "reporting/Reportable.h"
 #include "reporting/Timers.h"
@@ -40,25 +41,87 @@ namespace hemelb
         template<class Lattice> friend class lb::LBM; //! Let the LBM have access to internals so it can initialise the distribution arrays.
         template<class LatticeData> friend class Site; //! Let the inner classes have access to site-related data that's otherwise private.
 
-        LatticeData(const lb::lattices::LatticeInfo& latticeInfo, const Geometry& readResult, const net::IOCommunicator& comms);
+        LatticeData(const lb::lattices::LatticeInfo& latticeInfo,
+                    const Geometry& readResult,
+                    const net::IOCommunicator& comms,
+                    bool inPlaceStreaming = false,
+                    SiteOrdering siteOrdering = BLOCK_ORDER);
 
         virtual ~LatticeData();
 
         void InitialiseGPU();
 
         /**
-         * Swap the fOld and fNew arrays around.
+         * Swap the fOld and fNew arrays around. With in-place streaming there
+         * is only one array, so this just moves on to the other kind of step.
          */
         inline void SwapOldAndNew()
         {
+          if (inPlaceStreaming)
+          {
+            oddInPlaceStep = !oddInPlaceStep;
+            return;
+          }
+
           std::swap(oldDistributions, newDistributions);
           std::swap(oldDistributions_dev, newDistributions_dev);
         }
 
+        /**
+         * Whether the distributions are streamed in place (the "AA pattern"),
+         * so that fOld and fNew are the same array and the steps alternate:
+         *
+         * - on an even step, each site reads its own distributions and writes
+         *   the post-collision ones back to its own slots for the opposite
+         *   directions;
+         * - on an odd step, each site reads the distribution in direction i
+         *   from GetStreamedIndex for the opposite direction (or from its own
+         *   slot for i, if the opposite link is to a wall or iolet) and streams
+         *   the post-collision ones as usual.
+         *
+         * Every slot is read and written by just one site in each step, so the
+         * order of the sites doesn't matter. After an odd step the
+         * distributions are laid out as usual; after an even step each site's
+         * are reversed.
+         * @return
+         */
+        inline bool IsInPlaceStreaming() const
+        {
+          return inPlaceStreaming;
+        }
+
+        /**
+         * @return whether the current step is an odd one, with in-place streaming
+         */
+        inline bool IsOddInPlaceStep() const
+        {
+          return oddInPlaceStep;
+        }
+
+        /**
+         * @return the order of the local sites within each collision type
+         */
+        inline SiteOrdering GetSiteOrdering() const
+        {
+          return siteOrdering;
+        }
+
+        /**
+         * A measure of how well the site ordering suits streaming: over all ranks
+         * and all links between local fluid sites, the geometric mean of one plus
+         * the difference between the contiguous indices of the two sites, less one.
+         * @return
+         */
+        inline double GetStreamingDistance() const
+        {
+          return streamingDistance;
+        }
+
         void PrepareStreamingIndicesGPU();
 
         void SendAndReceiveGPU(net::Net* net);
         void SendAndReceive(net::Net* net);
+        void PrepareSends();
         void CopyReceivedGPU(int blockSize);
         void CopyReceived();
 
@@ -197,7 +260,7 @@ namespace hemelb
           return &newDistributions[distributionIndex];
         }
 
-        inline site_t* GetStreamingIndicesGPU()
+        inline streaming_index_t* GetStreamingIndicesGPU()
         {
           return streamingIndices_dev;
         }
@@ -284,7 +347,7 @@ namespace hemelb
         }
 
 
-        const std::vector<site_t>& GetNeighbourIndices() const
+        const std::vector<streaming_index_t>& GetNeighbourIndices() const
         {
             return neighbourIndices;
         }
@@ -410,6 +473,16 @@ namespace hemelb
 
         void ProcessReadSites(const Geometry& readResult);
 
+        /**
+         * The order in which to number the sites of one collision type, as
+         * positions in the lists of their block and site numbers.
+         * @param blockNumbers
+         * @param siteNumbers
+         * @return
+         */
+        std::vector<site_t> GetOrderWithinCollisionType(const std::vector<site_t>& blockNumbers,
+                                                        const std::vector<site_t>& siteNumbers) const;
+
         void PopulateWithReadData(const std::vector<site_t> midDomainBlockNumbers[COLLISION_TYPES],
                                   const std::vector<site_t> midDomainSiteNumbers[COLLISION_TYPES],
                                   const std::vector<SiteData> midDomainSiteData[COLLISION_TYPES],
@@ -432,8 +505,12 @@ namespace hemelb
           // Data about contiguous local sites. First midDomain stuff, then domainEdge.
           for (unsigned collisionType = 0; collisionType < COLLISION_TYPES; collisionType++)
           {
-            for (unsigned indexInType = 0; indexInType < midDomainProcCollisions[collisionType]; indexInType++)
+            const std::vector<site_t> order =
+                GetOrderWithinCollisionType(midDomainBlockNumbers[collisionType],
+                                            midDomainSiteNumbers[collisionType]);
+            for (unsigned position = 0; position < midDomainProcCollisions[collisionType]; position++)
             {
+              const site_t indexInType = order[position];
               siteData.push_back(midDomainSiteData[collisionType][indexInType]);
               wallNormalAtSite.push_back(midDomainWallNormals[collisionType][indexInType]);
               for (Direction direction = 1; direction < latticeInfo.GetNumVectors(); direction++)
@@ -452,8 +529,12 @@ namespace hemelb
 
           for (unsigned collisionType = 0; collisionType < COLLISION_TYPES; collisionType++)
           {
-            for (unsigned indexInType = 0; indexInType < domainEdgeProcCollisions[collisionType]; indexInType++)
+            const std::vector<site_t> order =
+                GetOrderWithinCollisionType(domainEdgeBlockNumbers[collisionType],
+                                            domainEdgeSiteNumbers[collisionType]);
+            for (unsigned position = 0; position < domainEdgeProcCollisions[collisionType]; position++)
             {
+              const site_t indexInType = order[position];
               siteData.push_back(domainEdgeSiteData[collisionType][indexInType]);
               wallNormalAtSite.push_back(domainEdgeWallNormals[collisionType][indexInType]);
               for (Direction direction = 1; direction < latticeInfo.GetNumVectors(); direction++)
@@ -471,11 +552,20 @@ namespace hemelb
           }
 
           oldDistributions = new distribn_t[localFluidSites * latticeInfo.GetNumVectors() + 1 + totalSharedFs];
-          newDistributions = new distribn_t[localFluidSites * latticeInfo.GetNumVectors() + 1 + totalSharedFs];
+          if (inPlaceStreaming)
+          {
+            newDistributions = oldDistributions;
+            inPlaceExchangeBuffer.resize(totalSharedFs);
+          }
+          else
+          {
+            newDistributions = new distribn_t[localFluidSites * latticeInfo.GetNumVectors() + 1 + totalSharedFs];
+          }
         }
 
         void CollectFluidSiteDistribution();
         void CollectGlobalSiteExtrema();
+        void CollectStreamingDistance();
 
         void InitialiseNeighbourLookups();
 
@@ -496,7 +586,8 @@ namespace hemelb
                                          const unsigned int direction,
                                          const site_t distributionIndex)
         {
-          neighbourIndices[siteIndex * latticeInfo.GetNumVectors() + direction] = distributionIndex;
+          neighbourIndices[siteIndex * latticeInfo.GetNumVectors() + direction] =
+              (streaming_index_t) distributionIndex;
         }
 
         void GetBlockIJK(site_t block, util::Vector3D<site_t>& blockCoords) const;
@@ -604,7 +695,12 @@ namespace hemelb
         site_t domainEdgeProcCollisions[COLLISION_TYPES]; //! Number of fluid sites with at least one fluid neighbour on another rank, for each collision type.
         site_t localFluidSites; //! The number of local fluid sites.
         distribn_t* oldDistributions; //! The distribution values for the previous time step.
-        distribn_t* newDistributions; //! The distribution values for the next time step.
+        distribn_t* newDistributions; //! The distribution values for the next time step (the same array as oldDistributions with in-place streaming).
+        bool inPlaceStreaming; //! Whether the distributions are streamed in place.
+        bool oddInPlaceStep; //! With in-place streaming, whether the current step is an odd one.
+        std::vector<distribn_t> inPlaceExchangeBuffer; //! With in-place streaming, the distributions sent on even steps and received on odd ones.
+        SiteOrdering siteOrdering; //! The order of the local sites within each collision type.
+        double streamingDistance; //! The typical distance in contiguous indices streamed between local sites (see GetStreamingDistance).
         std::vector<Block> blocks; //! Data where local fluid sites are stored contiguously.
 
         std::vector<distribn_t> distanceToWall; //! Hold the distance to the wall for each fluid site.
@@ -614,14 +710,14 @@ namespace hemelb
         std::vector<site_t> fluidSitesOnEachProcessor; //! Array containing numbers of fluid sites on each processor.
         site_t totalFluidSites; //! The total number of fluid sites in the geometry.
         util::Vector3D<site_t> globalSiteMins, globalSiteMaxes; //! The minimal and maximal coordinates of any fluid sites.
-        std::vector<site_t> neighbourIndices; //! Data about neighbouring fluid sites.
-        std::vector<site_t> streamingIndicesForReceivedDistributions; //! The indices to stream to for distributions received from other processors.
+        std::vector<streaming_index_t> neighbourIndices; //! Data about neighbouring fluid sites.
+        std::vector<streaming_index_t> streamingIndicesForReceivedDistributions; //! The indices to stream to for distributions received from other processors.
         neighbouring::NeighbouringLatticeData *neighbouringData;
         const net::IOCommunicator& comms;
 
         // GPU buffers
-        site_t* streamingIndices_dev;
-        site_t* streamingIndicesForReceivedDistributions_dev;
+        streaming_index_t* streamingIndices_dev;
+        streaming_index_t* streamingIndicesForReceivedDistributions_dev;
         SiteData* siteData_dev;
         distribn_t* oldDistributions_dev;
         distribn_t* newDistributions_dev;
@@ -0,0 +1,105 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#include "geometry/SiteOrdering.h"
+#include "Exception.h"
+
+namespace hemelb
+{
+  namespace geometry
+  {
+    namespace
+    {
+      /**
+       * Interleaves the bits of the three coordinates, most significant first and
+       * x before y before z at each level.
+       */
+      uint64_t Interleave(const uint64_t coords[3])
+      {
+        uint64_t key = 0;
+        for (int bit = SPACE_FILLING_CURVE_BITS - 1; bit >= 0; --bit)
+        {
+          for (unsigned dim = 0; dim < 3; ++dim)
+          {
+            key = (key << 1) | ( (coords[dim] >> bit) & 1);
+          }
+        }
+        return key;
+      }
+    }
+
+    SiteOrdering GetSiteOrderingFromName(const std::string& name)
+    {
+      if (name == "block")
+      {
+        return BLOCK_ORDER;
+      }
+      if (name == "morton")
+      {
+        return MORTON_ORDER;
+      }
+      if (name == "hilbert")
+      {
+        return HILBERT_ORDER;
+      }
+      throw Exception() << "Unknown site ordering '" << name
+          << "'; expected one of 'block', 'morton' or 'hilbert'";
+    }
+
+    uint64_t GetMortonKey(const util::Vector3D<site_t>& coords)
+    {
+      const uint64_t axes[3] = { uint64_t(coords.x), uint64_t(coords.y), uint64_t(coords.z) };
+      return Interleave(axes);
+    }
+
+    uint64_t GetHilbertKey(const util::Vector3D<site_t>& coords)
+    {
+      // Skilling's algorithm (AIP Conf. Proc. 707, 381 (2004)): transform the
+      // coordinates in place into the "transposed" Hilbert index, whose
+      // interleaved bits are the index itself.
+      uint64_t axes[3] = { uint64_t(coords.x), uint64_t(coords.y), uint64_t(coords.z) };
+      const uint64_t highest = uint64_t(1) << (SPACE_FILLING_CURVE_BITS - 1);
+
+      for (uint64_t q = highest; q > 1; q >>= 1)
+      {
+        const uint64_t p = q - 1;
+        for (unsigned dim = 0; dim < 3; ++dim)
+        {
+          if (axes[dim] & q)
+          {
+            // Invert the low bits of x.
+            axes[0] ^= p;
+          }
+          else
+          {
+            // Exchange the low bits of x and this axis.
+            const uint64_t t = (axes[0] ^ axes[dim]) & p;
+            axes[0] ^= t;
+            axes[dim] ^= t;
+          }
+        }
+      }
+
+      // Gray encode.
+      axes[1] ^= axes[0];
+      axes[2] ^= axes[1];
+      uint64_t t = 0;
+      for (uint64_t q = highest; q > 1; q >>= 1)
+      {
+        if (axes[2] & q)
+        {
+          t ^= q - 1;
+        }
+      }
+      for (unsigned dim = 0; dim < 3; ++dim)
+      {
+        axes[dim] ^= t;
+      }
+
+      return Interleave(axes);
+    }
+  }
+}
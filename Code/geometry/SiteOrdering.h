@@ -0,0 +1,73 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_GEOMETRY_SITEORDERING_H
+#define HEMELB_GEOMETRY_SITEORDERING_H
+
+#include <string>
+#include <stdint.h>
+
+#include "units.h"
+#include "util/Vector3D.h"
+
+namespace hemelb
+{
+  namespace geometry
+  {
+    /**
+     * The order in which a rank's fluid sites are given their local contiguous
+     * indices, within each range of sites with the same collision type (see
+     * LatticeData::PopulateWithReadData).
+     */
+    enum SiteOrdering
+    {
+      /**
+       * Block by block, in the order the blocks were read, and within a block by
+       * site id. Sites a lattice vector apart can be a whole block apart in memory.
+       */
+      BLOCK_ORDER,
+      /**
+       * Along a Morton (Z-order) curve through the global site coordinates.
+       */
+      MORTON_ORDER,
+      /**
+       * Along a Hilbert curve through the global site coordinates. Consecutive
+       * points on the curve are always lattice neighbours.
+       */
+      HILBERT_ORDER
+    };
+
+    /**
+     * The ordering with the given name, one of "block", "morton" or "hilbert";
+     * throws for any other.
+     * @param name
+     * @return
+     */
+    SiteOrdering GetSiteOrderingFromName(const std::string& name);
+
+    /**
+     * The position of a site along the Morton curve: the bits of its x, y and z
+     * coordinates interleaved, most significant first. Each coordinate must be
+     * non-negative and less than 2^SPACE_FILLING_CURVE_BITS.
+     * @param coords
+     * @return
+     */
+    uint64_t GetMortonKey(const util::Vector3D<site_t>& coords);
+
+    /**
+     * The position of a site along the Hilbert curve that starts at the origin and
+     * fills the cube of side 2^SPACE_FILLING_CURVE_BITS.
+     * @param coords
+     * @return
+     */
+    uint64_t GetHilbertKey(const util::Vector3D<site_t>& coords);
+
+    //! The number of bits per coordinate in a space-filling curve key.
+    static const unsigned SPACE_FILLING_CURVE_BITS = 21;
+  }
+}
+
+#endif /* HEMELB_GEOMETRY_SITEORDERING_H */
@@ -21,7 +21,8 @@ namespace hemelb
           const LatticeData & localLatticeData, NeighbouringLatticeData & neighbouringLatticeData,
           net::InterfaceDelegationNet & net) :
           localLatticeData(localLatticeData), neighbouringLatticeData(neighbouringLatticeData),
-              net(net), needsEachProcHasFromMe(net.Size()),
+              net(net), needsEachProcHasFromMe(net.Size()), receiveRanges(),
+              localIdsEachProcNeedsFromMe(net.Size()), sendBufferForEachProc(net.Size()),
               needsHaveBeenShared(false)
       {
       }
@@ -104,36 +105,33 @@ namespace hemelb
           ShareNeeds();
         }*/ ///TODO: Re-enable!
 
-        // Ordering is important here, to ensure the requests are registered in the same order
-        // on the sending and receiving procs.
-        // But, the needsEachProcHasFromMe is always ordered,
-        // by the same order, as the neededSites, so this should be OK.
-        for (std::vector<site_t>::iterator localNeed = neededSites.begin();
-            localNeed != neededSites.end(); localNeed++)
+        // The remote indices were assigned in ShareNeeds so that the sites provided by each
+        // rank are contiguous, in the same order as that rank holds them in
+        // needsEachProcHasFromMe. So one message per rank in each direction suffices.
+        const unsigned numVectors = localLatticeData.GetLatticeInfo().GetNumVectors();
+        for (std::vector<RemoteIndexRange>::const_iterator range = receiveRanges.begin();
+            range != receiveRanges.end(); ++range)
         {
-          proc_t source = ProcForSite(*localNeed);
-          NeighbouringSite site = neighbouringLatticeData.GetSite(*localNeed);
-          net.RequestReceive(site.GetFOld(localLatticeData.GetLatticeInfo().GetNumVectors()),
-                             localLatticeData.GetLatticeInfo().GetNumVectors(),
-                             source);
-
+          net.RequestReceive(neighbouringLatticeData.GetFOldByRemoteIndex(range->firstRemoteIndex),
+                             range->count * numVectors,
+                             range->source);
         }
+
         for (proc_t other = 0; other < net.Size(); other++)
         {
-          for (std::vector<site_t>::iterator needOnProcFromMe =
-              needsEachProcHasFromMe[other].begin();
-              needOnProcFromMe != needsEachProcHasFromMe[other].end(); needOnProcFromMe++)
+          const std::vector<site_t>& localIds = localIdsEachProcNeedsFromMe[other];
+          if (localIds.empty())
           {
-            site_t localContiguousId =
-                localLatticeData.GetLocalContiguousIdFromGlobalNoncontiguousId(*needOnProcFromMe);
-            Site<LatticeData> site =
-                const_cast<LatticeData&>(localLatticeData).GetSite(localContiguousId);
-            // have to cast away the const, because no respect for const-ness for sends in MPI
-            net.RequestSend(const_cast<distribn_t*>(site.GetFOld(localLatticeData.GetLatticeInfo().GetNumVectors())),
-                            localLatticeData.GetLatticeInfo().GetNumVectors(),
-                            other);
+            continue;
+          }
 
+          std::vector<distribn_t>& sendBuffer = sendBufferForEachProc[other];
+          for (site_t needIndex = 0; needIndex < (site_t) localIds.size(); ++needIndex)
+          {
+            const distribn_t* fOld = localLatticeData.GetFOld(localIds[needIndex] * numVectors);
+            std::copy(fOld, fOld + numVectors, &sendBuffer[needIndex * numVectors]);
           }
+          net.RequestSend(&sendBuffer.front(), sendBuffer.size(), other);
         }
       }
 
@@ -177,6 +175,43 @@ namespace hemelb
         }
 
         net.Dispatch();
+
+        // Lay out the neighbouring data so that the sites needed from each rank are
+        // contiguous, and record the ranges to receive into.
+        std::vector<site_t> remoteIndexOrder;
+        remoteIndexOrder.reserve(neededSites.size());
+        receiveRanges.clear();
+        for (proc_t other = 0; other < netSize; other++)
+        {
+          if (needsIHaveFromEachProc[other].empty())
+          {
+            continue;
+          }
+          RemoteIndexRange range;
+          range.source = other;
+          range.firstRemoteIndex = remoteIndexOrder.size();
+          range.count = needsIHaveFromEachProc[other].size();
+          receiveRanges.push_back(range);
+          remoteIndexOrder.insert(remoteIndexOrder.end(),
+                                  needsIHaveFromEachProc[other].begin(),
+                                  needsIHaveFromEachProc[other].end());
+        }
+        neighbouringLatticeData.AssignRemoteIndices(remoteIndexOrder);
+
+        // Resolve the local sites every other rank needs from me, once.
+        const unsigned numVectors = localLatticeData.GetLatticeInfo().GetNumVectors();
+        for (proc_t other = 0; other < netSize; other++)
+        {
+          localIdsEachProcNeedsFromMe[other].resize(needsEachProcHasFromMe[other].size());
+          for (site_t needIndex = 0; needIndex < (site_t) needsEachProcHasFromMe[other].size();
+              ++needIndex)
+          {
+            localIdsEachProcNeedsFromMe[other][needIndex] =
+                localLatticeData.GetLocalContiguousIdFromGlobalNoncontiguousId(needsEachProcHasFromMe[other][needIndex]);
+          }
+          sendBufferForEachProc[other].resize(needsEachProcHasFromMe[other].size() * numVectors);
+        }
+
         needsHaveBeenShared = true;
       }
     }
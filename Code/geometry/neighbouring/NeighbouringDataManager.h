@@ -51,6 +51,17 @@ namespace hemelb
         protected:
           void RequestComms();
         private:
+          /**
+           * A contiguous run of remote indices in the NeighbouringLatticeData, all
+           * provided by the same rank.
+           */
+          struct RemoteIndexRange
+          {
+              proc_t source;
+              site_t firstRemoteIndex;
+              site_t count;
+          };
+
           const LatticeData & localLatticeData;
           NeighbouringLatticeData & neighbouringLatticeData;
           net::InterfaceDelegationNet & net;
@@ -58,6 +69,13 @@ namespace hemelb
           std::vector<site_t> neededSites;
           std::vector<std::vector<site_t> > needsEachProcHasFromMe;
 
+          // Set up by ShareNeeds, so that transferring the field dependent information
+          // involves no site lookups: one receive per providing rank straight into the
+          // NeighbouringLatticeData, and one send per needing rank from a packed buffer.
+          std::vector<RemoteIndexRange> receiveRanges;
+          std::vector<std::vector<site_t> > localIdsEachProcNeedsFromMe;
+          std::vector<std::vector<distribn_t> > sendBufferForEachProc;
+
           bool needsHaveBeenShared;
 
       };
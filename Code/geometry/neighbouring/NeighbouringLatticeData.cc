@@ -4,6 +4,8 @@
 // file AUTHORS. This software is provided under the terms of the
 // license in the file LICENSE.
 
+#include <algorithm>
+
 #include "geometry/neighbouring/NeighbouringLatticeData.h"
 #include "geometry/neighbouring/NeighbouringSite.h"
 #include "logging/Logger.h"
@@ -15,8 +17,85 @@ namespace hemelb
     {
 
       NeighbouringLatticeData::NeighbouringLatticeData(const lb::lattices::LatticeInfo& latticeInfo) :
-          distributions(), distanceToWall(), wallNormalAtSite(), siteData(), latticeInfo(latticeInfo)
+          remoteIndexForGlobalIndex(), globalIndexForRemoteIndex(), distributions(), distanceToWall(),
+              wallNormalAtSite(), siteData(), latticeInfo(latticeInfo)
+      {
+      }
+
+      void NeighbouringLatticeData::AssignRemoteIndices(const std::vector<site_t>& globalIndices)
+      {
+        const site_t numVectors = latticeInfo.GetNumVectors();
+
+        // Work out the new order: the requested sites, then any others we already hold.
+        std::vector<site_t> newOrder(globalIndices);
+        RemoteIndexMap newRemoteIndices;
+        newRemoteIndices.reserve(globalIndexForRemoteIndex.size() + globalIndices.size());
+        for (site_t newIndex = 0; newIndex < (site_t) newOrder.size(); ++newIndex)
+        {
+          newRemoteIndices.insert(RemoteIndexMap::value_type(newOrder[newIndex], newIndex));
+        }
+        for (std::vector<site_t>::const_iterator oldSite = globalIndexForRemoteIndex.begin();
+            oldSite != globalIndexForRemoteIndex.end(); ++oldSite)
+        {
+          if (newRemoteIndices.find(*oldSite) == newRemoteIndices.end())
+          {
+            newRemoteIndices.insert(RemoteIndexMap::value_type(*oldSite, newOrder.size()));
+            newOrder.push_back(*oldSite);
+          }
+        }
+
+        std::vector<distribn_t> newDistributions(newOrder.size() * numVectors, 0.0);
+        std::vector<distribn_t> newDistanceToWall(newOrder.size() * (numVectors - 1), 0.0);
+        std::vector<util::Vector3D<distribn_t> > newWallNormalAtSite(newOrder.size(),
+                                                                     util::Vector3D<distribn_t>::Zero());
+        std::vector<SiteData> newSiteData(newOrder.size());
+
+        // Carry over anything we already hold.
+        for (site_t oldIndex = 0; oldIndex < (site_t) globalIndexForRemoteIndex.size(); ++oldIndex)
+        {
+          site_t newIndex = newRemoteIndices.find(globalIndexForRemoteIndex[oldIndex])->second;
+          std::copy(&distributions[oldIndex * numVectors],
+                    &distributions[oldIndex * numVectors] + numVectors,
+                    &newDistributions[newIndex * numVectors]);
+          std::copy(&distanceToWall[oldIndex * (numVectors - 1)],
+                    &distanceToWall[oldIndex * (numVectors - 1)] + numVectors - 1,
+                    &newDistanceToWall[newIndex * (numVectors - 1)]);
+          newWallNormalAtSite[newIndex] = wallNormalAtSite[oldIndex];
+          newSiteData[newIndex] = siteData[oldIndex];
+        }
+
+        remoteIndexForGlobalIndex.swap(newRemoteIndices);
+        globalIndexForRemoteIndex.swap(newOrder);
+        distributions.swap(newDistributions);
+        distanceToWall.swap(newDistanceToWall);
+        wallNormalAtSite.swap(newWallNormalAtSite);
+        siteData.swap(newSiteData);
+      }
+
+      site_t NeighbouringLatticeData::RegisterSite(site_t globalIndex)
+      {
+        RemoteIndexMap::const_iterator existing = remoteIndexForGlobalIndex.find(globalIndex);
+        if (existing != remoteIndexForGlobalIndex.end())
+        {
+          return existing->second;
+        }
+
+        site_t remoteIndex = globalIndexForRemoteIndex.size();
+        remoteIndexForGlobalIndex.insert(RemoteIndexMap::value_type(globalIndex, remoteIndex));
+        globalIndexForRemoteIndex.push_back(globalIndex);
+        distributions.resize(distributions.size() + latticeInfo.GetNumVectors(), 0.0);
+        distanceToWall.resize(distanceToWall.size() + latticeInfo.GetNumVectors() - 1, 0.0);
+        wallNormalAtSite.push_back(util::Vector3D<distribn_t>::Zero());
+        siteData.push_back(SiteData());
+        return remoteIndex;
+      }
+
+      site_t NeighbouringLatticeData::GetRemoteIndex(site_t globalIndex) const
       {
+        RemoteIndexMap::const_iterator existing = remoteIndexForGlobalIndex.find(globalIndex);
+        return existing == remoteIndexForGlobalIndex.end() ?
+          -1 :
+          existing->second;
       }
 
       void NeighbouringLatticeData::SaveSite(site_t index,
@@ -25,7 +104,7 @@ namespace hemelb
                                              const util::Vector3D<distribn_t> &normal,
                                              const SiteData & data)
       {
-        GetDistribution(index) = distribution;
+        SetDistribution(index, distribution);
         for (unsigned int direction = 0; direction < latticeInfo.GetNumVectors() - 1; direction++)
         {
           GetCutDistances(index)[direction] = distances[direction];
@@ -46,55 +125,54 @@ namespace hemelb
 
       const util::Vector3D<distribn_t>& NeighbouringLatticeData::GetNormalToWall(site_t globalIndex) const
       {
-        return wallNormalAtSite.find(globalIndex)->second;
+        return wallNormalAtSite[GetRemoteIndex(globalIndex)];
       }
 
       util::Vector3D<distribn_t>& NeighbouringLatticeData::GetNormalToWall(site_t globalIndex)
       {
-        return wallNormalAtSite[globalIndex];
+        return wallNormalAtSite[RegisterSite(globalIndex)];
       }
 
       distribn_t* NeighbouringLatticeData::GetFOld(site_t distributionIndex)
       {
         site_t globalIndex = distributionIndex / latticeInfo.GetNumVectors();
         site_t direction = distributionIndex % latticeInfo.GetNumVectors();
-        std::vector<distribn_t> &buffer = distributions[globalIndex];
-        buffer.resize(latticeInfo.GetNumVectors());
-        return &buffer[direction];
+        return GetFOldByRemoteIndex(RegisterSite(globalIndex)) + direction;
       }
 
-      std::vector<distribn_t>& NeighbouringLatticeData::GetDistribution(site_t globalIndex)
+      void NeighbouringLatticeData::SetDistribution(site_t globalIndex,
+                                                    const std::vector<distribn_t>& distribution)
       {
-        return distributions[globalIndex];
+        std::copy(distribution.begin(),
+                  distribution.begin() + latticeInfo.GetNumVectors(),
+                  GetFOldByRemoteIndex(RegisterSite(globalIndex)));
       }
 
       const distribn_t* NeighbouringLatticeData::GetFOld(site_t distributionIndex) const
       {
         site_t globalIndex = distributionIndex / latticeInfo.GetNumVectors();
         site_t direction = distributionIndex % latticeInfo.GetNumVectors();
-        return &distributions.find(globalIndex)->second[direction];
+        return GetFOldByRemoteIndex(GetRemoteIndex(globalIndex)) + direction;
       }
 
       const SiteData & NeighbouringLatticeData::GetSiteData(site_t globalIndex) const
       {
-        return siteData.find(globalIndex)->second;
+        return siteData[GetRemoteIndex(globalIndex)];
       }
 
       SiteData& NeighbouringLatticeData::GetSiteData(site_t globalIndex)
       {
-        return siteData[globalIndex];
+        return siteData[RegisterSite(globalIndex)];
       }
 
       const distribn_t * NeighbouringLatticeData::GetCutDistances(site_t globalIndex) const
       {
-        return &distanceToWall.find(globalIndex)->second.front();
+        return &distanceToWall[GetRemoteIndex(globalIndex) * (latticeInfo.GetNumVectors() - 1)];
       }
 
       distribn_t* NeighbouringLatticeData::GetCutDistances(site_t globalIndex)
       {
-        std::vector<distribn_t> &buffer = distanceToWall[globalIndex];
-        buffer.resize(latticeInfo.GetNumVectors() - 1);
-        return &buffer.front();
+        return &distanceToWall[RegisterSite(globalIndex) * (latticeInfo.GetNumVectors() - 1)];
       }
 
     }
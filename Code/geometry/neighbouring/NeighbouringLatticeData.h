@@ -6,10 +6,11 @@
 
 #ifndef HEMELB_GEOMETRY_NEIGHBOURING_NEIGHBOURINGLATTICEDATA_H
 #define HEMELB_GEOMETRY_NEIGHBOURING_NEIGHBOURINGLATTICEDATA_H
-#include <map>
+#include <vector>
 #include "geometry/Site.h"
 #include "geometry/SiteData.h"
 #include "lb/lattices/LatticeInfo.h"
+#include "util/FlatMap.h"
 namespace hemelb
 {
   namespace geometry
@@ -21,6 +22,12 @@ namespace hemelb
 
       // Here, all site indices are GLOBAL index.
       // Local users must determine the global index of the site they are interested in.
+      //
+      // Internally, each remote site is assigned a dense "remote index" (normally by
+      // NeighbouringDataManager::ShareNeeds, grouped by the rank providing the site) and its
+      // data are held in contiguous arrays in that order. Code that accesses the same remote
+      // sites every time step should resolve the remote index once and use the *ByRemoteIndex
+      // accessors, which avoid the global-to-remote index lookup.
 
       class NeighbouringLatticeData
       {
@@ -33,6 +40,65 @@ namespace hemelb
           {
           }
 
+          /**
+           * Assign the remote indices 0, 1, ... to the given global site indices, in order, so
+           * that they are stored contiguously. Data already held for any of the sites is kept.
+           * Sites previously registered but not in the list are moved after these.
+           * Pointers previously obtained from this object are invalidated.
+           * @param globalIndices
+           */
+          void AssignRemoteIndices(const std::vector<site_t>& globalIndices);
+
+          /**
+           * Get the remote index for a site, registering the site if it is not known yet.
+           * Registration invalidates pointers previously obtained from this object.
+           * @param globalIndex
+           * @return
+           */
+          site_t RegisterSite(site_t globalIndex);
+
+          /**
+           * Get the remote index for a site, or -1 if it has not been registered.
+           * @param globalIndex
+           * @return
+           */
+          site_t GetRemoteIndex(site_t globalIndex) const;
+
+          /**
+           * Get the number of remote sites held.
+           * @return
+           */
+          inline site_t GetRemoteSiteCount() const
+          {
+            return globalIndexForRemoteIndex.size();
+          }
+
+          /**
+           * Get the global index of the site with the given remote index.
+           * @param remoteIndex
+           * @return
+           */
+          inline site_t GetGlobalIndex(site_t remoteIndex) const
+          {
+            return globalIndexForRemoteIndex[remoteIndex];
+          }
+
+          /**
+           * Get a pointer to the distributions of the site with the given remote index.
+           * Distributions of consecutive remote indices are contiguous.
+           * @param remoteIndex
+           * @return
+           */
+          inline distribn_t* GetFOldByRemoteIndex(site_t remoteIndex)
+          {
+            return &distributions[remoteIndex * latticeInfo.GetNumVectors()];
+          }
+
+          inline const distribn_t* GetFOldByRemoteIndex(site_t remoteIndex) const
+          {
+            return &distributions[remoteIndex * latticeInfo.GetNumVectors()];
+          }
+
           void SaveSite(site_t index,
                         const std::vector<distribn_t> &distribution,
                         const std::vector<distribn_t> &distances,
@@ -62,12 +128,11 @@ namespace hemelb
           distribn_t* GetFOld(site_t distributionIndex);
 
           /**
-           * Get a vector of the fOld array for the site
-           * LatticeData assumes that the index for GetFOld is in distribution-space not site-space
+           * Set the fOld array for the site from a vector
            * @param globalIndex
-           * @return
+           * @param distribution
            */
-          std::vector<distribn_t>& GetDistribution(site_t globalIndex);
+          void SetDistribution(site_t globalIndex, const std::vector<distribn_t>& distribution);
           /**
            * Get a pointer to the fOld array starting at the requested index. This version
            * of the function allows us to access the fOld array in a const way from a const
@@ -90,7 +155,8 @@ namespace hemelb
           template<typename LatticeType>
           double GetCutDistance(site_t globalIndex, int direction) const
           {
-            return distanceToWall.find(globalIndex)->second[direction - 1];
+            return distanceToWall[GetRemoteIndex(globalIndex) * (LatticeType::NUMVECTORS - 1)
+                + direction - 1];
           }
 
           /*
@@ -110,10 +176,14 @@ namespace hemelb
           SiteData &GetSiteData(site_t globalIndex);
 
         private:
-          std::map<site_t, std::vector<distribn_t> > distributions; //! The distribution values for the previous time step
-          std::map<site_t, std::vector<distribn_t> > distanceToWall; //! Hold the distance to the wall for each fluid site and direction
-          std::map<site_t, util::Vector3D<distribn_t> > wallNormalAtSite; //! Holds the wall normal near the fluid site, where appropriate
-          std::map<site_t, SiteData> siteData; //! Holds the SiteData for each site.
+          typedef util::FlatMap<site_t, site_t>::Type RemoteIndexMap;
+
+          RemoteIndexMap remoteIndexForGlobalIndex; //! The remote index of each registered site, by global index
+          std::vector<site_t> globalIndexForRemoteIndex; //! The global index of each registered site, by remote index
+          std::vector<distribn_t> distributions; //! The distribution values for the previous time step, NUMVECTORS per remote index
+          std::vector<distribn_t> distanceToWall; //! Hold the distance to the wall for each fluid site and direction, NUMVECTORS-1 per remote index
+          std::vector<util::Vector3D<distribn_t> > wallNormalAtSite; //! Holds the wall normal near the fluid site, where appropriate
+          std::vector<SiteData> siteData; //! Holds the SiteData for each site.
           const lb::lattices::LatticeInfo& latticeInfo;
       };
 
@@ -26,12 +26,114 @@ namespace hemelb
 
         /**
          * The version number of the file format.
+         *
+         * In version 4, the headers are followed by one record per write: a uhyper
+         * for the timestep, then for each site its coordinates, as three uints, and
+         * the values of its fields, as floats.
          */
         enum
         {
           VersionNumber = 4
         };
 
+        /**
+         * The version number of the static geometry format. The sites don't change,
+         * so the headers are followed by a table of their coordinates, three uints per
+         * site; each write's record is then the timestep and, for each site in the
+         * order of the table, only the values of its fields.
+         */
+        enum
+        {
+          StaticGeometryVersionNumber = 5
+        };
+
+        /**
+         * The version number of the compressed format. As in the static geometry
+         * format, the headers are followed by the table of the sites' coordinates.
+         * Each write's record is then made up of:
+         * uhyper - Timestep
+         * uhyper - Length of the whole record, so the next can be found
+         * uint - Number of chunks, one per core
+         * (uhyper, uhyper) x chunks - Each chunk's compressed and uncompressed length
+         * then the chunks themselves, in order. Uncompressed, the chunks joined
+         * together hold the sites' field values as in the static geometry format.
+         * Each chunk is deflated with zlib after a shuffle of its bytes: all the
+         * first bytes of its four-byte values, then all the second bytes and so on.
+         */
+        enum
+        {
+          CompressedVersionNumber = 6
+        };
+
+        /**
+         * The version number of the quantised format: the static geometry format, but
+         * the fields' values may be written in fewer bytes. Each field's entry in the
+         * field header is followed by:
+         * uint - How its values are encoded (see Encoding)
+         * double - The size of a fixed point step, or zero
+         * Each site's values are padded with zeros to a multiple of four bytes.
+         */
+        enum
+        {
+          QuantisedVersionNumber = 7
+        };
+
+        /**
+         * The version number of the quantised format with compressed records, as in
+         * the compressed format.
+         */
+        enum
+        {
+          QuantisedCompressedVersionNumber = 8
+        };
+
+        /**
+         * How the values of a field are encoded, in the quantised formats. A value
+         * read is, before the field's offset is added:
+         * - FloatEncoding: the float;
+         * - HalfEncoding: the IEEE 754 half-precision number, in two bytes;
+         * - FixedPointEncoding: the two-byte signed integer times the step, from the
+         *   field header.
+         */
+        enum Encoding
+        {
+          FloatEncoding = 0,
+          HalfEncoding = 1,
+          FixedPointEncoding = 2
+        };
+
+        /**
+         * The length of the header of each compressed record, before the chunk index.
+         */
+        enum
+        {
+          CompressedRecordHeaderLength = 20
+        };
+
+        /**
+         * The length of each entry in the chunk index of a compressed record.
+         */
+        enum
+        {
+          ChunkIndexEntryLength = 16
+        };
+
+        /**
+         * The length of the values whose bytes are shuffled before compression.
+         */
+        enum
+        {
+          ShuffleElementLength = 4
+        };
+
+        /**
+         * The length, in bytes, of each site's coordinates.
+         */
+        enum
+        {
+          SiteCoordinatesLength = 12
+        };
+
         /**
          * The length of the main header. Made up of:
          * uint - HemeLbMagicNumber
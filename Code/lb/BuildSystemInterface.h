@@ -77,6 +77,31 @@ namespace hemelb
         typedef kernels::TRT<Lattice> Type;
     };
 
+    /**
+     * LBGK with f_neq regularised onto the second-order Hermite moments.
+     */
+    template<class Lattice>
+    class Regularised
+    {
+      public:
+        typedef kernels::Regularised<Lattice> Type;
+    };
+
+    /**
+     * The cumulant kernel, on the D3Q27 lattice only.
+     */
+    template<class Lattice>
+    class Cumulant
+    {
+    };
+
+    template<>
+    class Cumulant<lattices::D3Q27>
+    {
+      public:
+        typedef kernels::Cumulant<lattices::D3Q27> Type;
+    };
+
     /**
      * Non-Newtonian kernel with Carreau-Yasuda rheology model.
      */
@@ -10,6 +10,11 @@ namespace hemelb
 {
   namespace lb
   {
+    const unsigned MacroscopicPropertyCache::NO_PROPERTIES;
+    const unsigned MacroscopicPropertyCache::MOMENT_PROPERTIES;
+    const unsigned MacroscopicPropertyCache::STRESS_PROPERTIES;
+    const unsigned MacroscopicPropertyCache::ALL_PROPERTIES;
+
     MacroscopicPropertyCache::MacroscopicPropertyCache(const SimulationState& simState,
                                                        const geometry::LatticeData& latticeData) :
       densityCache(simState, latticeData.GetLocalFluidSiteCount()),
@@ -27,14 +32,19 @@ namespace hemelb
 
     bool MacroscopicPropertyCache::RequiresRefresh() const
     {
-      return densityCache.RequiresRefresh()
-        || velocityCache.RequiresRefresh()
-        || wallShearStressMagnitudeCache.RequiresRefresh()
-        || vonMisesStressCache.RequiresRefresh()
-        || shearRateCache.RequiresRefresh()
-        || stressTensorCache.RequiresRefresh()
-        || tractionCache.RequiresRefresh()
-        || tangentialProjectionTractionCache.RequiresRefresh();
+      return GetRequiredProperties() != NO_PROPERTIES;
+    }
+
+    unsigned MacroscopicPropertyCache::GetRequiredProperties() const
+    {
+      return (densityCache.RequiresRefresh() ? DENSITY : 0)
+        | (velocityCache.RequiresRefresh() ? VELOCITY : 0)
+        | (wallShearStressMagnitudeCache.RequiresRefresh() ? WALL_SHEAR_STRESS_MAGNITUDE : 0)
+        | (vonMisesStressCache.RequiresRefresh() ? VON_MISES_STRESS : 0)
+        | (shearRateCache.RequiresRefresh() ? SHEAR_RATE : 0)
+        | (stressTensorCache.RequiresRefresh() ? STRESS_TENSOR : 0)
+        | (tractionCache.RequiresRefresh() ? TRACTION : 0)
+        | (tangentialProjectionTractionCache.RequiresRefresh() ? TANGENTIAL_PROJECTION_TRACTION : 0);
     }
 
     void MacroscopicPropertyCache::ResetRequirements()
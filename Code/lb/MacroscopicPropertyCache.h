@@ -24,6 +24,32 @@ namespace hemelb
     class MacroscopicPropertyCache
     {
       public:
+        /**
+         * One bit per cache, for GetRequiredProperties.
+         */
+        enum Property
+        {
+          DENSITY = 1u << 0,
+          VELOCITY = 1u << 1,
+          WALL_SHEAR_STRESS_MAGNITUDE = 1u << 2,
+          VON_MISES_STRESS = 1u << 3,
+          SHEAR_RATE = 1u << 4,
+          STRESS_TENSOR = 1u << 5,
+          TRACTION = 1u << 6,
+          TANGENTIAL_PROJECTION_TRACTION = 1u << 7
+        };
+
+        static const unsigned NO_PROPERTIES = 0;
+
+        //! The properties that come straight from the density and momentum.
+        static const unsigned MOMENT_PROPERTIES = DENSITY | VELOCITY;
+
+        //! The properties that are derived from the second moment of f_neq.
+        static const unsigned STRESS_PROPERTIES = WALL_SHEAR_STRESS_MAGNITUDE | VON_MISES_STRESS | SHEAR_RATE
+            | STRESS_TENSOR | TRACTION | TANGENTIAL_PROJECTION_TRACTION;
+
+        static const unsigned ALL_PROPERTIES = MOMENT_PROPERTIES | STRESS_PROPERTIES;
+
         /**
          * Constructor, the only way to create this object.
          * @param simState The simulation state, so that the cache knows when it is out of date.
@@ -37,6 +63,11 @@ namespace hemelb
          */
         bool RequiresRefresh() const;
 
+        /**
+         * @return the Property bits of the caches that need to be refreshed.
+         */
+        unsigned GetRequiredProperties() const;
+
         /**
          * Reset the list of cache types required to be none of them.
          */
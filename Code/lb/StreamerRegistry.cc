@@ -0,0 +1,97 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#include <sstream>
+
+#include "Exception.h"
+#include "lb/BuildSystemInterface.h"
+#include "lb/RegisteredStreamers.h"
+#include "lb/StreamerRegistry.h"
+#include "lb/lattices/Lattices.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace
+    {
+      template<class LatticeType, template<class > class Kernel, template<class > class Streamer>
+      streamers::AbstractStreamer* CreateStreamer(kernels::InitParams& initParams)
+      {
+        typedef collisions::Normal<typename Kernel<LatticeType>::Type> CollisionType;
+        typedef typename Streamer<CollisionType>::Type StreamerType;
+        return new streamers::ConcreteStreamer<StreamerType>(initParams);
+      }
+    }
+
+#define HEMELB_STREAMER_REGISTRY_ENTRY(kernel, streamer) \
+    { #kernel, #streamer, &CreateStreamer<lattices::HEMELB_LATTICE, kernel, streamer> },
+
+    template<>
+    const StreamerRegistry<lattices::HEMELB_LATTICE>::Entry StreamerRegistry<
+        lattices::HEMELB_LATTICE>::entries[] =
+        { HEMELB_REGISTERED_STREAMERS(HEMELB_STREAMER_REGISTRY_ENTRY) };
+
+#undef HEMELB_STREAMER_REGISTRY_ENTRY
+
+    template<>
+    const std::size_t StreamerRegistry<lattices::HEMELB_LATTICE>::entryCount =
+        sizeof(StreamerRegistry<lattices::HEMELB_LATTICE>::entries)
+            / sizeof(StreamerRegistry<lattices::HEMELB_LATTICE>::entries[0]);
+
+    template<class LatticeType>
+    const typename StreamerRegistry<LatticeType>::Entry* StreamerRegistry<LatticeType>::Find(
+        const std::string& kernelName, const std::string& streamerName)
+    {
+      for (std::size_t entry = 0; entry < entryCount; ++entry)
+      {
+        if (kernelName == entries[entry].kernelName
+            && streamerName == entries[entry].streamerName)
+        {
+          return &entries[entry];
+        }
+      }
+      return NULL;
+    }
+
+    template<class LatticeType>
+    streamers::AbstractStreamer* StreamerRegistry<LatticeType>::Create(
+        const std::string& kernelName, const std::string& streamerName,
+        kernels::InitParams& initParams)
+    {
+      const Entry* entry = Find(kernelName, streamerName);
+      if (entry == NULL)
+      {
+        throw Exception() << "Kernel '" << kernelName << "' with boundary conditions '"
+            << streamerName << "' was not compiled into this build. Available: "
+            << ListRegistered()
+            << ". Add it to HEMELB_RUNTIME_KERNELS / HEMELB_RUNTIME_STREAMERS and rebuild.";
+      }
+      return entry->factory(initParams);
+    }
+
+    template<class LatticeType>
+    bool StreamerRegistry<LatticeType>::IsRegistered(const std::string& kernelName,
+                                                     const std::string& streamerName)
+    {
+      return Find(kernelName, streamerName) != NULL;
+    }
+
+    template<class LatticeType>
+    std::string StreamerRegistry<LatticeType>::ListRegistered()
+    {
+      std::ostringstream list;
+      for (std::size_t entry = 0; entry < entryCount; ++entry)
+      {
+        list << (entry == 0 ? "" : ", ") << entries[entry].kernelName << "/"
+            << entries[entry].streamerName;
+      }
+      return list.str();
+    }
+
+    template class StreamerRegistry<lattices::HEMELB_LATTICE> ;
+  }
+}
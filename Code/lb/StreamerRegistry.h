@@ -0,0 +1,78 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_STREAMERREGISTRY_H
+#define HEMELB_LB_STREAMERREGISTRY_H
+
+#include <cstddef>
+#include <string>
+
+#include "lb/kernels/BaseKernel.h"
+#include "lb/streamers/AbstractStreamer.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    /**
+     * The kernel and streamer combinations that were compiled into this
+     * build, so that the one to use can be picked from the XML configuration.
+     *
+     * Names are those of the classes in BuildSystemInterface.h, e.g.
+     * ("LBGK", "NASHZEROTHORDERPRESSURESBB"). Which combinations are available
+     * is set with the CMake variables HEMELB_RUNTIME_KERNELS and
+     * HEMELB_RUNTIME_STREAMERS; the compile-time choice is always included.
+     *
+     * The streamers are explicitly instantiated in StreamerRegistry.cc for
+     * lattices::HEMELB_LATTICE only.
+     */
+    template<class LatticeType>
+    class StreamerRegistry
+    {
+      public:
+        typedef streamers::AbstractStreamer* (*Factory)(kernels::InitParams&);
+
+        /**
+         * Create a streamer for the given combination.
+         * @param kernelName
+         * @param streamerName
+         * @param initParams
+         * @return a new streamer, owned by the caller
+         * @throws Exception if the combination wasn't compiled in
+         */
+        static streamers::AbstractStreamer* Create(const std::string& kernelName,
+                                                   const std::string& streamerName,
+                                                   kernels::InitParams& initParams);
+
+        /**
+         * @param kernelName
+         * @param streamerName
+         * @return whether the given combination was compiled in
+         */
+        static bool IsRegistered(const std::string& kernelName, const std::string& streamerName);
+
+        /**
+         * @return a human-readable list of the available combinations
+         */
+        static std::string ListRegistered();
+
+      private:
+        struct Entry
+        {
+            const char* kernelName;
+            const char* streamerName;
+            Factory factory;
+        };
+
+        static const Entry* Find(const std::string& kernelName, const std::string& streamerName);
+
+        static const Entry entries[];
+        static const std::size_t entryCount;
+    };
+  }
+}
+
+#endif /* HEMELB_LB_STREAMERREGISTRY_H */
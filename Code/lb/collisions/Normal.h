@@ -9,6 +9,7 @@
 
 #include "lb/collisions/BaseCollision.h"
 #include "lb/kernels/BaseKernel.h"
+#include "lb/kernels/SiteBatch.h"
 
 namespace hemelb
 {
@@ -42,10 +43,36 @@ namespace hemelb
             kernel.Collide(lbmParams, hydroVars);
           }
 
+          /**
+           * Calculate the moments and equilibria of a batch of bulk sites; only
+           * for kernels with HasSiteBatch.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculatePreCollisionBatch(kernels::SiteBatch<typename KernelType::LatticeType>& batch)
+          {
+            kernel.CalculateDensityMomentumFeqBatch(batch);
+          }
+
+          /**
+           * Collide a batch of bulk sites; only for kernels with HasSiteBatch.
+           */
+          HEMELB_SITE_BATCH_INLINE void CollideBatch(const LbmParameters* lbmParams,
+                                                     kernels::SiteBatch<typename KernelType::LatticeType>& batch)
+          {
+            kernel.CollideBatch(lbmParams, batch);
+          }
+
         public:
           KernelType kernel;
       };
     }
+
+    namespace kernels
+    {
+      template<typename KernelType>
+      struct HasSiteBatch<collisions::Normal<KernelType> > : public HasSiteBatch<KernelType>
+      {
+      };
+    }
   }
 }
 
@@ -48,12 +48,14 @@ namespace hemelb
       template<class LatticeType>
       struct HydroVarsBase
       {
+          template<class LatticeImpl> friend class Cumulant;
           template<class LatticeImpl> friend class Entropic;
           template<class LatticeImpl> friend class EntropicAnsumali;
           template<class LatticeImpl> friend class EntropicChik;
           template<class LatticeImpl> friend class LBGK;
           template<class rheologyModel, class LatticeImpl> friend class LBGKNN;
           template<class LatticeImpl> friend class MRT;
+          template<class LatticeImpl> friend class Regularised;
           template<class LatticeImpl> friend class TRT;
 
         protected:
@@ -0,0 +1,222 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_KERNELS_CUMULANT_H
+#define HEMELB_LB_KERNELS_CUMULANT_H
+
+#include "lb/kernels/BaseKernel.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace kernels
+    {
+      /**
+       * The cumulant collision operator (Geier et al., Comput. Math. Appl. 70, 507
+       * (2015)), for the D3Q27 lattice only: the transform to cumulants needs the
+       * full tensor-product velocity set.
+       *
+       * The distributions are transformed to central moments about the local
+       * velocity, one axis at a time. In cumulant space:
+       *  - the deviatoric second-order cumulants relax at 1/tau, as in LBGK, which
+       *    sets the viscosity;
+       *  - the trace relaxes with rate 1, straight to its equilibrium;
+       *  - every higher-order cumulant also relaxes with rate 1, to its equilibrium
+       *    of zero.
+       * This is the usual parameter-free choice, and is what makes the operator
+       * stable at low viscosity: only the shear stress is carried from one step to
+       * the next. With all higher cumulants zero, the post-collision central
+       * moments are those of a Gaussian with the relaxed second-order moments as
+       * its covariance, and are transformed back to distributions axis by axis.
+       */
+      template<class LatticeType>
+      class Cumulant : public BaseKernel<Cumulant<LatticeType>, LatticeType>
+      {
+        public:
+          Cumulant(InitParams& initParams)
+          {
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              directionAt[LatticeType::CX[direction] + 1][LatticeType::CY[direction] + 1][LatticeType::CZ[direction]
+                  + 1] = direction;
+            }
+          }
+
+          inline void DoCalculateDensityMomentumFeq(HydroVars<Cumulant<LatticeType> >& hydroVars, site_t index)
+          {
+            LatticeType::CalculateDensityMomentumFEq(hydroVars.f,
+                                                     hydroVars.density,
+                                                     hydroVars.momentum.x,
+                                                     hydroVars.momentum.y,
+                                                     hydroVars.momentum.z,
+                                                     hydroVars.velocity.x,
+                                                     hydroVars.velocity.y,
+                                                     hydroVars.velocity.z,
+                                                     hydroVars.f_eq.f);
+
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
+          }
+
+          inline void DoCalculateFeq(HydroVars<Cumulant>& hydroVars, site_t index)
+          {
+            LatticeType::CalculateFeq(hydroVars.density,
+                                      hydroVars.momentum.x,
+                                      hydroVars.momentum.y,
+                                      hydroVars.momentum.z,
+                                      hydroVars.f_eq.f);
+
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
+          }
+
+          inline void DoCollide(const LbmParameters* const lbmParams, HydroVars<Cumulant>& hydroVars)
+          {
+            const distribn_t density = hydroVars.density;
+            const distribn_t velocity[3] = { hydroVars.momentum.x / density, hydroVars.momentum.y / density,
+                                             hydroVars.momentum.z / density };
+
+            // moments[i][j][k] starts as the distribution with velocity (i-1, j-1, k-1)
+            // and ends as the central moment of order (i, j, k).
+            distribn_t moments[3][3][3];
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned j = 0; j < 3; ++j)
+                for (unsigned k = 0; k < 3; ++k)
+                {
+                  moments[i][j][k] = hydroVars.f[directionAt[i][j][k]];
+                }
+
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned j = 0; j < 3; ++j)
+              {
+                ToCentralMoments(moments[i][j][0], moments[i][j][1], moments[i][j][2], velocity[2]);
+              }
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned k = 0; k < 3; ++k)
+              {
+                ToCentralMoments(moments[i][0][k], moments[i][1][k], moments[i][2][k], velocity[1]);
+              }
+            for (unsigned j = 0; j < 3; ++j)
+              for (unsigned k = 0; k < 3; ++k)
+              {
+                ToCentralMoments(moments[0][j][k], moments[1][j][k], moments[2][j][k], velocity[0]);
+              }
+
+            Relax(moments, density, -lbmParams->GetOmega());
+
+            for (unsigned j = 0; j < 3; ++j)
+              for (unsigned k = 0; k < 3; ++k)
+              {
+                FromCentralMoments(moments[0][j][k], moments[1][j][k], moments[2][j][k], velocity[0]);
+              }
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned k = 0; k < 3; ++k)
+              {
+                FromCentralMoments(moments[i][0][k], moments[i][1][k], moments[i][2][k], velocity[1]);
+              }
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned j = 0; j < 3; ++j)
+              {
+                FromCentralMoments(moments[i][j][0], moments[i][j][1], moments[i][j][2], velocity[2]);
+              }
+
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned j = 0; j < 3; ++j)
+                for (unsigned k = 0; k < 3; ++k)
+                {
+                  hydroVars.SetFPostCollision(directionAt[i][j][k], moments[i][j][k]);
+                }
+          }
+
+        private:
+          /**
+           * Replaces the distributions with velocities -1, 0 and +1 along one axis by
+           * their zeroth, first and second central moments about u.
+           */
+          inline static void ToCentralMoments(distribn_t& minus, distribn_t& zero, distribn_t& plus,
+                                              const distribn_t u)
+          {
+            const distribn_t sum = minus + zero + plus;
+            const distribn_t difference = plus - minus;
+            const distribn_t second = plus + minus - 2.0 * u * difference + u * u * sum;
+            minus = sum;
+            zero = difference - u * sum;
+            plus = second;
+          }
+
+          /**
+           * The inverse of ToCentralMoments.
+           */
+          inline static void FromCentralMoments(distribn_t& zeroth, distribn_t& first, distribn_t& second,
+                                                const distribn_t u)
+          {
+            const distribn_t minus = 0.5 * (zeroth * (u * u - u) + first * (2.0 * u - 1.0) + second);
+            const distribn_t plus = 0.5 * (zeroth * (u * u + u) + first * (2.0 * u + 1.0) + second);
+            const distribn_t zero = zeroth * (1.0 - u * u) - 2.0 * u * first - second;
+            zeroth = minus;
+            first = zero;
+            second = plus;
+          }
+
+          /**
+           * Sets the central moments to their post-collision values.
+           * @param moments
+           * @param density
+           * @param shearRate 1/tau
+           */
+          inline static void Relax(distribn_t moments[3][3][3], const distribn_t density,
+                                   const distribn_t shearRate)
+          {
+            const distribn_t keep = 1.0 - shearRate;
+
+            // Second order: the deviatoric part relaxes at the shear rate, the trace
+            // goes to its equilibrium, density (3 c_s^2 rho).
+            const distribn_t xy = keep * moments[1][1][0];
+            const distribn_t xz = keep * moments[1][0][1];
+            const distribn_t yz = keep * moments[0][1][1];
+            const distribn_t xxMinusYy = keep * (moments[2][0][0] - moments[0][2][0]);
+            const distribn_t xxMinusZz = keep * (moments[2][0][0] - moments[0][0][2]);
+            const distribn_t xx = (density + xxMinusYy + xxMinusZz) / 3.0;
+            const distribn_t yy = xx - xxMinusYy;
+            const distribn_t zz = xx - xxMinusZz;
+
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned j = 0; j < 3; ++j)
+                for (unsigned k = 0; k < 3; ++k)
+                {
+                  moments[i][j][k] = 0.0;
+                }
+
+            const distribn_t density_1 = 1.0 / density;
+            moments[0][0][0] = density;
+
+            moments[2][0][0] = xx;
+            moments[0][2][0] = yy;
+            moments[0][0][2] = zz;
+            moments[1][1][0] = xy;
+            moments[1][0][1] = xz;
+            moments[0][1][1] = yz;
+
+            // Fourth and sixth order follow from the second with zero cumulants
+            // (Isserlis' theorem); the odd orders are all zero.
+            moments[2][2][0] = (xx * yy + 2.0 * xy * xy) * density_1;
+            moments[2][0][2] = (xx * zz + 2.0 * xz * xz) * density_1;
+            moments[0][2][2] = (yy * zz + 2.0 * yz * yz) * density_1;
+            moments[2][1][1] = (xx * yz + 2.0 * xy * xz) * density_1;
+            moments[1][2][1] = (yy * xz + 2.0 * xy * yz) * density_1;
+            moments[1][1][2] = (zz * xy + 2.0 * xz * yz) * density_1;
+            moments[2][2][2] = (xx * yy * zz + 2.0 * (xx * yz * yz + yy * xz * xz + zz * xy * xy)
+                + 8.0 * xy * xz * yz) * density_1 * density_1;
+          }
+
+          //! The direction with velocity (i-1, j-1, k-1).
+          Direction directionAt[3][3][3];
+      };
+
+    }
+  }
+}
+
+#endif /* HEMELB_LB_KERNELS_CUMULANT_H */
@@ -8,8 +8,8 @@
 #define HEMELB_LB_KERNELS_ENTROPIC_H
 
 #include "lb/kernels/BaseKernel.h"
-#include "lb/HFunction.h"
-#include "util/UtilityFunctions.h"
+#include "lb/kernels/EntropicAlphaSolver.h"
+#include "lb/kernels/SiteBatch.h"
 
 namespace hemelb
 {
@@ -41,8 +41,8 @@ namespace hemelb
           template<typename HydroVarsType>
           inline void DoCollide(const LbmParameters* const lbmParams, HydroVarsType& hydroVars)
           {
-            distribn_t alpha = CalculateAlpha(lbmParams->GetTau(), hydroVars, oldAlpha[hydroVars.index]);
-            oldAlpha[hydroVars.index] = alpha;
+            distribn_t& alpha = oldAlpha[hydroVars.index];
+            EntropicAlphaSolver<LatticeType>::Solve(hydroVars.f, hydroVars.f_eq.f, lbmParams->GetTau(), &alpha);
 
             for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
             {
@@ -52,6 +52,34 @@ namespace hemelb
             }
           }
 
+          /**
+           * As DoCollide, for every site of the batch, solving for all their
+           * alphas together.
+           * @param lbmParams
+           * @param batch
+           */
+          HEMELB_SITE_BATCH_INLINE void CollideBatch(const LbmParameters* const lbmParams,
+                                                     SiteBatch<LatticeType>& batch)
+          {
+            typedef SiteBatch<LatticeType> BatchType;
+
+            distribn_t* const alpha = &oldAlpha[batch.firstIndex];
+            EntropicAlphaSolver<LatticeType, BatchType::WIDTH>::Solve(&batch.f[0][0],
+                                                                     &batch.fEq[0][0],
+                                                                     lbmParams->GetTau(),
+                                                                     alpha);
+
+            const distribn_t beta = lbmParams->GetBeta();
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              for (unsigned lane = 0; lane < BatchType::WIDTH; ++lane)
+              {
+                batch.fPostCollision[direction][lane] = batch.f[direction][lane]
+                    + (alpha[lane] * beta) * batch.fNeq[direction][lane];
+              }
+            }
+          }
+
         protected:
           /**
            * Constructs the alpha array.
@@ -67,84 +95,6 @@ namespace hemelb
             }
           }
 
-          /**
-           * Calculates the new value of alpha (the relaxation parameter) and updates the cache.
-           * @param tau The value of tau to use as a basis for calculating alpha.
-           * @param hydroVars
-           * @param prevAlpha Alpha value from the previous timestep.
-           * @return
-           */
-          template<typename HydroVarsType>
-          double CalculateAlpha(const distribn_t tau, const HydroVarsType& hydroVars, double prevAlpha)
-          {
-            bool big = false;
-            double deviation = 0.0;
-
-            for (unsigned int i = 0; i < LatticeType::NUMVECTORS; i++)
-            {
-              // Papers suggest f_eq - f < 0.001 or (f_eq - f)/f < 0.01 for the point to have approx alpha = 2
-              // Accuracy can change depending on stability requirements, because the more NR evaluations it skips
-              // the more of the simulation is in the LBGK limit.
-              deviation = util::NumericalFunctions::max(fabs( (hydroVars.f_eq.f[i] - hydroVars.f[i]) / hydroVars.f[i]),
-                                                        deviation);
-              if (deviation > 1.0E-2)
-              {
-                big = true;
-                // if this is the case Brent isn't called so the value of deviation doesn't matter
-                break;
-              }
-            }
-
-            if (big)
-            {
-              HFunction<LatticeType> HFunc(hydroVars.f, hydroVars.f_eq.f);
-
-              // This is in case previous Alpha was calculated to be zero (does happen occasionally if f_eq - f is small
-              prevAlpha = (prevAlpha < 2.0 * tau ?
-                2.0 :
-                prevAlpha);
-
-              return (hemelb::util::NumericalMethods::NewtonRaphson(&HFunc, prevAlpha, 1.0E-6));
-            }
-            else
-            {
-              // Happens a lot near equilibrium. In this limit we return LBGK to avoid unnecessary calculations
-              // Should really be a small number to accommodate round off and truncations errors, but only 0.0
-              // causes problems as it causes a NaN when bracketing in Brent.
-              if (deviation == 0.0)
-              {
-                return 2.0;
-              }
-
-              HFunction<LatticeType> HFunc(hydroVars.f, hydroVars.f_eq.f);
-
-              // The bracket is very large, but it should guarantee that a root is enclosed
-              double alphaLower = 2.0 * (tau), HLower;
-              double alphaHigher = 2.0 * (tau) / deviation, HHigher;
-
-              HFunc(alphaLower, HLower);
-              HFunc(alphaHigher, HHigher);
-
-              // The root should be enclosed, but in case it isn't return some default
-              // Chosen to return 2.0 as that is the LBGK case
-              // Very often if f is v close to equilibrium a root will not be enclosed (rounding and truncation errors)
-              // Doesn't really matter what is returned then as f_neq is negligible in that case
-              if (HLower * HHigher >= 0.0)
-              {
-                return 2.0;
-              }
-
-              return (hemelb::util::NumericalMethods::Brent(&HFunc,
-                                                            alphaLower,
-                                                            HLower,
-                                                            alphaHigher,
-                                                            HHigher,
-                                                            1.0E-6,
-                                                            1.0E-12));
-            }
-
-          }
-
           /**
            * Stores the value of alpha (the relaxation parameter) from the previous iteration.
            */
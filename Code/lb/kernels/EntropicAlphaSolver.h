@@ -0,0 +1,272 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_KERNELS_ENTROPICALPHASOLVER_H
+#define HEMELB_LB_KERNELS_ENTROPICALPHASOLVER_H
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdint.h>
+
+#include "units.h"
+#include "lb/kernels/SiteBatch.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace kernels
+    {
+      /**
+       * Finds the entropic relaxation parameter alpha for WIDTH sites at once:
+       * the non-trivial root of
+       *
+       *   g(alpha) = H(f + alpha (f_eq - f)) - H(f),  H(f) = sum_i f_i log(f_i / w_i)
+       *
+       * The distributions are stored direction-major, f[direction * WIDTH + lane],
+       * so WIDTH = 1 is a single site's f and WIDTH = SiteBatch::WIDTH is a
+       * SiteBatch's. All the lanes iterate together and every evaluation of g
+       * and g' is a loop over directions and lanes with no branches or library
+       * calls, so it vectorises across the sites (or, for one site, across
+       * the directions).
+       *
+       * g is convex with g(0) = 0 and is negative between 0 and the root, so
+       * the sign of g at any trial alpha says which side of the root it is on.
+       * Each lane starts a safeguarded Newton iteration from its alpha at the
+       * previous time step, which is usually within a couple of steps of the
+       * new root; the trial points seen so far bracket the root and any
+       * Newton step that leaves the bracket is replaced by bisection (or, until
+       * there is an upper bound, by doubling).
+       */
+      template<class LatticeType, unsigned WIDTH = 1>
+      class EntropicAlphaSolver
+      {
+        public:
+          /**
+           * The largest relative deviation of f from f_eq for which alpha is
+           * taken to be the LBGK value of 2 without solving. Papers suggest
+           * (f_eq - f)/f < 0.01.
+           */
+          static constexpr distribn_t NEAR_EQUILIBRIUM_DEVIATION = 1.0E-2;
+
+          //! Newton iterations stop once the step is smaller than this.
+          static constexpr distribn_t ALPHA_ACCURACY = 1.0E-6;
+
+          static const unsigned MAX_ITERATIONS = 40;
+
+          /**
+           * @param f
+           * @param fEq
+           * @param tau
+           * @param alpha on entry, each lane's alpha from the previous time step;
+           * on return, the new alpha.
+           */
+          HEMELB_SITE_BATCH_INLINE static void Solve(const distribn_t* const f,
+                                                     const distribn_t* const fEq,
+                                                     const distribn_t tau,
+                                                     distribn_t* const alpha)
+          {
+            distribn_t deviation[WIDTH];
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+              deviation[lane] = 0.0;
+            }
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                const distribn_t relative = std::fabs( (fEq[direction * WIDTH + lane]
+                    - f[direction * WIDTH + lane]) / f[direction * WIDTH + lane]);
+                deviation[lane] = relative > deviation[lane] ?
+                  relative :
+                  deviation[lane];
+              }
+            }
+
+            bool active[WIDTH];
+            unsigned activeCount = 0;
+            distribn_t lower[WIDTH], upper[WIDTH];
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+              // Near equilibrium the root is 2 to within the accuracy that matters
+              // (f_neq is negligible), so this is the LBGK limit.
+              active[lane] = deviation[lane] > NEAR_EQUILIBRIUM_DEVIATION;
+              if (!active[lane])
+              {
+                alpha[lane] = 2.0;
+                continue;
+              }
+              ++activeCount;
+
+              // The previous alpha can be zero (or otherwise tiny) when f_eq - f was small.
+              if (! (alpha[lane] >= 2.0 * tau))
+              {
+                alpha[lane] = 2.0;
+              }
+              lower[lane] = 0.0;
+              upper[lane] = std::numeric_limits<distribn_t>::infinity();
+            }
+
+            if (activeCount == 0)
+            {
+              return;
+            }
+
+            // H(f) doesn't change during the iteration.
+            distribn_t hOfF[WIDTH];
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+              hOfF[lane] = 0.0;
+            }
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              const distribn_t weight_1 = 1.0 / LatticeType::EQMWEIGHTS[direction];
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                const distribn_t fi = f[direction * WIDTH + lane];
+                hOfF[lane] += fi * Log(fi * weight_1);
+              }
+            }
+
+            for (unsigned iteration = 0; iteration < MAX_ITERATIONS && activeCount > 0; ++iteration)
+            {
+              distribn_t g[WIDTH], dg[WIDTH];
+              Evaluate(f, fEq, alpha, hOfF, g, dg);
+
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                if (!active[lane])
+                {
+                  continue;
+                }
+
+                // Test for convergence before safeguarding the step: a tiny step
+                // from the end of the bracket can round onto it.
+                const distribn_t step = g[lane] == 0.0 ?
+                  0.0 :
+                  -g[lane] / dg[lane];
+                if (std::fabs(step) < ALPHA_ACCURACY)
+                {
+                  alpha[lane] += step;
+                  active[lane] = false;
+                  --activeCount;
+                  continue;
+                }
+
+                if (g[lane] < 0.0)
+                {
+                  lower[lane] = alpha[lane];
+                }
+                else
+                {
+                  upper[lane] = alpha[lane];
+                }
+
+                const distribn_t next = alpha[lane] + step;
+                if (next > lower[lane] && next < upper[lane])
+                {
+                  alpha[lane] = next;
+                }
+                else
+                {
+                  alpha[lane] = upper[lane] == std::numeric_limits<distribn_t>::infinity() ?
+                    2.0 * alpha[lane] :
+                    0.5 * (lower[lane] + upper[lane]);
+                }
+              }
+            }
+          }
+
+        private:
+          /**
+           * g and dg/dalpha at the current alpha for every lane.
+           */
+          HEMELB_SITE_BATCH_INLINE static void Evaluate(const distribn_t* const f,
+                                                        const distribn_t* const fEq,
+                                                        const distribn_t* const alpha,
+                                                        const distribn_t* const hOfF,
+                                                        distribn_t* const g,
+                                                        distribn_t* const dg)
+          {
+            distribn_t h[WIDTH], dh[WIDTH];
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+              h[lane] = 0.0;
+              dh[lane] = 0.0;
+            }
+
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              const distribn_t weight_1 = 1.0 / LatticeType::EQMWEIGHTS[direction];
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                const distribn_t fi = f[direction * WIDTH + lane];
+                const distribn_t df = fEq[direction * WIDTH + lane] - fi;
+                const distribn_t fAlpha = fi + alpha[lane] * df;
+                const distribn_t absFAlpha = std::fabs(fAlpha);
+                const distribn_t logTerm = Log(absFAlpha * weight_1);
+
+                // As HFunction: H uses |f_alpha|, so dH picks up its sign.
+                h[lane] += absFAlpha * logTerm;
+                dh[lane] += (fAlpha < 0.0 ?
+                  -df :
+                  df) * (1.0 + logTerm);
+              }
+            }
+
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+              g[lane] = h[lane] - hOfF[lane];
+              dg[lane] = dh[lane];
+            }
+          }
+
+          /**
+           * Natural logarithm of a positive, normal x, to within a couple of ulps,
+           * using only arithmetic and bit operations so that loops calling it
+           * can be vectorised.
+           *
+           * x = m 2^e with m in [sqrt(1/2), sqrt(2)); log(m) = 2 atanh(s) with
+           * s = (m - 1) / (m + 1), |s| < 0.172, summed as a series in s^2.
+           */
+          HEMELB_SITE_BATCH_INLINE static distribn_t Log(const distribn_t x)
+          {
+            uint64_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+
+            // Shift the mantissa's range from [1, 2) to [sqrt(1/2), sqrt(2)) by
+            // rounding the exponent: adding the bits of (2 - sqrt(2)) carries
+            // into the exponent field exactly when m >= sqrt(2).
+            const uint64_t shifted = bits + (0x3ff0000000000000ULL - 0x3fe6a09e667f3bcdULL);
+            const uint64_t exponentBits = shifted >> 52;
+            const uint64_t mantissaBits = (shifted & 0x000fffffffffffffULL) + 0x3fe6a09e667f3bcdULL;
+
+            distribn_t m;
+            std::memcpy(&m, &mantissaBits, sizeof(m));
+
+            // Exact conversion of the (small) exponent to double without an
+            // int64 -> double instruction, which AVX2 lacks.
+            const uint64_t exponentAsDoubleBits = exponentBits | 0x4330000000000000ULL;
+            distribn_t exponent;
+            std::memcpy(&exponent, &exponentAsDoubleBits, sizeof(exponent));
+            exponent -= 4503599627370496.0 + 1023.0;
+
+            const distribn_t s = (m - 1.0) / (m + 1.0);
+            const distribn_t s2 = s * s;
+            const distribn_t series = 1.0
+                + s2 * (1.0 / 3.0 + s2 * (1.0 / 5.0 + s2 * (1.0 / 7.0 + s2 * (1.0 / 9.0 + s2
+                    * (1.0 / 11.0 + s2 * (1.0 / 13.0 + s2 * (1.0 / 15.0 + s2 * (1.0 / 17.0 + s2
+                        * (1.0 / 19.0 + s2 * (1.0 / 21.0))))))))));
+
+            return exponent * 0.6931471805599453094 + 2.0 * s * series;
+          }
+      };
+    }
+  }
+}
+
+#endif /* HEMELB_LB_KERNELS_ENTROPICALPHASOLVER_H */
@@ -76,10 +76,7 @@ namespace hemelb
                                                       hydroVars.momentum.z,
                                                       hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
           }
 
           /**
@@ -97,12 +94,39 @@ namespace hemelb
                                                       hydroVars.momentum.z,
                                                       hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
+          }
+
+          /**
+           * As DoCalculateDensityMomentumFeq, for every site of the batch.
+           * @param batch
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateDensityMomentumFeqBatch(SiteBatch<LatticeType>& batch)
+          {
+            typedef SiteBatch<LatticeType> BatchType;
+
+            batch.CalculateDensityAndMomentum();
+            for (unsigned lane = 0; lane < BatchType::WIDTH; ++lane)
             {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
+              distribn_t f_eq[LatticeType::NUMVECTORS];
+              LatticeType::CalculateEntropicFeqAnsumali(batch.density[lane],
+                                                        batch.momentum_x[lane],
+                                                        batch.momentum_y[lane],
+                                                        batch.momentum_z[lane],
+                                                        f_eq);
+              for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+              {
+                batch.fEq[direction][lane] = f_eq[direction];
+              }
             }
+            batch.CalculateFNeq();
           }
       };
+
+      template<class LatticeType>
+      struct HasSiteBatch<EntropicAnsumali<LatticeType> > : public std::true_type
+      {
+      };
     }
   }
 }
@@ -7,11 +7,13 @@
 #ifndef HEMELB_LB_KERNELS_KERNELS_H
 #define HEMELB_LB_KERNELS_KERNELS_H
 
+#include "lb/kernels/Cumulant.h"
 #include "lb/kernels/EntropicAnsumali.h"
 #include "lb/kernels/EntropicChik.h"
 #include "lb/kernels/LBGK.h"
 #include "lb/kernels/LBGKNN.h"
 #include "lb/kernels/MRT.h"
+#include "lb/kernels/Regularised.h"
 #include "lb/kernels/TRT.h"
 
 #endif /* HEMELB_LB_KERNELS_KERNELS_H */
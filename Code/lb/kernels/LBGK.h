@@ -11,6 +11,7 @@
 #include "lb/HFunction.h"
 #include "util/UtilityFunctions.h"
 #include "lb/kernels/BaseKernel.h"
+#include "lb/kernels/SiteBatch.h"
 
 namespace hemelb
 {
@@ -41,10 +42,7 @@ namespace hemelb
                                                      hydroVars.velocity.z,
                                                      hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
           }
 
           inline void DoCalculateFeq(HydroVars<LBGK>& hydroVars, site_t index)
@@ -55,10 +53,7 @@ namespace hemelb
                                       hydroVars.momentum.z,
                                       hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
           }
 
           inline void DoCollide(const LbmParameters* const lbmParams, HydroVars<LBGK>& hydroVars)
@@ -71,6 +66,36 @@ namespace hemelb
             }
           }
 
+          /**
+           * As DoCalculateDensityMomentumFeq, for every site of the batch.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateDensityMomentumFeqBatch(SiteBatch<LatticeType>& batch)
+          {
+            batch.CalculateDensityMomentumFeq();
+          }
+
+          /**
+           * As DoCollide, for every site of the batch.
+           */
+          HEMELB_SITE_BATCH_INLINE void CollideBatch(const LbmParameters* const lbmParams,
+                                                     SiteBatch<LatticeType>& batch)
+          {
+            const distribn_t omega = lbmParams->GetOmega();
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              for (unsigned lane = 0; lane < SiteBatch<LatticeType>::WIDTH; ++lane)
+              {
+                batch.fPostCollision[direction][lane] = batch.f[direction][lane]
+                    + batch.fNeq[direction][lane] * omega;
+              }
+            }
+          }
+
+      };
+
+      template<class LatticeType>
+      struct HasSiteBatch<LBGK<LatticeType> > : public std::true_type
+      {
       };
 
     }
@@ -45,10 +45,7 @@ namespace hemelb
                                                      hydroVars.velocity.z,
                                                      hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
 
             // Use the value of tau computed during the previous time step in coming calls to DoCollide
             assert( (index < (site_t) mTau.size()));
@@ -66,10 +63,7 @@ namespace hemelb
                                       hydroVars.momentum.z,
                                       hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
 
             // Use the value of tau computed during the previous time step in coming calls to DoCollide
             assert( (index < (site_t) mTau.size()));
@@ -8,44 +8,36 @@
 #define HEMELB_LB_KERNELS_MRT_H
 
 #include "lb/kernels/BaseKernel.h"
+#include "lb/lattices/SimdLevel.h"
 #include "lb/SimulationState.h"
 #include <cassert>
 #include <cmath>
 
+#if defined(HEMELB_USE_SSE3) || defined(HEMELB_LATTICE_RUNTIME_SIMD)
+#include <immintrin.h>
+#endif
+
 namespace hemelb
 {
   namespace lb
   {
     namespace kernels
     {
-      // Forward declaration needed by the struct
-      template<class MomentBasis> class MRT;
-
-      template<class MomentBasis>
-      struct HydroVars<MRT<MomentBasis> > : public HydroVarsBase<typename MomentBasis::Lattice>
-      {
-        public:
-          HydroVars(const distribn_t* const f) :
-              HydroVarsBase<typename MomentBasis::Lattice>(f)
-          {
-          }
-
-          /** Equilibrium velocity distribution in the momentum space. */
-          distribn_t m_neq[MomentBasis::NUM_KINETIC_MOMENTS];
-      };
-
       /**
        * This class implements the Multiple Relaxation Time (MRT) collision operator.
        *
        *  \Omega(f) = - M^{-1} * \hat{S} * M (f - f_{eq})
-       *            = - M^T * (M * M^T)^{-1} * \hat{S} * m_{neq}
+       *            = - M^T * (M * M^T)^{-1} * \hat{S} * M * f_{neq}
        *
        *  where f is the velocity distribution function, \Omega() is the collision operator,
        *  M is the momentum space basis, m=Mf is the vector of momentums, \hat{S} is the
        *  collision matrix, and {m,f}_{eq} and {m,f}_{neq} are the equilibrium and non-equilibrium
        *  versions of {m,f}.
        *
-       *  (M * M^T)^{-1} and \hat{S} are diagonal matrices.
+       *  (M * M^T)^{-1} and \hat{S} are diagonal matrices. None of the factors depend on the
+       *  site, so they are multiplied out once into a single Q x Q matrix and the collision
+       *  is one matrix-vector product in velocity space, rather than a projection into moment
+       *  space followed by a relaxation and a projection back.
        */
       template<class MomentBasis>
       class MRT : public BaseKernel<MRT<MomentBasis>, typename MomentBasis::Lattice>
@@ -55,17 +47,6 @@ namespace hemelb
           MRT(InitParams& initParams)
           {
             InitState(initParams);
-
-            // Pre-compute the reduced moment basis divided by the basis times basis transposed.
-            for (Direction direction = 0; direction < MomentBasis::Lattice::NUMVECTORS; ++direction)
-            {
-              for (unsigned momentIndex = 0; momentIndex < MomentBasis::NUM_KINETIC_MOMENTS; momentIndex++)
-              {
-                normalisedReducedMomentBasis[momentIndex][direction] =
-                    MomentBasis::REDUCED_MOMENT_BASIS[momentIndex][direction]
-                        / MomentBasis::BASIS_TIMES_BASIS_TRANSPOSED[momentIndex];
-              }
-            }
           }
 
           inline void DoCalculateDensityMomentumFeq(HydroVars<MRT>& hydroVars, site_t index)
@@ -80,13 +61,7 @@ namespace hemelb
                                                               hydroVars.velocity.z,
                                                               hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < MomentBasis::Lattice::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
-
-            /** @todo #222 consider computing m_neq directly in the momentum space. See d'Humieres 2002. */
-            MomentBasis::ProjectVelsIntoMomentSpace(hydroVars.f_neq.f, hydroVars.m_neq);
+            MomentBasis::Lattice::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
           }
 
           inline void DoCalculateFeq(HydroVars<MRT>& hydroVars, site_t index)
@@ -97,29 +72,33 @@ namespace hemelb
                                                hydroVars.momentum.z,
                                                hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < MomentBasis::Lattice::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
-
-            /** @todo #222 consider computing m_neq directly in the moment space. See d'Humieres 2002. */
-            MomentBasis::ProjectVelsIntoMomentSpace(hydroVars.f_neq.f, hydroVars.m_neq);
+            MomentBasis::Lattice::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
           }
 
           inline void DoCollide(const LbmParameters* const lbmParams, HydroVars<MRT>& hydroVars)
           {
+            distribn_t collision[MomentBasis::Lattice::NUMVECTORS];
+
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+            switch (lattices::GetSimdLevel())
+            {
+              case lattices::SIMD_AVX512:
+                ApplyCollisionOperatorAVX512(collisionOperator, hydroVars.f_neq.f, collision);
+                break;
+              case lattices::SIMD_AVX2:
+                ApplyCollisionOperatorAVX2(collisionOperator, hydroVars.f_neq.f, collision);
+                break;
+              default:
+                ApplyCollisionOperator(collisionOperator, hydroVars.f_neq.f, collision);
+                break;
+            }
+#else
+            ApplyCollisionOperator(collisionOperator, hydroVars.f_neq.f, collision);
+#endif
+
             for (Direction direction = 0; direction < MomentBasis::Lattice::NUMVECTORS; ++direction)
             {
-              /** @todo #222 many optimisations possible (and necessary!).
-               *  - Compute the loop below as a matrix product in DoCalculate*, alternatively we could consider reimplementing DoCollide to work with whole arrays (consider libraries boost::ublas or Armadillo)
-               */
-              distribn_t collision = 0.;
-              for (unsigned momentIndex = 0; momentIndex < MomentBasis::NUM_KINETIC_MOMENTS; momentIndex++)
-              {
-                collision += collisionMatrix[momentIndex] * normalisedReducedMomentBasis[momentIndex][direction]
-                    * hydroVars.m_neq[momentIndex];
-              }
-              hydroVars.SetFPostCollision(direction, hydroVars.f[direction] - collision);
+              hydroVars.SetFPostCollision(direction, hydroVars.f[direction] - collision[direction]);
             }
           }
 
@@ -136,13 +115,162 @@ namespace hemelb
           {
             assert(newRelaxationParameters.size() == MomentBasis::NUM_KINETIC_MOMENTS);
             collisionMatrix = newRelaxationParameters;
+            SetUpCollisionOperator();
           }
 
         private:
+          /**
+           * Columns of the collision operator are padded with zeros to a whole number of
+           * AVX-512 registers, so that the product needs no remainder loops.
+           */
+          static const unsigned PADDED_NUMVECTORS = (MomentBasis::Lattice::NUMVECTORS + 7) & ~7u;
+
+          typedef distribn_t CollisionOperator[MomentBasis::Lattice::NUMVECTORS][PADDED_NUMVECTORS];
+
           /** MRT collision matrix (\hat{S}, diagonal). It corresponds to the inverse of the relaxation time for each mode. */
           std::vector<distribn_t> collisionMatrix;
 
-          double normalisedReducedMomentBasis[MomentBasis::NUM_KINETIC_MOMENTS][MomentBasis::Lattice::NUMVECTORS];
+          /**
+           * M^T * (M * M^T)^{-1} * \hat{S} * M, restricted to the kinetic moments and stored
+           * column-major: collisionOperator[other][direction] is the effect of f_neq[other] on
+           * direction.
+           */
+          CollisionOperator collisionOperator;
+
+          /**
+           * collision = collisionOperator * fNeq
+           *
+           * Accumulates a column of the operator at a time, into a local array so
+           * that the sums can stay in registers.
+           */
+          inline static void ApplyCollisionOperator(const CollisionOperator& op,
+                                                    const distribn_t* const fNeq,
+                                                    distribn_t* const collision)
+          {
+#ifdef HEMELB_USE_SSE3
+            static const unsigned BLOCKS = PADDED_NUMVECTORS / 2;
+            __m128d sum[BLOCKS];
+            for (unsigned block = 0; block < BLOCKS; ++block)
+            {
+              sum[block] = _mm_setzero_pd();
+            }
+            for (Direction other = 0; other < MomentBasis::Lattice::NUMVECTORS; ++other)
+            {
+              const __m128d fNeqOther = _mm_set1_pd(fNeq[other]);
+              for (unsigned block = 0; block < BLOCKS; ++block)
+              {
+                sum[block] = _mm_add_pd(sum[block], _mm_mul_pd(_mm_loadu_pd(&op[other][2 * block]), fNeqOther));
+              }
+            }
+
+            distribn_t result[PADDED_NUMVECTORS];
+            for (unsigned block = 0; block < BLOCKS; ++block)
+            {
+              _mm_storeu_pd(&result[2 * block], sum[block]);
+            }
+#else
+            distribn_t result[PADDED_NUMVECTORS] = { };
+            for (Direction other = 0; other < MomentBasis::Lattice::NUMVECTORS; ++other)
+            {
+              const distribn_t fNeqOther = fNeq[other];
+              for (Direction direction = 0; direction < MomentBasis::Lattice::NUMVECTORS; ++direction)
+              {
+                result[direction] += op[other][direction] * fNeqOther;
+              }
+            }
+#endif
+            for (Direction direction = 0; direction < MomentBasis::Lattice::NUMVECTORS; ++direction)
+            {
+              collision[direction] = result[direction];
+            }
+          }
+
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+          // As ApplyCollisionOperator, keeping the sums in registers. Alternate
+          // columns go into separate sums so that consecutive multiply-adds
+          // don't wait on each other.
+          HEMELB_TARGET_AVX512 static void ApplyCollisionOperatorAVX512(const CollisionOperator& op,
+                                                                        const distribn_t* const fNeq,
+                                                                        distribn_t* const collision)
+          {
+            static const unsigned BLOCKS = PADDED_NUMVECTORS / 8;
+            __m512d sum[BLOCKS], oddSum[BLOCKS];
+            for (unsigned block = 0; block < BLOCKS; ++block)
+            {
+              sum[block] = oddSum[block] = _mm512_setzero_pd();
+            }
+            Direction other = 0;
+            for (; other + 1 < MomentBasis::Lattice::NUMVECTORS; other += 2)
+            {
+              const __m512d fNeqOther = _mm512_set1_pd(fNeq[other]);
+              const __m512d fNeqNext = _mm512_set1_pd(fNeq[other + 1]);
+              for (unsigned block = 0; block < BLOCKS; ++block)
+              {
+                sum[block] = _mm512_fmadd_pd(_mm512_loadu_pd(&op[other][8 * block]), fNeqOther, sum[block]);
+                oddSum[block] = _mm512_fmadd_pd(_mm512_loadu_pd(&op[other + 1][8 * block]), fNeqNext, oddSum[block]);
+              }
+            }
+            if (other < MomentBasis::Lattice::NUMVECTORS)
+            {
+              const __m512d fNeqOther = _mm512_set1_pd(fNeq[other]);
+              for (unsigned block = 0; block < BLOCKS; ++block)
+              {
+                sum[block] = _mm512_fmadd_pd(_mm512_loadu_pd(&op[other][8 * block]), fNeqOther, sum[block]);
+              }
+            }
+
+            distribn_t result[PADDED_NUMVECTORS];
+            for (unsigned block = 0; block < BLOCKS; ++block)
+            {
+              _mm512_storeu_pd(&result[8 * block], _mm512_add_pd(sum[block], oddSum[block]));
+            }
+            for (Direction direction = 0; direction < MomentBasis::Lattice::NUMVECTORS; ++direction)
+            {
+              collision[direction] = result[direction];
+            }
+          }
+
+          HEMELB_TARGET_AVX2 static void ApplyCollisionOperatorAVX2(const CollisionOperator& op,
+                                                                    const distribn_t* const fNeq,
+                                                                    distribn_t* const collision)
+          {
+            static const unsigned BLOCKS = PADDED_NUMVECTORS / 4;
+            __m256d sum[BLOCKS], oddSum[BLOCKS];
+            for (unsigned block = 0; block < BLOCKS; ++block)
+            {
+              sum[block] = oddSum[block] = _mm256_setzero_pd();
+            }
+            Direction other = 0;
+            for (; other + 1 < MomentBasis::Lattice::NUMVECTORS; other += 2)
+            {
+              const __m256d fNeqOther = _mm256_set1_pd(fNeq[other]);
+              const __m256d fNeqNext = _mm256_set1_pd(fNeq[other + 1]);
+              for (unsigned block = 0; block < BLOCKS; ++block)
+              {
+                sum[block] = _mm256_fmadd_pd(_mm256_loadu_pd(&op[other][4 * block]), fNeqOther, sum[block]);
+                oddSum[block] = _mm256_fmadd_pd(_mm256_loadu_pd(&op[other + 1][4 * block]), fNeqNext, oddSum[block]);
+              }
+            }
+            if (other < MomentBasis::Lattice::NUMVECTORS)
+            {
+              const __m256d fNeqOther = _mm256_set1_pd(fNeq[other]);
+              for (unsigned block = 0; block < BLOCKS; ++block)
+              {
+                sum[block] = _mm256_fmadd_pd(_mm256_loadu_pd(&op[other][4 * block]), fNeqOther, sum[block]);
+              }
+            }
+
+            distribn_t result[PADDED_NUMVECTORS];
+            for (unsigned block = 0; block < BLOCKS; ++block)
+            {
+              _mm256_storeu_pd(&result[4 * block], _mm256_add_pd(sum[block], oddSum[block]));
+            }
+            for (Direction direction = 0; direction < MomentBasis::Lattice::NUMVECTORS; ++direction)
+            {
+              collision[direction] = result[direction];
+            }
+          }
+#endif
 
           /**
            *  Helper method to set/update member variables. Called from the constructor and Reset()
@@ -152,6 +280,32 @@ namespace hemelb
           void InitState(const InitParams& initParams)
           {
             MomentBasis::SetUpCollisionMatrix(collisionMatrix, initParams.lbmParams->GetTau());
+            SetUpCollisionOperator();
+          }
+
+          /**
+           * Multiply out collisionOperator from the basis and the current collision matrix.
+           */
+          void SetUpCollisionOperator()
+          {
+            for (Direction direction = 0; direction < MomentBasis::Lattice::NUMVECTORS; ++direction)
+            {
+              for (Direction other = 0; other < MomentBasis::Lattice::NUMVECTORS; ++other)
+              {
+                distribn_t element = 0.;
+                for (unsigned momentIndex = 0; momentIndex < MomentBasis::NUM_KINETIC_MOMENTS; momentIndex++)
+                {
+                  element += MomentBasis::REDUCED_MOMENT_BASIS[momentIndex][direction]
+                      * collisionMatrix[momentIndex] / MomentBasis::BASIS_TIMES_BASIS_TRANSPOSED[momentIndex]
+                      * MomentBasis::REDUCED_MOMENT_BASIS[momentIndex][other];
+                }
+                collisionOperator[other][direction] = element;
+              }
+              for (unsigned padding = MomentBasis::Lattice::NUMVECTORS; padding < PADDED_NUMVECTORS; ++padding)
+              {
+                collisionOperator[direction][padding] = 0.;
+              }
+            }
           }
 
       };
@@ -0,0 +1,193 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_KERNELS_REGULARISED_H
+#define HEMELB_LB_KERNELS_REGULARISED_H
+
+#include "lb/kernels/BaseKernel.h"
+#include "lb/kernels/SiteBatch.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace kernels
+    {
+      /**
+       * Regularised LBGK (Latt & Chopard, Math. Comput. Simul. 72, 165 (2006)).
+       *
+       * Before relaxing, f_neq is replaced by its projection onto the second-order
+       * Hermite polynomials, which is all of f_neq that the Navier-Stokes level
+       * needs:
+       *
+       *   f_neq_i -> w_i / (2 c_s^4) Q_iab Pi_ab,  Q_iab = c_ia c_ib - c_s^2 delta_ab
+       *
+       * where Pi_ab = sum_i c_ia c_ib f_neq_i. The higher-order (ghost) content of
+       * f_neq, which LBGK carries from step to step and which is what goes unstable
+       * at low viscosity, is dropped. The post-collision distribution is
+       *
+       *   f_i = f_eq_i + (1 + omega) f_neq_i
+       *
+       * (with HemeLB's omega = -1/tau), which conserves mass and momentum as the
+       * projection has no zeroth- or first-order moments.
+       */
+      template<class LatticeType>
+      class Regularised : public BaseKernel<Regularised<LatticeType>, LatticeType>
+      {
+        public:
+          Regularised(InitParams& initParams)
+          {
+          }
+
+          inline void DoCalculateDensityMomentumFeq(HydroVars<Regularised<LatticeType> >& hydroVars,
+                                                    site_t index)
+          {
+            LatticeType::CalculateDensityMomentumFEq(hydroVars.f,
+                                                     hydroVars.density,
+                                                     hydroVars.momentum.x,
+                                                     hydroVars.momentum.y,
+                                                     hydroVars.momentum.z,
+                                                     hydroVars.velocity.x,
+                                                     hydroVars.velocity.y,
+                                                     hydroVars.velocity.z,
+                                                     hydroVars.f_eq.f);
+
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
+          }
+
+          inline void DoCalculateFeq(HydroVars<Regularised>& hydroVars, site_t index)
+          {
+            LatticeType::CalculateFeq(hydroVars.density,
+                                      hydroVars.momentum.x,
+                                      hydroVars.momentum.y,
+                                      hydroVars.momentum.z,
+                                      hydroVars.f_eq.f);
+
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
+          }
+
+          inline void DoCollide(const LbmParameters* const lbmParams, HydroVars<Regularised>& hydroVars)
+          {
+            // The non-equilibrium momentum flux, xx, yy, zz, xy, xz, yz.
+            distribn_t pi[6] = { 0., 0., 0., 0., 0., 0. };
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              const distribn_t fNeq = hydroVars.f_neq.f[direction];
+              pi[0] += LatticeType::CXD[direction] * LatticeType::CXD[direction] * fNeq;
+              pi[1] += LatticeType::CYD[direction] * LatticeType::CYD[direction] * fNeq;
+              pi[2] += LatticeType::CZD[direction] * LatticeType::CZD[direction] * fNeq;
+              pi[3] += LatticeType::CXD[direction] * LatticeType::CYD[direction] * fNeq;
+              pi[4] += LatticeType::CXD[direction] * LatticeType::CZD[direction] * fNeq;
+              pi[5] += LatticeType::CYD[direction] * LatticeType::CZD[direction] * fNeq;
+            }
+
+            const distribn_t relaxation = 1.0 + lbmParams->GetOmega();
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              hydroVars.SetFPostCollision(direction,
+                                          hydroVars.f_eq.f[direction]
+                                              + relaxation * ProjectedFNeq(direction, pi));
+            }
+          }
+
+          /**
+           * As DoCalculateDensityMomentumFeq, for every site of the batch.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateDensityMomentumFeqBatch(SiteBatch<LatticeType>& batch)
+          {
+            batch.CalculateDensityMomentumFeq();
+          }
+
+          /**
+           * As DoCollide, for every site of the batch.
+           */
+          HEMELB_SITE_BATCH_INLINE void CollideBatch(const LbmParameters* const lbmParams,
+                                                     SiteBatch<LatticeType>& batch)
+          {
+            static const unsigned WIDTH = SiteBatch<LatticeType>::WIDTH;
+
+            distribn_t pi[6][WIDTH];
+            for (unsigned component = 0; component < 6; ++component)
+            {
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                pi[component][lane] = 0.;
+              }
+            }
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              const distribn_t cx = LatticeType::CXD[direction];
+              const distribn_t cy = LatticeType::CYD[direction];
+              const distribn_t cz = LatticeType::CZD[direction];
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                const distribn_t fNeq = batch.fNeq[direction][lane];
+                pi[0][lane] += cx * cx * fNeq;
+                pi[1][lane] += cy * cy * fNeq;
+                pi[2][lane] += cz * cz * fNeq;
+                pi[3][lane] += cx * cy * fNeq;
+                pi[4][lane] += cx * cz * fNeq;
+                pi[5][lane] += cy * cz * fNeq;
+              }
+            }
+
+            const distribn_t relaxation = 1.0 + lbmParams->GetOmega();
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              distribn_t hermite[6];
+              GetHermiteCoefficients(direction, hermite);
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                const distribn_t projected = hermite[0] * pi[0][lane] + hermite[1] * pi[1][lane]
+                    + hermite[2] * pi[2][lane] + hermite[3] * pi[3][lane] + hermite[4] * pi[4][lane]
+                    + hermite[5] * pi[5][lane];
+                batch.fPostCollision[direction][lane] = batch.fEq[direction][lane]
+                    + relaxation * projected;
+              }
+            }
+          }
+
+        private:
+          /**
+           * The weights by which each component of Pi contributes to the projected
+           * f_neq in the given direction: w_i / (2 c_s^4) Q_iab, with the symmetric
+           * off-diagonal pairs folded together.
+           */
+          HEMELB_SITE_BATCH_INLINE static void GetHermiteCoefficients(const Direction direction,
+                                                                      distribn_t hermite[6])
+          {
+            // 1 / (2 c_s^4) = 9 / 2.
+            const distribn_t scale = 4.5 * LatticeType::EQMWEIGHTS[direction];
+            const distribn_t cx = LatticeType::CXD[direction];
+            const distribn_t cy = LatticeType::CYD[direction];
+            const distribn_t cz = LatticeType::CZD[direction];
+            hermite[0] = scale * (cx * cx - 1.0 / 3.0);
+            hermite[1] = scale * (cy * cy - 1.0 / 3.0);
+            hermite[2] = scale * (cz * cz - 1.0 / 3.0);
+            hermite[3] = scale * 2.0 * cx * cy;
+            hermite[4] = scale * 2.0 * cx * cz;
+            hermite[5] = scale * 2.0 * cy * cz;
+          }
+
+          inline static distribn_t ProjectedFNeq(const Direction direction, const distribn_t pi[6])
+          {
+            distribn_t hermite[6];
+            GetHermiteCoefficients(direction, hermite);
+            return hermite[0] * pi[0] + hermite[1] * pi[1] + hermite[2] * pi[2] + hermite[3] * pi[3]
+                + hermite[4] * pi[4] + hermite[5] * pi[5];
+          }
+      };
+
+      template<class LatticeType>
+      struct HasSiteBatch<Regularised<LatticeType> > : public std::true_type
+      {
+      };
+
+    }
+  }
+}
+
+#endif /* HEMELB_LB_KERNELS_REGULARISED_H */
@@ -0,0 +1,169 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_KERNELS_SITEBATCH_H
+#define HEMELB_LB_KERNELS_SITEBATCH_H
+
+#include <type_traits>
+
+#include "units.h"
+
+// The batch code is written as plain loops over the sites of a batch and
+// relies on being inlined into a caller compiled for the wider instruction
+// set (see StreamerTypeFactory) to be vectorised at that width.
+#define HEMELB_SITE_BATCH_INLINE inline __attribute__((always_inline))
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace kernels
+    {
+      /**
+       * Whether a kernel (or collision) can collide a whole SiteBatch at once.
+       * Specialised to true next to the kernels that implement
+       * CalculateDensityMomentumFeqBatch(SiteBatch<LatticeType>&) and
+       * CollideBatch(const LbmParameters*, SiteBatch<LatticeType>&).
+       */
+      template<class KernelOrCollision>
+      struct HasSiteBatch : public std::false_type
+      {
+      };
+
+      /**
+       * The distributions and moments of WIDTH consecutive sites, stored
+       * direction-major so that the same operation on every site of the
+       * batch maps onto one vector instruction (8 doubles is a full AVX-512
+       * register, or two AVX2 ones).
+       *
+       * Used for bulk fluid sites, whose links all go to the neighbouring
+       * fluid site, so nothing but the collision differs between the sites.
+       */
+      template<class LatticeType>
+      class SiteBatch
+      {
+        public:
+          static const unsigned WIDTH = 8;
+
+          /**
+           * Transpose fOld for sites [first, first + WIDTH) into f. Those sites'
+           * distributions are contiguous in LatticeData.
+           * @param fOld the distributions of the first site of the batch
+           * @param firstSiteIndex the index of the first site of the batch
+           */
+          HEMELB_SITE_BATCH_INLINE void Load(const distribn_t* fOld, const site_t firstSiteIndex)
+          {
+            firstIndex = firstSiteIndex;
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+              for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+              {
+                f[direction][lane] = fOld[lane * LatticeType::NUMVECTORS + direction];
+              }
+            }
+          }
+
+          /**
+           * As Lattice::CalculateDensityMomentumFEq followed by CalculateFNeq, for every site.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateDensityMomentumFeq()
+          {
+            CalculateDensityAndMomentum();
+            CalculateFeq();
+            CalculateFNeq();
+          }
+
+          /**
+           * As Lattice::CalculateDensityAndMomentum, for every site.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateDensityAndMomentum()
+          {
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+              density[lane] = momentum_x[lane] = momentum_y[lane] = momentum_z[lane] = 0.0;
+            }
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              const distribn_t cx = LatticeType::CXD[direction];
+              const distribn_t cy = LatticeType::CYD[direction];
+              const distribn_t cz = LatticeType::CZD[direction];
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                density[lane] += f[direction][lane];
+                momentum_x[lane] += cx * f[direction][lane];
+                momentum_y[lane] += cy * f[direction][lane];
+                momentum_z[lane] += cz * f[direction][lane];
+              }
+            }
+          }
+
+          /**
+           * The LBGK equilibrium distribution of every site, from its density and momentum.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateFeq()
+          {
+            distribn_t baseTerm[WIDTH], nineHalvesOfDensity_1[WIDTH];
+            for (unsigned lane = 0; lane < WIDTH; ++lane)
+            {
+#if HEMELB_LATTICE_INCOMPRESSIBLE
+              const distribn_t density_1 = 1.;
+#else
+              const distribn_t density_1 = 1. / density[lane];
+#endif
+              const distribn_t momentumMagnitudeSquared = momentum_x[lane] * momentum_x[lane]
+                  + momentum_y[lane] * momentum_y[lane] + momentum_z[lane] * momentum_z[lane];
+              baseTerm[lane] = density[lane] - (3. / 2.) * momentumMagnitudeSquared * density_1;
+              nineHalvesOfDensity_1[lane] = (9. / 2.) * density_1;
+            }
+
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              const distribn_t cx = LatticeType::CXD[direction];
+              const distribn_t cy = LatticeType::CYD[direction];
+              const distribn_t cz = LatticeType::CZD[direction];
+              const distribn_t weight = LatticeType::EQMWEIGHTS[direction];
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                const distribn_t mom_dot_ei = cx * momentum_x[lane] + cy * momentum_y[lane]
+                    + cz * momentum_z[lane];
+                fEq[direction][lane] = weight
+                    * (baseTerm[lane] + nineHalvesOfDensity_1[lane] * mom_dot_ei * mom_dot_ei
+                        + 3. * mom_dot_ei);
+              }
+            }
+          }
+
+          /**
+           * fNeq = f - fEq for every site.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateFNeq()
+          {
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              for (unsigned lane = 0; lane < WIDTH; ++lane)
+              {
+                fNeq[direction][lane] = f[direction][lane] - fEq[direction][lane];
+              }
+            }
+          }
+
+          alignas(64) distribn_t f[LatticeType::NUMVECTORS][WIDTH];
+          alignas(64) distribn_t fEq[LatticeType::NUMVECTORS][WIDTH];
+          alignas(64) distribn_t fNeq[LatticeType::NUMVECTORS][WIDTH];
+          alignas(64) distribn_t fPostCollision[LatticeType::NUMVECTORS][WIDTH];
+          alignas(64) distribn_t density[WIDTH];
+          alignas(64) distribn_t momentum_x[WIDTH];
+          alignas(64) distribn_t momentum_y[WIDTH];
+          alignas(64) distribn_t momentum_z[WIDTH];
+
+          //! The index of the first site of the batch, for kernels that keep per-site state.
+          site_t firstIndex;
+      };
+    }
+  }
+}
+
+#endif /* HEMELB_LB_KERNELS_SITEBATCH_H */
@@ -11,6 +11,7 @@
 #include "lb/HFunction.h"
 #include "util/UtilityFunctions.h"
 #include "lb/kernels/BaseKernel.h"
+#include "lb/kernels/SiteBatch.h"
 
 #include "debug/Debugger.h"
 
@@ -59,10 +60,7 @@ namespace hemelb
                                                      hydroVars.velocity.z,
                                                      hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
           }
 
           inline void DoCalculateFeq(HydroVars<TRT>& hydroVars, site_t index)
@@ -73,10 +71,7 @@ namespace hemelb
                                       hydroVars.momentum.z,
                                       hydroVars.f_eq.f);
 
-            for (unsigned int ii = 0; ii < LatticeType::NUMVECTORS; ++ii)
-            {
-              hydroVars.f_neq.f[ii] = hydroVars.f[ii] - hydroVars.f_eq.f[ii];
-            }
+            LatticeType::CalculateFNeq(hydroVars.f, hydroVars.f_eq.f, hydroVars.f_neq.f);
           }
 
           inline void DoCollide(const LbmParameters* const lbmParams, HydroVars<TRT>& hydroVars)
@@ -112,6 +107,48 @@ namespace hemelb
             }
           }
 
+          /**
+           * As DoCalculateDensityMomentumFeq, for every site of the batch.
+           */
+          HEMELB_SITE_BATCH_INLINE void CalculateDensityMomentumFeqBatch(SiteBatch<LatticeType>& batch)
+          {
+            batch.CalculateDensityMomentumFeq();
+          }
+
+          /**
+           * As DoCollide, for every site of the batch. Each direction is
+           * updated along with its opposite, so there's no need to go through
+           * the direction pairs.
+           */
+          HEMELB_SITE_BATCH_INLINE void CollideBatch(const LbmParameters* const lbmParams,
+                                                     SiteBatch<LatticeType>& batch)
+          {
+            const distribn_t Lambda = 3.0 / 16.0;
+
+            const distribn_t tau_plus = lbmParams->GetTau();
+            const distribn_t omega_plus = lbmParams->GetOmega();
+            const distribn_t tau_minus = 0.5 + Lambda / (tau_plus - 0.5);
+            const distribn_t omega_minus = -1.0 / tau_minus;
+
+            for (Direction i = 0; i < LatticeType::NUMVECTORS; ++i)
+            {
+              const Direction iBar = LatticeType::INVERSEDIRECTIONS[i];
+              for (unsigned lane = 0; lane < SiteBatch<LatticeType>::WIDTH; ++lane)
+              {
+                const distribn_t sym = 0.5 * omega_plus
+                    * (batch.fNeq[i][lane] + batch.fNeq[iBar][lane]);
+                const distribn_t asym = 0.5 * omega_minus
+                    * (batch.fNeq[i][lane] - batch.fNeq[iBar][lane]);
+                batch.fPostCollision[i][lane] = batch.f[i][lane] + sym + asym;
+              }
+            }
+          }
+
+      };
+
+      template<class LatticeType>
+      struct HasSiteBatch<TRT<LatticeType> > : public std::true_type
+      {
       };
 
     }
@@ -14,6 +14,7 @@
 
 #include "constants.h"
 #include "lb/lattices/LatticeInfo.h"
+#include "lb/lattices/LatticeSimd.h"
 #include "util/UtilityFunctions.h"
 #include "util/Vector3D.h"
 #include "util/Matrix3D.h"
@@ -44,11 +45,11 @@ namespace hemelb
            * @param momentum_y
            * @param momentum_z
            */
-          inline static void CalculateDensityAndMomentum(const distribn_t f[],
-                                                       distribn_t &density,
-                                                       distribn_t &momentum_x,
-                                                       distribn_t &momentum_y,
-                                                       distribn_t &momentum_z)
+          inline static void CalculateDensityAndMomentumBaseline(const distribn_t f[],
+                                                                 distribn_t &density,
+                                                                 distribn_t &momentum_x,
+                                                                 distribn_t &momentum_y,
+                                                                 distribn_t &momentum_z)
           {
             // SSE2 accumulator registers containing a pair of double values
             __m128d density_SSE2;
@@ -113,11 +114,11 @@ namespace hemelb
            * @param momentum_y
            * @param momentum_z
            */
-          inline static void CalculateDensityAndMomentum(const distribn_t f[],
-                                                         distribn_t &density,
-                                                         distribn_t &momentum_x,
-                                                         distribn_t &momentum_y,
-                                                         distribn_t &momentum_z)
+          inline static void CalculateDensityAndMomentumBaseline(const distribn_t f[],
+                                                                 distribn_t &density,
+                                                                 distribn_t &momentum_x,
+                                                                 distribn_t &momentum_y,
+                                                                 distribn_t &momentum_z)
           {
             density = momentum_x = momentum_y = momentum_z = 0.0;
 
@@ -132,11 +133,11 @@ namespace hemelb
 #endif
 
 #if HEMELB_LATTICE_INCOMPRESSIBLE
-          inline static void CalculateFeq(const distribn_t &density,
-                                          const distribn_t &momentum_x,
-                                          const distribn_t &momentum_y,
-                                          const distribn_t &momentum_z,
-                                          distribn_t f_eq[])
+          inline static void CalculateFeqBaseline(const distribn_t &density,
+                                                  const distribn_t &momentum_x,
+                                                  const distribn_t &momentum_y,
+                                                  const distribn_t &momentum_z,
+                                                  distribn_t f_eq[])
           {
             const distribn_t momentumMagnitudeSquared =
                 momentum_x * momentum_x
@@ -171,11 +172,11 @@ namespace hemelb
            * @param momentum_z
            * @param f_eq
            */
-          inline static void CalculateFeq(const distribn_t &density,
-                                          const distribn_t &momentum_x,
-                                          const distribn_t &momentum_y,
-                                          const distribn_t &momentum_z,
-                                          distribn_t f_eq[])
+          inline static void CalculateFeqBaseline(const distribn_t &density,
+                                                  const distribn_t &momentum_x,
+                                                  const distribn_t &momentum_y,
+                                                  const distribn_t &momentum_z,
+                                                  distribn_t f_eq[])
           {
 
             // merge some constants and invariants and populate SSE registers by them
@@ -261,11 +262,11 @@ namespace hemelb
            * @param momentum_z
            * @param f_eq
            */
-          inline static void CalculateFeq(const distribn_t &density,
-                                          const distribn_t &momentum_x,
-                                          const distribn_t &momentum_y,
-                                          const distribn_t &momentum_z,
-                                          distribn_t f_eq[])
+          inline static void CalculateFeqBaseline(const distribn_t &density,
+                                                  const distribn_t &momentum_x,
+                                                  const distribn_t &momentum_y,
+                                                  const distribn_t &momentum_z,
+                                                  distribn_t f_eq[])
           {
             const distribn_t density_1 = 1. / density;
             const distribn_t momentumMagnitudeSquared =
@@ -288,6 +289,102 @@ namespace hemelb
           }
 #endif
 
+          /**
+           * Calculate density and momentum with the widest instructions
+           * the CPU supports (see SimdLevel.h), falling back to the baseline.
+           * @param f
+           * @param density
+           * @param momentum_x
+           * @param momentum_y
+           * @param momentum_z
+           */
+          inline static void CalculateDensityAndMomentum(const distribn_t f[],
+                                                         distribn_t &density,
+                                                         distribn_t &momentum_x,
+                                                         distribn_t &momentum_y,
+                                                         distribn_t &momentum_z)
+          {
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+            switch (GetSimdLevel())
+            {
+              case SIMD_AVX512:
+                LatticeSimd<DmQn>::CalculateDensityAndMomentumAVX512(f, density, momentum_x, momentum_y, momentum_z);
+                return;
+              case SIMD_AVX2:
+                LatticeSimd<DmQn>::CalculateDensityAndMomentumAVX2(f, density, momentum_x, momentum_y, momentum_z);
+                return;
+              default:
+                break;
+            }
+#endif
+            CalculateDensityAndMomentumBaseline(f, density, momentum_x, momentum_y, momentum_z);
+          }
+
+          /**
+           * Calculate Feq with the widest instructions the CPU supports,
+           * falling back to the baseline.
+           * @param density
+           * @param momentum_x
+           * @param momentum_y
+           * @param momentum_z
+           * @param f_eq
+           */
+          inline static void CalculateFeq(const distribn_t &density,
+                                          const distribn_t &momentum_x,
+                                          const distribn_t &momentum_y,
+                                          const distribn_t &momentum_z,
+                                          distribn_t f_eq[])
+          {
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+#if HEMELB_LATTICE_INCOMPRESSIBLE
+            const distribn_t density_1 = 1.;
+#else
+            const distribn_t density_1 = 1. / density;
+#endif
+            switch (GetSimdLevel())
+            {
+              case SIMD_AVX512:
+                LatticeSimd<DmQn>::CalculateFeqAVX512(density, density_1, momentum_x, momentum_y, momentum_z, f_eq);
+                return;
+              case SIMD_AVX2:
+                LatticeSimd<DmQn>::CalculateFeqAVX2(density, density_1, momentum_x, momentum_y, momentum_z, f_eq);
+                return;
+              default:
+                break;
+            }
+#endif
+            CalculateFeqBaseline(density, momentum_x, momentum_y, momentum_z, f_eq);
+          }
+
+          /**
+           * The non-equilibrium part of the distribution, f - f_eq.
+           * @param f
+           * @param f_eq
+           * @param f_neq
+           */
+          inline static void CalculateFNeq(const distribn_t f[],
+                                           const distribn_t f_eq[],
+                                           distribn_t f_neq[])
+          {
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+            switch (GetSimdLevel())
+            {
+              case SIMD_AVX512:
+                LatticeSimd<DmQn>::CalculateFNeqAVX512(f, f_eq, f_neq);
+                return;
+              case SIMD_AVX2:
+                LatticeSimd<DmQn>::CalculateFNeqAVX2(f, f_eq, f_neq);
+                return;
+              default:
+                break;
+            }
+#endif
+            for (Direction i = 0; i < DmQn::NUMVECTORS; ++i)
+            {
+              f_neq[i] = f[i] - f_eq[i];
+            }
+          }
+
           // Calculate density, momentum and the equilibrium distribution
           // functions according to the D3Q15 model.  The calculated momentum_x, momentum_y
           // and momentum_z are actually density * velocity, because we are using the
@@ -322,39 +419,24 @@ namespace hemelb
                                                      distribn_t &stress,
                                                      const double iStressParameter)
           {
-            // Recall that sigma_ij = Sum_l f(l) * C_il * C_jl
-
-            // First calculate sigma_xx - sigma_yy.
-            // Using standard form of sigma_ij, sigma_xx - sigma_yy
-            //   = Sum_l f(l) * (Cx(l) * Cx(l) - Cy(l) * Cy(l))
-            // We calculate sigma_yy - sigma_zz and sigma_xx and sigma_zz
-            // in the same way.
-            distribn_t sigma_xx_yy = 0.0;
-            distribn_t sigma_yy_zz = 0.0;
-            distribn_t sigma_xx_zz = 0.0;
-
-            // We will also require sigma_xy, sigma_yz and sigma_xz, calculated in the usual
-            // way.
-            distribn_t sigma_xy = 0.0;
-            distribn_t sigma_xz = 0.0;
-            distribn_t sigma_yz = 0.0;
+            CalculateVonMisesStressFromPi(CalculatePiTensor(f), stress, iStressParameter);
+          }
 
-            for (Direction direction = 0; direction < DmQn::NUMVECTORS; ++direction)
-            {
-              sigma_xx_yy += f[direction]
-                  * (DmQn::CX[direction] * DmQn::CX[direction] - DmQn::CY[direction] * DmQn::CY[direction]);
-              sigma_yy_zz += f[direction]
-                  * (DmQn::CY[direction] * DmQn::CY[direction] - DmQn::CZ[direction] * DmQn::CZ[direction]);
-              sigma_xx_zz += f[direction]
-                  * (DmQn::CX[direction] * DmQn::CX[direction] - DmQn::CZ[direction] * DmQn::CZ[direction]);
-
-              sigma_xy += f[direction] * DmQn::CX[direction] * DmQn::CY[direction];
-              sigma_xz += f[direction] * DmQn::CX[direction] * DmQn::CZ[direction];
-              sigma_yz += f[direction] * DmQn::CY[direction] * DmQn::CZ[direction];
-            }
+          /**
+           * As CalculateVonMisesStress, given the second moment of the non-equilibrium
+           * distribution functions (see CalculatePiTensor).
+           */
+          inline static void CalculateVonMisesStressFromPi(const util::Matrix3D& pi,
+                                                           distribn_t &stress,
+                                                           const double iStressParameter)
+          {
+            // Recall that sigma_ij = Sum_l f(l) * C_il * C_jl, which is pi.
+            distribn_t sigma_xx_yy = pi[0][0] - pi[1][1];
+            distribn_t sigma_yy_zz = pi[1][1] - pi[2][2];
+            distribn_t sigma_xx_zz = pi[0][0] - pi[2][2];
 
             distribn_t a = sigma_xx_yy * sigma_xx_yy + sigma_yy_zz * sigma_yy_zz + sigma_xx_zz * sigma_xx_zz;
-            distribn_t b = sigma_xy * sigma_xy + sigma_xz * sigma_xz + sigma_yz * sigma_yz;
+            distribn_t b = pi[0][1] * pi[0][1] + pi[0][2] * pi[0][2] + pi[1][2] * pi[1][2];
 
             stress = iStressParameter * sqrt(a + 6.0 * b);
           }
@@ -407,6 +489,16 @@ namespace hemelb
             util::Vector3D<LatticeStress> traction;
             CalculateTractionOnAPoint(density, tau, fNonEquilibrium, wallNormal, traction);
 
+            CalculateTangentialProjection(traction, wallNormal, tractionTangentialComponent);
+          }
+
+          /**
+           * The projection of a traction vector on the plane with the given normal.
+           */
+          inline static void CalculateTangentialProjection(const util::Vector3D<LatticeStress>& traction,
+                                                           const util::Vector3D<Dimensionless>& wallNormal,
+                                                           util::Vector3D<LatticeStress>& tractionTangentialComponent)
+          {
             LatticeStress magnitudeNormalProjectionTraction = traction.Dot(wallNormal);
 
             tractionTangentialComponent = traction - wallNormal * magnitudeNormalProjectionTraction;
@@ -437,9 +529,21 @@ namespace hemelb
                                                    const distribn_t tau,
                                                    const distribn_t fNonEquilibrium[],
                                                    util::Matrix3D& stressTensor)
+          {
+            CalculateStressTensorFromPi(density, tau, CalculatePiTensor(fNonEquilibrium), stressTensor);
+          }
+
+          /**
+           * As CalculateStressTensor, given the second moment of the non equilibrium
+           * part of the distribution function (see CalculatePiTensor).
+           */
+          inline static void CalculateStressTensorFromPi(const distribn_t density,
+                                                         const distribn_t tau,
+                                                         const util::Matrix3D& pi,
+                                                         util::Matrix3D& stressTensor)
           {
             // Initialises the stress tensor to the deviatoric part, i.e. -\Pi^{(neq)}
-            stressTensor = CalculatePiTensor(fNonEquilibrium);
+            stressTensor = pi;
             stressTensor *= 1 - 1 / (2 * tau);
 
             // Add the pressure component to the stress tensor. The reference pressure given
@@ -465,6 +569,18 @@ namespace hemelb
                                                                const util::Vector3D<double> nor,
                                                                distribn_t &stress,
                                                                const double &iStressParameter)
+          {
+            CalculateWallShearStressMagnitudeFromPi(CalculatePiTensor(f), nor, stress, iStressParameter);
+          }
+
+          /**
+           * As CalculateWallShearStressMagnitude, given the second moment of the non
+           * equilibrium distribution function (see CalculatePiTensor).
+           */
+          inline static void CalculateWallShearStressMagnitudeFromPi(const util::Matrix3D& pi,
+                                                                     const util::Vector3D<double> nor,
+                                                                     distribn_t &stress,
+                                                                     const double &iStressParameter)
           {
             // sigma_ij is the force
             // per unit area in
@@ -484,9 +600,6 @@ namespace hemelb
             // of the moment flux tensor pi.
             distribn_t temp = iStressParameter * (-sqrt(2.0));
 
-            // Computes the second moment of the equilibrium function f.
-            util::Matrix3D pi = CalculatePiTensor(f);
-
             for (unsigned i = 0; i < 3; i++)
             {
               for (unsigned j = 0; j < 3; j++)
@@ -510,6 +623,22 @@ namespace hemelb
            */
           inline static util::Matrix3D CalculatePiTensor(const distribn_t* const f)
           {
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+            switch (GetSimdLevel())
+            {
+              case SIMD_AVX512:
+                return LatticeSimd<DmQn>::CalculatePiTensorAVX512(f);
+              case SIMD_AVX2:
+                return LatticeSimd<DmQn>::CalculatePiTensorAVX2(f);
+              default:
+                break;
+            }
+#endif
+            return CalculatePiTensorBaseline(f);
+          }
+
+          inline static util::Matrix3D CalculatePiTensorBaseline(const distribn_t* const f)
+          {
             util::Matrix3D ret;
 
             // Fill in 0,0 1,0 1,1 2,0 2,1 2,2
@@ -541,18 +670,32 @@ namespace hemelb
                                                       const distribn_t iFNeq[],
                                                       const distribn_t &iDensity)
           {
+            return CalculateShearRateFromPi(iTau, CalculatePiTensor(iFNeq), iDensity);
+          }
+
+          /**
+           * As CalculateShearRate, given the second moment of the non equilibrium
+           * distribution function (see CalculatePiTensor).
+           */
+          inline static distribn_t CalculateShearRateFromPi(const distribn_t &iTau,
+                                                            const util::Matrix3D& pi,
+                                                            const distribn_t &iDensity)
+          {
+            // The strain rate tensor is pi scaled by this.
+            const distribn_t strainRatePerPi = -1.0 / (2.0 * iTau * iDensity * Cs2);
+
             distribn_t shear_rate = 0.0;
             distribn_t strain_rate_tensor_i_j;
 
             // Take advantage of strain rate tensor symmetry
             for (unsigned row = 0; row < 3; row++)
             {
-              strain_rate_tensor_i_j = CalculateStrainRateTensorComponent(row, row, iTau, iFNeq, iDensity);
+              strain_rate_tensor_i_j = pi[row][row] * strainRatePerPi;
               shear_rate += strain_rate_tensor_i_j * strain_rate_tensor_i_j;
 
               for (unsigned column = row+1; column < 3; column++)
               {
-                strain_rate_tensor_i_j = CalculateStrainRateTensorComponent(row, column, iTau, iFNeq, iDensity);
+                strain_rate_tensor_i_j = pi[row][column] * strainRatePerPi;
                 shear_rate += 2*strain_rate_tensor_i_j * strain_rate_tensor_i_j;
               }
             }
@@ -694,27 +837,6 @@ namespace hemelb
           }
 
         private:
-          inline static distribn_t CalculateStrainRateTensorComponent(const unsigned &iRow,
-                                                                      const unsigned &iColumn,
-                                                                      const distribn_t &iTau,
-                                                                      const distribn_t iFNeq[],
-                                                                      const distribn_t &iDensity)
-          {
-            distribn_t strain_rate_tensor_i_j = 0.0;
-
-            for (Direction vec_index = 0; vec_index < DmQn::NUMVECTORS; vec_index++)
-            {
-              strain_rate_tensor_i_j +=
-                  iFNeq[vec_index]
-                      * (DmQn::discreteVelocityVectors[iRow][vec_index]
-                          * DmQn::discreteVelocityVectors[iColumn][vec_index]);
-            }
-
-            strain_rate_tensor_i_j *= -1.0 / (2.0 * iTau * iDensity * Cs2);
-
-            return strain_rate_tensor_i_j;
-          }
-
           /**
            * Calculate high order of zeta as defined by equation 10 in Chikatamarla et al (PRL, 97, 010201 (2006)
            * @param velocity
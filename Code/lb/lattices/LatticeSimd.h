@@ -0,0 +1,359 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_LATTICES_LATTICESIMD_H
+#define HEMELB_LB_LATTICES_LATTICESIMD_H
+
+#include "lb/lattices/SimdLevel.h"
+
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+
+#include <immintrin.h>
+
+#include "units.h"
+#include "util/Matrix3D.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace lattices
+    {
+      /**
+       * AVX2 and AVX-512 versions of the Lattice primitives, chosen between at
+       * run time by Lattice according to GetSimdLevel().
+       *
+       * The directions are processed in blocks of 4 (AVX2) or 8 (AVX-512)
+       * doubles; the remainder (e.g. 3 or 7 of the 15 for D3Q15) is done with
+       * masked loads and stores rather than in scalar code. Nothing here may
+       * assume alignment as f, f_eq and f_neq can start anywhere.
+       *
+       * Sums are accumulated in a different order from the scalar code (and
+       * with fused multiply-adds), so results agree to rounding only.
+       */
+      template<class DmQn>
+      class LatticeSimd
+      {
+        private:
+          static const Direction AVX2_WIDTH = 4;
+          static const Direction AVX2_BODY = (DmQn::NUMVECTORS / AVX2_WIDTH) * AVX2_WIDTH;
+          static const Direction AVX2_TAIL = DmQn::NUMVECTORS - AVX2_BODY;
+
+          static const Direction AVX512_WIDTH = 8;
+          static const Direction AVX512_BODY = (DmQn::NUMVECTORS / AVX512_WIDTH) * AVX512_WIDTH;
+          static const Direction AVX512_TAIL = DmQn::NUMVECTORS - AVX512_BODY;
+
+          HEMELB_TARGET_AVX2
+          inline static __m256i TailMaskAVX2()
+          {
+            // All ones in the lanes below AVX2_TAIL.
+            return _mm256_cmpgt_epi64(_mm256_set1_epi64x(AVX2_TAIL), _mm256_setr_epi64x(0, 1, 2, 3));
+          }
+
+          HEMELB_TARGET_AVX2
+          inline static distribn_t HorizontalSumAVX2(__m256d value)
+          {
+            __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(value), _mm256_extractf128_pd(value, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+          }
+
+          HEMELB_TARGET_AVX512
+          inline static distribn_t HorizontalSumAVX512(__m512d value)
+          {
+            // Zero-masked extracts, as the plain ones (and _mm512_reduce_add_pd)
+            // trip -Wuninitialized in some GCCs.
+            __m256d sum = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, value, 0),
+                                        _mm512_maskz_extractf64x4_pd(0xF, value, 1));
+            __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+          }
+
+          inline static __mmask8 TailMaskAVX512()
+          {
+            return (__mmask8) ( (1u << AVX512_TAIL) - 1u);
+          }
+
+        public:
+          HEMELB_TARGET_AVX2
+          static void CalculateDensityAndMomentumAVX2(const distribn_t f[],
+                                                      distribn_t &density,
+                                                      distribn_t &momentum_x,
+                                                      distribn_t &momentum_y,
+                                                      distribn_t &momentum_z)
+          {
+            __m256d density_AVX = _mm256_setzero_pd();
+            __m256d momentum_x_AVX = _mm256_setzero_pd();
+            __m256d momentum_y_AVX = _mm256_setzero_pd();
+            __m256d momentum_z_AVX = _mm256_setzero_pd();
+
+            for (Direction direction = 0; direction < AVX2_BODY; direction += AVX2_WIDTH)
+            {
+              const __m256d f_AVX = _mm256_loadu_pd(&f[direction]);
+              density_AVX = _mm256_add_pd(density_AVX, f_AVX);
+              momentum_x_AVX = _mm256_fmadd_pd(_mm256_loadu_pd(&DmQn::CXD[direction]), f_AVX, momentum_x_AVX);
+              momentum_y_AVX = _mm256_fmadd_pd(_mm256_loadu_pd(&DmQn::CYD[direction]), f_AVX, momentum_y_AVX);
+              momentum_z_AVX = _mm256_fmadd_pd(_mm256_loadu_pd(&DmQn::CZD[direction]), f_AVX, momentum_z_AVX);
+            }
+
+            if (AVX2_TAIL != 0)
+            {
+              const __m256i mask = TailMaskAVX2();
+              const __m256d f_AVX = _mm256_maskload_pd(&f[AVX2_BODY], mask);
+              density_AVX = _mm256_add_pd(density_AVX, f_AVX);
+              momentum_x_AVX = _mm256_fmadd_pd(_mm256_maskload_pd(&DmQn::CXD[AVX2_BODY], mask), f_AVX, momentum_x_AVX);
+              momentum_y_AVX = _mm256_fmadd_pd(_mm256_maskload_pd(&DmQn::CYD[AVX2_BODY], mask), f_AVX, momentum_y_AVX);
+              momentum_z_AVX = _mm256_fmadd_pd(_mm256_maskload_pd(&DmQn::CZD[AVX2_BODY], mask), f_AVX, momentum_z_AVX);
+            }
+
+            density = HorizontalSumAVX2(density_AVX);
+            momentum_x = HorizontalSumAVX2(momentum_x_AVX);
+            momentum_y = HorizontalSumAVX2(momentum_y_AVX);
+            momentum_z = HorizontalSumAVX2(momentum_z_AVX);
+          }
+
+          HEMELB_TARGET_AVX512
+          static void CalculateDensityAndMomentumAVX512(const distribn_t f[],
+                                                        distribn_t &density,
+                                                        distribn_t &momentum_x,
+                                                        distribn_t &momentum_y,
+                                                        distribn_t &momentum_z)
+          {
+            __m512d density_AVX = _mm512_setzero_pd();
+            __m512d momentum_x_AVX = _mm512_setzero_pd();
+            __m512d momentum_y_AVX = _mm512_setzero_pd();
+            __m512d momentum_z_AVX = _mm512_setzero_pd();
+
+            for (Direction direction = 0; direction < AVX512_BODY; direction += AVX512_WIDTH)
+            {
+              const __m512d f_AVX = _mm512_loadu_pd(&f[direction]);
+              density_AVX = _mm512_add_pd(density_AVX, f_AVX);
+              momentum_x_AVX = _mm512_fmadd_pd(_mm512_loadu_pd(&DmQn::CXD[direction]), f_AVX, momentum_x_AVX);
+              momentum_y_AVX = _mm512_fmadd_pd(_mm512_loadu_pd(&DmQn::CYD[direction]), f_AVX, momentum_y_AVX);
+              momentum_z_AVX = _mm512_fmadd_pd(_mm512_loadu_pd(&DmQn::CZD[direction]), f_AVX, momentum_z_AVX);
+            }
+
+            if (AVX512_TAIL != 0)
+            {
+              const __mmask8 mask = TailMaskAVX512();
+              const __m512d f_AVX = _mm512_maskz_loadu_pd(mask, &f[AVX512_BODY]);
+              density_AVX = _mm512_add_pd(density_AVX, f_AVX);
+              momentum_x_AVX = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, &DmQn::CXD[AVX512_BODY]), f_AVX, momentum_x_AVX);
+              momentum_y_AVX = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, &DmQn::CYD[AVX512_BODY]), f_AVX, momentum_y_AVX);
+              momentum_z_AVX = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, &DmQn::CZD[AVX512_BODY]), f_AVX, momentum_z_AVX);
+            }
+
+            density = HorizontalSumAVX512(density_AVX);
+            momentum_x = HorizontalSumAVX512(momentum_x_AVX);
+            momentum_y = HorizontalSumAVX512(momentum_y_AVX);
+            momentum_z = HorizontalSumAVX512(momentum_z_AVX);
+          }
+
+          /**
+           * f_eq[i] = w_i * (baseTerm + 9/2 * density_1 * (e_i.u)^2 + 3 * e_i.u), where
+           * baseTerm = density - 3/2 * density_1 * |u|^2. The incompressible
+           * lattice passes density_1 = 1.
+           */
+          HEMELB_TARGET_AVX2
+          static void CalculateFeqAVX2(const distribn_t &density,
+                                       const distribn_t &density_1,
+                                       const distribn_t &momentum_x,
+                                       const distribn_t &momentum_y,
+                                       const distribn_t &momentum_z,
+                                       distribn_t f_eq[])
+          {
+            const distribn_t momentumMagnitudeSquared = momentum_x * momentum_x
+                + momentum_y * momentum_y + momentum_z * momentum_z;
+            const __m256d baseTerm_AVX = _mm256_set1_pd(density
+                - (3. / 2.) * momentumMagnitudeSquared * density_1);
+            const __m256d nineHalvesOfDensity_1_AVX = _mm256_set1_pd( (9. / 2.) * density_1);
+            const __m256d three_AVX = _mm256_set1_pd(3.);
+            const __m256d momentum_x_AVX = _mm256_set1_pd(momentum_x);
+            const __m256d momentum_y_AVX = _mm256_set1_pd(momentum_y);
+            const __m256d momentum_z_AVX = _mm256_set1_pd(momentum_z);
+
+            for (Direction i = 0; i < DmQn::NUMVECTORS; i += AVX2_WIDTH)
+            {
+              const bool isTail = (i == AVX2_BODY);
+              const __m256i mask = TailMaskAVX2();
+              const __m256d CX_AVX = isTail ? _mm256_maskload_pd(&DmQn::CXD[i], mask) : _mm256_loadu_pd(&DmQn::CXD[i]);
+              const __m256d CY_AVX = isTail ? _mm256_maskload_pd(&DmQn::CYD[i], mask) : _mm256_loadu_pd(&DmQn::CYD[i]);
+              const __m256d CZ_AVX = isTail ? _mm256_maskload_pd(&DmQn::CZD[i], mask) : _mm256_loadu_pd(&DmQn::CZD[i]);
+              const __m256d weights_AVX = isTail ? _mm256_maskload_pd(&DmQn::EQMWEIGHTS[i], mask) : _mm256_loadu_pd(&DmQn::EQMWEIGHTS[i]);
+
+              const __m256d mom_dot_ei = _mm256_fmadd_pd(CX_AVX, momentum_x_AVX,
+                  _mm256_fmadd_pd(CY_AVX, momentum_y_AVX, _mm256_mul_pd(CZ_AVX, momentum_z_AVX)));
+              __m256d bracket = _mm256_fmadd_pd(_mm256_mul_pd(nineHalvesOfDensity_1_AVX, mom_dot_ei),
+                                                mom_dot_ei,
+                                                baseTerm_AVX);
+              bracket = _mm256_fmadd_pd(three_AVX, mom_dot_ei, bracket);
+
+              if (isTail)
+              {
+                _mm256_maskstore_pd(&f_eq[i], mask, _mm256_mul_pd(weights_AVX, bracket));
+              }
+              else
+              {
+                _mm256_storeu_pd(&f_eq[i], _mm256_mul_pd(weights_AVX, bracket));
+              }
+            }
+          }
+
+          HEMELB_TARGET_AVX512
+          static void CalculateFeqAVX512(const distribn_t &density,
+                                         const distribn_t &density_1,
+                                         const distribn_t &momentum_x,
+                                         const distribn_t &momentum_y,
+                                         const distribn_t &momentum_z,
+                                         distribn_t f_eq[])
+          {
+            const distribn_t momentumMagnitudeSquared = momentum_x * momentum_x
+                + momentum_y * momentum_y + momentum_z * momentum_z;
+            const __m512d baseTerm_AVX = _mm512_set1_pd(density
+                - (3. / 2.) * momentumMagnitudeSquared * density_1);
+            const __m512d nineHalvesOfDensity_1_AVX = _mm512_set1_pd( (9. / 2.) * density_1);
+            const __m512d three_AVX = _mm512_set1_pd(3.);
+            const __m512d momentum_x_AVX = _mm512_set1_pd(momentum_x);
+            const __m512d momentum_y_AVX = _mm512_set1_pd(momentum_y);
+            const __m512d momentum_z_AVX = _mm512_set1_pd(momentum_z);
+
+            for (Direction i = 0; i < DmQn::NUMVECTORS; i += AVX512_WIDTH)
+            {
+              const __mmask8 mask = (i == AVX512_BODY) ? TailMaskAVX512() : (__mmask8) 0xFF;
+              const __m512d CX_AVX = _mm512_maskz_loadu_pd(mask, &DmQn::CXD[i]);
+              const __m512d CY_AVX = _mm512_maskz_loadu_pd(mask, &DmQn::CYD[i]);
+              const __m512d CZ_AVX = _mm512_maskz_loadu_pd(mask, &DmQn::CZD[i]);
+              const __m512d weights_AVX = _mm512_maskz_loadu_pd(mask, &DmQn::EQMWEIGHTS[i]);
+
+              const __m512d mom_dot_ei = _mm512_fmadd_pd(CX_AVX, momentum_x_AVX,
+                  _mm512_fmadd_pd(CY_AVX, momentum_y_AVX, _mm512_mul_pd(CZ_AVX, momentum_z_AVX)));
+              __m512d bracket = _mm512_fmadd_pd(_mm512_mul_pd(nineHalvesOfDensity_1_AVX, mom_dot_ei),
+                                                mom_dot_ei,
+                                                baseTerm_AVX);
+              bracket = _mm512_fmadd_pd(three_AVX, mom_dot_ei, bracket);
+
+              _mm512_mask_storeu_pd(&f_eq[i], mask, _mm512_mul_pd(weights_AVX, bracket));
+            }
+          }
+
+          HEMELB_TARGET_AVX2
+          static void CalculateFNeqAVX2(const distribn_t f[], const distribn_t f_eq[], distribn_t f_neq[])
+          {
+            for (Direction i = 0; i < AVX2_BODY; i += AVX2_WIDTH)
+            {
+              _mm256_storeu_pd(&f_neq[i], _mm256_sub_pd(_mm256_loadu_pd(&f[i]), _mm256_loadu_pd(&f_eq[i])));
+            }
+            if (AVX2_TAIL != 0)
+            {
+              const __m256i mask = TailMaskAVX2();
+              _mm256_maskstore_pd(&f_neq[AVX2_BODY],
+                                  mask,
+                                  _mm256_sub_pd(_mm256_maskload_pd(&f[AVX2_BODY], mask),
+                                                _mm256_maskload_pd(&f_eq[AVX2_BODY], mask)));
+            }
+          }
+
+          HEMELB_TARGET_AVX512
+          static void CalculateFNeqAVX512(const distribn_t f[], const distribn_t f_eq[], distribn_t f_neq[])
+          {
+            for (Direction i = 0; i < DmQn::NUMVECTORS; i += AVX512_WIDTH)
+            {
+              const __mmask8 mask = (i == AVX512_BODY) ? TailMaskAVX512() : (__mmask8) 0xFF;
+              _mm512_mask_storeu_pd(&f_neq[i],
+                                    mask,
+                                    _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, &f[i]),
+                                                  _mm512_maskz_loadu_pd(mask, &f_eq[i])));
+            }
+          }
+
+          /**
+           * Second moment of f, sum_l f_l c_l c_l, as in Lattice::CalculatePiTensor.
+           */
+          HEMELB_TARGET_AVX2
+          static util::Matrix3D CalculatePiTensorAVX2(const distribn_t* const f)
+          {
+            __m256d xx = _mm256_setzero_pd(), yx = _mm256_setzero_pd(), yy = _mm256_setzero_pd();
+            __m256d zx = _mm256_setzero_pd(), zy = _mm256_setzero_pd(), zz = _mm256_setzero_pd();
+
+            for (Direction i = 0; i < DmQn::NUMVECTORS; i += AVX2_WIDTH)
+            {
+              const bool isTail = (i == AVX2_BODY);
+              const __m256i mask = TailMaskAVX2();
+              const __m256d f_AVX = isTail ? _mm256_maskload_pd(&f[i], mask) : _mm256_loadu_pd(&f[i]);
+              const __m256d CX_AVX = isTail ? _mm256_maskload_pd(&DmQn::CXD[i], mask) : _mm256_loadu_pd(&DmQn::CXD[i]);
+              const __m256d CY_AVX = isTail ? _mm256_maskload_pd(&DmQn::CYD[i], mask) : _mm256_loadu_pd(&DmQn::CYD[i]);
+              const __m256d CZ_AVX = isTail ? _mm256_maskload_pd(&DmQn::CZD[i], mask) : _mm256_loadu_pd(&DmQn::CZD[i]);
+
+              const __m256d fCX = _mm256_mul_pd(f_AVX, CX_AVX);
+              const __m256d fCY = _mm256_mul_pd(f_AVX, CY_AVX);
+              xx = _mm256_fmadd_pd(fCX, CX_AVX, xx);
+              yx = _mm256_fmadd_pd(fCY, CX_AVX, yx);
+              yy = _mm256_fmadd_pd(fCY, CY_AVX, yy);
+              zx = _mm256_fmadd_pd(fCX, CZ_AVX, zx);
+              zy = _mm256_fmadd_pd(fCY, CZ_AVX, zy);
+              zz = _mm256_fmadd_pd(_mm256_mul_pd(f_AVX, CZ_AVX), CZ_AVX, zz);
+            }
+
+            return MakeSymmetric(HorizontalSumAVX2(xx),
+                                 HorizontalSumAVX2(yx),
+                                 HorizontalSumAVX2(yy),
+                                 HorizontalSumAVX2(zx),
+                                 HorizontalSumAVX2(zy),
+                                 HorizontalSumAVX2(zz));
+          }
+
+          HEMELB_TARGET_AVX512
+          static util::Matrix3D CalculatePiTensorAVX512(const distribn_t* const f)
+          {
+            __m512d xx = _mm512_setzero_pd(), yx = _mm512_setzero_pd(), yy = _mm512_setzero_pd();
+            __m512d zx = _mm512_setzero_pd(), zy = _mm512_setzero_pd(), zz = _mm512_setzero_pd();
+
+            for (Direction i = 0; i < DmQn::NUMVECTORS; i += AVX512_WIDTH)
+            {
+              const __mmask8 mask = (i == AVX512_BODY) ? TailMaskAVX512() : (__mmask8) 0xFF;
+              const __m512d f_AVX = _mm512_maskz_loadu_pd(mask, &f[i]);
+              const __m512d CX_AVX = _mm512_maskz_loadu_pd(mask, &DmQn::CXD[i]);
+              const __m512d CY_AVX = _mm512_maskz_loadu_pd(mask, &DmQn::CYD[i]);
+              const __m512d CZ_AVX = _mm512_maskz_loadu_pd(mask, &DmQn::CZD[i]);
+
+              const __m512d fCX = _mm512_mul_pd(f_AVX, CX_AVX);
+              const __m512d fCY = _mm512_mul_pd(f_AVX, CY_AVX);
+              xx = _mm512_fmadd_pd(fCX, CX_AVX, xx);
+              yx = _mm512_fmadd_pd(fCY, CX_AVX, yx);
+              yy = _mm512_fmadd_pd(fCY, CY_AVX, yy);
+              zx = _mm512_fmadd_pd(fCX, CZ_AVX, zx);
+              zy = _mm512_fmadd_pd(fCY, CZ_AVX, zy);
+              zz = _mm512_fmadd_pd(_mm512_mul_pd(f_AVX, CZ_AVX), CZ_AVX, zz);
+            }
+
+            return MakeSymmetric(HorizontalSumAVX512(xx),
+                                 HorizontalSumAVX512(yx),
+                                 HorizontalSumAVX512(yy),
+                                 HorizontalSumAVX512(zx),
+                                 HorizontalSumAVX512(zy),
+                                 HorizontalSumAVX512(zz));
+          }
+
+        private:
+          inline static util::Matrix3D MakeSymmetric(distribn_t xx, distribn_t yx, distribn_t yy,
+                                                     distribn_t zx, distribn_t zy, distribn_t zz)
+          {
+            util::Matrix3D ret;
+            ret[0][0] = xx;
+            ret[1][0] = ret[0][1] = yx;
+            ret[1][1] = yy;
+            ret[2][0] = ret[0][2] = zx;
+            ret[2][1] = ret[1][2] = zy;
+            ret[2][2] = zz;
+            return ret;
+          }
+      };
+    }
+  }
+}
+
+#endif /* HEMELB_LATTICE_RUNTIME_SIMD */
+
+#endif /* HEMELB_LB_LATTICES_LATTICESIMD_H */
@@ -0,0 +1,69 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#include "lb/lattices/SimdLevel.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace lattices
+    {
+      namespace
+      {
+        SimdLevel DetectSimdLevel()
+        {
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+          // Checks CPUID and that the OS saves the wider registers.
+          __builtin_cpu_init();
+          if (__builtin_cpu_supports("avx512f"))
+          {
+            return SIMD_AVX512;
+          }
+          if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+          {
+            return SIMD_AVX2;
+          }
+#endif
+          return SIMD_BASELINE;
+        }
+      }
+
+      SimdLevel activeSimdLevel = GetSupportedSimdLevel();
+
+      SimdLevel GetSupportedSimdLevel()
+      {
+        static const SimdLevel supported = DetectSimdLevel();
+        return supported;
+      }
+
+      SimdLevel SetSimdLevel(SimdLevel level)
+      {
+        activeSimdLevel = level > GetSupportedSimdLevel() ?
+          GetSupportedSimdLevel() :
+          level;
+        return activeSimdLevel;
+      }
+
+      const char* GetSimdLevelName(SimdLevel level)
+      {
+        switch (level)
+        {
+          case SIMD_AVX512:
+            return "AVX-512";
+          case SIMD_AVX2:
+            return "AVX2";
+          default:
+#ifdef HEMELB_USE_SSE3
+            return "SSE3";
+#else
+            return "scalar";
+#endif
+        }
+      }
+    }
+  }
+}
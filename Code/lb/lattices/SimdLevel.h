@@ -0,0 +1,64 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_LATTICES_SIMDLEVEL_H
+#define HEMELB_LB_LATTICES_SIMDLEVEL_H
+
+// The AVX paths are compiled with per-function target attributes, so the rest
+// of the code doesn't need -mavx2 and still runs on CPUs without it.
+#if defined(HEMELB_USE_AVX) && (defined(__x86_64__) || defined(__i386__)) && !defined(__CUDACC__)
+  #define HEMELB_LATTICE_RUNTIME_SIMD
+  #define HEMELB_TARGET_AVX2 __attribute__((target("avx2,fma")))
+  #define HEMELB_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace lattices
+    {
+      /**
+       * The vector instruction sets the lattice primitives can use, in order
+       * of preference.
+       */
+      enum SimdLevel
+      {
+        SIMD_BASELINE, //! The compile-time choice (SSE3 or plain C++)
+        SIMD_AVX2, //! AVX2 + FMA, 4 doubles per instruction
+        SIMD_AVX512 //! AVX-512F, 8 doubles per instruction
+      };
+
+      //! The level in use; read through GetSimdLevel.
+      extern SimdLevel activeSimdLevel;
+
+      /**
+       * @return the best level the CPU we're running on supports
+       */
+      SimdLevel GetSupportedSimdLevel();
+
+      /**
+       * @return the level the lattice primitives are currently using
+       */
+      inline SimdLevel GetSimdLevel()
+      {
+        return activeSimdLevel;
+      }
+
+      /**
+       * Use a particular level, e.g. to compare against the baseline. Levels
+       * beyond what the CPU supports are reduced to the supported one.
+       * @param level
+       * @return the level now in use
+       */
+      SimdLevel SetSimdLevel(SimdLevel level);
+
+      const char* GetSimdLevelName(SimdLevel level);
+    }
+  }
+}
+
+#endif /* HEMELB_LB_LATTICES_SIMDLEVEL_H */
@@ -13,6 +13,7 @@
 #include "lb/iolets/InOutLetCosine.cuh"
 #include "lb/BuildSystemInterface.h"
 #include "lb/MacroscopicPropertyCache.h"
+#include "lb/StreamerRegistry.h"
 #include "net/IOCommunicator.h"
 #include "net/IteratedAction.h"
 #include "net/net.h"
@@ -34,12 +35,6 @@ namespace hemelb
     template<class LatticeType>
     class LBM : public net::IteratedAction
     {
-      private:
-        // Use the kernel, collider, and boundary conditions specified by the build system
-        typedef typename HEMELB_KERNEL<LatticeType>::Type KernelType;
-        typedef typename collisions::Normal<KernelType> CollisionType;
-        typedef typename HEMELB_WALL_INLET_BOUNDARY<CollisionType>::Type StreamerType;
-
       public:
         /**
          * Constructor, stage 1.
@@ -115,36 +110,23 @@ namespace hemelb
 
         void handleIOError(int iError);
 
-        // Collision objects
-        StreamerType* mMidFluidStreamer;
-        StreamerType* mWallStreamer;
-        StreamerType* mInletStreamer;
-        StreamerType* mOutletStreamer;
-        StreamerType* mInletWallStreamer;
-        StreamerType* mOutletWallStreamer;
+        // Collision objects, using the kernel and boundary conditions chosen in the
+        // configuration from those registered in StreamerRegistry.
+        streamers::AbstractStreamer* mMidFluidStreamer;
+        streamers::AbstractStreamer* mWallStreamer;
+        streamers::AbstractStreamer* mInletStreamer;
+        streamers::AbstractStreamer* mOutletStreamer;
+        streamers::AbstractStreamer* mInletWallStreamer;
+        streamers::AbstractStreamer* mOutletWallStreamer;
 
-        void StreamAndCollide(StreamerType* streamer, const site_t iFirstIndex, const site_t iSiteCount)
+        void StreamAndCollide(streamers::AbstractStreamer* streamer, const site_t iFirstIndex, const site_t iSiteCount)
         {
-          if (mVisControl->IsRendering())
-          {
-            streamer->template StreamAndCollide<true> (iFirstIndex, iSiteCount, &mParams, mLatDat, propertyCache);
-          }
-          else
-          {
-            streamer->template StreamAndCollide<false> (iFirstIndex, iSiteCount, &mParams, mLatDat, propertyCache);
-          }
+          streamer->StreamAndCollide(mVisControl->IsRendering(), iFirstIndex, iSiteCount, &mParams, mLatDat, propertyCache);
         }
 
-        void PostStep(StreamerType* streamer, const site_t iFirstIndex, const site_t iSiteCount)
+        void PostStep(streamers::AbstractStreamer* streamer, const site_t iFirstIndex, const site_t iSiteCount)
         {
-          if (mVisControl->IsRendering())
-          {
-            streamer->template DoPostStep<true> (iFirstIndex, iSiteCount, &mParams, mLatDat, propertyCache);
-          }
-          else
-          {
-            streamer->template DoPostStep<false> (iFirstIndex, iSiteCount, &mParams, mLatDat, propertyCache);
-          }
+          streamer->PostStep(mVisControl->IsRendering(), iFirstIndex, iSiteCount, &mParams, mLatDat, propertyCache);
         }
 
         unsigned int inletCount;
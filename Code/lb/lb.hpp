@@ -9,6 +9,7 @@
 
 #include "io/writers/xdr/XdrMemWriter.h"
 #include "lb/lb.h"
+#include "logging/Logger.h"
 #include "cuda_helper.h"
 
 namespace hemelb
@@ -102,28 +103,48 @@ namespace hemelb
       initParams.neighbouringDataManager = neighbouringDataManager;
       initParams.boundaryObject = nullptr;
 
+      const std::string& kernelName = mSimConfig->GetKernelName();
+      const std::string streamerName = mSimConfig->GetStreamerName();
+      logging::Logger::Log<logging::Info, logging::Singleton>("Using kernel %s with boundary conditions %s",
+                                                              kernelName.c_str(),
+                                                              streamerName.c_str());
+      logging::Logger::Log<logging::Info, logging::Singleton>("Lattice primitives using %s",
+                                                              lattices::GetSimdLevelName(lattices::GetSimdLevel()));
+
       unsigned collId;
       InitInitParamsSiteRanges(initParams, collId);
-      mMidFluidStreamer = new StreamerType(initParams);
+      mMidFluidStreamer = StreamerRegistry<LatticeType>::Create(kernelName, streamerName, initParams);
+
+      if (mSimConfig->UseGPU() && !mMidFluidStreamer->HasGPUImplementation())
+      {
+        throw Exception() << "The GPU is only supported with kernel LBGK and boundary conditions "
+            << "NASHZEROTHORDERPRESSURESBB, not " << kernelName << " with " << streamerName;
+      }
+
+      if (mLatDat->IsInPlaceStreaming() && !mMidFluidStreamer->HasInPlaceImplementation())
+      {
+        throw Exception() << "In-place streaming is only supported with simple bounce-back walls and "
+            << "zeroth-order pressure or Ladd iolets, not " << streamerName;
+      }
 
       AdvanceInitParamsSiteRanges(initParams, collId);
-      mWallStreamer = new StreamerType(initParams);
+      mWallStreamer = StreamerRegistry<LatticeType>::Create(kernelName, streamerName, initParams);
 
       AdvanceInitParamsSiteRanges(initParams, collId);
       initParams.boundaryObject = mInletValues;
-      mInletStreamer = new StreamerType(initParams);
+      mInletStreamer = StreamerRegistry<LatticeType>::Create(kernelName, streamerName, initParams);
 
       AdvanceInitParamsSiteRanges(initParams, collId);
       initParams.boundaryObject = mOutletValues;
-      mOutletStreamer = new StreamerType(initParams);
+      mOutletStreamer = StreamerRegistry<LatticeType>::Create(kernelName, streamerName, initParams);
 
       AdvanceInitParamsSiteRanges(initParams, collId);
       initParams.boundaryObject = mInletValues;
-      mInletWallStreamer = new StreamerType(initParams);
+      mInletWallStreamer = StreamerRegistry<LatticeType>::Create(kernelName, streamerName, initParams);
 
       AdvanceInitParamsSiteRanges(initParams, collId);
       initParams.boundaryObject = mOutletValues;
-      mOutletWallStreamer = new StreamerType(initParams);
+      mOutletWallStreamer = StreamerRegistry<LatticeType>::Create(kernelName, streamerName, initParams);
     }
 
     template<class LatticeType>
@@ -137,6 +158,19 @@ namespace hemelb
       mUnits = iUnits;
       mVisControl = iControl;
 
+      if (mLatDat->IsInPlaceStreaming())
+      {
+        if (mSimConfig->UseGPU())
+        {
+          throw Exception() << "In-place streaming isn't supported on the GPU";
+        }
+        // With one distribution array there's no previous time step to compare with.
+        if (mSimConfig->GetMonitoringConfiguration()->doConvergenceCheck)
+        {
+          throw Exception() << "The steady flow convergence check doesn't work with in-place streaming";
+        }
+      }
+
       // initialize GPU buffers in lattice data
       if ( mSimConfig->UseGPU() )
       {
@@ -372,6 +406,8 @@ namespace hemelb
 
         StreamAndCollide(mOutletWallStreamer, offset, mLatDat->GetDomainEdgeCollisionCount(5));
 
+        mLatDat->PrepareSends();
+
         if ( mSimConfig->UseGPU() )
         {
           // copy fNew (shared edges) from host to device
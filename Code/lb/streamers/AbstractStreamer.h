@@ -0,0 +1,227 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_STREAMERS_ABSTRACTSTREAMER_H
+#define HEMELB_LB_STREAMERS_ABSTRACTSTREAMER_H
+
+#include <type_traits>
+
+#include "Exception.h"
+#include "geometry/LatticeData.h"
+#include "lb/LbmParameters.h"
+#include "lb/MacroscopicPropertyCache.h"
+#include "lb/SimulationState.h"
+#include "lb/collisions/Normal.h"
+#include "lb/iolets/InOutLetCosine.cuh"
+#include "lb/kernels/BaseKernel.h"
+#include "lb/kernels/LBGK.h"
+#include "lb/lattices/Lattices.h"
+#include "lb/streamers/BaseStreamerDelegate.h"
+#include "lb/streamers/NashZerothOrderPressureIolet.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace streamers
+    {
+      /**
+       * Run-time interface to a streamer, so that the kernel and boundary
+       * conditions can be chosen when the simulation starts rather than when
+       * HemeLB is compiled.
+       *
+       * Calls are made once per range of sites, never per site: everything
+       * inside a range runs in the fully templated streamer, exactly as it
+       * would with the streamer type fixed at compile time.
+       */
+      class AbstractStreamer
+      {
+        public:
+          virtual ~AbstractStreamer()
+          {
+          }
+
+          virtual void StreamAndCollide(bool doRayTracing,
+                                        const site_t firstIndex,
+                                        const site_t siteCount,
+                                        const LbmParameters* lbmParams,
+                                        geometry::LatticeData* latDat,
+                                        lb::MacroscopicPropertyCache& propertyCache) = 0;
+
+          virtual void PostStep(bool doRayTracing,
+                                const site_t firstIndex,
+                                const site_t siteCount,
+                                const LbmParameters* lbmParams,
+                                geometry::LatticeData* latDat,
+                                lb::MacroscopicPropertyCache& propertyCache) = 0;
+
+          /**
+           * @return whether StreamAndCollideGPU is implemented for this streamer
+           */
+          virtual bool HasGPUImplementation() const = 0;
+
+          /**
+           * @return whether this streamer works with in-place streaming
+           */
+          virtual bool HasInPlaceImplementation() const = 0;
+
+          virtual void StreamAndCollideGPU(const site_t firstIndex,
+                                           const site_t siteCount,
+                                           const lb::LbmParameters* lbmParams,
+                                           geometry::LatticeData* latDat,
+                                           lb::SimulationState* simState,
+                                           const iolets::InOutLetCosineGPU* inlets,
+                                           const iolets::InOutLetCosineGPU* outlets,
+                                           int blockSize) = 0;
+      };
+
+      /**
+       * Whether a streamer type has a CUDA implementation of StreamAndCollideGPU.
+       * Specialise this for each type that has one, here, so that every user of
+       * the trait sees the same answer; the member is only declared in
+       * StreamerTypeFactory so calling it for any other type would fail at link
+       * time.
+       */
+      template<typename StreamerImpl>
+      struct HasGPUStreamAndCollide : public std::false_type
+      {
+      };
+
+      // StreamerTypeFactory.cu provides the CUDA streamer for this combination only.
+      template<>
+      struct HasGPUStreamAndCollide<NashZerothOrderPressureIoletSBB<collisions::Normal<
+          kernels::LBGK<lattices::HEMELB_LATTICE> > >::Type> : public std::true_type
+      {
+      };
+
+      /**
+       * Adapt a (CRTP) streamer to the AbstractStreamer interface.
+       */
+      template<typename StreamerImpl>
+      class ConcreteStreamer : public AbstractStreamer
+      {
+        public:
+          ConcreteStreamer(kernels::InitParams& initParams) :
+              streamer(initParams)
+          {
+          }
+
+          virtual void StreamAndCollide(bool doRayTracing,
+                                        const site_t firstIndex,
+                                        const site_t siteCount,
+                                        const LbmParameters* lbmParams,
+                                        geometry::LatticeData* latDat,
+                                        lb::MacroscopicPropertyCache& propertyCache)
+          {
+            if (doRayTracing)
+            {
+              streamer.template StreamAndCollide<true> (firstIndex,
+                                                        siteCount,
+                                                        lbmParams,
+                                                        latDat,
+                                                        propertyCache);
+            }
+            else
+            {
+              streamer.template StreamAndCollide<false> (firstIndex,
+                                                         siteCount,
+                                                         lbmParams,
+                                                         latDat,
+                                                         propertyCache);
+            }
+          }
+
+          virtual void PostStep(bool doRayTracing,
+                                const site_t firstIndex,
+                                const site_t siteCount,
+                                const LbmParameters* lbmParams,
+                                geometry::LatticeData* latDat,
+                                lb::MacroscopicPropertyCache& propertyCache)
+          {
+            if (doRayTracing)
+            {
+              streamer.template DoPostStep<true> (firstIndex,
+                                                  siteCount,
+                                                  lbmParams,
+                                                  latDat,
+                                                  propertyCache);
+            }
+            else
+            {
+              streamer.template DoPostStep<false> (firstIndex,
+                                                   siteCount,
+                                                   lbmParams,
+                                                   latDat,
+                                                   propertyCache);
+            }
+          }
+
+          virtual bool HasGPUImplementation() const
+          {
+            return HasGPUStreamAndCollide<StreamerImpl>::value;
+          }
+
+          virtual bool HasInPlaceImplementation() const
+          {
+            return SupportsInPlaceStreaming<StreamerImpl>::value;
+          }
+
+          virtual void StreamAndCollideGPU(const site_t firstIndex,
+                                           const site_t siteCount,
+                                           const lb::LbmParameters* lbmParams,
+                                           geometry::LatticeData* latDat,
+                                           lb::SimulationState* simState,
+                                           const iolets::InOutLetCosineGPU* inlets,
+                                           const iolets::InOutLetCosineGPU* outlets,
+                                           int blockSize)
+          {
+            DoStreamAndCollideGPU(firstIndex,
+                                  siteCount,
+                                  lbmParams,
+                                  latDat,
+                                  simState,
+                                  inlets,
+                                  outlets,
+                                  blockSize,
+                                  HasGPUStreamAndCollide<StreamerImpl>());
+          }
+
+        private:
+          void DoStreamAndCollideGPU(const site_t firstIndex,
+                                     const site_t siteCount,
+                                     const lb::LbmParameters* lbmParams,
+                                     geometry::LatticeData* latDat,
+                                     lb::SimulationState* simState,
+                                     const iolets::InOutLetCosineGPU* inlets,
+                                     const iolets::InOutLetCosineGPU* outlets,
+                                     int blockSize,
+                                     std::true_type)
+          {
+            streamer.StreamAndCollideGPU(firstIndex,
+                                         siteCount,
+                                         lbmParams,
+                                         latDat,
+                                         simState,
+                                         inlets,
+                                         outlets,
+                                         blockSize);
+          }
+
+          void DoStreamAndCollideGPU(const site_t, const site_t, const lb::LbmParameters*,
+                                     geometry::LatticeData*, lb::SimulationState*,
+                                     const iolets::InOutLetCosineGPU*,
+                                     const iolets::InOutLetCosineGPU*, int, std::false_type)
+          {
+            throw Exception() << "No GPU implementation of the selected kernel and boundary conditions";
+          }
+
+          StreamerImpl streamer;
+      };
+    }
+  }
+}
+
+#endif /* HEMELB_LB_STREAMERS_ABSTRACTSTREAMER_H */
@@ -36,8 +36,9 @@ namespace hemelb
        * using the CRTP).
        *  - typedef for CollisionType, the type of the collider operation.
        *  - Constructor(InitParams&)
-       *  - <bool tDoRayTracing> DoStreamAndCollide(const site_t, const site_t, const LbmParameters*,
-       *      geometry::LatticeData*, hemelb::vis::Control*)
+       *  - <bool tDoRayTracing, unsigned tProperties> DoStreamAndCollide(const site_t, const site_t,
+       *      const LbmParameters*, geometry::LatticeData*, hemelb::vis::Control*), passing
+       *      tProperties on to UpdateMinsAndMaxes
        *  - <bool tDoRayTracing> DoPostStep(const site_t, const site_t, const LbmParameters*,
        *      geometry::LatticeData*, hemelb::vis::Control*)
        *  - DoReset(kernels::InitParams* init)
@@ -54,6 +55,11 @@ namespace hemelb
       class BaseStreamer
       {
         public:
+          /**
+           * Chooses the instance of DoStreamAndCollide for the properties that
+           * need to be cached on this step, so the test of which are needed is
+           * made once per call rather than once per site.
+           */
           template<bool tDoRayTracing>
           inline void StreamAndCollide(const site_t firstIndex,
                                        const site_t siteCount,
@@ -61,11 +67,32 @@ namespace hemelb
                                        geometry::LatticeData* latDat,
                                        lb::MacroscopicPropertyCache& propertyCache)
           {
-            static_cast<StreamerImpl*> (this)->template DoStreamAndCollide<tDoRayTracing> (firstIndex,
-                                                                                           siteCount,
-                                                                                           lbmParams,
-                                                                                           latDat,
-                                                                                           propertyCache);
+            const unsigned requiredProperties = propertyCache.GetRequiredProperties();
+
+            if (requiredProperties == MacroscopicPropertyCache::NO_PROPERTIES)
+            {
+              CallDoStreamAndCollide<tDoRayTracing, MacroscopicPropertyCache::NO_PROPERTIES> (firstIndex,
+                                                                                              siteCount,
+                                                                                              lbmParams,
+                                                                                              latDat,
+                                                                                              propertyCache);
+            }
+            else if ( (requiredProperties & ~MacroscopicPropertyCache::MOMENT_PROPERTIES) == 0)
+            {
+              CallDoStreamAndCollide<tDoRayTracing, MacroscopicPropertyCache::MOMENT_PROPERTIES> (firstIndex,
+                                                                                                  siteCount,
+                                                                                                  lbmParams,
+                                                                                                  latDat,
+                                                                                                  propertyCache);
+            }
+            else
+            {
+              CallDoStreamAndCollide<tDoRayTracing, MacroscopicPropertyCache::ALL_PROPERTIES> (firstIndex,
+                                                                                               siteCount,
+                                                                                               lbmParams,
+                                                                                               latDat,
+                                                                                               propertyCache);
+            }
           }
 
           template<bool tDoRayTracing>
@@ -85,23 +112,59 @@ namespace hemelb
           }
 
         protected:
-          template<bool tDoRayTracing, class LatticeType>
+          /**
+           * Fill in the property caches for a site.
+           *
+           * tProperties is the set of MacroscopicPropertyCache::Property that this
+           * instance may be asked for: code for the others is compiled out. Only
+           * ALL_PROPERTIES looks up at run time which are actually required; the
+           * smaller sets are only used when they are exactly what's needed (or
+           * as cheap as the test would be). Every stress property is derived
+           * from a single calculation of the second moment of f_neq.
+           */
+          template<bool tDoRayTracing, unsigned tProperties, class LatticeType>
           inline static void UpdateMinsAndMaxes(const geometry::Site<geometry::LatticeData>& site,
                                                 const kernels::HydroVarsBase<LatticeType>& hydroVars,
                                                 const LbmParameters* lbmParams,
                                                 lb::MacroscopicPropertyCache& propertyCache)
           {
-            if (propertyCache.densityCache.RequiresRefresh())
+            if (tProperties == MacroscopicPropertyCache::NO_PROPERTIES)
+            {
+              return;
+            }
+
+            const unsigned properties = tProperties == MacroscopicPropertyCache::ALL_PROPERTIES ?
+              propertyCache.GetRequiredProperties() :
+              tProperties;
+
+            if (properties & MacroscopicPropertyCache::DENSITY)
             {
               propertyCache.densityCache.Put(site.GetIndex(), hydroVars.density);
             }
 
-            if (propertyCache.velocityCache.RequiresRefresh())
+            if (properties & MacroscopicPropertyCache::VELOCITY)
             {
               propertyCache.velocityCache.Put(site.GetIndex(), hydroVars.velocity);
             }
 
-            if (propertyCache.wallShearStressMagnitudeCache.RequiresRefresh())
+            if ( (tProperties & MacroscopicPropertyCache::STRESS_PROPERTIES)
+                && (properties & MacroscopicPropertyCache::STRESS_PROPERTIES))
+            {
+              UpdateStresses(site, hydroVars, lbmParams, propertyCache, properties);
+            }
+          }
+
+        private:
+          template<class LatticeType>
+          static void UpdateStresses(const geometry::Site<geometry::LatticeData>& site,
+                                     const kernels::HydroVarsBase<LatticeType>& hydroVars,
+                                     const LbmParameters* lbmParams,
+                                     lb::MacroscopicPropertyCache& propertyCache,
+                                     const unsigned properties)
+          {
+            const util::Matrix3D pi = LatticeType::CalculatePiTensor(hydroVars.GetFNeq().f);
+
+            if (properties & MacroscopicPropertyCache::WALL_SHEAR_STRESS_MAGNITUDE)
             {
               distribn_t stress;
 
@@ -111,90 +174,88 @@ namespace hemelb
               }
               else
               {
-                LatticeType::CalculateWallShearStressMagnitude(hydroVars.density,
-                                                               hydroVars.GetFNeq().f,
-                                                               site.GetWallNormal(),
-                                                               stress,
-                                                               lbmParams->GetStressParameter());
+                LatticeType::CalculateWallShearStressMagnitudeFromPi(pi,
+                                                                     site.GetWallNormal(),
+                                                                     stress,
+                                                                     lbmParams->GetStressParameter());
               }
 
               propertyCache.wallShearStressMagnitudeCache.Put(site.GetIndex(), stress);
             }
 
-            if (propertyCache.vonMisesStressCache.RequiresRefresh())
+            if (properties & MacroscopicPropertyCache::VON_MISES_STRESS)
             {
               distribn_t stress;
-              StreamerImpl::CollisionType::CKernel::LatticeType::CalculateVonMisesStress(hydroVars.GetFNeq().f,
-                                                                                         stress,
-                                                                                         lbmParams->GetStressParameter());
+              LatticeType::CalculateVonMisesStressFromPi(pi, stress, lbmParams->GetStressParameter());
 
               propertyCache.vonMisesStressCache.Put(site.GetIndex(), stress);
             }
 
-            if (propertyCache.shearRateCache.RequiresRefresh())
+            if (properties & MacroscopicPropertyCache::SHEAR_RATE)
             {
-              distribn_t shear_rate =
-                  StreamerImpl::CollisionType::CKernel::LatticeType::CalculateShearRate(hydroVars.tau,
-                                                                                        hydroVars.GetFNeq().f,
-                                                                                        hydroVars.density);
+              distribn_t shear_rate = LatticeType::CalculateShearRateFromPi(hydroVars.tau, pi, hydroVars.density);
 
               propertyCache.shearRateCache.Put(site.GetIndex(), shear_rate);
             }
 
-            if (propertyCache.stressTensorCache.RequiresRefresh())
+            const unsigned stressTensorProperties = MacroscopicPropertyCache::STRESS_TENSOR
+                | MacroscopicPropertyCache::TRACTION | MacroscopicPropertyCache::TANGENTIAL_PROJECTION_TRACTION;
+            if (! (properties & stressTensorProperties))
             {
-              util::Matrix3D stressTensor;
-              StreamerImpl::CollisionType::CKernel::LatticeType::CalculateStressTensor(hydroVars.density,
-                                                                                       hydroVars.tau,
-                                                                                       hydroVars.GetFNeq().f,
-                                                                                       stressTensor);
+              return;
+            }
 
-              propertyCache.stressTensorCache.Put(site.GetIndex(), stressTensor);
+            util::Matrix3D stressTensor;
+            LatticeType::CalculateStressTensorFromPi(hydroVars.density, hydroVars.tau, pi, stressTensor);
 
+            if (properties & MacroscopicPropertyCache::STRESS_TENSOR)
+            {
+              propertyCache.stressTensorCache.Put(site.GetIndex(), stressTensor);
             }
 
-            if (propertyCache.tractionCache.RequiresRefresh())
+            /*
+             * Wall normals are only available at the sites marked as being at the domain edge.
+             * For the sites in the fluid bulk, the traction vectors will be 0.
+             */
+            util::Vector3D<LatticeStress> tractionOnAPoint(0);
+            if (site.IsWall())
             {
-              util::Vector3D<LatticeStress> tractionOnAPoint(0);
-
-              /*
-               * Wall normals are only available at the sites marked as being at the domain edge.
-               * For the sites in the fluid bulk, the traction vector will be 0.
-               */
-              if (site.IsWall())
-              {
-                LatticeType::CalculateTractionOnAPoint(hydroVars.density,
-                                                       hydroVars.tau,
-                                                       hydroVars.GetFNeq().f,
-                                                       site.GetWallNormal(),
-                                                       tractionOnAPoint);
-              }
+              stressTensor.timesVector(site.GetWallNormal(), tractionOnAPoint);
+            }
 
+            if (properties & MacroscopicPropertyCache::TRACTION)
+            {
               propertyCache.tractionCache.Put(site.GetIndex(), tractionOnAPoint);
-
             }
 
-            if (propertyCache.tangentialProjectionTractionCache.RequiresRefresh())
+            if (properties & MacroscopicPropertyCache::TANGENTIAL_PROJECTION_TRACTION)
             {
               util::Vector3D<LatticeStress> tangentialProjectionTractionOnAPoint(0);
-
-              /*
-               * Wall normals are only available at the sites marked as being at the domain edge.
-               * For the sites in the fluid bulk, the traction vector will be 0.
-               */
               if (site.IsWall())
               {
-                LatticeType::CalculateTangentialProjectionTraction(hydroVars.density,
-                                                                   hydroVars.tau,
-                                                                   hydroVars.GetFNeq().f,
-                                                                   site.GetWallNormal(),
-                                                                   tangentialProjectionTractionOnAPoint);
+                LatticeType::CalculateTangentialProjection(tractionOnAPoint,
+                                                           site.GetWallNormal(),
+                                                           tangentialProjectionTractionOnAPoint);
               }
 
-              propertyCache.tangentialProjectionTractionCache.Put(site.GetIndex(), tangentialProjectionTractionOnAPoint);
-
+              propertyCache.tangentialProjectionTractionCache.Put(site.GetIndex(),
+                                                                  tangentialProjectionTractionOnAPoint);
             }
           }
+
+          template<bool tDoRayTracing, unsigned tProperties>
+          inline void CallDoStreamAndCollide(const site_t firstIndex,
+                                             const site_t siteCount,
+                                             const lb::LbmParameters* lbmParams,
+                                             geometry::LatticeData* latDat,
+                                             lb::MacroscopicPropertyCache& propertyCache)
+          {
+            static_cast<StreamerImpl*> (this)->template DoStreamAndCollide<tDoRayTracing, tProperties> (firstIndex,
+                                                                                                        siteCount,
+                                                                                                        lbmParams,
+                                                                                                        latDat,
+                                                                                                        propertyCache);
+          }
       };
     }
   }
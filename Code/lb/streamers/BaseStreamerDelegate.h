@@ -7,6 +7,8 @@
 #ifndef HEMELB_LB_STREAMERS_BASESTREAMERDELEGATE_H
 #define HEMELB_LB_STREAMERS_BASESTREAMERDELEGATE_H
 
+#include <type_traits>
+
 #include "geometry/LatticeData.h"
 #include "lb/kernels/BaseKernel.h"
 
@@ -84,6 +86,20 @@ namespace hemelb
           }
       };
 
+      /**
+       * Whether a streamer, or streamer delegate, works with in-place
+       * streaming (see geometry::LatticeData::IsInPlaceStreaming).
+       *
+       * A delegate does if its StreamLink uses nothing but the site's own
+       * HydroVars and writes only the site's own distribution for the
+       * opposite direction, and it has no PostStepLink. Specialise this to
+       * true for each delegate that does.
+       */
+      template<typename StreamerImpl>
+      struct SupportsInPlaceStreaming : public std::false_type
+      {
+      };
+
     }
   }
 }
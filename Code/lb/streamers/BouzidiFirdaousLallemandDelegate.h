@@ -9,6 +9,7 @@
 
 #include "lb/streamers/BaseStreamerDelegate.h"
 #include "lb/streamers/SimpleBounceBackDelegate.h"
+#include "lb/streamers/WallLinkTable.h"
 
 namespace hemelb
 {
@@ -25,6 +26,10 @@ namespace hemelb
        *
        * Note that since the method requires data from neighbouring sites (in
        * some circumstances), it has a DoPostStep method.
+       *
+       * Which of the three cases applies to each wall link, and the
+       * interpolation weights for it, depend only on the geometry so are
+       * worked out once at construction.
        */
       template<typename CollisionImpl>
       class BouzidiFirdaousLallemandDelegate : public BaseStreamerDelegate<CollisionImpl>
@@ -33,12 +38,97 @@ namespace hemelb
           typedef CollisionImpl CollisionType;
           typedef typename CollisionType::CKernel::LatticeType LatticeType;
         private:
+          /**
+           * How to complete the update along a wall link, and the weights to use.
+           * fNew[invDirection] = directionWeight * f[direction] + invDirectionWeight * f[invDirection]
+           * where f is fPostCollision (in StreamLink) or fNew (in PostStepLink).
+           */
+          struct BouzidiLink
+          {
+              enum Scheme
+              {
+                BOUNCE_BACK, //! No fluid site in the opposite direction; SBB only
+                INTERPOLATE_IN_STREAM, //! q >= 0.5; Eq (5b) using this site's data
+                INTERPOLATE_IN_POST_STEP //! q < 0.5; SBB, then Eq (5a) once the neighbour has streamed
+              };
+
+              BouzidiLink() :
+                  scheme(BOUNCE_BACK), directionWeight(1.0), invDirectionWeight(0.0)
+              {
+              }
+
+              Scheme scheme;
+              distribn_t directionWeight;
+              distribn_t invDirectionWeight;
+          };
+
           SimpleBounceBackDelegate<CollisionType> bbDelegate;
+          WallLinkTable<LatticeType, BouzidiLink> links;
+
+          template<typename SiteType>
+          static BouzidiLink MakeLink(const SiteType& site, Direction direction)
+          {
+            BouzidiLink link;
+            Direction invDirection = LatticeType::INVERSEDIRECTIONS[direction];
+            distribn_t q = site.template GetWallDistance<LatticeType> (direction);
+
+            if (site.HasWall(invDirection))
+            {
+              return link;
+            }
+
+            if (q < 0.5)
+            {
+              // Eq (5a): 2q * bounced-back value + (1 - 2q) * value arriving from the neighbour
+              link.scheme = BouzidiLink::INTERPOLATE_IN_POST_STEP;
+              link.directionWeight = 1.0 - 2.0 * q;
+              link.invDirectionWeight = 2.0 * q;
+            }
+            else
+            {
+              // Eq (5b): (f[direction] + (2q - 1) f[invDirection]) / 2q
+              link.scheme = BouzidiLink::INTERPOLATE_IN_STREAM;
+              link.directionWeight = 1.0 / (2.0 * q);
+              link.invDirectionWeight = (2.0 * q - 1.0) / (2.0 * q);
+            }
+            return link;
+          }
+
+          inline BouzidiLink GetLink(const geometry::Site<geometry::LatticeData>& site,
+                                     Direction direction) const
+          {
+            const BouzidiLink* siteLinks = links.Find(site.GetIndex());
+            return siteLinks == NULL ?
+              MakeLink(site, direction) :
+              siteLinks[direction];
+          }
 
         public:
           BouzidiFirdaousLallemandDelegate(CollisionType& delegatorCollider, kernels::InitParams& initParams) :
-            bbDelegate(delegatorCollider, initParams)
+            bbDelegate(delegatorCollider, initParams), links(initParams)
           {
+            for (std::vector<std::pair<site_t, site_t> >::iterator rangeIt =
+                initParams.siteRanges.begin(); rangeIt != initParams.siteRanges.end(); ++rangeIt)
+            {
+              for (site_t localIndex = rangeIt->first; localIndex < rangeIt->second; ++localIndex)
+              {
+                BouzidiLink* siteLinks = links.Find(localIndex);
+                if (siteLinks == NULL)
+                {
+                  continue;
+                }
+
+                geometry::Site<const geometry::LatticeData> localSite =
+                    initParams.latDat->GetSite(localIndex);
+                for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+                {
+                  if (localSite.HasWall(direction))
+                  {
+                    siteLinks[direction] = MakeLink(localSite, direction);
+                  }
+                }
+              }
+            }
           }
 
           inline void StreamLink(const LbmParameters* lbmParams,
@@ -47,11 +137,9 @@ namespace hemelb
                                  kernels::HydroVars<typename CollisionType::CKernel>& hydroVars,
                                  const Direction& direction)
           {
-            site_t invDirection = LatticeType::INVERSEDIRECTIONS[direction];
-            site_t bbDestination = (site.GetIndex() * LatticeType::NUMVECTORS) + invDirection;
-            distribn_t q = site.GetWallDistance<LatticeType> (direction);
+            const BouzidiLink link = GetLink(site, direction);
 
-            if (site.HasWall(invDirection) || q < 0.5)
+            if (link.scheme != BouzidiLink::INTERPOLATE_IN_STREAM)
             {
               // If there IS NO fluid site in the opposite direction, fall back to SBB.
               // If there IS such a site, we have to wait for the site in the opposite
@@ -64,8 +152,11 @@ namespace hemelb
             {
               // We have a fluid site and have all the data needed to complete this direction!
               // Implement Eq (5b) from Bouzidi et al.
-              * (latticeData->GetFNew(bbDestination)) = (hydroVars.GetFPostCollision()[direction] + (2.0 * q - 1)
-                  * hydroVars.GetFPostCollision()[invDirection]) / (2.0 * q);
+              site_t invDirection = LatticeType::INVERSEDIRECTIONS[direction];
+              site_t bbDestination = (site.GetIndex() * LatticeType::NUMVECTORS) + invDirection;
+              * (latticeData->GetFNew(bbDestination)) = link.directionWeight
+                  * hydroVars.GetFPostCollision()[direction] + link.invDirectionWeight
+                  * hydroVars.GetFPostCollision()[invDirection];
             }
 
           }
@@ -73,14 +164,12 @@ namespace hemelb
                                    const geometry::Site<geometry::LatticeData>& site,
                                    const Direction& direction)
           {
-            distribn_t* fNew = latticeData->GetFNew(site.GetIndex() * LatticeType::NUMVECTORS);
-            site_t invDirection = LatticeType::INVERSEDIRECTIONS[direction];
-            distribn_t q = site.GetWallDistance<LatticeType> (direction);
+            const BouzidiLink link = GetLink(site, direction);
             // If there is no fluid site in the opposite direction, fall back to simple
             // bounce back, which has been done above.
 
             // If q >= 0.5, then we handled that fully above also.
-            if (!site.HasWall(invDirection) && q < 0.5)
+            if (link.scheme == BouzidiLink::INTERPOLATE_IN_POST_STEP)
             {
               // So, we have a fluid site and all the data needed to complete this direction!
               // Implement Eq (5a) from Bouzidi et al.
@@ -88,7 +177,10 @@ namespace hemelb
               // Note that:
               // - fNew[direction] is the newly-arrived fPostColl[direction] from the neighbouring site
               // - fNew[invDirection] is the above-bounced-back fPostColl[direction] for this site.
-              fNew[invDirection] = 2.0 * q * fNew[invDirection] + (1.0 - 2.0 * q) * fNew[direction];
+              distribn_t* fNew = latticeData->GetFNew(site.GetIndex() * LatticeType::NUMVECTORS);
+              site_t invDirection = LatticeType::INVERSEDIRECTIONS[direction];
+              fNew[invDirection] = link.invDirectionWeight * fNew[invDirection] + link.directionWeight
+                  * fNew[direction];
             }
           }
       };
@@ -8,6 +8,7 @@
 #define HEMELB_LB_STREAMERS_GUOZHENGSHIDELEGATE_H
 
 #include "lb/streamers/BaseStreamerDelegate.h"
+#include "lb/streamers/WallLinkTable.h"
 #include "geometry/neighbouring/RequiredSiteInformation.h"
 #include "geometry/neighbouring/NeighbouringDataManager.h"
 
@@ -22,6 +23,10 @@ namespace hemelb
        * This class implements the boundary condition described by Guo, Zheng and Shi
        * in 'An Extrapolation Method for Boundary Conditions in Lattice-Boltzmann method'
        * Physics of Fluids, 14/6, June 2002, pp 2007-2010.
+       *
+       * The location of the next fluid site out from each wall link (the one
+       * used for the second extrapolation) is resolved once, at construction,
+       * and kept in a per-link table.
        */
       template<typename CollisionImpl>
       class GuoZhengShiDelegate : public BaseStreamerDelegate<CollisionImpl>
@@ -34,7 +39,8 @@ namespace hemelb
             collider(delegatorCollider),
                 neighbouringLatticeData(initParams.latDat->GetNeighbouringData()),
                 bValues(initParams.boundaryObject),
-                bbDelegate(delegatorCollider, initParams)
+                bbDelegate(delegatorCollider, initParams),
+                neighbourLinks(initParams)
           {
             // Want to loop over each site this streamer is responsible for,
             // as specified in the siteRanges.
@@ -73,15 +79,10 @@ namespace hemelb
                     continue;
 
                   // We will need this site's data - work out what task it's data is on.
-                  const LatticeVector neighbourLocation = localSiteLocation
-                      + LatticeVector(LatticeType::CX[opp],
-                                      LatticeType::CY[opp],
-                                      LatticeType::CZ[opp]);
-                  proc_t neighbourSiteHomeProc =
-                      initParams.latDat->GetProcIdFromGlobalCoords(neighbourLocation);
+                  NeighbourLink link = LocateNeighbour(localSite, opp, initParams.latDat);
 
                   // A solid site - this should have been picked up above by HasWall/HasIolet
-                  if (neighbourSiteHomeProc == SITE_OR_BLOCK_SOLID)
+                  if (link.location == NeighbourLink::NONE)
                   {
                     hemelb::logging::Logger::Log<hemelb::logging::Error, hemelb::logging::OnePerCore>("Inconsistent cut links/neighbour status for site [%d, %d, %d]",
                                                                                           localSiteLocation.x,
@@ -89,8 +90,11 @@ namespace hemelb
                                                                                           localSiteLocation.z);
                     continue;
                   }
+
+                  neighbourLinks.Find(localIndex)[direction] = link;
+
                   // If it's on this task, we don't need to request its data.
-                  if (neighbourSiteHomeProc == initParams.latDat->GetLocalRank())
+                  if (link.location == NeighbourLink::LOCAL)
                     continue;
 
                   // Create a requirements with the info we need.
@@ -99,8 +103,7 @@ namespace hemelb
                   requirements.Require(geometry::neighbouring::terms::Density);
                   requirements.Require(geometry::neighbouring::terms::Velocity);
 
-                  initParams.neighbouringDataManager->RegisterNeededSite(initParams.latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(neighbourLocation),
-                                                                         requirements);
+                  initParams.neighbouringDataManager->RegisterNeededSite(link.index, requirements);
 
                 }
               }
@@ -217,7 +220,17 @@ namespace hemelb
                 else
                 {
                   // There is a neighbour site to use for standard GZS to calculate u_w2.
-                  const distribn_t *neighbourFOld = GetNeighbourFOld(site, i, latDat);
+                  // Use the location worked out at construction if we have it.
+                  NeighbourLink* precomputedLinks = neighbourLinks.Find(site.GetIndex());
+                  NeighbourLink locatedLink;
+                  if (precomputedLinks == NULL)
+                  {
+                    locatedLink = LocateNeighbour(site, i, latDat);
+                  }
+                  NeighbourLink& link = precomputedLinks == NULL ?
+                    locatedLink :
+                    precomputedLinks[iPrime];
+                  const distribn_t *neighbourFOld = GetNeighbourFOld(link, latDat);
                   // Now calculate this field information.
                   LatticeVelocity neighbourVelocity;
                   distribn_t neighbourFEq[LatticeType::NUMVECTORS];
@@ -293,37 +306,87 @@ namespace hemelb
           }
 
         private:
-          const distribn_t *GetNeighbourFOld(const geometry::Site<geometry::LatticeData>& site,
-                                             const Direction& i,
-                                             geometry::LatticeData* const latDat)
+          /**
+           * Where to find the distributions of the next fluid site out from a wall link.
+           */
+          struct NeighbourLink
+          {
+              enum Location
+              {
+                NONE, //! No usable fluid site; fall back to bounce-back
+                LOCAL, //! index is a local contiguous site id
+                REMOTE, //! index is a remote index in the NeighbouringLatticeData
+                REMOTE_UNRESOLVED //! index is a global site id, not yet converted to a remote index
+              };
+
+              NeighbourLink() :
+                  location(NONE), index(-1)
+              {
+              }
+
+              Location location;
+              site_t index;
+          };
+
+          /**
+           * Find the fluid site one step from the given site in the given direction.
+           * @param site
+           * @param direction
+           * @param latDat
+           * @return The link, with location NONE if that site is solid.
+           */
+          template<typename SiteType>
+          static NeighbourLink LocateNeighbour(const SiteType& site, Direction direction,
+                                               const geometry::LatticeData* latDat)
           {
-            const distribn_t* neighbourFOld;
-            // Find the neighbour's global location and which proc it's on.
-            LatticeVector neighbourGlobalLocation = site.GetGlobalSiteCoords()
-                + LatticeVector(LatticeType::CX[i], LatticeType::CY[i], LatticeType::CZ[i]);
-            proc_t neighbourProcessor = latDat->GetProcIdFromGlobalCoords(neighbourGlobalLocation);
-            if (neighbourProcessor == latDat->GetLocalRank())
+            NeighbourLink link;
+            const LatticeVector neighbourLocation = site.GetGlobalSiteCoords()
+                + LatticeVector(LatticeType::CX[direction],
+                                LatticeType::CY[direction],
+                                LatticeType::CZ[direction]);
+            proc_t neighbourSiteHomeProc = latDat->GetProcIdFromGlobalCoords(neighbourLocation);
+
+            if (neighbourSiteHomeProc == SITE_OR_BLOCK_SOLID)
             {
-              // If it's local, get a Site object for it.
-              geometry::Site<geometry::LatticeData> nextSiteOut =
-                  latDat->GetSite(latDat->GetContiguousSiteId(neighbourGlobalLocation));
-              neighbourFOld = nextSiteOut.GetFOld<LatticeType> ();
+              return link;
+            }
+
+            if (neighbourSiteHomeProc == latDat->GetLocalRank())
+            {
+              link.location = NeighbourLink::LOCAL;
+              link.index = latDat->GetContiguousSiteId(neighbourLocation);
             }
             else
             {
-              const geometry::neighbouring::ConstNeighbouringSite
-                  neighbourSite =
-                      neighbouringLatticeData.GetSite(latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(neighbourGlobalLocation));
-              neighbourFOld = neighbourSite.GetFOld<LatticeType> ();
+              // The remote index isn't assigned until the needs have been shared, so
+              // hold on to the global id until the first time the link is used.
+              link.location = NeighbourLink::REMOTE_UNRESOLVED;
+              link.index = latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(neighbourLocation);
             }
-            return neighbourFOld;
+            return link;
+          }
 
+          const distribn_t *GetNeighbourFOld(NeighbourLink& link, geometry::LatticeData* const latDat)
+          {
+            if (link.location == NeighbourLink::LOCAL)
+            {
+              return latDat->GetFOld(link.index * LatticeType::NUMVECTORS);
+            }
+
+            if (link.location == NeighbourLink::REMOTE_UNRESOLVED)
+            {
+              link.index = neighbouringLatticeData.GetRemoteIndex(link.index);
+              link.location = NeighbourLink::REMOTE;
+            }
+            return neighbouringLatticeData.GetFOldByRemoteIndex(link.index);
           }
+
           // the collision
           CollisionType collider;
           const geometry::neighbouring::NeighbouringLatticeData& neighbouringLatticeData;
           iolets::BoundaryValues* bValues;
           SimpleBounceBackDelegate<CollisionType> bbDelegate;
+          WallLinkTable<LatticeType, NeighbourLink> neighbourLinks;
       };
 
     }
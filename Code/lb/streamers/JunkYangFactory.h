@@ -7,12 +7,13 @@
 #ifndef HEMELB_LB_STREAMERS_JUNKYANGFACTORY_H
 #define HEMELB_LB_STREAMERS_JUNKYANGFACTORY_H
 
+#include <cassert>
+#include <cmath>
+#include <vector>
+
 #include "lb/kernels/BaseKernel.h"
 #include "lb/streamers/BaseStreamer.h"
 #include "lb/streamers/SimpleCollideAndStreamDelegate.h"
-#include <boost/numeric/ublas/matrix.hpp>
-#include <boost/numeric/ublas/lu.hpp>
-#include <boost/numeric/ublas/io.hpp>
 
 namespace hemelb
 {
@@ -20,8 +21,6 @@ namespace hemelb
   {
     namespace streamers
     {
-      using namespace boost::numeric;
-
       /**
        * Template to produce Streamers that can cope with fluid-fluid, fluid-solid
        * (using the Junk&Yang method, see below) and fluid-iolet links. Requires
@@ -34,6 +33,12 @@ namespace hemelb
        * This class implements the Junk&Yang no-slip boundary condition as described in
        *
        * M. Junk and Z. Yang "One-point boundary condition for the lattice Boltzmann method", Phys Rev E 72 (2005)
+       *
+       * Every site the streamer is responsible for gets a slot of fixed size
+       * (NUMVECTORS x NUMVECTORS for each matrix) in a contiguous arena, so
+       * that the per-step work is a sweep over dense arrays: assemble the
+       * right-hand sides for a range of sites, solve all of their (already
+       * LU-factorised) systems in one batch, then scatter the solutions.
        */
       template<typename CollisionImpl, typename IoletLinkImpl>
       class JunkYangFactory : public BaseStreamer<JunkYangFactory<CollisionImpl, IoletLinkImpl> >
@@ -47,45 +52,58 @@ namespace hemelb
                   ioletLinkDelegate(collider, initParams), THETA(0.7),
                   latticeData(*initParams.latDat)
           {
+            site_t slotCount = 0;
             for (std::vector<std::pair<site_t, site_t> >::iterator rangeIt =
                 initParams.siteRanges.begin(); rangeIt != initParams.siteRanges.end(); ++rangeIt)
             {
-              for (site_t siteIdx = rangeIt->first; siteIdx < rangeIt->second; ++siteIdx)
+              SiteRange range = { rangeIt->first, rangeIt->second, slotCount };
+              siteRanges.push_back(range);
+              slotCount += rangeIt->second - rangeIt->first;
+            }
+
+            sites.resize(slotCount);
+            kMatrices.resize(slotCount * MATRIX_STRIDE);
+            luMatrices.resize(slotCount * MATRIX_STRIDE);
+            rhsVectors.resize(slotCount * LatticeType::NUMVECTORS);
+
+            for (typename std::vector<SiteRange>::const_iterator range = siteRanges.begin();
+                range != siteRanges.end(); ++range)
+            {
+              for (site_t siteIdx = range->first; siteIdx < range->end; ++siteIdx)
               {
+                const site_t slot = range->firstSlot + siteIdx - range->first;
                 geometry::Site<const geometry::LatticeData> localSite =
                     latticeData.GetSite(siteIdx);
                 // Only consider walls - the initParams .siteRanges should take care of that for us, but check anyway
                 if (localSite.IsWall())
                 {
-                  ConstructVelocitySets(siteIdx);
-                  AssembleKMatrix(siteIdx);
-                  AssembleLMatrix(siteIdx);
+                  ConstructVelocitySets(siteIdx, slot);
+                  AssembleKMatrix(siteIdx, slot);
+                  AssembleLMatrix(slot);
+                  FactoriseLMatrix(slot);
                 }
               }
             }
-            FactoriseLMatrices();
-          }
-
-          ~JunkYangFactory()
-          {
-            // Free dynamically allocated permutation matrices.
-            for (std::map<site_t, ublas::permutation_matrix<std::size_t>*>::iterator iter =
-                luPermutationMatrices.begin(); iter != luPermutationMatrices.end(); ++iter)
-            {
-              delete iter->second;
-            }
           }
 
-          template<bool tDoRayTracing>
+          template<bool tDoRayTracing,
+                   unsigned tProperties = MacroscopicPropertyCache::ALL_PROPERTIES>
           inline void DoStreamAndCollide(const site_t firstIndex, const site_t siteCount,
                                          const lb::LbmParameters* lbmParams,
                                          geometry::LatticeData* latticeData,
                                          lb::MacroscopicPropertyCache& propertyCache)
           {
+            // LBM calls every streamer for every range, so this range may be an empty one
+            // past the end of those with slots.
+            if (siteCount == 0)
+            {
+              return;
+            }
+
+            const site_t firstSlot = GetSlot(firstIndex);
             for (site_t siteIndex = firstIndex; siteIndex < (firstIndex + siteCount); siteIndex++)
             {
               assert(latticeData->GetSite(siteIndex).IsWall());
-              assert(lMatrices.find(siteIndex) != lMatrices.end());
 
               geometry::Site<geometry::LatticeData> site = latticeData->GetSite(siteIndex);
 
@@ -115,39 +133,16 @@ namespace hemelb
                 }
               }
 
-              // The following for loops prepare the data required by DoPostStep
-
-              // TODO: Ideally, this should be done in the loop over directions above
-              // but the f's are permuted by the below making it tricky.
-              unsigned index = 0;
-              for (std::set<Direction>::const_iterator incomingVelocityIter =
-                  incomingVelocities[siteIndex].begin();
-                  incomingVelocityIter != incomingVelocities[siteIndex].end();
-                  ++incomingVelocityIter, ++index)
-              {
-                int inverseDirection = LatticeType::INVERSEDIRECTIONS[*incomingVelocityIter];
+              // Everything in the system RHS except the theta * K_out * fNew_out term can be
+              // worked out now, which saves keeping fPostCollision and fOld until DoPostStep.
+              AssemblePartialRHS(firstSlot + siteIndex - firstIndex,
+                                 hydroVars.GetFPostCollision().f,
+                                 site.GetFOld<LatticeType>());
 
-                fPostCollision[siteIndex](index) =
-                    hydroVars.GetFPostCollision()[*incomingVelocityIter];
-                fPostCollisionInverseDir[siteIndex](index) =
-                    hydroVars.GetFPostCollision()[inverseDirection];
-                fOld[siteIndex](index) = site.GetFOld<LatticeType>()[*incomingVelocityIter];
-              }
-
-              for (std::set<Direction>::const_iterator outgoingVelocityIter =
-                  outgoingVelocities[siteIndex].begin();
-                  outgoingVelocityIter != outgoingVelocities[siteIndex].end();
-                  ++outgoingVelocityIter, ++index)
-              {
-                fPostCollision[siteIndex](index) =
-                    hydroVars.GetFPostCollision()[*outgoingVelocityIter];
-                fOld[siteIndex](index) = site.GetFOld<LatticeType>()[*outgoingVelocityIter];
-              }
-
-              BaseStreamer<JunkYangFactory>::template UpdateMinsAndMaxes<tDoRayTracing>(site,
-                                                                                        hydroVars,
-                                                                                        lbmParams,
-                                                                                        propertyCache);
+              BaseStreamer<JunkYangFactory>::template UpdateMinsAndMaxes<tDoRayTracing, tProperties>(site,
+                                                                                                     hydroVars,
+                                                                                                     lbmParams,
+                                                                                                     propertyCache);
             }
 
           }
@@ -157,46 +152,44 @@ namespace hemelb
                                  const LbmParameters* lbmParams, geometry::LatticeData* latticeData,
                                  lb::MacroscopicPropertyCache& propertyCache)
           {
+            if (siteCount == 0)
+            {
+              return;
+            }
+
+            const site_t firstSlot = GetSlot(firstIndex);
+
+            // Complete the RHS of each system with the newly streamed outgoing distributions.
             for (site_t siteIndex = firstIndex; siteIndex < (firstIndex + siteCount); siteIndex++)
             {
               assert(latticeData->GetSite(siteIndex).IsWall());
-              assert(lMatrices.find(siteIndex) != lMatrices.end());
-              assert(luPermutationMatrices.find(siteIndex) != luPermutationMatrices.end());
-
-              ublas::vector<distribn_t> rVector;
-              AssembleRVector(siteIndex, rVector);
+              CompleteRHS(firstSlot + siteIndex - firstIndex,
+                          latticeData->GetFNew(siteIndex * LatticeType::NUMVECTORS));
+            }
 
-              // assemble RHS
-              ublas::vector<distribn_t> systemRHS = fPostCollisionInverseDir[siteIndex] - rVector;
+            // lu_substitute will overwrite the RHS with the solution
+            SolveFactorisedSystems(firstSlot, siteCount);
 
-              // lu_substitue will overwrite the RHS with the solution
-              ublas::vector<distribn_t> &systemSolution = systemRHS;
-              lu_substitute(lMatrices[siteIndex],
-                            *luPermutationMatrices[siteIndex],
-                            systemSolution);
+            for (site_t siteIndex = firstIndex; siteIndex < (firstIndex + siteCount); siteIndex++)
+            {
+              const site_t slot = firstSlot + siteIndex - firstIndex;
+              const JunkYangSite& jySite = sites[slot];
+              const distribn_t* systemSolution = &rhsVectors[slot * LatticeType::NUMVECTORS];
+              distribn_t* fNew = latticeData->GetFNew(siteIndex * LatticeType::NUMVECTORS);
 
               // Update the distribution function for incoming velocities with the solution of the linear system
-              unsigned index = 0;
-              for (std::set<Direction>::const_iterator incomingVelocityIter =
-                  incomingVelocities[siteIndex].begin();
-                  incomingVelocityIter != incomingVelocities[siteIndex].end();
-                  ++incomingVelocityIter, ++index)
+              for (unsigned index = 0; index < jySite.incomingCount; ++index)
               {
-                * (latticeData->GetFNew(siteIndex * LatticeType::NUMVECTORS + *incomingVelocityIter)) =
-                    systemSolution[index];
+                fNew[jySite.directions[index]] = systemSolution[index];
               }
 
               geometry::Site<geometry::LatticeData> site = latticeData->GetSite(siteIndex);
-              for (std::set<Direction>::const_iterator outgoingVelocityIter =
-                  outgoingVelocities[siteIndex].begin();
-                  outgoingVelocityIter != outgoingVelocities[siteIndex].end();
-                  ++outgoingVelocityIter)
+              for (unsigned index = jySite.incomingCount; index < LatticeType::NUMVECTORS; ++index)
               {
-                if (site.HasIolet(*outgoingVelocityIter))
+                if (site.HasIolet(jySite.directions[index]))
                 {
-                  ioletLinkDelegate.PostStepLink(latticeData, site, *outgoingVelocityIter);
+                  ioletLinkDelegate.PostStepLink(latticeData, site, jySite.directions[index]);
                 }
-
               }
             }
           }
@@ -211,58 +204,119 @@ namespace hemelb
           static const unsigned DIMENSION = 3U;
           //! Vector coordinate arbitrarily chosen in the paper
           static const unsigned ALPHA = DIMENSION - 1;
+          //! Size of each site's slot in the matrix arenas (rows and columns are padded to NUMVECTORS)
+          static const unsigned MATRIX_STRIDE = LatticeType::NUMVECTORS * LatticeType::NUMVECTORS;
           //! theta constant in the theta-method used for interpolation (0 for fully explicit, 1 for fully implicit)
           const distribn_t THETA;
 
           //! Reference to the lattice object used for initialisation
           const geometry::LatticeData& latticeData;
 
-          //! Sets of incoming velocities (those with an inverse direction crossing a wall boundary)
-          std::map<site_t, std::set<Direction> > incomingVelocities;
-          //! Sets of outgoing velocities (the complement of incomingVelocities)
-          std::map<site_t, std::set<Direction> > outgoingVelocities;
+          /**
+           * A contiguous range of sites and the slot of its first site.
+           */
+          struct SiteRange
+          {
+              site_t first;
+              site_t end;
+              site_t firstSlot;
+          };
 
-          //! Map containing the K matrices used to assemble both the left-hand- and the right-hand-side of the linear systems for each site
-          std::map<site_t, ublas::matrix<distribn_t> > kMatrices;
-          //! Map containing the linear system left-hand-sides for each site
-          std::map<site_t, ublas::matrix<distribn_t> > lMatrices;
           /**
-           * Map containing the permutations generated by the LU factorisation of each linear system. The permutaation matrices are dinamically allocated
-           * because there isn't a default constructor for ublas::permutation_matrix (unlike other ublas data structures) and the size is not known until
-           * run time.
+           * The per-site description of the linear system.
            */
-          std::map<site_t, ublas::permutation_matrix<std::size_t>*> luPermutationMatrices;
+          struct JunkYangSite
+          {
+              JunkYangSite() :
+                  incomingCount(0)
+              {
+                for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+                {
+                  directions[direction] = direction;
+                  luPivots[direction] = direction;
+                }
+              }
 
-          //! Map of postcollision distributions with incoming/outgoing ordering.
-          std::map<site_t, ublas::c_vector<distribn_t, LatticeType::NUMVECTORS> > fPostCollision;
-          //! Map of postcollision distributions for the inverse directions of those in the incoming set of velocities.
-          std::map<site_t, ublas::vector<distribn_t> > fPostCollisionInverseDir;
-          //! Map of distributions in the previous time step with incoming/outgoing ordering.
-          std::map<site_t, ublas::c_vector<distribn_t, LatticeType::NUMVECTORS> > fOld;
+              //! Number of incoming velocities (those with an inverse direction crossing a wall boundary)
+              unsigned incomingCount;
+              //! The incoming velocities, followed by the outgoing ones (the complement), each in increasing order
+              Direction directions[LatticeType::NUMVECTORS];
+              //! Row permutation generated by the LU factorisation of L, as for ublas::permutation_matrix
+              unsigned luPivots[LatticeType::NUMVECTORS];
+          };
+
+          std::vector<SiteRange> siteRanges;
+          std::vector<JunkYangSite> sites;
+
+          /**
+           * Arena of K matrices used to assemble both the left-hand- and the right-hand-side of
+           * the linear systems, one MATRIX_STRIDE slot per site, row-major with row stride
+           * NUMVECTORS. Only the first incomingCount rows are used.
+           */
+          std::vector<distribn_t> kMatrices;
+          //! Arena of LU-factorised linear system left-hand-sides, laid out as kMatrices
+          std::vector<distribn_t> luMatrices;
+          //! Arena of system right-hand-sides (and, after the solve, solutions), NUMVECTORS per site
+          std::vector<distribn_t> rhsVectors;
+
+          /**
+           * Find the slot for a site in the ranges this streamer was constructed with.
+           *
+           * @param contiguousSiteIndex Contiguous site index (for this core)
+           */
+          inline site_t GetSlot(site_t contiguousSiteIndex) const
+          {
+            for (typename std::vector<SiteRange>::const_iterator range = siteRanges.begin();
+                range != siteRanges.end(); ++range)
+            {
+              if (contiguousSiteIndex >= range->first && contiguousSiteIndex < range->end)
+              {
+                return range->firstSlot + contiguousSiteIndex - range->first;
+              }
+            }
+            // Junk&Yang can only work on sites it has assembled the systems for.
+            assert(false);
+            return -1;
+          }
 
           /**
            * Construct the incoming/outgoing velocity sets for site siteLocalIndex
            *
            * @param contiguousSiteIndex Contiguous site index (for this core)
+           * @param slot The site's slot in the arenas
            */
-          inline void ConstructVelocitySets(site_t contiguousSiteIndex)
+          inline void ConstructVelocitySets(site_t contiguousSiteIndex, site_t slot)
           {
             geometry::Site<const geometry::LatticeData> site =
                 latticeData.GetSite(contiguousSiteIndex);
 
+            uint32_t incomingMask = 0;
             for (Direction direction = 0; direction < LatticeType::NUMVECTORS; direction++)
             {
               int inverseDirection = LatticeType::INVERSEDIRECTIONS[direction];
               if (site.HasWall(inverseDirection))
               {
-                incomingVelocities[contiguousSiteIndex].insert(direction);
+                incomingMask |= 1U << direction;
               }
-              else
+            }
+
+            JunkYangSite& jySite = sites[slot];
+            unsigned index = 0;
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; direction++)
+            {
+              if (incomingMask & (1U << direction))
               {
-                outgoingVelocities[contiguousSiteIndex].insert(direction);
+                jySite.directions[index++] = direction;
+              }
+            }
+            jySite.incomingCount = index;
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; direction++)
+            {
+              if (! (incomingMask & (1U << direction)))
+              {
+                jySite.directions[index++] = direction;
               }
             }
-            fPostCollisionInverseDir[contiguousSiteIndex].resize(incomingVelocities[contiguousSiteIndex].size());
           }
 
           /**
@@ -270,213 +324,246 @@ namespace hemelb
            *
            * K is a rectangular matrix (num_incoming_vels x LatticeType::NUMVECTORS). Our
            * implementation places the columns corresponding to the set of incoming velocities
-           * first followed by those corresponding to outgoing velocities. This makes easier
-           * handling the subblocks with uBLAS.
+           * first followed by those corresponding to outgoing velocities, i.e. column j
+           * corresponds to directions[j].
            *
            * @param contiguousSiteIndex Contiguous site index (for this core)
+           * @param slot The site's slot in the arenas
            */
-          inline void AssembleKMatrix(site_t contiguousSiteIndex)
+          inline void AssembleKMatrix(site_t contiguousSiteIndex, site_t slot)
           {
             geometry::Site<const geometry::LatticeData> site =
                 latticeData.GetSite(contiguousSiteIndex);
 
-            unsigned incomingVelsSetSize = incomingVelocities[contiguousSiteIndex].size();
+            const JunkYangSite& jySite = sites[slot];
+            distribn_t* kMatrix = &kMatrices[slot * MATRIX_STRIDE];
 
-            kMatrices[contiguousSiteIndex].resize(incomingVelsSetSize, LatticeType::NUMVECTORS);
-
-            /*
-             *  Assemble K(:, 0:num_incoming_velocities-1)
-             */
-            unsigned rowIndex = 0;
-            for (std::set<Direction>::const_iterator rowIndexIncomingVelocity =
-                incomingVelocities[contiguousSiteIndex].begin();
-                rowIndexIncomingVelocity != incomingVelocities[contiguousSiteIndex].end();
-                ++rowIndexIncomingVelocity, ++rowIndex)
+            for (unsigned rowIndex = 0; rowIndex < jySite.incomingCount; ++rowIndex)
             {
+              const Direction rowVelocity = jySite.directions[rowIndex];
+
               // |c_i|^2, where c_i is the i-th velocity vector
-              const int rowRowdirectionsInnProd = LatticeType::CX[*rowIndexIncomingVelocity]
-                  * LatticeType::CX[*rowIndexIncomingVelocity]
-                  + LatticeType::CY[*rowIndexIncomingVelocity]
-                      * LatticeType::CY[*rowIndexIncomingVelocity]
-                  + LatticeType::CZ[*rowIndexIncomingVelocity]
-                      * LatticeType::CZ[*rowIndexIncomingVelocity];
-
-              unsigned columnIndex = 0;
-              for (std::set<Direction>::const_iterator columnIndexIncomingVelocity =
-                  incomingVelocities[contiguousSiteIndex].begin();
-                  columnIndexIncomingVelocity != incomingVelocities[contiguousSiteIndex].end();
-                  ++columnIndexIncomingVelocity, ++columnIndex)
+              const int rowRowdirectionsInnProd = LatticeType::CX[rowVelocity]
+                  * LatticeType::CX[rowVelocity] + LatticeType::CY[rowVelocity]
+                  * LatticeType::CY[rowVelocity] + LatticeType::CZ[rowVelocity]
+                  * LatticeType::CZ[rowVelocity];
+
+              const distribn_t wallDistance =
+                  site.template GetWallDistance<LatticeType>(LatticeType::INVERSEDIRECTIONS[rowVelocity]);
+              assert(wallDistance >= 0);
+              assert(wallDistance < 1);
+
+              for (unsigned columnIndex = 0; columnIndex < LatticeType::NUMVECTORS; ++columnIndex)
               {
+                const Direction columnVelocity = jySite.directions[columnIndex];
+
                 // |c_i|^2, where c_i is the i-th velocity vector
-                const int colColdirectionsInnProd = LatticeType::CX[*columnIndexIncomingVelocity]
-                    * LatticeType::CX[*columnIndexIncomingVelocity]
-                    + LatticeType::CY[*columnIndexIncomingVelocity]
-                        * LatticeType::CY[*columnIndexIncomingVelocity]
-                    + LatticeType::CZ[*columnIndexIncomingVelocity]
-                        * LatticeType::CZ[*columnIndexIncomingVelocity];
+                const int colColdirectionsInnProd = LatticeType::CX[columnVelocity]
+                    * LatticeType::CX[columnVelocity] + LatticeType::CY[columnVelocity]
+                    * LatticeType::CY[columnVelocity] + LatticeType::CZ[columnVelocity]
+                    * LatticeType::CZ[columnVelocity];
 
                 // (c_i \dot c_j)^2, where c_{i,j} are the {i,j}-th velocity vectors
-                const int rowColdirectionsInnProd = LatticeType::CX[*rowIndexIncomingVelocity]
-                    * LatticeType::CX[*columnIndexIncomingVelocity]
-                    + LatticeType::CY[*rowIndexIncomingVelocity]
-                        * LatticeType::CY[*columnIndexIncomingVelocity]
-                    + LatticeType::CZ[*rowIndexIncomingVelocity]
-                        * LatticeType::CZ[*columnIndexIncomingVelocity];
-
-                assert(site.template GetWallDistance<LatticeType> (LatticeType::INVERSEDIRECTIONS[(Direction) *rowIndexIncomingVelocity]) >= 0);
-                assert(site.template GetWallDistance<LatticeType> (LatticeType::INVERSEDIRECTIONS[(Direction) *rowIndexIncomingVelocity]) < 1);
+                const int rowColdirectionsInnProd = LatticeType::CX[rowVelocity]
+                    * LatticeType::CX[columnVelocity] + LatticeType::CY[rowVelocity]
+                    * LatticeType::CY[columnVelocity] + LatticeType::CZ[rowVelocity]
+                    * LatticeType::CZ[columnVelocity];
 
-                kMatrices[contiguousSiteIndex](rowIndex, columnIndex) =
+                kMatrix[rowIndex * LatticeType::NUMVECTORS + columnIndex] =
                     (-3.0 / 2.0)
-                        * (3.0
-                            - 6
-                                * site.template GetWallDistance<LatticeType>(LatticeType::INVERSEDIRECTIONS[(Direction) *rowIndexIncomingVelocity]))
-                        * LatticeType::EQMWEIGHTS[*rowIndexIncomingVelocity]
+                        * (3.0 - 6 * wallDistance)
+                        * LatticeType::EQMWEIGHTS[rowVelocity]
                         * ( (rowColdirectionsInnProd * rowColdirectionsInnProd)
                             - (rowRowdirectionsInnProd / 3.0)
-                            - LatticeType::discreteVelocityVectors[ALPHA][*rowIndexIncomingVelocity]
-                                * LatticeType::discreteVelocityVectors[ALPHA][*rowIndexIncomingVelocity]
+                            - LatticeType::discreteVelocityVectors[ALPHA][rowVelocity]
+                                * LatticeType::discreteVelocityVectors[ALPHA][rowVelocity]
                                 * (colColdirectionsInnProd - (DIMENSION / 3.0)));
 
-                assert(fabs(kMatrices[contiguousSiteIndex](rowIndex, columnIndex)) < 1e3);
+                assert(std::fabs(kMatrix[rowIndex * LatticeType::NUMVECTORS + columnIndex]) < 1e3);
               }
+            }
+          }
+
+          /**
+           * Assemble the L matrix for a site. L is a square matrix (num_incoming_vels x num_incoming_vels)
+           * equal to I + THETA * K(:, 0:num_incoming_vels-1).
+           *
+           * @param slot The site's slot in the arenas
+           */
+          inline void AssembleLMatrix(site_t slot)
+          {
+            const unsigned incomingCount = sites[slot].incomingCount;
+            const distribn_t* kMatrix = &kMatrices[slot * MATRIX_STRIDE];
+            distribn_t* lMatrix = &luMatrices[slot * MATRIX_STRIDE];
 
-              /*
-               * Assemble K(:, num_incoming_velocities:num_incoming_velocities+num_outgoing_velocities-1)
-               */
-              for (std::set<Direction>::const_iterator columnIndexOutgoingVelocity =
-                  outgoingVelocities[contiguousSiteIndex].begin();
-                  columnIndexOutgoingVelocity != outgoingVelocities[contiguousSiteIndex].end();
-                  ++columnIndexOutgoingVelocity, ++columnIndex)
+            for (unsigned row = 0; row < incomingCount; ++row)
+            {
+              for (unsigned column = 0; column < incomingCount; ++column)
               {
-                // |c_i|^2, where c_i is the i-th velocity vector
-                const int colColdirectionsInnProd = LatticeType::CX[*columnIndexOutgoingVelocity]
-                    * LatticeType::CX[*columnIndexOutgoingVelocity]
-                    + LatticeType::CY[*columnIndexOutgoingVelocity]
-                        * LatticeType::CY[*columnIndexOutgoingVelocity]
-                    + LatticeType::CZ[*columnIndexOutgoingVelocity]
-                        * LatticeType::CZ[*columnIndexOutgoingVelocity];
+                lMatrix[row * LatticeType::NUMVECTORS + column] = (row == column ?
+                  1.0 :
+                  0.0) + THETA * kMatrix[row * LatticeType::NUMVECTORS + column];
+              }
+            }
+          }
 
-                // (c_i \dot c_j)^2, where c_{i,j} are the {i,j}-th velocity vectors
-                const int rowColdirectionsInnProd = LatticeType::CX[*rowIndexIncomingVelocity]
-                    * LatticeType::CX[*columnIndexOutgoingVelocity]
-                    + LatticeType::CY[*rowIndexIncomingVelocity]
-                        * LatticeType::CY[*columnIndexOutgoingVelocity]
-                    + LatticeType::CZ[*rowIndexIncomingVelocity]
-                        * LatticeType::CZ[*columnIndexOutgoingVelocity];
+          /**
+           * Compute the LU factorisation of a site's L matrix in place, with partial pivoting
+           * (the same algorithm as ublas::lu_factorize).
+           *
+           * @param slot The site's slot in the arenas
+           */
+          inline void FactoriseLMatrix(site_t slot)
+          {
+            JunkYangSite& jySite = sites[slot];
+            const unsigned size = jySite.incomingCount;
+            distribn_t* lu = &luMatrices[slot * MATRIX_STRIDE];
 
-                assert(site.template GetWallDistance<LatticeType> (LatticeType::INVERSEDIRECTIONS[(Direction) *rowIndexIncomingVelocity]) >= 0);
-                assert(site.template GetWallDistance<LatticeType> (LatticeType::INVERSEDIRECTIONS[(Direction) *rowIndexIncomingVelocity]) < 1);
+            for (unsigned column = 0; column < size; ++column)
+            {
+              unsigned pivotRow = column;
+              for (unsigned row = column + 1; row < size; ++row)
+              {
+                if (std::fabs(lu[row * LatticeType::NUMVECTORS + column])
+                    > std::fabs(lu[pivotRow * LatticeType::NUMVECTORS + column]))
+                {
+                  pivotRow = row;
+                }
+              }
+              jySite.luPivots[column] = pivotRow;
 
-                kMatrices[contiguousSiteIndex](rowIndex, columnIndex) =
-                    (-3.0 / 2.0)
-                        * (3.0
-                            - 6
-                                * site.template GetWallDistance<LatticeType>(LatticeType::INVERSEDIRECTIONS[(Direction) *rowIndexIncomingVelocity]))
-                        * LatticeType::EQMWEIGHTS[*rowIndexIncomingVelocity]
-                        * ( (rowColdirectionsInnProd * rowColdirectionsInnProd)
-                            - (rowRowdirectionsInnProd / 3.0)
-                            - LatticeType::discreteVelocityVectors[ALPHA][*rowIndexIncomingVelocity]
-                                * LatticeType::discreteVelocityVectors[ALPHA][*rowIndexIncomingVelocity]
-                                * (colColdirectionsInnProd - (DIMENSION / 3.0)));
+              // If this assertion trips, the L matrix is singular.
+              assert(lu[pivotRow * LatticeType::NUMVECTORS + column] != 0.0);
 
-                assert(fabs(kMatrices[contiguousSiteIndex](rowIndex, columnIndex)) < 1e3);
+              if (pivotRow != column)
+              {
+                for (unsigned k = 0; k < size; ++k)
+                {
+                  std::swap(lu[column * LatticeType::NUMVECTORS + k],
+                            lu[pivotRow * LatticeType::NUMVECTORS + k]);
+                }
               }
 
+              const distribn_t inversePivot = 1.0 / lu[column * LatticeType::NUMVECTORS + column];
+              for (unsigned row = column + 1; row < size; ++row)
+              {
+                distribn_t& multiplier = lu[row * LatticeType::NUMVECTORS + column];
+                multiplier *= inversePivot;
+                for (unsigned k = column + 1; k < size; ++k)
+                {
+                  lu[row * LatticeType::NUMVECTORS + k] -= multiplier
+                      * lu[column * LatticeType::NUMVECTORS + k];
+                }
+              }
             }
           }
 
           /**
-           * Assemble the L matrix for site contiguousSiteIndex. L is a square matrix (num_incoming_vels x num_incoming_vels)
+           * Assemble the parts of the system RHS, fPostCollision(inverse incoming) - K * sigma,
+           * that only depend on data available during stream-and-collide. sigma is
+           * fPostCollision - (1 - THETA) * fOld with incoming/outgoing ordering. We are not
+           * including the forcing term used in the paper to drive the flow. This might become
+           * necessary for biocolloids.
            *
-           * @param contiguousSiteIndex Contiguous site index (for this core)
+           * @param slot The site's slot in the arenas
+           * @param fPostCollision The site's post-collision distributions
+           * @param fOld The site's distributions at the previous time step
            */
-          inline void AssembleLMatrix(site_t siteLocalIndex)
+          inline void AssemblePartialRHS(site_t slot, const distribn_t* fPostCollision,
+                                         const distribn_t* fOld)
           {
-            unsigned incomingVelsSetSize = incomingVelocities[siteLocalIndex].size();
-
-            lMatrices[siteLocalIndex] = ublas::identity_matrix<distribn_t>(incomingVelsSetSize)
-                + THETA
-                    * ublas::subrange(kMatrices[siteLocalIndex],
-                                      0,
-                                      incomingVelsSetSize,
-                                      0,
-                                      incomingVelsSetSize);
-          }
+            const JunkYangSite& jySite = sites[slot];
+            const distribn_t* kMatrix = &kMatrices[slot * MATRIX_STRIDE];
+            distribn_t* rhs = &rhsVectors[slot * LatticeType::NUMVECTORS];
 
-          /**
-           * Compute the LU factorisation of all the L matrices
-           */
-          inline void FactoriseLMatrices()
-          {
-            for (std::map<site_t, ublas::matrix<distribn_t> >::iterator iter = lMatrices.begin();
-                iter != lMatrices.end(); ++iter)
+            distribn_t sigmaVector[LatticeType::NUMVECTORS];
+            for (unsigned index = 0; index < LatticeType::NUMVECTORS; ++index)
             {
-              luPermutationMatrices[iter->first] =
-                  new ublas::permutation_matrix<std::size_t>(incomingVelocities[iter->first].size());
-              int ret = lu_factorize(iter->second, *luPermutationMatrices[iter->first]);
-              // If this assertion trips, lMatrices[siteLocalIndex] is singular.
-              assert(ret == 0);
+              sigmaVector[index] = fPostCollision[jySite.directions[index]] - (1 - THETA)
+                  * fOld[jySite.directions[index]];
+            }
+
+            for (unsigned row = 0; row < jySite.incomingCount; ++row)
+            {
+              distribn_t kSigma = 0.0;
+              for (unsigned column = 0; column < LatticeType::NUMVECTORS; ++column)
+              {
+                kSigma += kMatrix[row * LatticeType::NUMVECTORS + column] * sigmaVector[column];
+              }
+              rhs[row] = fPostCollision[LatticeType::INVERSEDIRECTIONS[jySite.directions[row]]]
+                  - kSigma;
             }
           }
 
           /**
-           * Assemble the sigma vector required to assemble the system RHS. We are not including
-           * the forcing term used in the paper to drive the flow. This might become necessary
-           * for biocolloids.
+           * Subtract THETA * K(:, outgoing) * fNew(outgoing) from the system RHS, using the
+           * updated values of the distribution function for the outgoing velocities, which have
+           * already been streamed.
            *
-           * @param contiguousSiteIndex Contiguous site index (for this core)
-           * @param sigmaVector sigma vector
+           * @param slot The site's slot in the arenas
+           * @param fNew The site's new distributions
            */
-          inline void AssembleSigmaVector(
-              const site_t contiguousSiteIndex,
-              ublas::c_vector<distribn_t, LatticeType::NUMVECTORS>& sigmaVector) // const
+          inline void CompleteRHS(site_t slot, const distribn_t* fNew)
           {
-            assert(fPostCollision.find(contiguousSiteIndex) != fPostCollision.end());
-            assert(fOld.find(contiguousSiteIndex) != fOld.end());
-            sigmaVector = fPostCollision[contiguousSiteIndex]
-                - (1 - THETA) * fOld[contiguousSiteIndex];
+            const JunkYangSite& jySite = sites[slot];
+            const distribn_t* kMatrix = &kMatrices[slot * MATRIX_STRIDE];
+            distribn_t* rhs = &rhsVectors[slot * LatticeType::NUMVECTORS];
+
+            for (unsigned row = 0; row < jySite.incomingCount; ++row)
+            {
+              distribn_t kFNew = 0.0;
+              for (unsigned column = jySite.incomingCount; column < LatticeType::NUMVECTORS; ++column)
+              {
+                kFNew += kMatrix[row * LatticeType::NUMVECTORS + column]
+                    * fNew[jySite.directions[column]];
+              }
+              rhs[row] -= THETA * kFNew;
+            }
           }
 
           /**
-           * Assemble the r vector required to assemble the system RHS
+           * Solve the LU-factorised systems for a run of consecutive slots, overwriting each
+           * RHS with the solution (as ublas::lu_substitute does).
            *
-           * @param contiguousSiteIndex Contiguous site index (for this core)
-           * @param rVector r vector
+           * @param firstSlot
+           * @param slotCount
            */
-          inline void AssembleRVector(const site_t contiguousSiteIndex,
-                                      ublas::vector<distribn_t>& rVector) //const
+          inline void SolveFactorisedSystems(site_t firstSlot, site_t slotCount)
           {
-            ublas::c_vector<distribn_t, LatticeType::NUMVECTORS> sigmaVector;
-            AssembleSigmaVector(contiguousSiteIndex, sigmaVector);
+            for (site_t slot = firstSlot; slot < firstSlot + slotCount; ++slot)
+            {
+              const JunkYangSite& jySite = sites[slot];
+              const unsigned size = jySite.incomingCount;
+              const distribn_t* lu = &luMatrices[slot * MATRIX_STRIDE];
+              distribn_t* x = &rhsVectors[slot * LatticeType::NUMVECTORS];
 
-            unsigned incomingVelsSetSize = incomingVelocities[contiguousSiteIndex].size();
-            unsigned outgoingVelsSetSize = outgoingVelocities[contiguousSiteIndex].size();
+              for (unsigned row = 0; row < size; ++row)
+              {
+                if (jySite.luPivots[row] != row)
+                {
+                  std::swap(x[row], x[jySite.luPivots[row]]);
+                }
+              }
 
-            ublas::vector<distribn_t> fNew(outgoingVelsSetSize);
+              // Forward substitution with the unit lower triangle.
+              for (unsigned row = 1; row < size; ++row)
+              {
+                for (unsigned column = 0; column < row; ++column)
+                {
+                  x[row] -= lu[row * LatticeType::NUMVECTORS + column] * x[column];
+                }
+              }
 
-            /*
-             *  Assemble a vector with the updated values of the distribution function for the outgoing velocities,
-             *  which have already been streamed
-             */
-            assert(fNew.size() == outgoingVelocities[contiguousSiteIndex].size());
-            unsigned index = 0;
-            for (std::set<Direction>::const_iterator outgoingDirIter =
-                outgoingVelocities[contiguousSiteIndex].begin();
-                outgoingDirIter != outgoingVelocities[contiguousSiteIndex].end();
-                ++outgoingDirIter, ++index)
-            {
-              fNew[index] = *latticeData.GetFNew(contiguousSiteIndex * LatticeType::NUMVECTORS
-                  + *outgoingDirIter);
+              // Back substitution with the upper triangle.
+              for (unsigned row = size; row-- > 0;)
+              {
+                for (unsigned column = row + 1; column < size; ++column)
+                {
+                  x[row] -= lu[row * LatticeType::NUMVECTORS + column] * x[column];
+                }
+                x[row] /= lu[row * LatticeType::NUMVECTORS + row];
+              }
             }
-
-            rVector = THETA
-                * ublas::prod(ublas::subrange(kMatrices[contiguousSiteIndex],
-                                              0,
-                                              incomingVelsSetSize,
-                                              incomingVelsSetSize,
-                                              LatticeType::NUMVECTORS),
-                              fNew) + ublas::prod(kMatrices[contiguousSiteIndex], sigmaVector);
           }
       };
 
@@ -75,6 +75,11 @@ namespace hemelb
           iolets::BoundaryValues* bValues;
       };
 
+      template<typename CollisionImpl>
+      struct SupportsInPlaceStreaming<LaddIoletDelegate<CollisionImpl> > : public std::true_type
+      {
+      };
+
     }
   }
 }
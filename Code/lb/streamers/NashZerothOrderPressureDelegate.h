@@ -65,6 +65,11 @@ namespace hemelb
           CollisionType& collider;
           iolets::BoundaryValues& iolet;
       };
+
+      template<typename CollisionImpl>
+      struct SupportsInPlaceStreaming<NashZerothOrderPressureDelegate<CollisionImpl> > : public std::true_type
+      {
+      };
     }
   }
 }
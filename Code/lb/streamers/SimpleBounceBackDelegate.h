@@ -44,6 +44,11 @@ namespace hemelb
 
       };
 
+      template<typename CollisionImpl>
+      struct SupportsInPlaceStreaming<SimpleBounceBackDelegate<CollisionImpl> > : public std::true_type
+      {
+      };
+
     }
   }
 }
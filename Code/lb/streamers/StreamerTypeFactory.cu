@@ -50,7 +50,7 @@ void Normal_LBGK_SBB_Nash_StreamAndCollide(
   distribn_t lbmParams_omega,
   const iolets::InOutLetCosineGPU* inlets,
   const iolets::InOutLetCosineGPU* outlets,
-  const site_t* streamingIndices,
+  const streaming_index_t* streamingIndices,
   const geometry::SiteData* siteData,
   const distribn_t* fOld,
   distribn_t* fNew,
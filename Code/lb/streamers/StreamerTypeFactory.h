@@ -7,7 +7,12 @@
 #ifndef HEMELB_LB_STREAMERS_STREAMERTYPEFACTORY_H
 #define HEMELB_LB_STREAMERS_STREAMERTYPEFACTORY_H
 
+#include <type_traits>
+
+#include "Exception.h"
 #include "lb/iolets/InOutLetCosine.cuh"
+#include "lb/kernels/SiteBatch.h"
+#include "lb/lattices/SimdLevel.h"
 #include "lb/streamers/BaseStreamer.h"
 #include "lb/streamers/SimpleCollideAndStreamDelegate.h"
 
@@ -59,50 +64,47 @@ namespace hemelb
                                    const iolets::InOutLetCosineGPU* outlets,
                                    int blockSize);
 
-          template<bool tDoRayTracing>
+          /**
+           * Collide and stream the given sites. Where the collision supports
+           * it (kernels::HasSiteBatch), runs of bulk sites are collided a batch
+           * at a time; see DoStreamAndCollideBatches. The batches don't keep
+           * per-site HydroVars, so can't fill in the property cache: steps
+           * that need it go site by site.
+           *
+           * With in-place streaming, the step is compiled separately for odd
+           * and even steps. Only streamers whose delegates support it
+           * (SupportsInPlaceStreaming) can stream in place.
+           */
+          template<bool tDoRayTracing,
+                   unsigned tProperties = MacroscopicPropertyCache::ALL_PROPERTIES>
           inline void DoStreamAndCollide(const site_t firstIndex,
                                          const site_t siteCount,
                                          const LbmParameters* lbmParams,
                                          geometry::LatticeData* latDat,
                                          lb::MacroscopicPropertyCache& propertyCache)
           {
-            for (site_t siteIndex = firstIndex; siteIndex < (firstIndex + siteCount); siteIndex++)
-            {
-              geometry::Site<geometry::LatticeData> site = latDat->GetSite(siteIndex);
-
-              const distribn_t* fOld = site.GetFOld<LatticeType> ();
-
-              kernels::HydroVars<typename CollisionType::CKernel> hydroVars(fOld);
-
-              ///< @todo #126 This value of tau will be updated by some kernels within the collider code (e.g. LBGKNN). It would be nicer if tau is handled in a single place.
-              hydroVars.tau = lbmParams->GetTau();
-
-              collider.CalculatePreCollision(hydroVars, site);
-
-              collider.Collide(lbmParams, hydroVars);
-
-              for (Direction ii = 0; ii < LatticeType::NUMVECTORS; ii++)
-              {
-                if (site.HasIolet(ii))
-                {
-                  ioletLinkDelegate.StreamLink(lbmParams, latDat, site, hydroVars, ii);
-                }
-                else if (site.HasWall(ii))
-                {
-                  wallLinkDelegate.StreamLink(lbmParams, latDat, site, hydroVars, ii);
-                }
-                else
-                {
-                  bulkLinkDelegate.StreamLink(lbmParams, latDat, site, hydroVars, ii);
-                }
-              }
+            typedef std::integral_constant<bool,
+                kernels::HasSiteBatch<CollisionType>::value
+                    && tProperties == MacroscopicPropertyCache::NO_PROPERTIES> UseSiteBatches;
 
-              //TODO: Necessary to specify sub-class?
-              BaseStreamer<StreamerTypeFactory>::template UpdateMinsAndMaxes<tDoRayTracing>(site,
-                                                                                            hydroVars,
-                                                                                            lbmParams,
-                                                                                            propertyCache);
+            if (latDat->IsInPlaceStreaming())
+            {
+              DoStreamAndCollideInPlace<tDoRayTracing, tProperties> (firstIndex,
+                                                                     siteCount,
+                                                                     lbmParams,
+                                                                     latDat,
+                                                                     propertyCache,
+                                                                     UseSiteBatches(),
+                                                                     SupportsInPlaceStreaming<StreamerTypeFactory>());
+              return;
             }
+
+            DoStreamAndCollide<tDoRayTracing, tProperties, TWO_LATTICE_STEP> (firstIndex,
+                                                                              siteCount,
+                                                                              lbmParams,
+                                                                              latDat,
+                                                                              propertyCache,
+                                                                              UseSiteBatches());
           }
 
           template<bool tDoRayTracing>
@@ -129,6 +131,330 @@ namespace hemelb
             }
 
           }
+
+        private:
+          typedef kernels::SiteBatch<LatticeType> BatchType;
+
+          /**
+           * Where the distributions are read from and streamed to: see
+           * geometry::LatticeData::IsInPlaceStreaming.
+           */
+          enum StreamingStep
+          {
+            TWO_LATTICE_STEP,
+            EVEN_IN_PLACE_STEP,
+            ODD_IN_PLACE_STEP
+          };
+
+          template<bool tDoRayTracing, unsigned tProperties, typename UseSiteBatches>
+          inline void DoStreamAndCollideInPlace(const site_t firstIndex,
+                                                const site_t siteCount,
+                                                const LbmParameters* lbmParams,
+                                                geometry::LatticeData* latDat,
+                                                lb::MacroscopicPropertyCache& propertyCache,
+                                                UseSiteBatches useSiteBatches,
+                                                std::true_type)
+          {
+            if (latDat->IsOddInPlaceStep())
+            {
+              DoStreamAndCollide<tDoRayTracing, tProperties, ODD_IN_PLACE_STEP> (firstIndex,
+                                                                                 siteCount,
+                                                                                 lbmParams,
+                                                                                 latDat,
+                                                                                 propertyCache,
+                                                                                 useSiteBatches);
+            }
+            else
+            {
+              DoStreamAndCollide<tDoRayTracing, tProperties, EVEN_IN_PLACE_STEP> (firstIndex,
+                                                                                  siteCount,
+                                                                                  lbmParams,
+                                                                                  latDat,
+                                                                                  propertyCache,
+                                                                                  useSiteBatches);
+            }
+          }
+
+          template<bool tDoRayTracing, unsigned tProperties, typename UseSiteBatches>
+          inline void DoStreamAndCollideInPlace(const site_t, const site_t, const LbmParameters*,
+                                                geometry::LatticeData*, lb::MacroscopicPropertyCache&,
+                                                UseSiteBatches, std::false_type)
+          {
+            throw Exception() << "In-place streaming isn't supported by the selected boundary conditions";
+          }
+
+          /**
+           * Read the site's distributions for the given step into f.
+           */
+          template<StreamingStep tStep>
+          HEMELB_SITE_BATCH_INLINE static void LoadSite(geometry::LatticeData* latDat,
+                                                        const geometry::Site<geometry::LatticeData>& site,
+                                                        distribn_t* f)
+          {
+            const distribn_t* fOld = site.GetFOld<LatticeType> ();
+            for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+            {
+              if (tStep == ODD_IN_PLACE_STEP)
+              {
+                const Direction inverse = LatticeType::INVERSEDIRECTIONS[direction];
+                f[direction] = site.HasIolet(inverse) || site.HasWall(inverse) ?
+                  fOld[direction] :
+                  *latDat->GetFOld(site.GetStreamedIndex<LatticeType> (inverse));
+              }
+              else
+              {
+                f[direction] = fOld[direction];
+              }
+            }
+          }
+
+          /**
+           * @return the index in fNew of the post-collision distribution in
+           * the given direction, for a bulk link.
+           */
+          template<StreamingStep tStep>
+          HEMELB_SITE_BATCH_INLINE static site_t GetBulkStreamedIndex(const geometry::Site<geometry::LatticeData>& site,
+                                                                      const Direction direction)
+          {
+            return tStep == EVEN_IN_PLACE_STEP ?
+              site.GetIndex() * LatticeType::NUMVECTORS + LatticeType::INVERSEDIRECTIONS[direction] :
+              site.GetStreamedIndex<LatticeType> (direction);
+          }
+
+          template<bool tDoRayTracing, unsigned tProperties, StreamingStep tStep>
+          inline void StreamAndCollideSite(const site_t siteIndex,
+                                           const LbmParameters* lbmParams,
+                                           geometry::LatticeData* latDat,
+                                           lb::MacroscopicPropertyCache& propertyCache)
+          {
+            geometry::Site<geometry::LatticeData> site = latDat->GetSite(siteIndex);
+
+            // In place, the site's slots are overwritten as it streams, so work
+            // on a copy.
+            distribn_t fInPlace[LatticeType::NUMVECTORS];
+            const distribn_t* fOld = site.GetFOld<LatticeType> ();
+            if (tStep != TWO_LATTICE_STEP)
+            {
+              LoadSite<tStep> (latDat, site, fInPlace);
+              fOld = fInPlace;
+            }
+
+            kernels::HydroVars<typename CollisionType::CKernel> hydroVars(fOld);
+
+            ///< @todo #126 This value of tau will be updated by some kernels within the collider code (e.g. LBGKNN). It would be nicer if tau is handled in a single place.
+            hydroVars.tau = lbmParams->GetTau();
+
+            collider.CalculatePreCollision(hydroVars, site);
+
+            collider.Collide(lbmParams, hydroVars);
+
+            for (Direction ii = 0; ii < LatticeType::NUMVECTORS; ii++)
+            {
+              if (site.HasIolet(ii))
+              {
+                ioletLinkDelegate.StreamLink(lbmParams, latDat, site, hydroVars, ii);
+              }
+              else if (site.HasWall(ii))
+              {
+                wallLinkDelegate.StreamLink(lbmParams, latDat, site, hydroVars, ii);
+              }
+              else if (tStep == EVEN_IN_PLACE_STEP)
+              {
+                * (latDat->GetFNew(GetBulkStreamedIndex<tStep> (site, ii)))
+                    = hydroVars.GetFPostCollision()[ii];
+              }
+              else
+              {
+                bulkLinkDelegate.StreamLink(lbmParams, latDat, site, hydroVars, ii);
+              }
+            }
+
+            //TODO: Necessary to specify sub-class?
+            BaseStreamer<StreamerTypeFactory>::template UpdateMinsAndMaxes<tDoRayTracing, tProperties>(site,
+                                                                                                       hydroVars,
+                                                                                                       lbmParams,
+                                                                                                       propertyCache);
+          }
+
+          template<bool tDoRayTracing, unsigned tProperties, StreamingStep tStep>
+          inline void DoStreamAndCollide(const site_t firstIndex,
+                                         const site_t siteCount,
+                                         const LbmParameters* lbmParams,
+                                         geometry::LatticeData* latDat,
+                                         lb::MacroscopicPropertyCache& propertyCache,
+                                         std::false_type)
+          {
+            for (site_t siteIndex = firstIndex; siteIndex < (firstIndex + siteCount); siteIndex++)
+            {
+              StreamAndCollideSite<tDoRayTracing, tProperties, tStep> (siteIndex,
+                                                                       lbmParams,
+                                                                       latDat,
+                                                                       propertyCache);
+            }
+          }
+
+          template<bool tDoRayTracing, unsigned tProperties, StreamingStep tStep>
+          inline void DoStreamAndCollide(const site_t firstIndex,
+                                         const site_t siteCount,
+                                         const LbmParameters* lbmParams,
+                                         geometry::LatticeData* latDat,
+                                         lb::MacroscopicPropertyCache& propertyCache,
+                                         std::true_type)
+          {
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+            switch (lattices::GetSimdLevel())
+            {
+              case lattices::SIMD_AVX512:
+                DoStreamAndCollideBatchesAVX512<tDoRayTracing, tStep> (firstIndex,
+                                                                       siteCount,
+                                                                       lbmParams,
+                                                                       latDat,
+                                                                       propertyCache);
+                return;
+              case lattices::SIMD_AVX2:
+                DoStreamAndCollideBatchesAVX2<tDoRayTracing, tStep> (firstIndex,
+                                                                     siteCount,
+                                                                     lbmParams,
+                                                                     latDat,
+                                                                     propertyCache);
+                return;
+              default:
+                break;
+            }
+#endif
+            DoStreamAndCollideBatches<tDoRayTracing, tStep> (firstIndex,
+                                                             siteCount,
+                                                             lbmParams,
+                                                             latDat,
+                                                             propertyCache);
+          }
+
+#ifdef HEMELB_LATTICE_RUNTIME_SIMD
+          // Compiling the same loop for each instruction set lets the batch
+          // code, which is all inlined, use the full vector width.
+          template<bool tDoRayTracing, StreamingStep tStep>
+          HEMELB_TARGET_AVX512 void DoStreamAndCollideBatchesAVX512(const site_t firstIndex,
+                                                                    const site_t siteCount,
+                                                                    const LbmParameters* lbmParams,
+                                                                    geometry::LatticeData* latDat,
+                                                                    lb::MacroscopicPropertyCache& propertyCache)
+          {
+            DoStreamAndCollideBatches<tDoRayTracing, tStep> (firstIndex,
+                                                             siteCount,
+                                                             lbmParams,
+                                                             latDat,
+                                                             propertyCache);
+          }
+
+          template<bool tDoRayTracing, StreamingStep tStep>
+          HEMELB_TARGET_AVX2 void DoStreamAndCollideBatchesAVX2(const site_t firstIndex,
+                                                                const site_t siteCount,
+                                                                const LbmParameters* lbmParams,
+                                                                geometry::LatticeData* latDat,
+                                                                lb::MacroscopicPropertyCache& propertyCache)
+          {
+            DoStreamAndCollideBatches<tDoRayTracing, tStep> (firstIndex,
+                                                             siteCount,
+                                                             lbmParams,
+                                                             latDat,
+                                                             propertyCache);
+          }
+#endif
+
+          /**
+           * @return whether none of the sites [firstIndex, firstIndex + WIDTH)
+           * has a wall or iolet link, so they all stream to their neighbours.
+           */
+          inline static bool IsBulkBatch(geometry::LatticeData* latDat, const site_t firstIndex)
+          {
+            uint32_t boundaryLinks = 0;
+            for (unsigned lane = 0; lane < BatchType::WIDTH; ++lane)
+            {
+              const geometry::SiteData& siteData = latDat->GetSite(firstIndex + lane).GetSiteData();
+              boundaryLinks |= siteData.GetWallIntersectionData() | siteData.GetIoletIntersectionData();
+            }
+            return boundaryLinks == 0;
+          }
+
+          /**
+           * Batches of BatchType::WIDTH consecutive bulk sites are collided
+           * together and their post-collision distributions streamed straight
+           * to fNew, exactly as SimpleCollideAndStreamDelegate would. Batches
+           * with any boundary links, and the sites left over at the end, go
+           * through StreamAndCollideSite.
+           */
+          template<bool tDoRayTracing, StreamingStep tStep>
+          HEMELB_SITE_BATCH_INLINE void DoStreamAndCollideBatches(const site_t firstIndex,
+                                                                  const site_t siteCount,
+                                                                  const LbmParameters* lbmParams,
+                                                                  geometry::LatticeData* latDat,
+                                                                  lb::MacroscopicPropertyCache& propertyCache)
+          {
+            BatchType batch;
+            const site_t endIndex = firstIndex + siteCount;
+            site_t siteIndex = firstIndex;
+
+            for (; siteIndex + (site_t) BatchType::WIDTH <= endIndex; siteIndex += BatchType::WIDTH)
+            {
+              if (!IsBulkBatch(latDat, siteIndex))
+              {
+                for (unsigned lane = 0; lane < BatchType::WIDTH; ++lane)
+                {
+                  StreamAndCollideSite<tDoRayTracing, MacroscopicPropertyCache::NO_PROPERTIES, tStep> (siteIndex
+                                                                                                           + lane,
+                                                                                                       lbmParams,
+                                                                                                       latDat,
+                                                                                                       propertyCache);
+                }
+                continue;
+              }
+
+              if (tStep == ODD_IN_PLACE_STEP)
+              {
+                // Bulk sites read every distribution from a neighbour.
+                batch.firstIndex = siteIndex;
+                for (unsigned lane = 0; lane < BatchType::WIDTH; ++lane)
+                {
+                  const geometry::Site<geometry::LatticeData> site = latDat->GetSite(siteIndex + lane);
+                  for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+                  {
+                    batch.f[direction][lane]
+                        = *latDat->GetFOld(site.GetStreamedIndex<LatticeType> (LatticeType::INVERSEDIRECTIONS[direction]));
+                  }
+                }
+              }
+              else
+              {
+                batch.Load(latDat->GetSite(siteIndex).template GetFOld<LatticeType> (), siteIndex);
+              }
+              collider.CalculatePreCollisionBatch(batch);
+              collider.CollideBatch(lbmParams, batch);
+
+              for (unsigned lane = 0; lane < BatchType::WIDTH; ++lane)
+              {
+                const geometry::Site<geometry::LatticeData> site = latDat->GetSite(siteIndex + lane);
+                for (Direction direction = 0; direction < LatticeType::NUMVECTORS; ++direction)
+                {
+                  * (latDat->GetFNew(GetBulkStreamedIndex<tStep> (site, direction)))
+                      = batch.fPostCollision[direction][lane];
+                }
+              }
+            }
+
+            for (; siteIndex < endIndex; ++siteIndex)
+            {
+              StreamAndCollideSite<tDoRayTracing, MacroscopicPropertyCache::NO_PROPERTIES, tStep> (siteIndex,
+                                                                                                   lbmParams,
+                                                                                                   latDat,
+                                                                                                   propertyCache);
+            }
+          }
+      };
+
+      template<typename CollisionImpl, typename WallLinkImpl, typename IoletLinkImpl>
+      struct SupportsInPlaceStreaming<StreamerTypeFactory<CollisionImpl, WallLinkImpl, IoletLinkImpl> > : public std::integral_constant<
+          bool, SupportsInPlaceStreaming<WallLinkImpl>::value && SupportsInPlaceStreaming<IoletLinkImpl>::value>
+      {
       };
     }
   }
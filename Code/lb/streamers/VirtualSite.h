@@ -28,7 +28,8 @@ namespace hemelb
        */
       struct RSHV
       {
-          typedef util::FlatMap<site_t, RSHV>::Type Map;
+          // Global (non-contiguous) id of the site
+          site_t globalIdx;
           // Time step at which this was last updated
           LatticeTimeStep t;
           // Density at that time
@@ -54,6 +55,11 @@ namespace hemelb
 
       /*
        * Extra data attached to each Iolet to enable virtual site BCs.
+       *
+       * The real-site hydro vars and the virtual sites are each kept in a
+       * contiguous array, in the order they were first needed. Entries are
+       * only ever appended, so their indices can be held on to by the
+       * virtual sites and streamers (several streamers share an iolet).
        */
       template<class LatticeType>
       class VSExtra : public iolets::IoletExtraData
@@ -64,38 +70,77 @@ namespace hemelb
           {
 
           }
-          typename VirtualSite<LatticeType>::Map vSites;
-          RSHV::Map hydroVarsCache;
-      };
 
-      template<class LatticeType>
-      class VirtualSite
-      {
-        public:
-          typedef std::map<site_t, VirtualSite<LatticeType> > Map;
+          /*
+           * Get the index in hydroVarsCache of the given site, or -1 if it isn't there.
+           */
+          site_t FindHydroVars(site_t globalIdx) const
+          {
+            typename util::FlatMap<site_t, site_t>::Type::const_iterator found =
+                hydroVarsIndexForGlobalId.find(globalIdx);
+            return found == hydroVarsIndexForGlobalId.end() ?
+              -1 :
+              found->second;
+          }
 
-          VirtualSite& operator=(const VirtualSite& rhs)
+          /*
+           * Get the index in hydroVarsCache of the given site, adding an entry if needed.
+           */
+          site_t FindOrAddHydroVars(site_t globalIdx, const LatticePosition& posIolet)
           {
-            neighbourDirections = rhs.neighbourDirections;
-            neighbourGlobalIds = rhs.neighbourGlobalIds;
-            q = rhs.q;
-            sumQiSq = rhs.sumQiSq;
-            for (unsigned i = 0; i < 3; ++i)
-              for (unsigned j = 0; j < 3; ++j)
-                velocityMatrixInv[i][j] = rhs.velocityMatrixInv[i][j];
-            hv = rhs.hv;
-            return *this;
+            site_t index = FindHydroVars(globalIdx);
+            if (index < 0)
+            {
+              RSHV hv;
+              hv.globalIdx = globalIdx;
+              hv.t = 0;
+              hv.rho = 1.0;
+              hv.u = LatticeVelocity::Zero();
+              hv.posIolet = posIolet;
+              index = hydroVarsCache.size();
+              hydroVarsCache.push_back(hv);
+              hydroVarsIndexForGlobalId[globalIdx] = index;
+            }
+            return index;
           }
 
-          VirtualSite(const VirtualSite& rhs)
+          /*
+           * Get the index in vSites of the virtual site with the given global id, or -1.
+           */
+          site_t FindVirtualSite(site_t globalIdx) const
           {
-            *this = rhs;
+            typename util::FlatMap<site_t, site_t>::Type::const_iterator found =
+                vSiteIndexForGlobalId.find(globalIdx);
+            return found == vSiteIndexForGlobalId.end() ?
+              -1 :
+              found->second;
           }
 
+          site_t AddVirtualSite(const VirtualSite<LatticeType>& vSite)
+          {
+            site_t index = vSites.size();
+            vSites.push_back(vSite);
+            vSiteIndexForGlobalId[vSite.hv.globalIdx] = index;
+            return index;
+          }
+
+          std::vector<VirtualSite<LatticeType> > vSites;
+          std::vector<RSHV> hydroVarsCache;
+
+        private:
+          util::FlatMap<site_t, site_t>::Type vSiteIndexForGlobalId;
+          util::FlatMap<site_t, site_t>::Type hydroVarsIndexForGlobalId;
+      };
+
+      template<class LatticeType>
+      class VirtualSite
+      {
+        public:
           VirtualSite(kernels::InitParams& initParams, VSExtra<LatticeType>& extra,
                       const LatticeVector& location) :
             sumQiSq(0.)
           {
+            hv.globalIdx = initParams.latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(location);
             hv.t = 0;
             hv.rho = 1.;
             hv.u = LatticeVelocity::Zero();
@@ -104,6 +149,7 @@ namespace hemelb
             lattices::LatticeInfo& lattice = LatticeType::GetLatticeInfo();
 
             distribn_t velocityMatrix[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+            std::vector<LatticePosition> neighbourPositions;
 
             // For each site index in the neighbourhood
             for (Direction i = 0; i < lattice.GetNumVectors(); ++i)
@@ -162,6 +208,7 @@ namespace hemelb
 
               // Add this site's contribution to the velocity matrix.
               LatticePosition xIolet = extra.WorldToIolet(neighbourLocation);
+              neighbourPositions.push_back(xIolet);
               velocityMatrix[0][0] += xIolet.x * xIolet.x;
               velocityMatrix[0][1] += xIolet.x * xIolet.y;
               velocityMatrix[0][2] += xIolet.x;
@@ -175,16 +222,7 @@ namespace hemelb
               velocityMatrix[2][2] += 1;
 
               // Ensure there's an entry in the hydroVars cache for the site.
-              RSHV::Map::iterator neighPtr = extra.hydroVarsCache.find(neighGlobalIdx);
-              if (neighPtr == extra.hydroVarsCache.end())
-              {
-                RSHV neighHV;
-                neighHV.t = 0;
-                neighHV.rho = 1.0;
-                neighHV.u = LatticeVelocity::Zero();
-                neighHV.posIolet = xIolet;
-                extra.hydroVarsCache.insert(RSHV::Map::value_type(neighGlobalIdx, neighHV));
-              }
+              neighbourHydroVars.push_back(extra.FindOrAddHydroVars(neighGlobalIdx, xIolet));
 
               if (neighbourSiteHomeProc == initParams.latDat->GetLocalRank())
               {
@@ -224,6 +262,8 @@ namespace hemelb
                   velocityMatrixInv[i][j] = 0.;
               velocityMatrixInv[2][2] = 1.0 / velocityMatrix[2][2];
             }
+
+            ComputeFitWeights(neighbourPositions);
           }
 
           static distribn_t Matrix3DInverse(const distribn_t m[3][3], distribn_t out[3][3])
@@ -255,12 +295,54 @@ namespace hemelb
             sumQiSq += qNew * qNew;
           }
 
+          /**
+           * Both least-squares fits are linear in the neighbours' values and
+           * their matrices are constant, so reduce each to one weight per
+           * neighbour:
+           *
+           * rho_virtual = ioletDensityWeight * rho_iolet + SUM_i densityWeights[i] * rho[i]
+           * u_virtual.n = SUM_i velocityWeights[i] * u[i].n
+           *
+           * @param neighbourPositions The neighbours' positions in iolet coordinates
+           */
+          void ComputeFitWeights(const std::vector<LatticePosition>& neighbourPositions)
+          {
+            ioletDensityWeight = 0.;
+            densityWeights.resize(q.size());
+            for (unsigned i = 0; i < q.size(); ++i)
+            {
+              ioletDensityWeight += q[i] / sumQiSq;
+              densityWeights[i] = -q[i] * (1.0 - q[i]) / sumQiSq;
+            }
+
+            // (x, y, 1) . M_inv, evaluated at the virtual site.
+            distribn_t fitRow[3] = { 0, 0, 0 };
+            const distribn_t vSitePos[3] = { hv.posIolet.x, hv.posIolet.y, 1.0 };
+            for (unsigned i = 0; i < 3; ++i)
+              for (unsigned j = 0; j < 3; ++j)
+                fitRow[j] += vSitePos[i] * velocityMatrixInv[i][j];
+
+            velocityWeights.resize(neighbourPositions.size());
+            for (unsigned i = 0; i < neighbourPositions.size(); ++i)
+            {
+              velocityWeights[i] = fitRow[0] * neighbourPositions[i].x + fitRow[1]
+                  * neighbourPositions[i].y + fitRow[2];
+            }
+          }
+
           std::vector<Direction> neighbourDirections;
           std::vector<site_t> neighbourGlobalIds;
+          //! Index of each neighbour's entry in the iolet's VSExtra::hydroVarsCache
+          std::vector<site_t> neighbourHydroVars;
 
           std::vector<LatticeDistance> q;
           distribn_t sumQiSq;
           distribn_t velocityMatrixInv[3][3];
+
+          distribn_t ioletDensityWeight;
+          std::vector<distribn_t> densityWeights;
+          std::vector<distribn_t> velocityWeights;
+
           VSHV<LatticeType> hv;
 
       };
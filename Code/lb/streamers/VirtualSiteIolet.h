@@ -13,8 +13,8 @@
 #include "lb/streamers/BaseStreamerDelegate.h"
 #include "lb/streamers/VirtualSite.h"
 #include "logging/Logger.h"
-#include "util/FlatMap.h"
-#include <map>
+#include <algorithm>
+#include <vector>
 
 #include "debug/Debugger.h"
 
@@ -43,20 +43,49 @@ namespace hemelb
           iolets::BoundaryValues* bValues;
           const geometry::neighbouring::NeighbouringLatticeData& neighbouringLatticeData;
 
-          // These will store a map from localIdx => (iolet, vsite, direction) triples
-          struct IoletVSiteDirection
+          /*
+           * One of these for each iolet link of each site, sorted by the
+           * local index of the site, so a range of sites is a contiguous run.
+           */
+          struct VSiteLink
           {
-              IoletVSiteDirection(InOutLet*iolet_, VirtualSite<LatticeType>* vsite_, Direction i_) :
-                iolet(iolet_), vsite(vsite_), direction(i_)
-              {
-              }
+              site_t siteIdx;
               InOutLet* iolet;
-              VirtualSite<LatticeType>* vsite;
+              VSExtra<LatticeType>* extra;
+              //! Index into extra->vSites
+              site_t vSite;
               Direction direction;
           };
-          typedef typename util::FlatMultiMap<site_t, IoletVSiteDirection>::Type
-              VSiteByLocalIdxMultiMap;
-          VSiteByLocalIdxMultiMap vsByLocalIdx;
+          std::vector<VSiteLink> vSiteLinks;
+
+          /*
+           * Where each site in the siteRanges stores its hydro vars for the
+           * virtual sites to use.
+           */
+          struct SiteHydroVars
+          {
+              VSExtra<LatticeType>* extra;
+              //! Index into extra->hydroVarsCache
+              site_t hydroVars;
+          };
+          struct SiteRange
+          {
+              site_t first;
+              site_t end;
+              site_t firstSlot;
+          };
+          std::vector<SiteRange> siteRanges;
+          std::vector<SiteHydroVars> siteHydroVars;
+
+          static bool VSiteLinkLess(const VSiteLink& a, const VSiteLink& b)
+          {
+            return a.siteIdx < b.siteIdx;
+          }
+
+          static bool VSiteLinkBefore(const VSiteLink& link, site_t siteIdx)
+          {
+            return link.siteIdx < siteIdx;
+          }
 
         public:
           VirtualSiteIolet(kernels::InitParams& initParams) :
@@ -74,15 +103,24 @@ namespace hemelb
             }
 
             lattices::LatticeInfo& lattice = LatticeType::GetLatticeInfo();
+            site_t slotCount = 0;
             // Want to loop over each site this streamer is responsible for,
             // as specified in the siteRanges.
             for (std::vector<std::pair<site_t, site_t> >::iterator rangeIt =
                 initParams.siteRanges.begin(); rangeIt != initParams.siteRanges.end(); ++rangeIt)
             {
+              SiteRange range = { rangeIt->first, rangeIt->second, slotCount };
+              siteRanges.push_back(range);
+              slotCount += rangeIt->second - rangeIt->first;
+              siteHydroVars.resize(slotCount);
+
               for (site_t siteIdx = rangeIt->first; siteIdx < rangeIt->second; ++siteIdx)
               {
                 geometry::Site<const geometry::LatticeData> site =
                     initParams.latDat->GetSite(siteIdx);
+                SiteHydroVars& cachedHV = siteHydroVars[range.firstSlot + siteIdx - range.first];
+                cachedHV.extra = NULL;
+                cachedHV.hydroVars = -1;
 
                 if (site.GetSiteType() != bValues->GetIoletType())
                 {
@@ -108,31 +146,29 @@ namespace hemelb
                   site_t
                       neighbourGlobalIdx =
                           initParams.latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(neighbourLocation);
-                  typename VSiteType::Map::iterator vNeigh = extra->vSites.find(neighbourGlobalIdx);
+                  site_t vNeigh = extra->FindVirtualSite(neighbourGlobalIdx);
 
-                  // find() returns end() if key not present
-                  if (vNeigh == extra->vSites.end())
+                  if (vNeigh < 0)
                   {
                     // Create a vSite
-                    std::pair<typename VSiteType::Map::iterator, bool>
-                        inserted =
-                            extra->vSites.insert(typename VSiteType::Map::value_type(neighbourGlobalIdx,
-                                                                                     VSiteType(initParams,
-                                                                                               *extra,
-                                                                                               neighbourLocation)));
-                    // inserted.first is an iterator, pointing to a pair<neighGlobalIdx, newly constructed vSite>
-                    vNeigh = inserted.first;
+                    vNeigh = extra->AddVirtualSite(VSiteType(initParams, *extra, neighbourLocation));
                   }
 
-                  // Add the (possibly newly created) virtual site to the map by local index.
-                  vsByLocalIdx.insert(typename VSiteByLocalIdxMultiMap::value_type(siteIdx,
-                                                                                   IoletVSiteDirection(&iolet,
-                                                                                                       & (vNeigh->second),
-                                                                                                       lattice.GetInverseIndex(i))));
+                  // Add the (possibly newly created) virtual site to the list by local index.
+                  VSiteLink link = { siteIdx, &iolet, extra, vNeigh, lattice.GetInverseIndex(i) };
+                  vSiteLinks.push_back(link);
                 }
+
+                // The site's own hydro vars are written here each step.
+                cachedHV.extra = extra;
+                cachedHV.hydroVars =
+                    extra->FindOrAddHydroVars(initParams.latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(siteLocation),
+                                              extra->WorldToIolet(siteLocation));
               }
             }
 
+            // The ranges needn't be given in order.
+            std::stable_sort(vSiteLinks.begin(), vSiteLinks.end(), VSiteLinkLess);
           }
 
           /*
@@ -140,7 +176,8 @@ namespace hemelb
            * links will be done in the post-step as we must ensure that all
            * the data is available to construct virtual sites.
            */
-          template<bool tDoRayTracing>
+          template<bool tDoRayTracing,
+                   unsigned tProperties = MacroscopicPropertyCache::ALL_PROPERTIES>
           inline void DoStreamAndCollide(const site_t firstIndex, const site_t siteCount,
                                          const lb::LbmParameters* lbmParams,
                                          geometry::LatticeData* latDat,
@@ -179,23 +216,16 @@ namespace hemelb
               /*
                * Store the density and velocity for later use.
                */
-              // Get the iolet
-              InOutLet* iolet = bValues->GetLocalIolet(site.GetIoletId());
-
-              // Get the extra data for this iolet
-              VSExtra<LatticeType>* extra = GetExtra(iolet);
-              site_t globalIdx =
-                  latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(site.GetGlobalSiteCoords());
-              RSHV& cachedHV = extra->hydroVarsCache[globalIdx];
+              RSHV& cachedHV = GetSiteHydroVars(*latDat, site);
               cachedHV.t = bValues->GetTimeStep();
               cachedHV.rho = hydroVars.density;
               cachedHV.u = hydroVars.velocity;
 
               // TODO: Necessary to specify sub-class?
-              BaseStreamer<VirtualSiteIolet>::template UpdateMinsAndMaxes<tDoRayTracing>(site,
-                                                                                         hydroVars,
-                                                                                         lbmParams,
-                                                                                         propertyCache);
+              BaseStreamer<VirtualSiteIolet>::template UpdateMinsAndMaxes<tDoRayTracing, tProperties>(site,
+                                                                                                      hydroVars,
+                                                                                                      lbmParams,
+                                                                                                      propertyCache);
             }
           }
 
@@ -205,27 +235,22 @@ namespace hemelb
                                  lb::MacroscopicPropertyCache& propertyCache)
           {
             const LatticeTimeStep t = bValues->GetTimeStep();
-            const typename VSiteByLocalIdxMultiMap::iterator beginVSites =
-                vsByLocalIdx.lower_bound(firstIndex), endVSites =
-                vsByLocalIdx.lower_bound(firstIndex + siteCount);
-
-            for (typename VSiteByLocalIdxMultiMap::iterator vSiteIt = beginVSites; vSiteIt
-                != endVSites; ++vSiteIt)
+            const typename std::vector<VSiteLink>::iterator beginLinks =
+                std::lower_bound(vSiteLinks.begin(), vSiteLinks.end(), firstIndex, VSiteLinkBefore),
+                endLinks = std::lower_bound(beginLinks,
+                                            vSiteLinks.end(),
+                                            firstIndex + siteCount,
+                                            VSiteLinkBefore);
+
+            for (typename std::vector<VSiteLink>::iterator link = beginLinks; link != endLinks; ++link)
             {
-              site_t siteIdx = vSiteIt->first;
-              // vSiteIt->second == (Iolet*, VirtualSite*, Direction)
-              InOutLet* iolet = vSiteIt->second.iolet;
-              // Get the extra data for this iolet
-              VSExtra<LatticeType>* extra = GetExtra(iolet);
-              VSiteType* vSite = vSiteIt->second.vsite;
+              VSiteType& vSite = link->extra->vSites[link->vSite];
 
               // Compute the distributions for the vSite if needed
-              CalculateVirtualSiteDistributions(*latDat, *iolet, extra->hydroVarsCache, *vSite, t);
+              CalculateVirtualSiteDistributions(*latDat, *link->iolet, *link->extra, vSite, t);
               // Stream this direction
-              Direction i = vSiteIt->second.direction;
-              * (latDat->GetFNew(siteIdx * LatticeType::NUMVECTORS + i)) = vSite->hv.fPostColl[i];
-              //* (latticeData->GetFNew(GetBBIndex(site.GetIndex(), direction))) = hydroVars.GetFPostCollision()[direction];
-              //return (siteIndex * LatticeType::NUMVECTORS) + LatticeType::INVERSEDIRECTIONS[direction];
+              * (latDat->GetFNew(link->siteIdx * LatticeType::NUMVECTORS + link->direction)) =
+                  vSite.hv.fPostColl[link->direction];
             }
           }
 
@@ -238,10 +263,10 @@ namespace hemelb
 
             std::ofstream hvCache("hvCache");
             hvCache << "# local global x y z" << std::endl;
-            for (RSHV::Map::const_iterator hvIt = extra->hydroVarsCache.begin(); hvIt
+            for (std::vector<RSHV>::const_iterator hvIt = extra->hydroVarsCache.begin(); hvIt
                 != extra->hydroVarsCache.end(); ++hvIt)
             {
-              site_t global = hvIt->first;
+              site_t global = hvIt->globalIdx;
               LatticeVector pos;
               latDat->GetGlobalCoordsFromGlobalNoncontiguousSiteId(global, pos);
               site_t local = latDat->GetContiguousSiteId(pos);
@@ -252,12 +277,12 @@ namespace hemelb
 
             std::ofstream vSites("vSites");
             vSites << "# global x y z vSitePtr" << std::endl;
-            for (typename VirtualSite<LatticeType>::Map::const_iterator vsIt =
-                extra->vSites.begin(); vsIt != extra->vSites.end(); ++vsIt)
+            for (typename std::vector<VSiteType>::const_iterator vsIt = extra->vSites.begin(); vsIt
+                != extra->vSites.end(); ++vsIt)
             {
-              site_t global = vsIt->first;
+              const VSiteType& vs = *vsIt;
+              site_t global = vs.hv.globalIdx;
               LatticeVector pos;
-              const VSiteType& vs = vsIt->second;
 
               latDat->GetGlobalCoordsFromGlobalNoncontiguousSiteId(global, pos);
               vSites << global << " " << pos.x << " " << pos.y << " " << pos.z << " " << &vs;
@@ -271,35 +296,60 @@ namespace hemelb
 
             std::ofstream outletMap("outletMap");
             outletMap << "# local global x y z vSitePtr direction" << std::endl;
-            for (typename VSiteByLocalIdxMultiMap::const_iterator entry =
-                ioletStreamer->vsByLocalIdx.begin(); entry != ioletStreamer->vsByLocalIdx.end(); ++entry)
-            {
-              site_t local = entry->first;
-              geometry::Site<const geometry::LatticeData> site = latDat->GetSite(local);
-              LatticeVector pos = site.GetGlobalSiteCoords();
-              site_t global = latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(pos);
-              outletMap << local << " " << global << " " << pos.x << " " << pos.y << " " << pos.z
-                  << " " << entry->second.vsite << " " << entry->second.direction << std::endl;
-            }
+            DumpLinks(ioletStreamer->vSiteLinks, latDat, outletMap);
             outletMap.close();
 
             std::ofstream outletWallMap("outletWallMap");
             outletWallMap << "# local global x y z vSitePtr direction" << std::endl;
-            for (typename VSiteByLocalIdxMultiMap::const_iterator entry =
-                ioletWallStreamer->vsByLocalIdx.begin(); entry
-                != ioletWallStreamer->vsByLocalIdx.end(); ++entry)
+            DumpLinks(ioletWallStreamer->vSiteLinks, latDat, outletWallMap);
+          }
+
+        private:
+          static void DumpLinks(const std::vector<VSiteLink>& links,
+                                const geometry::LatticeData* latDat, std::ostream& out)
+          {
+            for (typename std::vector<VSiteLink>::const_iterator entry = links.begin(); entry
+                != links.end(); ++entry)
             {
-              site_t local = entry->first;
+              site_t local = entry->siteIdx;
               geometry::Site<const geometry::LatticeData> site = latDat->GetSite(local);
               LatticeVector pos = site.GetGlobalSiteCoords();
               site_t global = latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(pos);
-              outletWallMap << local << " " << global << " " << pos.x << " " << pos.y << " "
-                  << pos.z << " " << entry->second.vsite << " " << entry->second.direction
-                  << std::endl;
+              out << local << " " << global << " " << pos.x << " " << pos.y << " " << pos.z << " "
+                  << &entry->extra->vSites[entry->vSite] << " " << entry->direction << std::endl;
             }
           }
 
-        private:
+          /*
+           * Get the cache entry for a site's hydro vars, using the one looked up at
+           * construction if the site is in our ranges.
+           */
+          RSHV& GetSiteHydroVars(const geometry::LatticeData& latDat,
+                                 const geometry::Site<geometry::LatticeData>& site)
+          {
+            const site_t siteIdx = site.GetIndex();
+            for (typename std::vector<SiteRange>::const_iterator range = siteRanges.begin();
+                range != siteRanges.end(); ++range)
+            {
+              if (siteIdx >= range->first && siteIdx < range->end)
+              {
+                const SiteHydroVars& cached = siteHydroVars[range->firstSlot + siteIdx - range->first];
+                if (cached.extra != NULL)
+                {
+                  return cached.extra->hydroVarsCache[cached.hydroVars];
+                }
+                break;
+              }
+            }
+
+            VSExtra<LatticeType>* extra = GetExtra(bValues->GetLocalIolet(site.GetIoletId()));
+            const LatticeVector& location = site.GetGlobalSiteCoords();
+            site_t index =
+                extra->FindOrAddHydroVars(latDat.GetGlobalNoncontiguousSiteIdFromGlobalCoords(location),
+                                          extra->WorldToIolet(location));
+            return extra->hydroVarsCache[index];
+          }
+
           static VSExtra<LatticeType>* GetExtra(InOutLet* iolet)
           {
             // Get the extra data for this iolet
@@ -314,13 +364,13 @@ namespace hemelb
           }
 
           void CalculateVirtualSiteDistributions(const geometry::LatticeData& latDat,
-                                                 const InOutLet& iolet, RSHV::Map& hydroVarsCache,
+                                                 const InOutLet& iolet, VSExtra<LatticeType>& extra,
                                                  VSiteType& vSite, const LatticeTimeStep t)
           {
             if (vSite.hv.t != t)
             {
-              vSite.hv.rho = CalculateVirtualSiteDensity(latDat, iolet, hydroVarsCache, vSite, t);
-              vSite.hv.u = CalculateVirtualSiteVelocity(latDat, iolet, hydroVarsCache, vSite, t);
+              vSite.hv.rho = CalculateVirtualSiteDensity(latDat, iolet, extra, vSite, t);
+              vSite.hv.u = CalculateVirtualSiteVelocity(latDat, iolet, extra, vSite, t);
               vSite.hv.t = t;
 
               // Should really compute stress, relax it with collision and
@@ -341,30 +391,25 @@ namespace hemelb
            *
            * rho_virtual = SUM_i ( q[i] (rho_iolet - (1 - q[i]) * rho[i]) ) / SUM _i (q[i]^2)
            *
+           * The weights for rho_iolet and each rho[i] are precomputed by the VirtualSite.
+           *
            * @param latDat
            * @param iolet
-           * @param hydroVarsCache
+           * @param extra
            * @param vSite
            * @param t
            * @return
            */
           LatticeDensity CalculateVirtualSiteDensity(const geometry::LatticeData& latDat,
                                                      const InOutLet& iolet,
-                                                     RSHV::Map& hydroVarsCache,
+                                                     VSExtra<LatticeType>& extra,
                                                      const VSiteType& vSite, const LatticeTimeStep t)
           {
-            LatticeDensity rho = 0.;
-            LatticeDensity rho_iolet = iolet.GetDensity(t);
-            for (unsigned i = 0; i < vSite.neighbourGlobalIds.size(); ++i)
+            LatticeDensity rho = vSite.ioletDensityWeight * iolet.GetDensity(t);
+            for (unsigned i = 0; i < vSite.neighbourHydroVars.size(); ++i)
             {
-
-              LatticeDensity rho_site_i = GetHV(latDat,
-                                                hydroVarsCache,
-                                                vSite.neighbourGlobalIds[i],
-                                                t).rho;
-              rho += vSite.q[i] * (rho_iolet - (1.0 - vSite.q[i]) * rho_site_i);
+              rho += vSite.densityWeights[i] * GetHV(latDat, extra, vSite.neighbourHydroVars[i], t).rho;
             }
-            rho /= vSite.sumQiSq;
             return rho;
           }
           /**
@@ -376,14 +421,14 @@ namespace hemelb
            *
            * @param latDat
            * @param iolet
-           * @param hydroVarsCache
+           * @param extra
            * @param vSite
            * @param t
            * @return
            */
           LatticeVelocity CalculateVirtualSiteVelocity(const geometry::LatticeData& latDat,
                                                        const InOutLet& iolet,
-                                                       RSHV::Map& hydroVarsCache,
+                                                       VSExtra<LatticeType>& extra,
                                                        const VSiteType& vSite, const LatticeTimeStep t)
           {
             /*
@@ -414,41 +459,27 @@ namespace hemelb
              *  (( 0, 0,   0),
              *   ( 0, 0,   0),
              *   ( 0, 0, 1/N)
+             *
+             * The fitted value at the virtual site, (x, y, 1) . M_inv . Y, is
+             * linear in the u_i, so the VirtualSite precomputes the weight of
+             * each neighbour and the fit is a single dot product.
              */
-
-            // Compute y, by summing over neighbouring fluid sites.
-            distribn_t sums[3] = { 0, 0, 0 };
-            // {sumXU, sumYU, sumU}
-            for (unsigned i = 0; i < vSite.neighbourGlobalIds.size(); ++i)
+            LatticeSpeed ansNorm = 0.;
+            for (unsigned i = 0; i < vSite.neighbourHydroVars.size(); ++i)
             {
-              RSHV& hv = GetHV(latDat, hydroVarsCache, vSite.neighbourGlobalIds[i], t);
-              LatticeSpeed uNorm = hv.u.Dot(iolet.GetNormal());
-              sums[0] += hv.posIolet.x * uNorm;
-              sums[1] += hv.posIolet.y * uNorm;
-              sums[2] += uNorm;
+              const RSHV& hv = GetHV(latDat, extra, vSite.neighbourHydroVars[i], t);
+              ansNorm += vSite.velocityWeights[i] * hv.u.Dot(iolet.GetNormal());
             }
 
-            // {A, B, C}
-            distribn_t coeffs[3] = { 0, 0, 0 };
-
-            // Do the matrix multiply to get the fitted coefficients.
-            for (unsigned i = 0; i < 3; ++i)
-              for (unsigned j = 0; j < 3; ++j)
-                coeffs[i] += vSite.velocityMatrixInv[i][j] * sums[j];
-
-            // Compute the magnitude of the velocity.
-            LatticeSpeed ansNorm = coeffs[0] * vSite.hv.posIolet.x + coeffs[1]
-                * vSite.hv.posIolet.y + coeffs[2];
-
             // multiply by the iolet normal and we're done!
             return iolet.GetNormal() * ansNorm;
 
           }
 
-          RSHV& GetHV(const geometry::LatticeData& latDat, RSHV::Map& hydroVarsCache,
-                      const site_t globalIdx, const LatticeTimeStep t)
+          RSHV& GetHV(const geometry::LatticeData& latDat, VSExtra<LatticeType>& extra,
+                      const site_t hydroVarsIdx, const LatticeTimeStep t)
           {
-            RSHV& ans = hydroVarsCache.at(globalIdx);
+            RSHV& ans = extra.hydroVarsCache[hydroVarsIdx];
             /* Local sites have their entry in the cache set during collision
              * so they are guaranteed to be up to date. Neighbouring sites may
              * not be, but all the communication needed has been done. If the
@@ -458,7 +489,7 @@ namespace hemelb
               return ans;
 
             geometry::neighbouring::ConstNeighbouringSite neigh =
-                latDat.GetNeighbouringData().GetSite(globalIdx);
+                latDat.GetNeighbouringData().GetSite(ans.globalIdx);
             const distribn_t* fOld = neigh.GetFOld<LatticeType> ();
             LatticeType::CalculateDensityAndMomentum(fOld, ans.rho, ans.u.x, ans.u.y, ans.u.z);
             if (LatticeType::IsLatticeCompressible())
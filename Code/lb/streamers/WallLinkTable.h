@@ -0,0 +1,132 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_LB_STREAMERS_WALLLINKTABLE_H
+#define HEMELB_LB_STREAMERS_WALLLINKTABLE_H
+
+#include <vector>
+
+#include "geometry/LatticeData.h"
+#include "lb/kernels/BaseKernel.h"
+
+namespace hemelb
+{
+  namespace lb
+  {
+    namespace streamers
+    {
+      /**
+       * Per-link storage for data that wall delegates can work out once at
+       * construction rather than on every time step.
+       *
+       * Holds one Entry per direction for every wall site in the site ranges
+       * the delegate is responsible for, so that the entry for a link can be
+       * found with a couple of subtractions. Sites that are not walls take up
+       * no space beyond their offset; a streamer with no wall sites stores
+       * nothing at all.
+       */
+      template<typename LatticeType, typename Entry>
+      class WallLinkTable
+      {
+        public:
+          /**
+           * Set up the offsets for the wall sites in the given ranges. The
+           * entries are default constructed; fill them in via Find.
+           * @param initParams
+           */
+          WallLinkTable(const kernels::InitParams& initParams)
+          {
+            site_t rangeOffset = 0;
+            site_t wallSiteCount = 0;
+            for (std::vector<std::pair<site_t, site_t> >::const_iterator rangeIt =
+                initParams.siteRanges.begin(); rangeIt != initParams.siteRanges.end(); ++rangeIt)
+            {
+              Range range = { rangeIt->first, rangeIt->second, rangeOffset };
+              ranges.push_back(range);
+              rangeOffset += rangeIt->second - rangeIt->first;
+
+              for (site_t localIndex = rangeIt->first; localIndex < rangeIt->second; ++localIndex)
+              {
+                if (initParams.latDat->GetSite(localIndex).IsWall())
+                {
+                  ++wallSiteCount;
+                }
+              }
+            }
+
+            if (wallSiteCount == 0)
+            {
+              ranges.clear();
+              return;
+            }
+
+            firstEntryForSite.resize(rangeOffset, -1);
+            entries.resize(wallSiteCount * LatticeType::NUMVECTORS);
+
+            site_t nextEntry = 0;
+            for (typename std::vector<Range>::const_iterator range = ranges.begin();
+                range != ranges.end(); ++range)
+            {
+              for (site_t localIndex = range->first; localIndex < range->end; ++localIndex)
+              {
+                if (initParams.latDat->GetSite(localIndex).IsWall())
+                {
+                  firstEntryForSite[range->offset + localIndex - range->first] = nextEntry;
+                  nextEntry += LatticeType::NUMVECTORS;
+                }
+              }
+            }
+          }
+
+          /**
+           * Get the entries for the links of the given site, indexed by direction.
+           * @param siteIndex
+           * @return The entries, or NULL if the site isn't a wall site in the ranges
+           * this table was built for.
+           */
+          inline Entry* Find(site_t siteIndex)
+          {
+            site_t firstEntry = GetFirstEntry(siteIndex);
+            return firstEntry < 0 ? NULL : &entries[firstEntry];
+          }
+
+          inline const Entry* Find(site_t siteIndex) const
+          {
+            site_t firstEntry = GetFirstEntry(siteIndex);
+            return firstEntry < 0 ? NULL : &entries[firstEntry];
+          }
+
+        private:
+          struct Range
+          {
+              site_t first;
+              site_t end;
+              site_t offset;
+          };
+
+          inline site_t GetFirstEntry(site_t siteIndex) const
+          {
+            // There are only ever a couple of ranges (midDomain and domainEdge).
+            for (typename std::vector<Range>::const_iterator range = ranges.begin();
+                range != ranges.end(); ++range)
+            {
+              if (siteIndex >= range->first && siteIndex < range->end)
+              {
+                return firstEntryForSite[range->offset + siteIndex - range->first];
+              }
+            }
+            return -1;
+          }
+
+          std::vector<Range> ranges;
+          std::vector<site_t> firstEntryForSite;
+          std::vector<Entry> entries;
+      };
+    }
+  }
+}
+
+#endif /* HEMELB_LB_STREAMERS_WALLLINKTABLE_H */
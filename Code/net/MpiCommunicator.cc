@@ -111,5 +111,12 @@ namespace hemelb
       HEMELB_MPI_CALL(MPI_Comm_dup, (*commPtr, &newComm));
       return MpiCommunicator(newComm, true);
     }
+
+    MpiCommunicator MpiCommunicator::Split(int colour, int key) const
+    {
+      MPI_Comm newComm;
+      HEMELB_MPI_CALL(MPI_Comm_split, (*commPtr, colour, key, &newComm));
+      return MpiCommunicator(newComm, true);
+    }
   }
 }
@@ -88,6 +88,15 @@ namespace hemelb
          */
         MpiCommunicator Duplicate() const;
 
+        /**
+         * Split the communicator into one for each colour, ranked by key - see
+         * MPI_COMM_SPLIT
+         * @param colour
+         * @param key
+         * @return
+         */
+        MpiCommunicator Split(int colour, int key) const;
+
         template <typename T>
         void Broadcast(T& val, const int root) const;
         template <typename T>
@@ -103,8 +112,31 @@ namespace hemelb
         template <typename T>
         std::vector<T> Reduce(const std::vector<T>& vals, const MPI_Op& op, const int root) const;
 
+        /**
+         * The reduction of the values on all lower ranks - see MPI_EXSCAN. MPI leaves
+         * the result undefined on rank 0; here it is value-initialised (zero, for the
+         * arithmetic types).
+         */
+        template <typename T>
+        T ExclusiveScan(const T& val, const MPI_Op& op) const;
+        template <typename T>
+        std::vector<T> ExclusiveScan(const std::vector<T>& vals, const MPI_Op& op) const;
+
         template <typename T>
         std::vector<T> Gather(const T& val, const int root) const;
+        /**
+         * Gather the same number of values from every rank, in rank order. The
+         * result is only on the root; it is empty elsewhere.
+         */
+        template <typename T>
+        std::vector<T> Gather(const std::vector<T>& vals, const int root) const;
+
+        /**
+         * Gather every rank's values, however many each has, in rank order - see
+         * MPI_GATHERV. The result is only on the root; it is empty elsewhere.
+         */
+        template <typename T>
+        std::vector<T> GatherV(const std::vector<T>& vals, const int root) const;
 
         template <typename T>
         std::vector<T> AllGather(const T& val) const;
@@ -112,6 +144,14 @@ namespace hemelb
         template <typename T>
         std::vector<T> AllToAll(const std::vector<T>& vals) const;
 
+        /**
+         * Send each rank its own number of values, receiving each's in return - see
+         * MPI_ALLTOALLV. The values are sent and received in rank order.
+         */
+        template <typename T>
+        std::vector<T> AllToAllV(const std::vector<T>& vals, const std::vector<int>& sendCounts,
+                                 const std::vector<int>& receiveCounts) const;
+
         template <typename T>
         void Send(const T& val, int dest, int tag=0) const;
         template <typename T>
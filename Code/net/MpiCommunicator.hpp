@@ -84,6 +84,36 @@ namespace hemelb
       return ans;
     }
 
+    template<typename T>
+    T MpiCommunicator::ExclusiveScan(const T& val, const MPI_Op& op) const
+    {
+      T ans = T();
+      HEMELB_MPI_CALL(
+          MPI_Exscan,
+          (MpiConstCast(&val), &ans, 1, MpiDataType<T>(), op, *this)
+      );
+      if (Rank() == 0)
+      {
+        ans = T();
+      }
+      return ans;
+    }
+
+    template<typename T>
+    std::vector<T> MpiCommunicator::ExclusiveScan(const std::vector<T>& vals, const MPI_Op& op) const
+    {
+      std::vector<T> ans(vals.size());
+      HEMELB_MPI_CALL(
+          MPI_Exscan,
+          (MpiConstCast(&vals[0]), &ans[0], vals.size(), MpiDataType<T>(), op, *this)
+      );
+      if (Rank() == 0)
+      {
+        ans.assign(vals.size(), T());
+      }
+      return ans;
+    }
+
     template<typename T>
     std::vector<T> MpiCommunicator::Gather(const T& val, const int root) const
     {
@@ -105,6 +135,64 @@ namespace hemelb
       return ans;
     }
 
+    template<typename T>
+    std::vector<T> MpiCommunicator::Gather(const std::vector<T>& vals, const int root) const
+    {
+      std::vector<T> ans;
+      T* recvbuf = NULL;
+
+      if (Rank() == root)
+      {
+        ans.resize(Size() * vals.size());
+        if (!ans.empty())
+        {
+          recvbuf = &ans[0];
+        }
+      }
+      HEMELB_MPI_CALL(
+          MPI_Gather,
+          (MpiConstCast(vals.empty() ? NULL : &vals[0]), vals.size(), MpiDataType<T>(),
+              recvbuf, vals.size(), MpiDataType<T>(),
+              root, *this)
+      );
+      return ans;
+    }
+
+    template<typename T>
+    std::vector<T> MpiCommunicator::GatherV(const std::vector<T>& vals, const int root) const
+    {
+      const int count = vals.size();
+      const std::vector<int> counts = Gather(count, root);
+
+      std::vector<T> ans;
+      std::vector<int> displacements;
+      T* recvbuf = NULL;
+
+      if (Rank() == root)
+      {
+        displacements.resize(Size());
+        int total = 0;
+        for (int rank = 0; rank < Size(); ++rank)
+        {
+          displacements[rank] = total;
+          total += counts[rank];
+        }
+        ans.resize(total);
+        if (total > 0)
+        {
+          recvbuf = &ans[0];
+        }
+      }
+      HEMELB_MPI_CALL(
+          MPI_Gatherv,
+          (MpiConstCast(vals.empty() ? NULL : &vals[0]), count, MpiDataType<T>(),
+              recvbuf, MpiConstCast(counts.empty() ? NULL : &counts[0]),
+              MpiConstCast(displacements.empty() ? NULL : &displacements[0]), MpiDataType<T>(),
+              root, *this)
+      );
+      return ans;
+    }
+
     template<typename T>
     std::vector<T> MpiCommunicator::AllGather(const T& val) const
     {
@@ -133,6 +221,33 @@ namespace hemelb
       return ans;
     }
 
+    template <typename T>
+    std::vector<T> MpiCommunicator::AllToAllV(const std::vector<T>& vals,
+                                              const std::vector<int>& sendCounts,
+                                              const std::vector<int>& receiveCounts) const
+    {
+      std::vector<int> sendDisplacements(Size()), receiveDisplacements(Size());
+      int sendTotal = 0, receiveTotal = 0;
+      for (int rank = 0; rank < Size(); ++rank)
+      {
+        sendDisplacements[rank] = sendTotal;
+        sendTotal += sendCounts[rank];
+        receiveDisplacements[rank] = receiveTotal;
+        receiveTotal += receiveCounts[rank];
+      }
+
+      std::vector<T> ans(receiveTotal);
+      HEMELB_MPI_CALL(
+          MPI_Alltoallv,
+          (MpiConstCast(vals.empty() ? NULL : &vals[0]), MpiConstCast(&sendCounts[0]),
+           MpiConstCast(&sendDisplacements[0]), MpiDataType<T>(),
+           ans.empty() ? NULL : &ans[0], MpiConstCast(&receiveCounts[0]),
+           MpiConstCast(&receiveDisplacements[0]), MpiDataType<T>(),
+           *this)
+      );
+      return ans;
+    }
+
     template <typename T>
     void MpiCommunicator::Send(const T& val, int dest, int tag) const
     {
@@ -56,6 +56,16 @@ namespace hemelb
         void Write(const std::vector<T>& buffer, MPI_Status* stat = MPI_STATUS_IGNORE);
         template<typename T>
         void WriteAt(MPI_Offset offset, const std::vector<T>& buffer, MPI_Status* stat = MPI_STATUS_IGNORE);
+
+        /**
+         * Starts writing the buffer at the offset with MPI_File_iwrite_at. The buffer
+         * must be left alone until the returned request completes.
+         * @param offset
+         * @param buffer
+         * @return The request for the write.
+         */
+        template<typename T>
+        MPI_Request IwriteAt(MPI_Offset offset, const std::vector<T>& buffer);
       protected:
         MpiFile(const MpiCommunicator& parentComm, MPI_File fh);
 
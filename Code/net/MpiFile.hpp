@@ -49,6 +49,17 @@ namespace hemelb
 
     }
 
+    template<typename T>
+    MPI_Request MpiFile::IwriteAt(MPI_Offset offset, const std::vector<T>& buffer)
+    {
+      MPI_Request request;
+      HEMELB_MPI_CALL(
+          MPI_File_iwrite_at,
+          (*filePtr, offset, MpiConstCast(&buffer[0]), buffer.size(), MpiDataType<T>(), &request)
+      );
+      return request;
+    }
+
   }
 }
 
@@ -29,6 +29,14 @@ namespace hemelb
   typedef unsigned Direction;
   typedef uint64_t sitedata_t;
 
+  // An index into a rank's distribution arrays, as stored in the streaming tables.
+  // These are read for every link on every step, so are only as wide as needed.
+#ifdef HEMELB_WIDE_STREAMING_INDICES
+  typedef uint64_t streaming_index_t;
+#else
+  typedef uint32_t streaming_index_t;
+#endif
+
   // ------- NEW POLICY -------------
   // Types should reflect the meaning of a quantity as well as the precision
   // the type name should reflect the dimensionality and the base of the units
@@ -58,7 +58,11 @@ namespace hemelb
          *
          * @return
          */
-        static FourCubeLatticeData* Create(const net::IOCommunicator& comm, site_t sitesPerBlockUnit = 6, proc_t rankCount = 1)
+        static FourCubeLatticeData* Create(const net::IOCommunicator& comm,
+                                           site_t sitesPerBlockUnit = 6,
+                                           proc_t rankCount = 1,
+                                           bool inPlaceStreaming = false,
+                                           geometry::SiteOrdering siteOrdering = geometry::BLOCK_ORDER)
         {
           hemelb::geometry::Geometry readResult(util::Vector3D<site_t>::Ones(),
                                                 sitesPerBlockUnit);
@@ -152,7 +156,10 @@ namespace hemelb
             }
           }
 
-          FourCubeLatticeData* returnable = new FourCubeLatticeData(readResult, comm);
+          FourCubeLatticeData* returnable = new FourCubeLatticeData(readResult,
+                                                                    comm,
+                                                                    inPlaceStreaming,
+                                                                    siteOrdering);
 
           // First, fiddle with the fluid site count, for tests that require this set.
           returnable->fluidSitesOnEachProcessor.resize(rankCount);
@@ -228,8 +235,15 @@ namespace hemelb
         }
 
       protected:
-        FourCubeLatticeData(hemelb::geometry::Geometry& readResult, const net::IOCommunicator& comms) :
-          hemelb::geometry::LatticeData(lb::lattices::D3Q15::GetLatticeInfo(), readResult, comms)
+        FourCubeLatticeData(hemelb::geometry::Geometry& readResult,
+                            const net::IOCommunicator& comms,
+                            bool inPlaceStreaming,
+                            geometry::SiteOrdering siteOrdering) :
+          hemelb::geometry::LatticeData(lb::lattices::D3Q15::GetLatticeInfo(),
+                                        readResult,
+                                        comms,
+                                        inPlaceStreaming,
+                                        siteOrdering)
         {
 
         }
@@ -49,8 +49,8 @@ namespace hemelb
 
         }
       protected:
-        virtual void CheckIoletMatchesCMake(const io::xml::Element& ioletEl,
-                                            const std::string& requiredBC)
+        virtual void CheckIoletBoundary(const io::xml::Element& ioletEl,
+                                        const std::string& requiredBC)
         {
         }
     };
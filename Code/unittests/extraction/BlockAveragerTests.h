@@ -0,0 +1,145 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_UNITTESTS_EXTRACTION_BLOCKAVERAGERTESTS_H
+#define HEMELB_UNITTESTS_EXTRACTION_BLOCKAVERAGERTESTS_H
+
+#include <vector>
+#include <cppunit/TestFixture.h>
+#include "extraction/BlockAverager.h"
+#include "unittests/helpers/HasCommsTestFixture.h"
+
+namespace hemelb
+{
+  namespace unittests
+  {
+    namespace extraction
+    {
+      using hemelb::extraction::BlockAverager;
+      using hemelb::extraction::FloatingType;
+
+      /**
+       * Tests averaging over blocks of sites, for coarsened property output.
+       */
+      class BlockAveragerTests : public helpers::HasCommsTestFixture
+      {
+          CPPUNIT_TEST_SUITE ( BlockAveragerTests);
+          CPPUNIT_TEST ( TestAverage);
+          CPPUNIT_TEST ( TestOwners);
+          CPPUNIT_TEST ( TestNoSites);CPPUNIT_TEST_SUITE_END();
+
+        public:
+          void TestAverage()
+          {
+            // Every core has every site of a 4x4x4 cube, so each block of two along
+            // each axis has eight sites on each core.
+            std::vector<util::Vector3D<site_t> > positions;
+            std::vector<FloatingType> values;
+            for (site_t i = 0; i < 4; ++i)
+            {
+              for (site_t j = 0; j < 4; ++j)
+              {
+                for (site_t k = 0; k < 4; ++k)
+                {
+                  positions.push_back(util::Vector3D<site_t>(i, j, k));
+                  values.push_back(i + 10 * j + 100 * k + Comms().Rank());
+                  values.push_back(1.);
+                }
+              }
+            }
+
+            BlockAverager averager(2, positions, Comms());
+            const std::vector<util::Vector3D<site_t> >& blocks = averager.GetBlockPositions();
+            CPPUNIT_ASSERT_EQUAL(8, Comms().AllReduce(int(blocks.size()), MPI_SUM));
+
+            std::vector<FloatingType> averages;
+            averager.Average(values, 2, averages);
+            CPPUNIT_ASSERT_EQUAL(2 * blocks.size(), averages.size());
+
+            // The average over a block's sites, then over the cores' ranks.
+            const FloatingType meanRank = 0.5 * (Comms().Size() - 1);
+            for (size_t block = 0; block < blocks.size(); ++block)
+            {
+              const util::Vector3D<site_t>& position = blocks[block];
+              CPPUNIT_ASSERT(position.x >= 0 && position.x < 2);
+              CPPUNIT_ASSERT(position.y >= 0 && position.y < 2);
+              CPPUNIT_ASSERT(position.z >= 0 && position.z < 2);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL( (2 * position.x + 0.5) + 10 * (2 * position.y + 0.5)
+                                               + 100 * (2 * position.z + 0.5) + meanRank,
+                                           averages[2 * block],
+                                           1e-9);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(1., averages[2 * block + 1], 1e-12);
+            }
+          }
+
+          void TestOwners()
+          {
+            // Each core has a site in the block along x at its rank, and one in the
+            // next, so shares each block but the first and last with one other.
+            const site_t rank = Comms().Rank();
+            std::vector<util::Vector3D<site_t> > positions;
+            positions.push_back(util::Vector3D<site_t>(2 * rank, 0, 1));
+            positions.push_back(util::Vector3D<site_t>(2 * rank + 3, 1, 0));
+            std::vector<FloatingType> values(2, FloatingType(rank));
+
+            BlockAverager averager(2, positions, Comms());
+            std::vector<FloatingType> averages;
+            averager.Average(values, 1, averages);
+
+            // The lowest ranked core with sites in a block owns it: the first core
+            // owns the first two, and each other the one after its own.
+            const std::vector<util::Vector3D<site_t> >& blocks = averager.GetBlockPositions();
+            CPPUNIT_ASSERT_EQUAL(size_t(rank == 0 ?
+                                   2 :
+                                   1),
+                                 blocks.size());
+            CPPUNIT_ASSERT_EQUAL(blocks.size(), averages.size());
+            CPPUNIT_ASSERT_EQUAL(util::Vector3D<site_t>(rank + 1, 0, 0), blocks.back());
+            const FloatingType shared = rank + 1 < Comms().Size() ?
+              rank + 0.5 :
+              rank;
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(shared, averages.back(), 1e-12);
+            if (rank == 0)
+            {
+              CPPUNIT_ASSERT_EQUAL(util::Vector3D<site_t>(0), blocks[0]);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(0., averages[0], 1e-12);
+            }
+          }
+
+          void TestNoSites()
+          {
+            // Only the first core has sites, all in one block.
+            std::vector<util::Vector3D<site_t> > positions;
+            std::vector<FloatingType> values;
+            if (Comms().Rank() == 0)
+            {
+              positions.push_back(util::Vector3D<site_t>(4, 5, 6));
+              values.push_back(2.);
+              positions.push_back(util::Vector3D<site_t>(7, 7, 7));
+              values.push_back(4.);
+            }
+
+            BlockAverager averager(8, positions, Comms());
+            const std::vector<util::Vector3D<site_t> >& blocks = averager.GetBlockPositions();
+            CPPUNIT_ASSERT_EQUAL(1, Comms().AllReduce(int(blocks.size()), MPI_SUM));
+
+            std::vector<FloatingType> averages;
+            averager.Average(values, 1, averages);
+            CPPUNIT_ASSERT_EQUAL(blocks.size(), averages.size());
+            if (!blocks.empty())
+            {
+              CPPUNIT_ASSERT_EQUAL(util::Vector3D<site_t>(0), blocks[0]);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(3., averages[0], 1e-12);
+            }
+          }
+      };
+
+      CPPUNIT_TEST_SUITE_REGISTRATION ( BlockAveragerTests);
+    }
+  }
+}
+
+#endif /* HEMELB_UNITTESTS_EXTRACTION_BLOCKAVERAGERTESTS_H */
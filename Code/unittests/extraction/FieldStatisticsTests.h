@@ -0,0 +1,133 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_UNITTESTS_EXTRACTION_FIELDSTATISTICSTESTS_H
+#define HEMELB_UNITTESTS_EXTRACTION_FIELDSTATISTICSTESTS_H
+
+#include <cmath>
+#include <vector>
+#include <cppunit/TestFixture.h>
+#include "extraction/FieldStatistics.h"
+
+namespace hemelb
+{
+  namespace unittests
+  {
+    namespace extraction
+    {
+      using hemelb::extraction::FieldStatistics;
+      using hemelb::extraction::FloatingType;
+      using hemelb::extraction::OutputField;
+
+      /**
+       * Tests the statistics accumulated over time for property output.
+       */
+      class FieldStatisticsTests : public CppUnit::TestFixture
+      {
+          CPPUNIT_TEST_SUITE ( FieldStatisticsTests);
+          CPPUNIT_TEST ( TestComponentStatistics);
+          CPPUNIT_TEST ( TestWallShearStressStatistics);
+          CPPUNIT_TEST ( TestReset);CPPUNIT_TEST_SUITE_END();
+
+        public:
+          void TestComponentStatistics()
+          {
+            // Two sites of a scalar field, sampled three times.
+            FieldStatistics mean(OutputField::Mean, 1, 2);
+            FieldStatistics rms(OutputField::RootMeanSquare, 1, 2);
+            FieldStatistics minimum(OutputField::Minimum, 1, 2);
+            FieldStatistics maximum(OutputField::Maximum, 1, 2);
+
+            const FloatingType samples[3][2] = { { 1., -2. }, { 3., 2. }, { 5., -6. } };
+            for (unsigned sample = 0; sample < 3; ++sample)
+            {
+              const std::vector<FloatingType> values(samples[sample], samples[sample] + 2);
+              mean.Accumulate(values);
+              rms.Accumulate(values);
+              minimum.Accumulate(values);
+              maximum.Accumulate(values);
+            }
+            CPPUNIT_ASSERT_EQUAL(3ul, mean.GetSampleCount());
+            CPPUNIT_ASSERT_EQUAL(1u, mean.GetResultLength());
+
+            std::vector<FloatingType> results;
+            mean.GetResults(results);
+            CPPUNIT_ASSERT_EQUAL(size_t(2), results.size());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(3., results[0], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(-2., results[1], 1e-12);
+
+            rms.GetResults(results);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(std::sqrt(35. / 3.), results[0], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(std::sqrt(44. / 3.), results[1], 1e-12);
+
+            minimum.GetResults(results);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1., results[0], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(-6., results[1], 1e-12);
+
+            maximum.GetResults(results);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(5., results[0], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(2., results[1], 1e-12);
+          }
+
+          void TestWallShearStressStatistics()
+          {
+            // At the first site the stress keeps its direction; at the second it
+            // reverses half the time; at the third there's none.
+            FieldStatistics tawss(OutputField::TimeAveragedMagnitude, 3, 3);
+            FieldStatistics osi(OutputField::OscillatoryIndex, 3, 3);
+            CPPUNIT_ASSERT_EQUAL(1u, tawss.GetResultLength());
+            CPPUNIT_ASSERT_EQUAL(1u, osi.GetResultLength());
+
+            for (unsigned sample = 0; sample < 4; ++sample)
+            {
+              std::vector<FloatingType> values(9, 0.);
+              values[0] = 3.;
+              values[1] = 4.;
+              values[5] = sample % 2 == 0 ?
+                2. :
+                -2.;
+              tawss.Accumulate(values);
+              osi.Accumulate(values);
+            }
+
+            std::vector<FloatingType> results;
+            tawss.GetResults(results);
+            CPPUNIT_ASSERT_EQUAL(size_t(3), results.size());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(5., results[0], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(2., results[1], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(0., results[2], 1e-12);
+
+            osi.GetResults(results);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(0., results[0], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, results[1], 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(0., results[2], 1e-12);
+          }
+
+          void TestReset()
+          {
+            FieldStatistics maximum(OutputField::Maximum, 1, 1);
+            maximum.Accumulate(std::vector<FloatingType>(1, 10.));
+            maximum.Reset();
+            CPPUNIT_ASSERT_EQUAL(0ul, maximum.GetSampleCount());
+
+            // No samples, no statistic.
+            std::vector<FloatingType> results;
+            maximum.GetResults(results);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(0., results[0], 1e-12);
+
+            // The new window doesn't remember the old.
+            maximum.Accumulate(std::vector<FloatingType>(1, -1.));
+            maximum.GetResults(results);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(-1., results[0], 1e-12);
+          }
+      };
+
+      CPPUNIT_TEST_SUITE_REGISTRATION ( FieldStatisticsTests);
+    }
+  }
+}
+
+#endif /* HEMELB_UNITTESTS_EXTRACTION_FIELDSTATISTICSTESTS_H */
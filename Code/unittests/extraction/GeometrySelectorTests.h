@@ -17,6 +17,7 @@
 #include "extraction/PlaneGeometrySelector.h"
 #include "extraction/WholeGeometrySelector.h"
 #include "extraction/GeometrySurfaceSelector.h"
+#include "extraction/StridedGeometrySelector.h"
 #include "unittests/FourCubeLatticeData.h"
 #include "unittests/helpers/HasCommsTestFixture.h"
 
@@ -32,6 +33,7 @@ namespace hemelb
           CPPUNIT_TEST ( TestStraightLineGeometrySelector);
           CPPUNIT_TEST ( TestPlaneGeometrySelector);
           CPPUNIT_TEST ( TestWholeGeometrySelector);
+          CPPUNIT_TEST ( TestStridedGeometrySelector);
           CPPUNIT_TEST ( TestGeometrySurfaceSelector);
           CPPUNIT_TEST ( TestSurfacePointSelector);
           CPPUNIT_TEST ( TestSurfacePointSelectorMultipleHits);CPPUNIT_TEST_SUITE_END();
@@ -79,6 +81,7 @@ namespace hemelb
             straightLineGeometrySelector
                 = new hemelb::extraction::StraightLineGeometrySelector(lineEndPoint1, lineEndPoint2);
             wholeGeometrySelector = new hemelb::extraction::WholeGeometrySelector();
+            stridedGeometrySelector = new hemelb::extraction::StridedGeometrySelector(3);
 
             geometrySurfaceSelector = new hemelb::extraction::GeometrySurfaceSelector();
 
@@ -93,6 +96,7 @@ namespace hemelb
             delete planeGeometrySelectorWithRadius;
             delete straightLineGeometrySelector;
             delete wholeGeometrySelector;
+            delete stridedGeometrySelector;
             delete geometrySurfaceSelector;
 
             delete dataSourceIterator;
@@ -191,6 +195,28 @@ namespace hemelb
             CPPUNIT_ASSERT_EQUAL(CubeSize * CubeSize * CubeSize, count);
           }
 
+          void TestStridedGeometrySelector()
+          {
+            TestOutOfGeometrySites(stridedGeometrySelector);
+
+            // The fluid sites run from 1 to the cube size along each axis, so every
+            // third site is at 3, 6 and 9.
+            std::vector<util::Vector3D<site_t> > includedCoords;
+            for (site_t xCoord = 3; xCoord <= CubeSize; xCoord += 3)
+            {
+              for (site_t yCoord = 3; yCoord <= CubeSize; yCoord += 3)
+              {
+                for (site_t zCoord = 3; zCoord <= CubeSize; zCoord += 3)
+                {
+                  includedCoords.push_back(util::Vector3D<site_t>(xCoord, yCoord, zCoord));
+                }
+              }
+            }
+            CPPUNIT_ASSERT_EQUAL(size_t(27), includedCoords.size());
+
+            TestExpectedIncludedSites(stridedGeometrySelector, includedCoords);
+          }
+
           void TestGeometrySurfaceSelector()
           {
             TestOutOfGeometrySites(geometrySurfaceSelector);
@@ -322,6 +348,7 @@ namespace hemelb
           hemelb::extraction::PlaneGeometrySelector* planeGeometrySelectorWithRadius;
           hemelb::extraction::StraightLineGeometrySelector* straightLineGeometrySelector;
           hemelb::extraction::WholeGeometrySelector* wholeGeometrySelector;
+          hemelb::extraction::StridedGeometrySelector* stridedGeometrySelector;
           hemelb::extraction::GeometrySurfaceSelector* geometrySurfaceSelector;
           hemelb::extraction::SurfacePointSelector* surfacePointSelector;
           hemelb::extraction::SurfacePointSelector* surfacePointSelectorMultipleHits;
@@ -7,16 +7,22 @@
 #ifndef HEMELB_UNITTESTS_EXTRACTION_LOCALPROPERTYOUTPUTTESTS_H
 #define HEMELB_UNITTESTS_EXTRACTION_LOCALPROPERTYOUTPUTTESTS_H
 
+#include <algorithm>
 #include <string>
+#include <vector>
 #include <cstdio>
 
+#include <zlib.h>
 #include <cppunit/TestFixture.h>
 
+#include "io/formats/formats.h"
 #include "io/formats/extraction.h"
 #include "io/writers/xdr/XdrMemReader.h"
 #include "extraction/PropertyOutputFile.h"
 #include "extraction/OutputField.h"
 #include "extraction/WholeGeometrySelector.h"
+#include "extraction/StraightLineGeometrySelector.h"
+#include "util/HalfPrecision.h"
 
 #include "unittests/helpers/HasCommsTestFixture.h"
 #include "unittests/extraction/DummyDataSource.h"
@@ -31,7 +37,15 @@ namespace hemelb
       {
           CPPUNIT_TEST_SUITE (LocalPropertyOutputTests);
           CPPUNIT_TEST (TestStringWrittenLength);
-          CPPUNIT_TEST (TestWrite);CPPUNIT_TEST_SUITE_END();
+          CPPUNIT_TEST (TestWrite);
+          CPPUNIT_TEST (TestWriteSelection);
+          CPPUNIT_TEST (TestWriteBuffering);
+          CPPUNIT_TEST (TestWriteStaticGeometry);
+          CPPUNIT_TEST (TestWriteStatistics);
+          CPPUNIT_TEST (TestWriteCompressed);
+          CPPUNIT_TEST (TestWriteQuantised);
+          CPPUNIT_TEST (TestWriteAggregated);
+          CPPUNIT_TEST (TestWriteCoarsened);CPPUNIT_TEST_SUITE_END();
 
         public:
           void setUp()
@@ -170,6 +184,7 @@ namespace hemelb
             simpleDataSource->FillFields();
             // Write it
             propertyWriter->Write(0);
+            propertyWriter->Flush();
 
             CheckDataWriting(simpleDataSource, 0, writtenFile);
 
@@ -179,6 +194,7 @@ namespace hemelb
             propertyWriter->Write(10);
             // This SHOULD write
             propertyWriter->Write(100);
+            propertyWriter->Flush();
 
             // The previous call to CheckDataWriting() sets the EOF indicator in writtenFile,
             // the previous call to Write() ought to unset it but it isn't working properly in
@@ -188,21 +204,525 @@ namespace hemelb
             CheckDataWriting(simpleDataSource, 100, writtenFile);
           }
 
+          void TestWriteSelection()
+          {
+            // Only the sites along one edge of the cube.
+            const util::Vector3D<float> start(simpleDataSource->GetOrigin());
+            const util::Vector3D<float> end = start
+                + util::Vector3D<float>(3 * simpleDataSource->GetVoxelSize(), 0, 0);
+            delete simpleOutFile.geometry;
+            simpleOutFile.geometry = new hemelb::extraction::StraightLineGeometrySelector(start, end);
+
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            // Skip the headers, checked above.
+            std::fseek(writtenFile,
+                       hemelb::io::formats::extraction::MainHeaderLength + fieldHeaderLength,
+                       SEEK_SET);
+
+            simpleDataSource->FillFields();
+            propertyWriter->Write(0);
+            propertyWriter->Flush();
+            CPPUNIT_ASSERT_EQUAL(4L, CheckDataWriting(simpleDataSource, 0, writtenFile));
+
+            // The selection is kept, but the values are new on each write.
+            simpleDataSource->FillFields();
+            propertyWriter->Write(100);
+            propertyWriter->Flush();
+            std::clearerr(writtenFile);
+            CPPUNIT_ASSERT_EQUAL(4L, CheckDataWriting(simpleDataSource, 100, writtenFile));
+          }
+
+          void TestWriteBuffering()
+          {
+            // More writes than buffers, so some must wait for earlier ones.
+            simpleOutFile.bufferCount = 2;
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            std::fseek(writtenFile,
+                       hemelb::io::formats::extraction::MainHeaderLength + fieldHeaderLength,
+                       SEEK_SET);
+
+            simpleDataSource->FillFields();
+            propertyWriter->Write(0);
+            propertyWriter->Write(100);
+            propertyWriter->Write(200);
+            propertyWriter->Flush();
+
+            // Each in its own place in the file, in order. With the same data, they
+            // differ only in the timestep.
+            const size_t writeLength = 8 + 28 * 64;
+            std::vector<char> firstWrite(writeLength), secondWrite(writeLength);
+            CPPUNIT_ASSERT_EQUAL(writeLength, std::fread(&firstWrite[0], 1, writeLength, writtenFile));
+            CPPUNIT_ASSERT_EQUAL(writeLength, std::fread(&secondWrite[0], 1, writeLength, writtenFile));
+
+            hemelb::io::writers::xdr::XdrMemReader firstReader(&firstWrite[0], writeLength);
+            hemelb::io::writers::xdr::XdrMemReader secondReader(&secondWrite[0], writeLength);
+            uint64_t firstTimestep, secondTimestep;
+            firstReader.readUnsignedLong(firstTimestep);
+            secondReader.readUnsignedLong(secondTimestep);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(0), firstTimestep);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(100), secondTimestep);
+            CPPUNIT_ASSERT(std::equal(firstWrite.begin() + 8, firstWrite.end(), secondWrite.begin() + 8));
+
+            CheckDataWriting(simpleDataSource, 200, writtenFile);
+          }
+
+          void TestWriteStaticGeometry()
+          {
+            simpleOutFile.staticGeometry = true;
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            // The main header is as before, but for the version.
+            CheckMainHeader(hemelb::io::formats::extraction::StaticGeometryVersionNumber);
+
+            // After the field header, the coordinates of every site, in order.
+            std::fseek(writtenFile, fieldHeaderLength, SEEK_CUR);
+            const size_t tableLength = 64 * hemelb::io::formats::extraction::SiteCoordinatesLength;
+            std::vector<char> table(tableLength);
+            CPPUNIT_ASSERT_EQUAL(tableLength, std::fread(&table[0], 1, tableLength, writtenFile));
+            hemelb::io::writers::xdr::XdrMemReader tableReader(&table[0], tableLength);
+            simpleDataSource->Reset();
+            while (simpleDataSource->ReadNext())
+            {
+              CheckGrid(simpleDataSource->GetPosition(), tableReader);
+            }
+
+            // Then the records, with only the fields.
+            simpleDataSource->FillFields();
+            propertyWriter->Write(0);
+            propertyWriter->Flush();
+            CPPUNIT_ASSERT_EQUAL(64L, CheckDataWriting(simpleDataSource, 0, writtenFile));
+
+            simpleDataSource->FillFields();
+            propertyWriter->Write(100);
+            propertyWriter->Flush();
+            std::clearerr(writtenFile);
+            CPPUNIT_ASSERT_EQUAL(64L, CheckDataWriting(simpleDataSource, 100, writtenFile));
+          }
+
+          void TestWriteAggregated()
+          {
+            // However many cores there are, one writes for them all, from its own
+            // offset; the file is as if each wrote its own part.
+            simpleOutFile.staticGeometry = true;
+            simpleOutFile.aggregatorCount = 1;
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            std::fseek(writtenFile,
+                       hemelb::io::formats::extraction::MainHeaderLength + fieldHeaderLength,
+                       SEEK_SET);
+            const size_t tableLength = 64 * hemelb::io::formats::extraction::SiteCoordinatesLength;
+            std::vector<char> table(tableLength);
+            CPPUNIT_ASSERT_EQUAL(tableLength, std::fread(&table[0], 1, tableLength, writtenFile));
+            hemelb::io::writers::xdr::XdrMemReader tableReader(&table[0], tableLength);
+            simpleDataSource->Reset();
+            while (simpleDataSource->ReadNext())
+            {
+              CheckGrid(simpleDataSource->GetPosition(), tableReader);
+            }
+
+            simpleDataSource->FillFields();
+            propertyWriter->Write(0);
+            propertyWriter->Flush();
+            CPPUNIT_ASSERT_EQUAL(64L, CheckDataWriting(simpleDataSource, 0, writtenFile));
+
+            simpleDataSource->FillFields();
+            propertyWriter->Write(100);
+            propertyWriter->Flush();
+            std::clearerr(writtenFile);
+            CPPUNIT_ASSERT_EQUAL(64L, CheckDataWriting(simpleDataSource, 100, writtenFile));
+          }
+
+          void TestWriteCoarsened()
+          {
+            // The 4x4x4 cube, averaged over blocks of 2x2x2, is 8 sites of a grid
+            // twice as coarse, whose first is at the centre of the first block.
+            simpleOutFile.staticGeometry = true;
+            simpleOutFile.coarsening = 2;
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            CheckMainHeader(hemelb::io::formats::extraction::StaticGeometryVersionNumber);
+            // After the magic numbers and version, the grid is coarser.
+            hemelb::io::writers::xdr::XdrMemReader headerReader(writtenMainHeader + 12,
+                                                                hemelb::io::formats::extraction::MainHeaderLength
+                                                                    - 12);
+            double voxelSize;
+            PhysicalPosition origin;
+            uint64_t siteCount;
+            headerReader.readDouble(voxelSize);
+            headerReader.readDouble(origin.x);
+            headerReader.readDouble(origin.y);
+            headerReader.readDouble(origin.z);
+            headerReader.readUnsignedLong(siteCount);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(2. * simpleDataSource->GetVoxelSize(), voxelSize, 1e-12);
+            const PhysicalPosition expectedOrigin = simpleDataSource->GetOrigin()
+                + PhysicalPosition(0.5 * simpleDataSource->GetVoxelSize());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedOrigin.x, origin.x, 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedOrigin.y, origin.y, 1e-12);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedOrigin.z, origin.z, 1e-12);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(8), siteCount);
+
+            // The table has the blocks' positions, in order.
+            std::fseek(writtenFile, fieldHeaderLength, SEEK_CUR);
+            const size_t tableLength = 8 * hemelb::io::formats::extraction::SiteCoordinatesLength;
+            std::vector<char> table(tableLength);
+            CPPUNIT_ASSERT_EQUAL(tableLength, std::fread(&table[0], 1, tableLength, writtenFile));
+            hemelb::io::writers::xdr::XdrMemReader tableReader(&table[0], tableLength);
+            std::vector<util::Vector3D<site_t> > blocks;
+            for (site_t i = 0; i < 2; ++i)
+            {
+              for (site_t j = 0; j < 2; ++j)
+              {
+                for (site_t k = 0; k < 2; ++k)
+                {
+                  blocks.push_back(util::Vector3D<site_t>(i, j, k));
+                  CheckGrid(blocks.back(), tableReader);
+                }
+              }
+            }
+
+            // Each record is the averages of the block's sites' values.
+            simpleDataSource->FillFields();
+            std::vector<hemelb::extraction::FloatingType> expected(4 * blocks.size(), 0.);
+            simpleDataSource->Reset();
+            while (simpleDataSource->ReadNext())
+            {
+              const util::Vector3D<site_t> position = simpleDataSource->GetPosition();
+              const size_t block = 4 * (position.x / 2) + 2 * (position.y / 2) + (position.z / 2);
+              expected[4 * block] += simpleDataSource->GetPressure() / 8.;
+              expected[4 * block + 1] += simpleDataSource->GetVelocity().x / 8.;
+              expected[4 * block + 2] += simpleDataSource->GetVelocity().y / 8.;
+              expected[4 * block + 3] += simpleDataSource->GetVelocity().z / 8.;
+            }
+            propertyWriter->Write(0);
+            propertyWriter->Flush();
+
+            const size_t writeLength = 8 + 16 * blocks.size();
+            std::vector<char> written(writeLength);
+            CPPUNIT_ASSERT_EQUAL(writeLength, std::fread(&written[0], 1, writeLength + 1, writtenFile));
+            hemelb::io::writers::xdr::XdrMemReader reader(&written[0], writeLength);
+            uint64_t timestep;
+            reader.readUnsignedLong(timestep);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(0), timestep);
+            for (size_t block = 0; block < blocks.size(); ++block)
+            {
+              float pressure, vx, vy, vz;
+              reader.readFloat(pressure);
+              reader.readFloat(vx);
+              reader.readFloat(vy);
+              reader.readFloat(vz);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[4 * block],
+                                           REFERENCE_PRESSURE_mmHg + (double) pressure,
+                                           epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[4 * block + 1], (double) vx, epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[4 * block + 2], (double) vy, epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[4 * block + 3], (double) vz, epsilon);
+            }
+          }
+
+          void TestWriteStatistics()
+          {
+            // The mean pressure over each window of the period, sampled twice in it.
+            simpleOutFile.fields[0].statistic = hemelb::extraction::OutputField::Mean;
+            simpleOutFile.samplingPeriod = 50;
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            std::fseek(writtenFile,
+                       hemelb::io::formats::extraction::MainHeaderLength + fieldHeaderLength,
+                       SEEK_SET);
+
+            CPPUNIT_ASSERT(propertyWriter->ShouldSample(50));
+            CPPUNIT_ASSERT(!propertyWriter->ShouldSample(75));
+
+            // Sampled but not written.
+            simpleDataSource->FillFields();
+            std::vector<double> firstPressures;
+            simpleDataSource->Reset();
+            while (simpleDataSource->ReadNext())
+            {
+              firstPressures.push_back(simpleDataSource->GetPressure());
+            }
+            propertyWriter->Write(50);
+
+            // Sampled and written.
+            simpleDataSource->FillFields();
+            propertyWriter->Write(100);
+            propertyWriter->Flush();
+
+            const size_t writeLength = 8 + 28 * 64;
+            std::vector<char> contents(writeLength);
+            CPPUNIT_ASSERT_EQUAL(writeLength, std::fread(&contents[0], 1, writeLength, writtenFile));
+            hemelb::io::writers::xdr::XdrMemReader reader(&contents[0], writeLength);
+
+            uint64_t timestep;
+            reader.readUnsignedLong(timestep);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(100), timestep);
+
+            simpleDataSource->Reset();
+            for (unsigned site = 0; simpleDataSource->ReadNext(); ++site)
+            {
+              CheckGrid(simpleDataSource->GetPosition(), reader);
+
+              // Written less the reference pressure, like the pressure itself.
+              float pressure;
+              reader.readFloat(pressure);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5 * (firstPressures[site] + simpleDataSource->GetPressure()),
+                                           REFERENCE_PRESSURE_mmHg + (double) pressure,
+                                           epsilon);
+
+              // The velocity is still the current value.
+              PhysicalVelocity velocity = simpleDataSource->GetVelocity();
+              float vx, vy, vz;
+              reader.readFloat(vx);
+              reader.readFloat(vy);
+              reader.readFloat(vz);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(velocity.x, (double) vx, epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(velocity.y, (double) vy, epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(velocity.z, (double) vz, epsilon);
+            }
+          }
+
+          void TestWriteCompressed()
+          {
+            simpleOutFile.compressed = true;
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            CheckMainHeader(hemelb::io::formats::extraction::CompressedVersionNumber);
+
+            // Skip the field header and coordinate table, as in the static geometry format.
+            std::fseek(writtenFile,
+                       fieldHeaderLength + 64 * hemelb::io::formats::extraction::SiteCoordinatesLength,
+                       SEEK_CUR);
+
+            simpleDataSource->FillFields();
+            propertyWriter->Write(0);
+            propertyWriter->Flush();
+            CheckCompressedWriting(0, writtenFile);
+
+            // Records have different lengths, but each follows the last.
+            simpleDataSource->FillFields();
+            propertyWriter->Write(100);
+            propertyWriter->Flush();
+            std::clearerr(writtenFile);
+            CheckCompressedWriting(100, writtenFile);
+          }
+
+          void TestWriteQuantised()
+          {
+            // The pressure to within 0.01 mmHg, the velocity to half precision.
+            simpleOutFile.fields[0].quantisation = hemelb::extraction::OutputField::FixedPoint;
+            simpleOutFile.fields[0].errorBound = 0.01;
+            simpleOutFile.fields[1].quantisation = hemelb::extraction::OutputField::HalfPrecision;
+            propertyWriter = new hemelb::extraction::LocalPropertyOutput(*simpleDataSource, &simpleOutFile, Comms());
+            writtenFile = std::fopen(simpleOutFile.filename.c_str(), "r");
+            CPPUNIT_ASSERT(writtenFile != NULL);
+
+            CheckMainHeader(hemelb::io::formats::extraction::QuantisedVersionNumber);
+
+            // Each field's entry has its encoding and step too.
+            const size_t quantisedFieldHeaderLength = fieldHeaderLength + 2 * 12;
+            std::vector<char> fieldHeader(quantisedFieldHeaderLength);
+            CPPUNIT_ASSERT_EQUAL(quantisedFieldHeaderLength,
+                                 std::fread(&fieldHeader[0], 1, quantisedFieldHeaderLength, writtenFile));
+            hemelb::io::writers::xdr::XdrMemReader fieldHeaderReader(&fieldHeader[0],
+                                                                     quantisedFieldHeaderLength);
+            const unsigned expectedEncodings[] = { hemelb::io::formats::extraction::FixedPointEncoding,
+                                                   hemelb::io::formats::extraction::HalfEncoding };
+            const double expectedSteps[] = { 0.02, 0 };
+            for (unsigned field = 0; field < 2; ++field)
+            {
+              // Both names are eight characters, so two words.
+              unsigned nameLength, name0, name1, length, encoding;
+              double offset, step;
+              fieldHeaderReader.readUnsignedInt(nameLength);
+              fieldHeaderReader.readUnsignedInt(name0);
+              fieldHeaderReader.readUnsignedInt(name1);
+              fieldHeaderReader.readUnsignedInt(length);
+              fieldHeaderReader.readDouble(offset);
+              fieldHeaderReader.readUnsignedInt(encoding);
+              fieldHeaderReader.readDouble(step);
+              CPPUNIT_ASSERT_EQUAL(unsigned(simpleOutFile.fields[field].name.size()), nameLength);
+              CPPUNIT_ASSERT_EQUAL(2u * field + 1u, length);
+              CPPUNIT_ASSERT_EQUAL(expectedEncodings[field], encoding);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedSteps[field], step, 1e-15);
+            }
+
+            // Then the coordinate table, then the records.
+            std::fseek(writtenFile, 64 * hemelb::io::formats::extraction::SiteCoordinatesLength, SEEK_CUR);
+
+            simpleDataSource->FillFields();
+            propertyWriter->Write(0);
+            propertyWriter->Flush();
+
+            // Two bytes for the pressure and six for the velocity, so no padding.
+            const size_t writeLength = 8 + 8 * 64;
+            std::vector<char> contents(writeLength);
+            CPPUNIT_ASSERT_EQUAL(writeLength, std::fread(&contents[0], 1, writeLength + 1, writtenFile));
+            const unsigned char* record = reinterpret_cast<const unsigned char*>(&contents[8]);
+
+            simpleDataSource->Reset();
+            while (simpleDataSource->ReadNext())
+            {
+              const int16_t steps = int16_t( (record[0] << 8) | record[1]);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(simpleDataSource->GetPressure(),
+                                           REFERENCE_PRESSURE_mmHg + 0.02 * steps,
+                                           0.01 + 1e-9);
+
+              PhysicalVelocity velocity = simpleDataSource->GetVelocity();
+              for (unsigned component = 0; component < 3; ++component)
+              {
+                const uint16_t half = uint16_t( (record[2 + 2 * component] << 8)
+                    | record[3 + 2 * component]);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(velocity[component],
+                                             hemelb::util::HalfToFloat(half),
+                                             std::ldexp(std::fabs(velocity[component]), -11) + 1e-12);
+              }
+              record += 8;
+            }
+          }
+
         private:
-          void CheckDataWriting(DummyDataSource* datasource, uint64_t timestep, FILE* file)
+          /**
+           * Reads the main header from the written file, checking its magic numbers
+           * and version.
+           */
+          void CheckMainHeader(unsigned expectedVersion)
+          {
+            CPPUNIT_ASSERT_EQUAL(size_t(hemelb::io::formats::extraction::MainHeaderLength),
+                                 std::fread(writtenMainHeader,
+                                            1,
+                                            hemelb::io::formats::extraction::MainHeaderLength,
+                                            writtenFile));
+            hemelb::io::writers::xdr::XdrMemReader headerReader(writtenMainHeader,
+                                                                hemelb::io::formats::extraction::MainHeaderLength);
+            unsigned hemeLbMagic, extractionMagic, version;
+            headerReader.readUnsignedInt(hemeLbMagic);
+            headerReader.readUnsignedInt(extractionMagic);
+            headerReader.readUnsignedInt(version);
+            CPPUNIT_ASSERT_EQUAL(unsigned(hemelb::io::formats::HemeLbMagicNumber), hemeLbMagic);
+            CPPUNIT_ASSERT_EQUAL(unsigned(hemelb::io::formats::extraction::MagicNumber), extractionMagic);
+            CPPUNIT_ASSERT_EQUAL(expectedVersion, version);
+          }
+
+          /**
+           * Checks the next site's grid coordinates read match its position.
+           */
+          void CheckGrid(const LatticeVector& grid, hemelb::io::writers::xdr::XdrMemReader& reader)
+          {
+            unsigned x, y, z;
+            reader.readUnsignedInt(x);
+            reader.readUnsignedInt(y);
+            reader.readUnsignedInt(z);
+
+            CPPUNIT_ASSERT_EQUAL((unsigned) grid.x, x);
+            CPPUNIT_ASSERT_EQUAL((unsigned) grid.y, y);
+            CPPUNIT_ASSERT_EQUAL((unsigned) grid.z, z);
+          }
+
+          /**
+           * Checks the next compressed record in the file against the data source.
+           */
+          void CheckCompressedWriting(uint64_t timestep, FILE* file)
+          {
+            const size_t headerLength = hemelb::io::formats::extraction::CompressedRecordHeaderLength
+                + hemelb::io::formats::extraction::ChunkIndexEntryLength;
+            std::vector<char> header(headerLength);
+            CPPUNIT_ASSERT_EQUAL(headerLength, std::fread(&header[0], 1, headerLength, file));
+            hemelb::io::writers::xdr::XdrMemReader headerReader(&header[0], headerLength);
+
+            uint64_t readTimestep, recordLength, compressedLength, uncompressedLength;
+            unsigned chunkCount;
+            headerReader.readUnsignedLong(readTimestep);
+            headerReader.readUnsignedLong(recordLength);
+            headerReader.readUnsignedInt(chunkCount);
+            headerReader.readUnsignedLong(compressedLength);
+            headerReader.readUnsignedLong(uncompressedLength);
+            CPPUNIT_ASSERT_EQUAL(timestep, readTimestep);
+            CPPUNIT_ASSERT_EQUAL(1u, chunkCount);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(headerLength + compressedLength), recordLength);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(16 * 64), uncompressedLength);
+
+            std::vector<char> compressed(compressedLength);
+            CPPUNIT_ASSERT_EQUAL(size_t(compressedLength),
+                                 std::fread(&compressed[0], 1, compressedLength, file));
+            std::vector<char> shuffled(uncompressedLength);
+            uLongf inflatedLength = uncompressedLength;
+            CPPUNIT_ASSERT_EQUAL(Z_OK,
+                                 uncompress(reinterpret_cast<Bytef*>(&shuffled[0]),
+                                            &inflatedLength,
+                                            reinterpret_cast<const Bytef*>(&compressed[0]),
+                                            compressedLength));
+            CPPUNIT_ASSERT_EQUAL(uLongf(uncompressedLength), inflatedLength);
+
+            // Undo the shuffle, then it's as in the static geometry format.
+            const size_t valueCount = uncompressedLength / 4;
+            std::vector<char> values(uncompressedLength);
+            for (size_t value = 0; value < valueCount; ++value)
+            {
+              for (size_t byte = 0; byte < 4; ++byte)
+              {
+                values[value * 4 + byte] = shuffled[byte * valueCount + value];
+              }
+            }
+
+            hemelb::io::writers::xdr::XdrMemReader reader(&values[0], uncompressedLength);
+            simpleDataSource->Reset();
+            while (simpleDataSource->ReadNext())
+            {
+              float pressure;
+              reader.readFloat(pressure);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(simpleDataSource->GetPressure(),
+                                           REFERENCE_PRESSURE_mmHg + (double) pressure,
+                                           epsilon);
+
+              PhysicalVelocity velocity = simpleDataSource->GetVelocity();
+              float vx, vy, vz;
+              reader.readFloat(vx);
+              reader.readFloat(vy);
+              reader.readFloat(vz);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(velocity.x, (double) vx, epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(velocity.y, (double) vy, epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(velocity.z, (double) vz, epsilon);
+            }
+          }
+
+          /**
+           * Checks the next write in the file against the data source, for the sites
+           * in the output's geometry, and returns how many there were.
+           */
+          long CheckDataWriting(DummyDataSource* datasource, uint64_t timestep, FILE* file)
           {
             // The file should have an entry for each lattice point, consisting
             // of 3D grid coords, pressure (with an offset of 80) and 3D velocity.
-            // This gives 3*4 + 4 + 3*4 = 28 bytes per site.
+            // This gives 3*4 + 4 + 3*4 = 28 bytes per site, or 16 if the grid
+            // coords are written once, after the headers.
             long siteCount = 0;
             datasource->Reset();
             while (datasource->ReadNext())
             {
-              ++siteCount;
+              if (simpleOutFile.geometry->Include(*datasource, datasource->GetPosition()))
+              {
+                ++siteCount;
+              }
             }
 
             // We also have the iteration number, a long
-            size_t expectedSize = 8 + 28 * siteCount;
+            size_t expectedSize = 8 + (simpleOutFile.staticGeometry ? 16 : 28) * siteCount;
 
             // Attempt to read one extra byte, to make sure we aren't under-reading
             char* contentsBuffer = new char[expectedSize];
@@ -223,16 +743,16 @@ namespace hemelb
             datasource->Reset();
             while (datasource->ReadNext())
             {
-              // Read the grid, which should be the same
-              LatticeVector grid = datasource->GetPosition();
-              unsigned x, y, z;
-              reader.readUnsignedInt(x);
-              reader.readUnsignedInt(y);
-              reader.readUnsignedInt(z);
+              if (!simpleOutFile.geometry->Include(*datasource, datasource->GetPosition()))
+              {
+                continue;
+              }
 
-              CPPUNIT_ASSERT_EQUAL((unsigned) grid.x, x);
-              CPPUNIT_ASSERT_EQUAL((unsigned) grid.y, y);
-              CPPUNIT_ASSERT_EQUAL((unsigned) grid.z, z);
+              // Read the grid, which should be the same
+              if (!simpleOutFile.staticGeometry)
+              {
+                CheckGrid(datasource->GetPosition(), reader);
+              }
 
               // Read the pressure, which should be an offset of the
               // reference pressure away.
@@ -254,6 +774,7 @@ namespace hemelb
             }
 
             delete[] contentsBuffer;
+            return siteCount;
           }
 
           hemelb::extraction::PropertyOutputFile simpleOutFile;
@@ -0,0 +1,234 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_UNITTESTS_EXTRACTION_REDUCTIONACTORTESTS_H
+#define HEMELB_UNITTESTS_EXTRACTION_REDUCTIONACTORTESTS_H
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include "extraction/ReductionActor.h"
+#include "geometry/LatticeData.h"
+#include "lb/lattices/D3Q15.h"
+#include "lb/iolets/InOutLetCosine.h"
+#include "reporting/Timers.h"
+#include "unittests/helpers/FourCubeBasedTestFixture.h"
+
+namespace hemelb
+{
+  namespace unittests
+  {
+    namespace extraction
+    {
+      /**
+       * Tests the reductions against those known for a uniform flow along a channel
+       * tilted to the lattice axes.
+       */
+      class ReductionActorTests : public helpers::FourCubeBasedTestFixture
+      {
+          CPPUNIT_TEST_SUITE (ReductionActorTests);
+          CPPUNIT_TEST (TestTiltedChannel);CPPUNIT_TEST_SUITE_END();
+
+        public:
+          void setUp()
+          {
+            helpers::FourCubeBasedTestFixture::setUp();
+            timings = new reporting::Timers(Comms());
+            outputSpec.filename = "reductions.txt";
+            outputSpec.frequency = 1;
+          }
+
+          void tearDown()
+          {
+            delete timings;
+            helpers::FourCubeBasedTestFixture::tearDown();
+          }
+
+          void TestTiltedChannel()
+          {
+            // The channel runs along (1, 0, 1), between inlet and outlet planes
+            // across it at x + z = 2.5 and 8.5. Its walls are the planes at
+            // x - z = +/-2.5, and y = 0.5 and 3.5. Each iolet is 3 sites across
+            // in y and 5 / sqrt(2) in x - z, each wall along (1, 0, -1) is 3
+            // across in y and 6 / sqrt(2) long.
+            const Dimensionless rootHalf = std::sqrt(0.5);
+            const distribn_t ioletArea = 3. * 5. * rootHalf;
+            const distribn_t sideWallArea = 3. * 6. * rootHalf;
+
+            geometry::LatticeData* channel = CreateTiltedChannel();
+            lb::MacroscopicPropertyCache propertyCache(*simState, *channel);
+            std::vector<lb::iolets::InOutLet*> inlets(1, new lb::iolets::InOutLetCosine());
+            std::vector<lb::iolets::InOutLet*> outlets(1, new lb::iolets::InOutLetCosine());
+            inlets[0]->SetNormal(util::Vector3D<Dimensionless>(1., 0., 1.));
+            outlets[0]->SetNormal(util::Vector3D<Dimensionless>(-1., 0., -1.));
+
+            hemelb::extraction::ReductionActor actor(*simState,
+                                                     outputSpec,
+                                                     *channel,
+                                                     propertyCache,
+                                                     inlets,
+                                                     outlets,
+                                                     *unitConverter,
+                                                     *timings,
+                                                     Comms());
+
+            // The same flow everywhere, and a traction only on the wall with normal
+            // along (1, 0, -1).
+            CPPUNIT_ASSERT(actor.ShouldWrite(simState->GetTimeStep()));
+            actor.SetRequiredProperties(propertyCache);
+            const distribn_t density = 1.01;
+            const util::Vector3D<distribn_t> velocity(0.01, -0.002, 0.004);
+            const util::Vector3D<LatticeStress> traction(0.0001, 0.0002, 0.0003);
+            const util::Vector3D<distribn_t> sideWallNormal = util::Vector3D<distribn_t>(1., 0., -1.)
+                * rootHalf;
+            for (site_t site = 0; site < channel->GetLocalFluidSiteCount(); ++site)
+            {
+              propertyCache.densityCache.Put(site, density);
+              propertyCache.velocityCache.Put(site, velocity);
+              const geometry::Site<geometry::LatticeData> channelSite = channel->GetSite(site);
+              const bool onSideWall = channelSite.IsWall()
+                  && (channelSite.GetWallNormal() - sideWallNormal).GetMagnitude() < 1e-6;
+              propertyCache.tractionCache.Put(site,
+                                              onSideWall ?
+                                                traction :
+                                                util::Vector3D<LatticeStress>::Zero());
+            }
+
+            actor.EndIteration();
+
+            std::ifstream written(outputSpec.filename.c_str());
+            std::string columns;
+            std::getline(written, columns);
+            CPPUNIT_ASSERT_EQUAL(std::string("# timestep inlet0_flux inlet0_pressure outlet0_flux "
+                                     "outlet0_pressure wall_force_x wall_force_y wall_force_z "),
+                                 columns);
+
+            unsigned long timestep;
+            double inletFlux, inletPressure, outletFlux, outletPressure, forceX, forceY, forceZ;
+            written >> timestep >> inletFlux >> inletPressure >> outletFlux >> outletPressure >> forceX
+                >> forceY >> forceZ;
+            CPPUNIT_ASSERT(written);
+            CPPUNIT_ASSERT_EQUAL((unsigned long) simState->GetTimeStep(), timestep);
+
+            const PhysicalDistance voxelSize = unitConverter->GetVoxelSize();
+            const PhysicalVelocity physicalVelocity = unitConverter->ConvertVelocityToPhysicalUnits(velocity);
+            const double expectedFlux = ioletArea * voxelSize * voxelSize
+                * physicalVelocity.Dot(inlets[0]->GetNormal());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedFlux, inletFlux, 1e-5 * std::abs(expectedFlux));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(-expectedFlux, outletFlux, 1e-5 * std::abs(expectedFlux));
+
+            const PhysicalPressure pressure = unitConverter->ConvertPressureToPhysicalUnits(density * Cs2);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(pressure, inletPressure, 1e-3);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(pressure, outletPressure, 1e-3);
+
+            const util::Vector3D<PhysicalStress> force =
+                unitConverter->ConvertStressToPhysicalUnits(traction)
+                    * (sideWallArea * voxelSize * voxelSize);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(force.x, forceX, 1e-5 * std::abs(force.x));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(force.y, forceY, 1e-5 * std::abs(force.y));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(force.z, forceZ, 1e-5 * std::abs(force.z));
+
+            delete inlets[0];
+            delete outlets[0];
+            delete channel;
+          }
+
+        private:
+          /**
+           * Makes the channel along (1, 0, 1) in one block of 8 sites along each
+           * axis. Its fluid sites are those with 3 <= x + z <= 8, -2 <= x - z <= 2
+           * and 1 <= y <= 3. The walls along (1, 0, -1) have their normals at the
+           * sites next to them, and the walls across y at the others.
+           */
+          geometry::LatticeData* CreateTiltedChannel()
+          {
+            typedef lb::lattices::D3Q15 Lattice;
+            const site_t blockSize = 8;
+            geometry::Geometry readResult(util::Vector3D<site_t>::Ones(), blockSize);
+            geometry::BlockReadResult& block = readResult.Blocks[0];
+            block.Sites.resize(readResult.GetSitesPerBlock(), geometry::GeometrySite(false));
+
+            site_t index = -1;
+            for (site_t i = 0; i < blockSize; ++i)
+            {
+              for (site_t j = 0; j < blockSize; ++j)
+              {
+                for (site_t k = 0; k < blockSize; ++k)
+                {
+                  ++index;
+                  if (!IsInTiltedChannel(i, j, k))
+                  {
+                    continue;
+                  }
+
+                  geometry::GeometrySite& site = block.Sites[index];
+                  site.isFluid = true;
+                  site.targetProcessor = 0;
+
+                  bool bySideWall = false, byEndWall = false;
+                  for (Direction direction = 1; direction < Lattice::NUMVECTORS; ++direction)
+                  {
+                    const site_t neighI = i + Lattice::CX[direction];
+                    const site_t neighJ = j + Lattice::CY[direction];
+                    const site_t neighK = k + Lattice::CZ[direction];
+
+                    geometry::GeometrySiteLink link;
+                    link.distanceToIntersection = 0.5;
+                    if (neighI + neighK < 3)
+                    {
+                      link.ioletId = 0;
+                      link.type = geometry::GeometrySiteLink::INLET_INTERSECTION;
+                    }
+                    else if (neighI + neighK > 8)
+                    {
+                      link.ioletId = 0;
+                      link.type = geometry::GeometrySiteLink::OUTLET_INTERSECTION;
+                    }
+                    else if (!IsInTiltedChannel(neighI, neighJ, neighK))
+                    {
+                      link.type = geometry::GeometrySiteLink::WALL_INTERSECTION;
+                      bySideWall |= std::abs(neighI - neighK) > 2;
+                      byEndWall |= std::abs(neighI - neighK) <= 2;
+                    }
+                    site.links.push_back(link);
+                  }
+
+                  if (bySideWall)
+                  {
+                    site.wallNormalAvailable = true;
+                    site.wallNormal = util::Vector3D<float>(i > k ? 1 : -1, 0, i > k ? -1 : 1)
+                        * float(std::sqrt(0.5));
+                  }
+                  else if (byEndWall)
+                  {
+                    site.wallNormalAvailable = true;
+                    site.wallNormal = util::Vector3D<float>(0, j == 1 ? -1 : 1, 0);
+                  }
+                }
+              }
+            }
+
+            return new geometry::LatticeData(Lattice::GetLatticeInfo(), readResult, Comms());
+          }
+
+          static bool IsInTiltedChannel(site_t i, site_t j, site_t k)
+          {
+            return i + k >= 3 && i + k <= 8 && std::abs(i - k) <= 2 && j >= 1 && j <= 3;
+          }
+
+          reporting::Timers* timings;
+          hemelb::extraction::ReductionOutputFile outputSpec;
+      };
+
+      CPPUNIT_TEST_SUITE_REGISTRATION (ReductionActorTests);
+    }
+  }
+}
+
+#endif /* HEMELB_UNITTESTS_EXTRACTION_REDUCTIONACTORTESTS_H */
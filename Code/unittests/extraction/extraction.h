@@ -7,7 +7,10 @@
 #ifndef HEMELB_UNITTESTS_EXTRACTION_EXTRACTION_H
 #define HEMELB_UNITTESTS_EXTRACTION_EXTRACTION_H
 
+#include "unittests/extraction/BlockAveragerTests.h"
+#include "unittests/extraction/FieldStatisticsTests.h"
 #include "unittests/extraction/GeometrySelectorTests.h"
 #include "unittests/extraction/LocalPropertyOutputTests.h"
+#include "unittests/extraction/ReductionActorTests.h"
 
 #endif /* HEMELB_UNITTESTS_EXTRACTION_EXTRACTION_H */
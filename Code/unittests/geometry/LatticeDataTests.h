@@ -7,6 +7,7 @@
 #ifndef HEMELB_UNITTESTS_GEOMETRY_LATTICEDATATESTS_H
 #define HEMELB_UNITTESTS_GEOMETRY_LATTICEDATATESTS_H
 
+#include <map>
 #include "geometry/LatticeData.h"
 
 namespace hemelb
@@ -23,6 +24,8 @@ namespace hemelb
           CPPUNIT_TEST ( TestConstruct);
           CPPUNIT_TEST ( TestConvertGlobalId);
           CPPUNIT_TEST ( TestGetProcFromGlobalId);
+          CPPUNIT_TEST ( TestHilbertKeyVisitsNeighbours);
+          CPPUNIT_TEST ( TestSiteOrderingKeepsCollisionTypes);
 
           CPPUNIT_TEST_SUITE_END();
 
@@ -68,6 +71,69 @@ namespace hemelb
             CPPUNIT_ASSERT_EQUAL(latDat->ProcProvidingSiteByGlobalNoncontiguousId(43), 0);
           }
 
+          void TestHilbertKeyVisitsNeighbours()
+          {
+            // The first 8^3 points of the curve fill the cube at the origin, each a
+            // lattice neighbour of the one before.
+            std::map<uint64_t, util::Vector3D<site_t> > curve;
+            for (site_t x = 0; x < 8; ++x)
+              for (site_t y = 0; y < 8; ++y)
+                for (site_t z = 0; z < 8; ++z)
+                {
+                  util::Vector3D<site_t> coords(x, y, z);
+                  curve[GetHilbertKey(coords)] = coords;
+                }
+
+            uint64_t expectedKey = 0;
+            for (std::map<uint64_t, util::Vector3D<site_t> >::const_iterator point = curve.begin();
+                point != curve.end(); ++point, ++expectedKey)
+            {
+              CPPUNIT_ASSERT_EQUAL(expectedKey, point->first);
+              if (point != curve.begin())
+              {
+                std::map<uint64_t, util::Vector3D<site_t> >::const_iterator previous = point;
+                --previous;
+                const util::Vector3D<site_t> step = point->second - previous->second;
+                CPPUNIT_ASSERT_EQUAL(site_t(1), std::abs(step.x) + std::abs(step.y) + std::abs(step.z));
+              }
+            }
+          }
+
+          void TestSiteOrderingKeepsCollisionTypes()
+          {
+            FourCubeLatticeData* blockOrdered = FourCubeLatticeData::Create(Comms(), 12);
+            const SiteOrdering orderings[] = { MORTON_ORDER, HILBERT_ORDER };
+            for (unsigned ordering = 0; ordering < 2; ++ordering)
+            {
+              FourCubeLatticeData* reordered = FourCubeLatticeData::Create(Comms(),
+                                                                           12,
+                                                                           1,
+                                                                           false,
+                                                                           orderings[ordering]);
+              for (unsigned collisionType = 0; collisionType < COLLISION_TYPES; ++collisionType)
+              {
+                CPPUNIT_ASSERT_EQUAL(blockOrdered->GetMidDomainCollisionCount(collisionType),
+                                     reordered->GetMidDomainCollisionCount(collisionType));
+                CPPUNIT_ASSERT_EQUAL(blockOrdered->GetDomainEdgeCollisionCount(collisionType),
+                                     reordered->GetDomainEdgeCollisionCount(collisionType));
+              }
+
+              // Each site keeps its data, under its new index.
+              for (site_t index = 0; index < reordered->GetLocalFluidSiteCount(); ++index)
+              {
+                const Site<LatticeData> site = reordered->GetSite(index);
+                const Site<LatticeData> original =
+                    blockOrdered->GetSite(blockOrdered->GetContiguousSiteId(site.GetGlobalSiteCoords()));
+                CPPUNIT_ASSERT_EQUAL(original.GetCollisionType(), site.GetCollisionType());
+                CPPUNIT_ASSERT_EQUAL(original.GetWallNormal(), site.GetWallNormal());
+              }
+
+              CPPUNIT_ASSERT(reordered->GetStreamingDistance() < blockOrdered->GetStreamingDistance());
+              delete reordered;
+            }
+            delete blockOrdered;
+          }
+
         private:
       };
       CPPUNIT_TEST_SUITE_REGISTRATION ( NeighbouringLatticeDataTests);
@@ -28,6 +28,7 @@ namespace hemelb
             CPPUNIT_TEST (TestInsertAndRetrieveNormal);
             CPPUNIT_TEST (TestInsertAndRetrieveDistributions);
             CPPUNIT_TEST (TestNeighbouringSite);
+            CPPUNIT_TEST (TestAssignRemoteIndices);
 
             CPPUNIT_TEST_SUITE_END();
 
@@ -89,7 +90,7 @@ namespace hemelb
                 distribution.push_back(exampleSite->GetFOld<lb::lattices::D3Q15>()[direction]);
               }
 
-              data->GetDistribution(dummyId) = distribution;
+              data->SetDistribution(dummyId, distribution);
 
               for (unsigned int direction = 0; direction < lb::lattices::D3Q15::NUMVECTORS; direction++)
               {
@@ -134,6 +135,35 @@ namespace hemelb
               }
             }
 
+            void TestAssignRemoteIndices()
+            {
+              std::vector<distribn_t> distribution(lb::lattices::D3Q15::NUMVECTORS, 17.0);
+              data->SetDistribution(dummyId, distribution);
+              CPPUNIT_ASSERT_EQUAL(site_t(0), data->GetRemoteIndex(dummyId));
+
+              // The assigned sites come first and in order; the existing site follows, with its data.
+              std::vector<site_t> order;
+              order.push_back(61);
+              order.push_back(12);
+              data->AssignRemoteIndices(order);
+
+              CPPUNIT_ASSERT_EQUAL(site_t(3), data->GetRemoteSiteCount());
+              CPPUNIT_ASSERT_EQUAL(site_t(0), data->GetRemoteIndex(61));
+              CPPUNIT_ASSERT_EQUAL(site_t(1), data->GetRemoteIndex(12));
+              CPPUNIT_ASSERT_EQUAL(site_t(2), data->GetRemoteIndex(dummyId));
+              CPPUNIT_ASSERT_EQUAL(site_t(-1), data->GetRemoteIndex(13));
+              CPPUNIT_ASSERT_EQUAL(dummyId, data->GetGlobalIndex(2));
+
+              // Distributions are contiguous in remote index order.
+              CPPUNIT_ASSERT_EQUAL(data->GetFOldByRemoteIndex(0) + 2 * lb::lattices::D3Q15::NUMVECTORS,
+                                   data->GetFOldByRemoteIndex(2));
+              for (unsigned int direction = 0; direction < lb::lattices::D3Q15::NUMVECTORS; direction++)
+              {
+                CPPUNIT_ASSERT_EQUAL(17.0, data->GetFOldByRemoteIndex(2)[direction]);
+                CPPUNIT_ASSERT_EQUAL(17.0, data->GetFOld(dummyId * lb::lattices::D3Q15::NUMVECTORS)[direction]);
+              }
+            }
+
           private:
             NeighbouringLatticeData *data;
             Site<LatticeData> *exampleSite;
@@ -11,6 +11,7 @@
 #include <sstream>
 
 #include "lb/kernels/Kernels.h"
+#include "lb/lattices/D3Q27.h"
 #include "lb/kernels/rheologyModels/RheologyModels.h"
 #include "lb/kernels/momentBasis/DHumieresD3Q15MRTBasis.h"
 #include "lb/kernels/momentBasis/DHumieresD3Q19MRTBasis.h"
@@ -36,10 +37,14 @@ namespace hemelb
           CPPUNIT_TEST_SUITE ( KernelTests);
           CPPUNIT_TEST ( TestAnsumaliEntropicCalculationsAndCollision);
           CPPUNIT_TEST ( TestChikatamarlaEntropicCalculationsAndCollision);
+          CPPUNIT_TEST ( TestEntropicAlphaSolver);
           CPPUNIT_TEST ( TestLBGKCalculationsAndCollision);
           CPPUNIT_TEST ( TestLBGKNNCalculationsAndCollision);
           CPPUNIT_TEST ( TestMRTConstantRelaxationTimeEqualsLBGK);
-          CPPUNIT_TEST ( TestD3Q19MRTConstantRelaxationTimeEqualsLBGK);CPPUNIT_TEST_SUITE_END();
+          CPPUNIT_TEST ( TestD3Q19MRTConstantRelaxationTimeEqualsLBGK);
+          CPPUNIT_TEST ( TestMRTMatchesMomentSpaceCollision);
+          CPPUNIT_TEST ( TestRegularisedCollision);
+          CPPUNIT_TEST ( TestCumulantCollision);CPPUNIT_TEST_SUITE_END();
         public:
           void setUp()
           {
@@ -699,6 +704,314 @@ namespace hemelb
                                                    allowedError);
             }
           }
+
+          void TestMRTMatchesMomentSpaceCollision()
+          {
+            CheckMRTMatchesMomentSpaceCollision<lb::kernels::momentBasis::DHumieresD3Q15MRTBasis>();
+            CheckMRTMatchesMomentSpaceCollision<lb::kernels::momentBasis::DHumieresD3Q19MRTBasis>();
+          }
+
+          void TestEntropicAlphaSolver()
+          {
+            typedef lb::lattices::D3Q15 Lattice;
+            const unsigned width = lb::kernels::SiteBatch<Lattice>::WIDTH;
+            distribn_t allowedError = 1e-10;
+
+            // A batch of sites far from equilibrium, stored direction-major as
+            // the solver expects, and the Newton-Raphson root for each.
+            distribn_t f[Lattice::NUMVECTORS * width];
+            distribn_t f_eq[Lattice::NUMVECTORS * width];
+            distribn_t expectedAlpha[width];
+            for (unsigned lane = 0; lane < width; ++lane)
+            {
+              distribn_t siteF[Lattice::NUMVECTORS], siteFEq[Lattice::NUMVECTORS];
+              LbTestsHelper::InitialiseAnisotropicTestData<Lattice>(lane, siteF);
+
+              distribn_t density, momentumX, momentumY, momentumZ;
+              Lattice::CalculateDensityAndMomentum(siteF, density, momentumX, momentumY, momentumZ);
+              Lattice::CalculateEntropicFeqAnsumali(density, momentumX, momentumY, momentumZ, siteFEq);
+
+              for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+              {
+                f[direction * width + lane] = siteF[direction];
+                f_eq[direction * width + lane] = siteFEq[direction];
+              }
+
+              lb::HFunction<Lattice> HFunc(siteF, siteFEq);
+              expectedAlpha[lane] = util::NumericalMethods::NewtonRaphson(&HFunc, 2.0, 1.0E-100);
+
+              // One site at a time.
+              distribn_t alpha = 2.0;
+              lb::kernels::EntropicAlphaSolver<Lattice>::Solve(siteF, siteFEq, lbmParams->GetTau(), &alpha);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedAlpha[lane], alpha, allowedError);
+            }
+
+            // The whole batch, starting from the LBGK value and then from the
+            // previous (converged) alpha.
+            distribn_t alpha[width];
+            for (unsigned lane = 0; lane < width; ++lane)
+            {
+              alpha[lane] = 2.0;
+            }
+            for (unsigned pass = 0; pass < 2; ++pass)
+            {
+              lb::kernels::EntropicAlphaSolver<Lattice, width>::Solve(f, f_eq, lbmParams->GetTau(), alpha);
+              for (unsigned lane = 0; lane < width; ++lane)
+              {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedAlpha[lane], alpha[lane], allowedError);
+              }
+            }
+
+            // Near equilibrium alpha is the LBGK value, whatever it was before.
+            distribn_t nearEqmF[Lattice::NUMVECTORS];
+            for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+            {
+              nearEqmF[direction] = f_eq[direction * width] * (direction % 2 == 0 ?
+                1.001 :
+                0.999);
+            }
+            distribn_t nearEqmFEq[Lattice::NUMVECTORS];
+            for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+            {
+              nearEqmFEq[direction] = f_eq[direction * width];
+            }
+            distribn_t nearEqmAlpha = expectedAlpha[0];
+            lb::kernels::EntropicAlphaSolver<Lattice>::Solve(nearEqmF, nearEqmFEq, lbmParams->GetTau(), &nearEqmAlpha);
+            CPPUNIT_ASSERT_EQUAL(2.0, nearEqmAlpha);
+          }
+
+          void TestRegularisedCollision()
+          {
+            typedef lb::lattices::D3Q15 Lattice;
+            typedef lb::kernels::Regularised<Lattice> Kernel;
+            Kernel regularised(initParams);
+            lb::kernels::LBGK<Lattice> lbgk(initParams);
+            distribn_t allowedError = 1e-10;
+
+            const unsigned width = lb::kernels::SiteBatch<Lattice>::WIDTH;
+            distribn_t fOld[width * Lattice::NUMVECTORS];
+            distribn_t expectedPostCollision[width][Lattice::NUMVECTORS];
+
+            for (unsigned site = 0; site < width; ++site)
+            {
+              distribn_t* f_original = &fOld[site * Lattice::NUMVECTORS];
+              LbTestsHelper::InitialiseAnisotropicTestData<Lattice>(site, f_original);
+
+              lb::kernels::HydroVars<Kernel> hydroVars(f_original);
+              regularised.CalculateDensityMomentumFeq(hydroVars, site);
+              regularised.Collide(lbmParams, hydroVars);
+
+              lb::kernels::HydroVars<lb::kernels::LBGK<Lattice> > lbgkHydroVars(f_original);
+              lbgk.CalculateDensityMomentumFeq(lbgkHydroVars, site);
+              lbgk.Collide(lbmParams, lbgkHydroVars);
+
+              // Only the moments above second order differ from LBGK.
+              CheckMomentsUpToSecondOrder<Lattice>(lbgkHydroVars.GetFPostCollision().f,
+                                                   hydroVars.GetFPostCollision().f,
+                                                   true,
+                                                   allowedError);
+
+              // Whose non-equilibrium part is now second-order only, so another collision
+              // is the same as LBGK's.
+              distribn_t f_regular[Lattice::NUMVECTORS];
+              for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+              {
+                f_regular[direction] = hydroVars.GetFPostCollision()[direction];
+                expectedPostCollision[site][direction] = f_regular[direction];
+              }
+              lb::kernels::HydroVars<Kernel> regularHydroVars(f_regular);
+              regularised.CalculateDensityMomentumFeq(regularHydroVars, site);
+              regularised.Collide(lbmParams, regularHydroVars);
+              lb::kernels::HydroVars<lb::kernels::LBGK<Lattice> > regularLbgkHydroVars(f_regular);
+              lbgk.CalculateDensityMomentumFeq(regularLbgkHydroVars, site);
+              lbgk.Collide(lbmParams, regularLbgkHydroVars);
+              for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+              {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(regularLbgkHydroVars.GetFPostCollision()[direction],
+                                             regularHydroVars.GetFPostCollision()[direction],
+                                             allowedError);
+              }
+            }
+
+            // The batch version agrees with the single-site one.
+            lb::kernels::SiteBatch<Lattice> batch;
+            batch.Load(fOld, 0);
+            regularised.CalculateDensityMomentumFeqBatch(batch);
+            regularised.CollideBatch(lbmParams, batch);
+            for (unsigned site = 0; site < width; ++site)
+            {
+              for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+              {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedPostCollision[site][direction],
+                                             batch.fPostCollision[direction][site],
+                                             allowedError);
+              }
+            }
+          }
+
+          void TestCumulantCollision()
+          {
+            typedef lb::lattices::D3Q27 Lattice;
+            typedef lb::kernels::Cumulant<Lattice> Kernel;
+            Kernel cumulant(initParams);
+            lb::kernels::LBGK<Lattice> lbgk(initParams);
+            distribn_t allowedError = 1e-10;
+
+            // The fluid at rest is left alone.
+            distribn_t f_rest[Lattice::NUMVECTORS];
+            for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+            {
+              f_rest[direction] = 1.1 * Lattice::EQMWEIGHTS[direction];
+            }
+            lb::kernels::HydroVars<Kernel> restHydroVars(f_rest);
+            cumulant.CalculateDensityMomentumFeq(restHydroVars, 0);
+            cumulant.Collide(lbmParams, restHydroVars);
+            for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+            {
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(f_rest[direction],
+                                           restHydroVars.GetFPostCollision()[direction],
+                                           allowedError);
+            }
+
+            for (site_t site = 0; site < 4; ++site)
+            {
+              distribn_t f_original[Lattice::NUMVECTORS];
+              LbTestsHelper::InitialiseAnisotropicTestData<Lattice>(site, f_original);
+
+              lb::kernels::HydroVars<Kernel> hydroVars(f_original);
+              cumulant.CalculateDensityMomentumFeq(hydroVars, site);
+              cumulant.Collide(lbmParams, hydroVars);
+
+              lb::kernels::HydroVars<lb::kernels::LBGK<Lattice> > lbgkHydroVars(f_original);
+              lbgk.CalculateDensityMomentumFeq(lbgkHydroVars, site);
+              lbgk.Collide(lbmParams, lbgkHydroVars);
+
+              // Mass, momentum and the deviatoric stress are as LBGK; the trace of the
+              // momentum flux goes straight to equilibrium.
+              CheckMomentsUpToSecondOrder<Lattice>(lbgkHydroVars.GetFPostCollision().f,
+                                                   hydroVars.GetFPostCollision().f,
+                                                   false,
+                                                   allowedError);
+
+              distribn_t trace = 0.0;
+              for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+              {
+                trace += (Lattice::CXD[direction] * Lattice::CXD[direction]
+                    + Lattice::CYD[direction] * Lattice::CYD[direction]
+                    + Lattice::CZD[direction] * Lattice::CZD[direction])
+                    * hydroVars.GetFPostCollision()[direction];
+              }
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(hydroVars.density + hydroVars.momentum.GetMagnitudeSquared()
+                                               / hydroVars.density,
+                                           trace,
+                                           allowedError);
+            }
+          }
+
+        private:
+          /**
+           * Check that two post-collision distributions have the same density, momentum
+           * and momentum flux; if withTrace is false, only the traceless part of the
+           * momentum flux is compared.
+           */
+          template<class Lattice>
+          void CheckMomentsUpToSecondOrder(const distribn_t* expected, const distribn_t* actual,
+                                           bool withTrace, distribn_t allowedError)
+          {
+            distribn_t expectedMoments[10], actualMoments[10];
+            CalculateMomentsUpToSecondOrder<Lattice>(expected, expectedMoments);
+            CalculateMomentsUpToSecondOrder<Lattice>(actual, actualMoments);
+            for (unsigned moment = 0; moment < 10; ++moment)
+            {
+              // The diagonal of the flux, xx, yy and zz, is compared as xx - yy,
+              // xx - zz, and, with the trace, xx.
+              const distribn_t expectedMoment = moment == 5 || moment == 6 ?
+                expectedMoments[4] - expectedMoments[moment] :
+                expectedMoments[moment];
+              const distribn_t actualMoment = moment == 5 || moment == 6 ?
+                actualMoments[4] - actualMoments[moment] :
+                actualMoments[moment];
+              if (moment == 4 && !withTrace)
+              {
+                continue;
+              }
+              std::stringstream message;
+              message << "Moment " << moment;
+              CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE(message.str(), expectedMoment, actualMoment, allowedError);
+            }
+          }
+
+          /**
+           * Density; momentum x, y, z; momentum flux xx, yy, zz, xy, xz, yz.
+           */
+          template<class Lattice>
+          void CalculateMomentsUpToSecondOrder(const distribn_t* f, distribn_t moments[10])
+          {
+            for (unsigned moment = 0; moment < 10; ++moment)
+            {
+              moments[moment] = 0.0;
+            }
+            for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+            {
+              const distribn_t c[3] = { Lattice::CXD[direction], Lattice::CYD[direction],
+                                        Lattice::CZD[direction] };
+              moments[0] += f[direction];
+              moments[1] += c[0] * f[direction];
+              moments[2] += c[1] * f[direction];
+              moments[3] += c[2] * f[direction];
+              moments[4] += c[0] * c[0] * f[direction];
+              moments[5] += c[1] * c[1] * f[direction];
+              moments[6] += c[2] * c[2] * f[direction];
+              moments[7] += c[0] * c[1] * f[direction];
+              moments[8] += c[0] * c[2] * f[direction];
+              moments[9] += c[1] * c[2] * f[direction];
+            }
+          }
+
+          /**
+           * Check the MRT collision, with the basis's own relaxation rates, against
+           * -M^T * (M * M^T)^{-1} * \hat{S} * M * f_neq worked out in moment space.
+           */
+          template<class MomentBasis>
+          void CheckMRTMatchesMomentSpaceCollision()
+          {
+            typedef typename MomentBasis::Lattice Lattice;
+            lb::kernels::MRT<MomentBasis> mrtKernel(initParams);
+
+            std::vector<distribn_t> collisionMatrix;
+            MomentBasis::SetUpCollisionMatrix(collisionMatrix, lbmParams->GetTau());
+
+            for (site_t site_index = 0; site_index < 4; ++site_index)
+            {
+              distribn_t f_original[Lattice::NUMVECTORS];
+              LbTestsHelper::InitialiseAnisotropicTestData<Lattice>(site_index, f_original);
+              lb::kernels::HydroVars<lb::kernels::MRT<MomentBasis> > hydroVars(f_original);
+
+              mrtKernel.CalculateDensityMomentumFeq(hydroVars, site_index);
+              mrtKernel.Collide(lbmParams, hydroVars);
+
+              distribn_t m_neq[MomentBasis::NUM_KINETIC_MOMENTS];
+              MomentBasis::ProjectVelsIntoMomentSpace(hydroVars.GetFNeq().f, m_neq);
+
+              for (Direction direction = 0; direction < Lattice::NUMVECTORS; ++direction)
+              {
+                distribn_t collision = 0.;
+                for (unsigned momentIndex = 0; momentIndex < MomentBasis::NUM_KINETIC_MOMENTS; momentIndex++)
+                {
+                  collision += collisionMatrix[momentIndex]
+                      * MomentBasis::REDUCED_MOMENT_BASIS[momentIndex][direction]
+                      / MomentBasis::BASIS_TIMES_BASIS_TRANSPOSED[momentIndex] * m_neq[momentIndex];
+                }
+
+                std::stringstream message;
+                message << "Post-collision: site " << site_index << " direction " << direction;
+                CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE(message.str(),
+                                                     f_original[direction] - collision,
+                                                     hydroVars.GetFPostCollision()[direction],
+                                                     1e-10);
+              }
+            }
+          }
       };
       CPPUNIT_TEST_SUITE_REGISTRATION ( KernelTests);
     }
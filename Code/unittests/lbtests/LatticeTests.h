@@ -24,7 +24,8 @@ namespace hemelb
           CPPUNIT_TEST_SUITE (LatticeTests);
           CPPUNIT_TEST (TestD3Q15);
           CPPUNIT_TEST (TestD3Q19);
-          CPPUNIT_TEST (TestD3Q27);CPPUNIT_TEST_SUITE_END();
+          CPPUNIT_TEST (TestD3Q27);
+          CPPUNIT_TEST (TestSimdLevelsMatchBaseline);CPPUNIT_TEST_SUITE_END();
 
         public:
 
@@ -59,7 +60,69 @@ namespace hemelb
             TestLattice<lb::lattices::D3Q27>();
           }
 
+          void TestSimdLevelsMatchBaseline()
+          {
+            const lb::lattices::SimdLevel original = lb::lattices::GetSimdLevel();
+            // Levels the CPU can't run are reduced to one it can, so this is
+            // always safe; it just tests less on older machines.
+            for (int level = lb::lattices::SIMD_AVX2; level <= lb::lattices::SIMD_AVX512; ++level)
+            {
+              TestSimdLevelMatchesBaseline<lb::lattices::D3Q15>(lb::lattices::SimdLevel(level));
+              TestSimdLevelMatchesBaseline<lb::lattices::D3Q19>(lb::lattices::SimdLevel(level));
+              TestSimdLevelMatchesBaseline<lb::lattices::D3Q27>(lb::lattices::SimdLevel(level));
+            }
+            lb::lattices::SetSimdLevel(original);
+          }
+
         private:
+          template<class LatticeType>
+          void TestSimdLevelMatchesBaseline(lb::lattices::SimdLevel level)
+          {
+            const Direction Q = LatticeType::NUMVECTORS;
+            distribn_t f[Q], expectedFeq[Q], fEq[Q], expectedFNeq[Q], fNeq[Q];
+            distribn_t expectedDensity, expectedMomentum[3], density, momentum[3];
+            LbTestsHelper::InitialiseAnisotropicTestData<LatticeType>(3, f);
+
+            lb::lattices::SetSimdLevel(lb::lattices::SIMD_BASELINE);
+            LatticeType::CalculateDensityAndMomentum(f,
+                                                     expectedDensity,
+                                                     expectedMomentum[0],
+                                                     expectedMomentum[1],
+                                                     expectedMomentum[2]);
+            LatticeType::CalculateFeq(expectedDensity,
+                                      expectedMomentum[0],
+                                      expectedMomentum[1],
+                                      expectedMomentum[2],
+                                      expectedFeq);
+            LatticeType::CalculateFNeq(f, expectedFeq, expectedFNeq);
+            util::Matrix3D expectedPi = LatticeType::CalculatePiTensor(expectedFNeq);
+
+            lb::lattices::SetSimdLevel(level);
+            LatticeType::CalculateDensityAndMomentum(f, density, momentum[0], momentum[1], momentum[2]);
+            LatticeType::CalculateFeq(expectedDensity,
+                                      expectedMomentum[0],
+                                      expectedMomentum[1],
+                                      expectedMomentum[2],
+                                      fEq);
+            LatticeType::CalculateFNeq(f, expectedFeq, fNeq);
+            util::Matrix3D pi = LatticeType::CalculatePiTensor(expectedFNeq);
+
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedDensity, density, epsilon);
+            for (unsigned i = 0; i < 3; ++i)
+            {
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedMomentum[i], momentum[i], epsilon);
+              for (unsigned j = 0; j < 3; ++j)
+              {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedPi[i][j], pi[i][j], epsilon);
+              }
+            }
+            for (Direction direction = 0; direction < Q; ++direction)
+            {
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedFeq[direction], fEq[direction], epsilon);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedFNeq[direction], fNeq[direction], epsilon);
+            }
+          }
+
           template<class LatticeType>
           void TestLattice()
           {
@@ -0,0 +1,110 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_UNITTESTS_LBTESTS_STREAMERREGISTRYTESTS_H
+#define HEMELB_UNITTESTS_LBTESTS_STREAMERREGISTRYTESTS_H
+
+#include <cppunit/TestFixture.h>
+
+#include "lb/StreamerRegistry.h"
+#include "lb/lattices/Lattices.h"
+#include "lb/streamers/Streamers.h"
+
+#include "unittests/helpers/FourCubeBasedTestFixture.h"
+#include "unittests/lbtests/LbTestsHelper.h"
+
+namespace hemelb
+{
+  namespace unittests
+  {
+    namespace lbtests
+    {
+      /**
+       * Check that the compiled-in streamers can be found by name and that
+       * going through the run-time interface gives the same answers as using
+       * the streamer type directly.
+       */
+      class StreamerRegistryTests : public helpers::FourCubeBasedTestFixture
+      {
+          CPPUNIT_TEST_SUITE ( StreamerRegistryTests);
+          CPPUNIT_TEST ( TestDefaultIsRegistered);
+          CPPUNIT_TEST ( TestUnknownCombinationThrows);
+          CPPUNIT_TEST ( TestConcreteStreamerMatchesDirect);
+          CPPUNIT_TEST_SUITE_END();
+        public:
+          typedef lb::collisions::Normal<lb::kernels::LBGK<lb::lattices::D3Q15> > CollisionType;
+          typedef lb::streamers::NashZerothOrderPressureIoletSBB<CollisionType>::Type StreamerType;
+          typedef lb::StreamerRegistry<lb::lattices::HEMELB_LATTICE> Registry;
+
+          void setUp()
+          {
+            FourCubeBasedTestFixture::setUp();
+            propertyCache = new lb::MacroscopicPropertyCache(*simState, *latDat);
+          }
+
+          void tearDown()
+          {
+            delete propertyCache;
+            FourCubeBasedTestFixture::tearDown();
+          }
+
+          void TestDefaultIsRegistered()
+          {
+            // With nothing in the XML, the configuration asks for the
+            // compile-time choice, which is always compiled in.
+            CPPUNIT_ASSERT(Registry::IsRegistered(simConfig->GetKernelName(),
+                                                  simConfig->GetStreamerName()));
+          }
+
+          void TestUnknownCombinationThrows()
+          {
+            CPPUNIT_ASSERT(!Registry::IsRegistered("NOSUCHKERNEL", simConfig->GetStreamerName()));
+            CPPUNIT_ASSERT_THROW(Registry::Create("NOSUCHKERNEL",
+                                                  simConfig->GetStreamerName(),
+                                                  initParams),
+                                 Exception);
+          }
+
+          void TestConcreteStreamerMatchesDirect()
+          {
+            lb::iolets::BoundaryValues inletBoundary(geometry::INLET_TYPE,
+                                                     latDat,
+                                                     simConfig->GetInlets(),
+                                                     simState,
+                                                     Comms(),
+                                                     *unitConverter);
+            initParams.boundaryObject = &inletBoundary;
+
+            const site_t siteCount = latDat->GetLocalFluidSiteCount();
+            const site_t distCount = siteCount * lb::lattices::D3Q15::NUMVECTORS;
+
+            LbTestsHelper::InitialiseAnisotropicTestData<lb::lattices::D3Q15>(latDat);
+            StreamerType direct(initParams);
+            direct.StreamAndCollide<false> (0, siteCount, lbmParams, latDat, *propertyCache);
+            direct.PostStep<false> (0, siteCount, lbmParams, latDat, *propertyCache);
+            std::vector<distribn_t> expected(latDat->GetFNew(0), latDat->GetFNew(0) + distCount);
+
+            LbTestsHelper::InitialiseAnisotropicTestData<lb::lattices::D3Q15>(latDat);
+            lb::streamers::ConcreteStreamer<StreamerType> wrapped(initParams);
+            lb::streamers::AbstractStreamer& streamer = wrapped;
+            streamer.StreamAndCollide(false, 0, siteCount, lbmParams, latDat, *propertyCache);
+            streamer.PostStep(false, 0, siteCount, lbmParams, latDat, *propertyCache);
+
+            for (site_t i = 0; i < distCount; ++i)
+            {
+              CPPUNIT_ASSERT_EQUAL(expected[i], latDat->GetFNew(0)[i]);
+            }
+          }
+
+        private:
+          lb::MacroscopicPropertyCache* propertyCache;
+      };
+      CPPUNIT_TEST_SUITE_REGISTRATION ( StreamerRegistryTests);
+    }
+  }
+}
+
+#endif /* HEMELB_UNITTESTS_LBTESTS_STREAMERREGISTRYTESTS_H */
@@ -37,7 +37,11 @@ namespace hemelb
           CPPUNIT_TEST ( TestBouzidiFirdaousLallemand);
           CPPUNIT_TEST ( TestGuoZhengShi);
           CPPUNIT_TEST ( TestJunkYangEquivalentToBounceBack);
+          CPPUNIT_TEST ( TestJunkYangEmptyRange);
           CPPUNIT_TEST ( TestNashZerothOrderPressureBB);
+          CPPUNIT_TEST ( TestSiteBatchesMatchSiteBySite);
+          CPPUNIT_TEST ( TestPropertyCacheRefresh);
+          CPPUNIT_TEST ( TestInPlaceStreamingMatchesTwoLattice);
           CPPUNIT_TEST_SUITE_END();
         public:
           typedef lb::collisions::Normal<lb::kernels::LBGK<lb::lattices::D3Q15>> CollisionType;
@@ -597,6 +601,41 @@ namespace hemelb
             }
           }
 
+          void TestJunkYangEmptyRange()
+          {
+            lb::iolets::BoundaryValues inletBoundary(geometry::INLET_TYPE,
+                                                     latDat,
+                                                     simConfig->GetInlets(),
+                                                     simState,
+                                                     Comms(),
+                                                     *unitConverter);
+
+            initParams.boundaryObject = &inletBoundary;
+
+            LbTestsHelper::InitialiseAnisotropicTestData<lb::lattices::D3Q15>(latDat);
+            LbTestsHelper::SetWallAndIoletDistances<lb::lattices::D3Q15>(*latDat, 0.5);
+
+            site_t firstWallSite = latDat->GetMidDomainCollisionCount(0);
+            site_t endWallSite = firstWallSite + latDat->GetMidDomainCollisionCount(1);
+            initParams.siteRanges.push_back(std::pair<site_t, site_t>(firstWallSite, endWallSite));
+            lb::streamers::NashZerothOrderPressureIoletJY<CollisionType>::Type junkYang(initParams);
+
+            const site_t fCount = latDat->GetLocalFluidSiteCount() * lb::lattices::D3Q15::NUMVECTORS;
+            std::vector<distribn_t> fNewBefore(latDat->GetFNew(0), latDat->GetFNew(0) + fCount);
+
+            // LBM runs every streamer on every range, including empty ones that start just
+            // past the end of the streamer's sites.
+            junkYang.StreamAndCollide<false> (endWallSite, 0, lbmParams, latDat, *propertyCache);
+            junkYang.PostStep<false> (endWallSite, 0, lbmParams, latDat, *propertyCache);
+
+            for (site_t index = 0; index < fCount; ++index)
+            {
+              CPPUNIT_ASSERT_EQUAL_MESSAGE("Junk&Yang on an empty range",
+                                           fNewBefore[index],
+                                           latDat->GetFNew(0)[index]);
+            }
+          }
+
           void TestNashZerothOrderPressureBB()
           {
             lb::iolets::BoundaryValues inletBoundary(geometry::INLET_TYPE,
@@ -727,7 +766,271 @@ namespace hemelb
             }
           }
 
+          void TestSiteBatchesMatchSiteBySite()
+          {
+            // Make two batches' worth of sites bulk so that the batched path is
+            // taken for them; the rest of the cube still goes site by site.
+            for (site_t siteIndex = 8; siteIndex < 24; ++siteIndex)
+            {
+              geometry::SiteData& siteData = latDat->GetSite(siteIndex).GetSiteData();
+              siteData.GetWallIntersectionData() = 0;
+              siteData.GetIoletIntersectionData() = 0;
+            }
+
+            CheckSiteBatchesMatchSiteBySite<CollisionType> ();
+            CheckSiteBatchesMatchSiteBySite<lb::collisions::Normal<lb::kernels::TRT<lb::lattices::D3Q15> > > ();
+            CheckSiteBatchesMatchSiteBySite<lb::collisions::Normal<lb::kernels::EntropicAnsumali<lb::lattices::D3Q15> > > ();
+          }
+
+          void TestPropertyCacheRefresh()
+          {
+            lb::iolets::BoundaryValues inletBoundary(geometry::INLET_TYPE,
+                                                     latDat,
+                                                     simConfig->GetInlets(),
+                                                     simState,
+                                                     Comms(),
+                                                     *unitConverter);
+            initParams.boundaryObject = &inletBoundary;
+
+            LbTestsHelper::InitialiseAnisotropicTestData<lb::lattices::D3Q15>(latDat);
+            lb::streamers::NashZerothOrderPressureIoletSBB<CollisionType>::Type streamer(initParams);
+
+            // Every property, so every stress is derived from the same Pi.
+            propertyCache->densityCache.SetRefreshFlag();
+            propertyCache->velocityCache.SetRefreshFlag();
+            propertyCache->wallShearStressMagnitudeCache.SetRefreshFlag();
+            propertyCache->vonMisesStressCache.SetRefreshFlag();
+            propertyCache->shearRateCache.SetRefreshFlag();
+            propertyCache->stressTensorCache.SetRefreshFlag();
+            propertyCache->tractionCache.SetRefreshFlag();
+            propertyCache->tangentialProjectionTractionCache.SetRefreshFlag();
+            CPPUNIT_ASSERT_EQUAL(lb::MacroscopicPropertyCache::ALL_PROPERTIES,
+                                 propertyCache->GetRequiredProperties());
+
+            streamer.StreamAndCollide<false> (0,
+                                              latDat->GetLocalFluidSiteCount(),
+                                              lbmParams,
+                                              latDat,
+                                              *propertyCache);
+            CheckPropertyCache(lb::MacroscopicPropertyCache::ALL_PROPERTIES);
+
+            // Just the density, which is filled in without looking at the other flags.
+            propertyCache->ResetRequirements();
+            propertyCache->densityCache.SetRefreshFlag();
+            LbTestsHelper::InitialiseAnisotropicTestData<lb::lattices::D3Q15>(latDat);
+            streamer.StreamAndCollide<false> (0,
+                                              latDat->GetLocalFluidSiteCount(),
+                                              lbmParams,
+                                              latDat,
+                                              *propertyCache);
+            CheckPropertyCache(lb::MacroscopicPropertyCache::DENSITY);
+
+            propertyCache->ResetRequirements();
+          }
+
+          void TestInPlaceStreamingMatchesTwoLattice()
+          {
+            typedef lb::lattices::D3Q15 Lattice;
+
+            lb::iolets::BoundaryValues inletBoundary(geometry::INLET_TYPE,
+                                                     latDat,
+                                                     simConfig->GetInlets(),
+                                                     simState,
+                                                     Comms(),
+                                                     *unitConverter);
+            initParams.boundaryObject = &inletBoundary;
+
+            // Big enough to have runs of bulk sites that are batched.
+            const site_t sitesPerBlockUnit = 12;
+            FourCubeLatticeData* twoLattice = FourCubeLatticeData::Create(Comms(), sitesPerBlockUnit);
+            FourCubeLatticeData* inPlace = FourCubeLatticeData::Create(Comms(), sitesPerBlockUnit, 1, true);
+            CPPUNIT_ASSERT(inPlace->IsInPlaceStreaming());
+            CPPUNIT_ASSERT(inPlace->GetFOld(0) == inPlace->GetFNew(0));
+
+            const site_t siteCount = twoLattice->GetLocalFluidSiteCount();
+            lb::MacroscopicPropertyCache cache(*simState, *twoLattice);
+            lb::streamers::NashZerothOrderPressureIoletSBB<CollisionType>::Type streamer(initParams);
+
+            LbTestsHelper::InitialiseAnisotropicTestData<Lattice>(twoLattice);
+            LbTestsHelper::InitialiseAnisotropicTestData<Lattice>(inPlace);
+
+            for (unsigned step = 1; step <= 4; ++step)
+            {
+              // The middle two steps (one odd, one even) fill in the cache, so
+              // go site by site; the others are batched.
+              if (step == 2 || step == 3)
+              {
+                cache.densityCache.SetRefreshFlag();
+              }
+
+              streamer.StreamAndCollide<false> (0, siteCount, lbmParams, twoLattice, cache);
+              twoLattice->SwapOldAndNew();
+              streamer.StreamAndCollide<false> (0, siteCount, lbmParams, inPlace, cache);
+              inPlace->SwapOldAndNew();
+
+              cache.densityCache.UnsetRefreshFlag();
+
+              // After an odd step, the in-place distributions are laid out as usual.
+              if (step % 2 == 0)
+              {
+                CPPUNIT_ASSERT(!inPlace->IsOddInPlaceStep());
+                for (site_t i = 0; i < siteCount * (site_t) Lattice::NUMVECTORS; ++i)
+                {
+                  CPPUNIT_ASSERT_DOUBLES_EQUAL(*twoLattice->GetFOld(i), *inPlace->GetFOld(i), allowedError);
+                }
+              }
+            }
+
+            delete twoLattice;
+            delete inPlace;
+          }
+
         private:
+          /**
+           * Compare the given properties in the cache with those calculated
+           * directly from each site's anisotropic test data.
+           */
+          void CheckPropertyCache(const unsigned properties)
+          {
+            typedef lb::lattices::D3Q15 Lattice;
+
+            for (site_t siteIndex = 0; siteIndex < latDat->GetLocalFluidSiteCount(); ++siteIndex)
+            {
+              const geometry::Site<geometry::LatticeData> site = latDat->GetSite(siteIndex);
+
+              distribn_t fOld[Lattice::NUMVECTORS];
+              LbTestsHelper::InitialiseAnisotropicTestData<Lattice>(siteIndex, fOld);
+              lb::kernels::HydroVars<lb::kernels::LBGK<Lattice> > hydroVars(fOld);
+              hydroVars.tau = lbmParams->GetTau();
+              normalCollision->CalculatePreCollision(hydroVars, site);
+              const distribn_t* fNeq = hydroVars.GetFNeq().f;
+
+              if (properties & lb::MacroscopicPropertyCache::DENSITY)
+              {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(hydroVars.density,
+                                             propertyCache->densityCache.Get(siteIndex),
+                                             allowedError);
+              }
+
+              if (properties & lb::MacroscopicPropertyCache::VELOCITY)
+              {
+                for (unsigned i = 0; i < 3; ++i)
+                {
+                  CPPUNIT_ASSERT_DOUBLES_EQUAL(hydroVars.velocity[i],
+                                               propertyCache->velocityCache.Get(siteIndex)[i],
+                                               allowedError);
+                }
+              }
+
+              if (properties & lb::MacroscopicPropertyCache::WALL_SHEAR_STRESS_MAGNITUDE)
+              {
+                distribn_t stress = NO_VALUE;
+                if (site.IsWall())
+                {
+                  Lattice::CalculateWallShearStressMagnitude(hydroVars.density,
+                                                             fNeq,
+                                                             site.GetWallNormal(),
+                                                             stress,
+                                                             lbmParams->GetStressParameter());
+                }
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(stress,
+                                             propertyCache->wallShearStressMagnitudeCache.Get(siteIndex),
+                                             allowedError);
+              }
+
+              if (properties & lb::MacroscopicPropertyCache::VON_MISES_STRESS)
+              {
+                distribn_t stress;
+                Lattice::CalculateVonMisesStress(fNeq, stress, lbmParams->GetStressParameter());
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(stress,
+                                             propertyCache->vonMisesStressCache.Get(siteIndex),
+                                             allowedError);
+              }
+
+              if (properties & lb::MacroscopicPropertyCache::SHEAR_RATE)
+              {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(Lattice::CalculateShearRate(hydroVars.tau, fNeq, hydroVars.density),
+                                             propertyCache->shearRateCache.Get(siteIndex),
+                                             allowedError);
+              }
+
+              if (properties & lb::MacroscopicPropertyCache::STRESS_TENSOR)
+              {
+                util::Matrix3D stressTensor;
+                Lattice::CalculateStressTensor(hydroVars.density, hydroVars.tau, fNeq, stressTensor);
+                const util::Matrix3D& cached = propertyCache->stressTensorCache.Get(siteIndex);
+                for (unsigned i = 0; i < 3; ++i)
+                {
+                  for (unsigned j = 0; j < 3; ++j)
+                  {
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL(stressTensor[i][j], cached[i][j], allowedError);
+                  }
+                }
+              }
+
+              util::Vector3D<LatticeStress> traction(0), tangentialTraction(0);
+              if (site.IsWall())
+              {
+                Lattice::CalculateTractionOnAPoint(hydroVars.density,
+                                                   hydroVars.tau,
+                                                   fNeq,
+                                                   site.GetWallNormal(),
+                                                   traction);
+                Lattice::CalculateTangentialProjectionTraction(hydroVars.density,
+                                                               hydroVars.tau,
+                                                               fNeq,
+                                                               site.GetWallNormal(),
+                                                               tangentialTraction);
+              }
+              for (unsigned i = 0; i < 3; ++i)
+              {
+                if (properties & lb::MacroscopicPropertyCache::TRACTION)
+                {
+                  CPPUNIT_ASSERT_DOUBLES_EQUAL(traction[i],
+                                               propertyCache->tractionCache.Get(siteIndex)[i],
+                                               allowedError);
+                }
+                if (properties & lb::MacroscopicPropertyCache::TANGENTIAL_PROJECTION_TRACTION)
+                {
+                  CPPUNIT_ASSERT_DOUBLES_EQUAL(tangentialTraction[i],
+                                               propertyCache->tangentialProjectionTractionCache.Get(siteIndex)[i],
+                                               allowedError);
+                }
+              }
+            }
+          }
+
+          template<typename Collision>
+          void CheckSiteBatchesMatchSiteBySite()
+          {
+            lb::iolets::BoundaryValues inletBoundary(geometry::INLET_TYPE,
+                                                     latDat,
+                                                     simConfig->GetInlets(),
+                                                     simState,
+                                                     Comms(),
+                                                     *unitConverter);
+            initParams.boundaryObject = &inletBoundary;
+
+            const site_t siteCount = latDat->GetLocalFluidSiteCount();
+            const site_t distCount = siteCount * lb::lattices::D3Q15::NUMVECTORS;
+            typename lb::streamers::NashZerothOrderPressureIoletSBB<Collision>::Type streamer(initParams);
+
+            // Nothing needs the property cache, so bulk sites are batched.
+            LbTestsHelper::InitialiseAnisotropicTestData<lb::lattices::D3Q15>(latDat);
+            streamer.template StreamAndCollide<false> (0, siteCount, lbmParams, latDat, *propertyCache);
+            std::vector<distribn_t> batched(latDat->GetFNew(0), latDat->GetFNew(0) + distCount);
+
+            // Filling the cache forces every site through the per-site path.
+            propertyCache->densityCache.SetRefreshFlag();
+            streamer.template StreamAndCollide<false> (0, siteCount, lbmParams, latDat, *propertyCache);
+            propertyCache->densityCache.UnsetRefreshFlag();
+
+            for (site_t i = 0; i < distCount; ++i)
+            {
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(latDat->GetFNew(0)[i], batched[i], allowedError);
+            }
+          }
+
           lb::MacroscopicPropertyCache* propertyCache;
           CollisionType* normalCollision;
       };
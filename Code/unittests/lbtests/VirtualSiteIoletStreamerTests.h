@@ -292,16 +292,15 @@ namespace hemelb
                 //                site_t localIdx = latDat->GetLocalContiguousIdFromGlobalNoncontiguousId(globalIdx);
                 //                geometry::Site < geometry::LatticeData > site = latDat->GetSite(localIdx);
 
-                RSHV::Map::iterator hvPtr = extra->hydroVarsCache.find(globalIdx);
-                CPPUNIT_ASSERT(hvPtr != extra->hydroVarsCache.end());
+                CPPUNIT_ASSERT(extra->FindHydroVars(globalIdx) >= 0);
               }
             }
 
             // And the reverse is true: every cache entry should be a site at the outlet plane
-            for (RSHV::Map::iterator hvPtr = extra->hydroVarsCache.begin(); hvPtr
+            for (std::vector<RSHV>::iterator hvPtr = extra->hydroVarsCache.begin(); hvPtr
                 != extra->hydroVarsCache.end(); ++hvPtr)
             {
-              site_t globalIdx = hvPtr->first;
+              site_t globalIdx = hvPtr->globalIdx;
               LatticeVector pos;
               latDat->GetGlobalCoordsFromGlobalNoncontiguousSiteId(globalIdx, pos);
               CPPUNIT_ASSERT(hemelb::util::NumericalFunctions::IsInRange<LatticeCoordinate>(pos.x,
@@ -393,11 +392,11 @@ namespace hemelb
             InOutLetCosine* inlet = GetIolet(inletBoundary);
             VSExtra<Lattice> * inExtra = dynamic_cast<VSExtra<Lattice>*> (inlet->GetExtraData());
 
-            for (VirtualSite::Map::iterator vsIt = inExtra->vSites.begin(); vsIt
+            for (std::vector<VirtualSite>::iterator vsIt = inExtra->vSites.begin(); vsIt
                 != inExtra->vSites.end(); ++vsIt)
             {
-              site_t vSiteGlobalIdx = vsIt->first;
-              VirtualSite& vSite = vsIt->second;
+              VirtualSite& vSite = *vsIt;
+              site_t vSiteGlobalIdx = vSite.hv.globalIdx;
 
               CPPUNIT_ASSERT_EQUAL(LatticeTimeStep(1), vSite.hv.t);
               CPPUNIT_ASSERT_DOUBLES_EQUAL(LatticeDensity(1.045), vSite.hv.rho, allowedError);
@@ -413,11 +412,11 @@ namespace hemelb
             InOutLetCosine* outlet = GetIolet(outletBoundary);
             VSExtra<Lattice> * outExtra = dynamic_cast<VSExtra<Lattice>*> (outlet->GetExtraData());
 
-            for (VirtualSite::Map::iterator vsIt = outExtra->vSites.begin(); vsIt
+            for (std::vector<VirtualSite>::iterator vsIt = outExtra->vSites.begin(); vsIt
                 != outExtra->vSites.end(); ++vsIt)
             {
-              site_t vSiteGlobalIdx = vsIt->first;
-              VirtualSite& vSite = vsIt->second;
+              VirtualSite& vSite = *vsIt;
+              site_t vSiteGlobalIdx = vSite.hv.globalIdx;
 
               CPPUNIT_ASSERT_EQUAL(LatticeTimeStep(1), vSite.hv.t);
               CPPUNIT_ASSERT_DOUBLES_EQUAL(LatticeDensity(0.995), vSite.hv.rho, allowedError);
@@ -440,13 +439,13 @@ namespace hemelb
           {
             VSExtra<Lattice> * extra =
                 dynamic_cast<VSExtra<Lattice>*> (iolets->GetLocalIolet(0)->GetExtraData());
-            for (RSHV::Map::iterator hvPtr = extra->hydroVarsCache.begin(); hvPtr
+            for (std::vector<RSHV>::iterator hvPtr = extra->hydroVarsCache.begin(); hvPtr
                 != extra->hydroVarsCache.end(); ++hvPtr)
             {
-              site_t siteGlobalIdx = hvPtr->first;
+              RSHV& hv = *hvPtr;
+              site_t siteGlobalIdx = hv.globalIdx;
               LatticeVector sitePos;
               latDat->GetGlobalCoordsFromGlobalNoncontiguousSiteId(siteGlobalIdx, sitePos);
-              RSHV& hv = hvPtr->second;
               CPPUNIT_ASSERT_EQUAL(expectedT, hv.t);
               CPPUNIT_ASSERT_DOUBLES_EQUAL(GetDensity(sitePos), hv.rho, allowedError);
               LatticeVelocity u = GetVelocity(sitePos);
@@ -461,12 +460,12 @@ namespace hemelb
           {
             site_t expectedGlobalIdx =
                 latDat->GetGlobalNoncontiguousSiteIdFromGlobalCoords(expectedPt);
-            RSHV::Map::iterator hvPtr = extra.hydroVarsCache.find(expectedGlobalIdx);
+            site_t hvIdx = extra.FindHydroVars(expectedGlobalIdx);
 
-            CPPUNIT_ASSERT(hvPtr != extra.hydroVarsCache.end());
+            CPPUNIT_ASSERT(hvIdx >= 0);
             for (unsigned i = 0; i < 3; ++i)
               CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedIoletPos[i],
-                                           hvPtr->second.posIolet[i],
+                                           extra.hydroVarsCache[hvIdx].posIolet[i],
                                            allowedError);
 
           }
@@ -34,8 +34,8 @@ namespace hemelb
               Init();
             }
           protected:
-            virtual void CheckIoletMatchesCMake(const io::xml::Element& ioletEl,
-                                                const std::string& requiredBC)
+            virtual void CheckIoletBoundary(const io::xml::Element& ioletEl,
+                                            const std::string& requiredBC)
             {
 
             }
@@ -10,6 +10,7 @@
 #include "unittests/lbtests/KernelTests.h"
 #include "unittests/lbtests/CollisionTests.h"
 #include "unittests/lbtests/StreamerTests.h"
+#include "unittests/lbtests/StreamerRegistryTests.h"
 #include "unittests/lbtests/RheologyModelTests.h"
 #include "unittests/lbtests/IncompressibilityCheckerTests.h"
 #include "unittests/lbtests/LatticeTests.h"
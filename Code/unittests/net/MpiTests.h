@@ -7,6 +7,7 @@
 #ifndef HEMELB_UNITTESTS_NET_MPITESTS_H
 #define HEMELB_UNITTESTS_NET_MPITESTS_H
 
+#include <algorithm>
 #include <cppunit/TestFixture.h>
 #include "net/mpi.h"
 
@@ -27,6 +28,11 @@ namespace hemelb
         public:
         CPPUNIT_TEST_SUITE (MpiTests);
         CPPUNIT_TEST (TestMpiComm);
+        CPPUNIT_TEST (TestExclusiveScan);
+        CPPUNIT_TEST (TestSplit);
+        CPPUNIT_TEST (TestGatherVector);
+        CPPUNIT_TEST (TestGatherV);
+        CPPUNIT_TEST (TestAllToAllV);
         CPPUNIT_TEST_SUITE_END();
 
           void TestMpiComm()
@@ -57,6 +63,106 @@ namespace hemelb
               CPPUNIT_ASSERT(commWorld2 != commWorld);
             }
           }
+
+          void TestExclusiveScan()
+          {
+            MpiCommunicator commWorld = MpiCommunicator::World();
+
+            // Every rank contributes the same, so each gets that times its rank.
+            CPPUNIT_ASSERT_EQUAL(uint64_t(3 * commWorld.Rank()),
+                                 commWorld.ExclusiveScan(uint64_t(3), MPI_SUM));
+
+            std::vector<uint64_t> vals(2);
+            vals[0] = 1;
+            vals[1] = 5;
+            std::vector<uint64_t> scanned = commWorld.ExclusiveScan(vals, MPI_SUM);
+            CPPUNIT_ASSERT_EQUAL(size_t(2), scanned.size());
+            CPPUNIT_ASSERT_EQUAL(uint64_t(commWorld.Rank()), scanned[0]);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(5 * commWorld.Rank()), scanned[1]);
+          }
+
+          void TestSplit()
+          {
+            MpiCommunicator commWorld = MpiCommunicator::World();
+
+            // Pairs of neighbouring ranks, the lower first.
+            MpiCommunicator commPair = commWorld.Split(commWorld.Rank() / 2, commWorld.Rank());
+            CPPUNIT_ASSERT(commPair);
+            CPPUNIT_ASSERT(commPair != commWorld);
+            CPPUNIT_ASSERT_EQUAL(commWorld.Rank() % 2, commPair.Rank());
+            CPPUNIT_ASSERT_EQUAL(std::min(2, commWorld.Size() - 2 * (commWorld.Rank() / 2)),
+                                 commPair.Size());
+          }
+
+          void TestGatherVector()
+          {
+            MpiCommunicator commWorld = MpiCommunicator::World();
+
+            // Each rank has its rank and its rank's square.
+            std::vector<int> vals(2, commWorld.Rank());
+            vals[1] *= commWorld.Rank();
+            std::vector<int> gathered = commWorld.Gather(vals, 0);
+
+            if (commWorld.Rank() != 0)
+            {
+              CPPUNIT_ASSERT(gathered.empty());
+              return;
+            }
+            CPPUNIT_ASSERT_EQUAL(size_t(2 * commWorld.Size()), gathered.size());
+            for (int rank = 0; rank < commWorld.Size(); ++rank)
+            {
+              CPPUNIT_ASSERT_EQUAL(rank, gathered[2 * rank]);
+              CPPUNIT_ASSERT_EQUAL(rank * rank, gathered[2 * rank + 1]);
+            }
+          }
+
+          void TestGatherV()
+          {
+            MpiCommunicator commWorld = MpiCommunicator::World();
+
+            // Each rank has as many values as its rank, all equal to it, so rank 0
+            // has none.
+            std::vector<int> vals(commWorld.Rank(), commWorld.Rank());
+            std::vector<int> gathered = commWorld.GatherV(vals, 0);
+
+            if (commWorld.Rank() != 0)
+            {
+              CPPUNIT_ASSERT(gathered.empty());
+              return;
+            }
+            CPPUNIT_ASSERT_EQUAL(size_t(commWorld.Size() * (commWorld.Size() - 1) / 2),
+                                 gathered.size());
+            size_t index = 0;
+            for (int rank = 0; rank < commWorld.Size(); ++rank)
+            {
+              for (int value = 0; value < rank; ++value, ++index)
+              {
+                CPPUNIT_ASSERT_EQUAL(rank, gathered[index]);
+              }
+            }
+          }
+
+          void TestAllToAllV()
+          {
+            MpiCommunicator commWorld = MpiCommunicator::World();
+
+            // Each rank sends each as many copies of its own rank as the receiver's.
+            std::vector<int> sendCounts(commWorld.Size()), receiveCounts(commWorld.Size());
+            std::vector<int> vals;
+            for (int rank = 0; rank < commWorld.Size(); ++rank)
+            {
+              sendCounts[rank] = rank;
+              receiveCounts[rank] = commWorld.Rank();
+              vals.insert(vals.end(), rank, commWorld.Rank());
+            }
+            std::vector<int> received = commWorld.AllToAllV(vals, sendCounts, receiveCounts);
+
+            CPPUNIT_ASSERT_EQUAL(size_t(commWorld.Rank() * commWorld.Size()), received.size());
+            for (size_t index = 0; index < received.size(); ++index)
+            {
+              CPPUNIT_ASSERT_EQUAL(int(index / commWorld.Rank()), received[index]);
+            }
+          }
       };
       CPPUNIT_TEST_SUITE_REGISTRATION (MpiTests);
     }
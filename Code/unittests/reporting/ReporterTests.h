@@ -109,6 +109,7 @@ namespace hemelb
             AssertValue("64", "SITES");
             AssertValue("1", "BLOCKS");
             AssertValue("216", "SITESPERBLOCK");
+            AssertValue("10.66", "STREAMINGDISTANCE");
           }
 
         private:
@@ -0,0 +1,95 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_UNITTESTS_UTIL_HALFPRECISIONTESTS_H
+#define HEMELB_UNITTESTS_UTIL_HALFPRECISIONTESTS_H
+
+#include <cmath>
+#include <limits>
+#include <cppunit/TestFixture.h>
+#include "util/HalfPrecision.h"
+
+namespace hemelb
+{
+  namespace unittests
+  {
+    namespace util
+    {
+      class HalfPrecisionTests : public CppUnit::TestFixture
+      {
+          CPPUNIT_TEST_SUITE( HalfPrecisionTests);
+          CPPUNIT_TEST( TestKnownValues);
+          CPPUNIT_TEST( TestRounding);
+          CPPUNIT_TEST( TestRoundTrip);CPPUNIT_TEST_SUITE_END();
+
+        public:
+          void TestKnownValues()
+          {
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x0000), hemelb::util::FloatToHalf(0.0f));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x8000), hemelb::util::FloatToHalf(-0.0f));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x3c00), hemelb::util::FloatToHalf(1.0f));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0xc000), hemelb::util::FloatToHalf(-2.0f));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x3555), hemelb::util::FloatToHalf(1.0f / 3.0f));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x7bff), hemelb::util::FloatToHalf(65504.0f));
+            // The smallest subnormal and normal numbers.
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x0001), hemelb::util::FloatToHalf(std::ldexp(1.0f, -24)));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x0400), hemelb::util::FloatToHalf(std::ldexp(1.0f, -14)));
+
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x7c00), hemelb::util::FloatToHalf(1e6f));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0xfc00),
+                                 hemelb::util::FloatToHalf(-std::numeric_limits<float>::infinity()));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x7e00),
+                                 hemelb::util::FloatToHalf(std::numeric_limits<float>::quiet_NaN()));
+            CPPUNIT_ASSERT(std::isnan(hemelb::util::HalfToFloat(0x7e00)));
+
+            CPPUNIT_ASSERT_EQUAL(1.0f, hemelb::util::HalfToFloat(0x3c00));
+            CPPUNIT_ASSERT_EQUAL(-2.0f, hemelb::util::HalfToFloat(0xc000));
+            CPPUNIT_ASSERT_EQUAL(std::ldexp(1.0f, -24), hemelb::util::HalfToFloat(0x0001));
+            CPPUNIT_ASSERT_EQUAL(std::numeric_limits<float>::infinity(), hemelb::util::HalfToFloat(0x7c00));
+          }
+
+          void TestRounding()
+          {
+            // Halfway between 1 and the next half, 1 + 2^-10: ties go to even.
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x3c00), hemelb::util::FloatToHalf(1.0f + std::ldexp(1.0f, -11)));
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x3c02),
+                                 hemelb::util::FloatToHalf(1.0f + 3.0f * std::ldexp(1.0f, -11)));
+            // Just above halfway rounds up.
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x3c01),
+                                 hemelb::util::FloatToHalf(1.0f + std::ldexp(1.0f, -11)
+                                     + std::ldexp(1.0f, -20)));
+            // Past the largest half, to infinity.
+            CPPUNIT_ASSERT_EQUAL(uint16_t(0x7c00), hemelb::util::FloatToHalf(65520.0f));
+          }
+
+          void TestRoundTrip()
+          {
+            // Every finite half converts to a float and back to itself...
+            for (uint32_t half = 0; half < 0x10000; ++half)
+            {
+              if ( (half & 0x7c00) == 0x7c00)
+              {
+                continue;
+              }
+              CPPUNIT_ASSERT_EQUAL(uint16_t(half),
+                                   hemelb::util::FloatToHalf(hemelb::util::HalfToFloat(uint16_t(half))));
+            }
+
+            // ... and floats in range are within half an ulp, 2^-11 relative.
+            for (float value = 1e-4f; value < 6e4f; value *= 1.37f)
+            {
+              const float converted = hemelb::util::HalfToFloat(hemelb::util::FloatToHalf(value));
+              CPPUNIT_ASSERT(std::fabs(converted - value) <= std::ldexp(value, -11));
+            }
+          }
+      };
+
+      CPPUNIT_TEST_SUITE_REGISTRATION( HalfPrecisionTests);
+    }
+  }
+}
+
+#endif /* HEMELB_UNITTESTS_UTIL_HALFPRECISIONTESTS_H */
@@ -0,0 +1,110 @@
+
+// This file is part of HemeLB and is Copyright (C)
+// the HemeLB team and/or their institutions, as detailed in the
+// file AUTHORS. This software is provided under the terms of the
+// license in the file LICENSE.
+
+#ifndef HEMELB_UTIL_HALFPRECISION_H
+#define HEMELB_UTIL_HALFPRECISION_H
+
+#include <cstring>
+#include <stdint.h>
+
+namespace hemelb
+{
+  namespace util
+  {
+    /**
+     * Converts a float to the bits of the nearest IEEE 754 half-precision number,
+     * rounding ties to even. Values too large become infinite; NaNs stay NaNs.
+     *
+     * There are no table lookups and only simple branches, so loops of these
+     * vectorise (after F. Giesen's float_to_half_fast3_rtne).
+     * @param value
+     * @return
+     */
+    inline uint16_t FloatToHalf(const float value)
+    {
+      const uint32_t floatInfinity = 255u << 23;
+      const uint32_t halfOverflow = (127u + 16u) << 23;
+      const uint32_t denormalMagicBits = ( (127u - 15u) + (23u - 10u) + 1u) << 23;
+
+      uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      const uint32_t sign = bits & 0x80000000u;
+      bits ^= sign;
+
+      uint32_t half;
+      if (bits >= halfOverflow)
+      {
+        // Infinity, or NaN (kept quiet).
+        half = bits > floatInfinity ?
+          0x7e00u :
+          0x7c00u;
+      }
+      else if (bits < (113u << 23))
+      {
+        // Subnormal as a half: let the float addition do the rounding.
+        float magic, magnitude;
+        std::memcpy(&magic, &denormalMagicBits, sizeof(magic));
+        std::memcpy(&magnitude, &bits, sizeof(magnitude));
+        magnitude += magic;
+        std::memcpy(&half, &magnitude, sizeof(half));
+        half -= denormalMagicBits;
+      }
+      else
+      {
+        // Rebias the exponent and round the mantissa, to even.
+        const uint32_t mantissaOdd = (bits >> 13) & 1u;
+        bits += ( (15u - 127u) << 23) + 0xfffu + mantissaOdd;
+        half = bits >> 13;
+      }
+
+      return uint16_t(half | (sign >> 16));
+    }
+
+    /**
+     * Converts the bits of an IEEE 754 half-precision number to a float, exactly.
+     * @param half
+     * @return
+     */
+    inline float HalfToFloat(const uint16_t half)
+    {
+      const uint32_t shiftedExponent = 0x7c00u << 13;
+      const uint32_t magicBits = 113u << 23;
+
+      uint32_t bits = (half & 0x7fffu) << 13;
+      const uint32_t exponent = shiftedExponent & bits;
+      bits += (127u - 15u) << 23;
+
+      float value;
+      if (exponent == shiftedExponent)
+      {
+        // Infinity or NaN.
+        bits += (128u - 16u) << 23;
+        std::memcpy(&value, &bits, sizeof(value));
+      }
+      else if (exponent == 0)
+      {
+        // Zero or subnormal: renormalise.
+        float magic;
+        bits += 1u << 23;
+        std::memcpy(&value, &bits, sizeof(value));
+        std::memcpy(&magic, &magicBits, sizeof(magic));
+        value -= magic;
+      }
+      else
+      {
+        std::memcpy(&value, &bits, sizeof(value));
+      }
+
+      uint32_t signedBits;
+      std::memcpy(&signedBits, &value, sizeof(signedBits));
+      signedBits |= uint32_t(half & 0x8000u) << 16;
+      std::memcpy(&value, &signedBits, sizeof(value));
+      return value;
+    }
+  }
+}
+
+#endif /* HEMELB_UTIL_HALFPRECISION_H */
@@ -23,6 +23,11 @@ namespace hemelb
       return matrix[row];
     }
 
+    const distribn_t* Matrix3D::operator [](const unsigned int row) const
+    {
+      return matrix[row];
+    }
+
     void Matrix3D::operator*=(distribn_t value)
     {
       for (unsigned row = 0; row < 3; row++)
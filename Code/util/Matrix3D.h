@@ -27,6 +27,14 @@ namespace hemelb
          */
         distribn_t* operator [](const unsigned int row);
 
+        /**
+         * Convenience accessor.
+         *
+         * @param row
+         * @return
+         */
+        const distribn_t* operator [](const unsigned int row) const;
+
         /**
          * Multiplies all the entries of the matrix by a given value
          *
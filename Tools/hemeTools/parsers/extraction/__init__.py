@@ -6,6 +6,7 @@
 
 import os.path
 import xdrlib
+import zlib
 import numpy as np
 
 from .. import HemeLbMagicNumber
@@ -13,6 +14,10 @@ from .. import HemeLbMagicNumber
 ExtractionMagicNumber = 0x78747204
 MainHeaderLength = 60
 TimeStepDataLength = 8
+SiteCoordinatesLength = 12
+CompressedRecordHeaderLength = 20
+ChunkIndexEntryLength = 16
+ShuffleElementLength = 4
 
 class FieldSpec(object):
     """Represent the data type of a single record in both XDR format and
@@ -30,11 +35,16 @@ class FieldSpec(object):
          
     """
 
-    def __init__(self, memspec):
+    def __init__(self, memspec, hasGrid=True):
         # name, XDR dtype, in-memory dtype, length, offset
-        self._filespec = [('grid', '>i4', np.uint32, (3,), 0)]
+        if hasGrid:
+            self._filespec = [('grid', '>i4', np.uint32, (3,), 0)]
+        else:
+            self._filespec = []
+            pass
         
         self._memspec = memspec
+        self._itemsize = None
         return
 
     def Append(self, name, length, pyType, datatype):
@@ -57,8 +67,23 @@ class FieldSpec(object):
     def GetXdr(self):
         """Get the numpy datatype for the XDR file.
         """
-        return np.dtype([(name, xdrType, length) 
-                         for name, xdrType, memType, length, offset in self._filespec])
+        dtype = np.dtype([(name, xdrType, length) 
+                          for name, xdrType, memType, length, offset in self._filespec])
+        if self._itemsize is None or self._itemsize == dtype.itemsize:
+            return dtype
+        # Padded at the end of each record
+        return np.dtype({'names': dtype.names,
+                         'formats': [dtype.fields[name][0] for name in dtype.names],
+                         'offsets': [dtype.fields[name][1] for name in dtype.names],
+                         'itemsize': self._itemsize})
+
+    def PadTo(self, multiple):
+        """Pad the record as stored to a multiple of the given length.
+        """
+        length = np.dtype([(name, xdrType, length)
+                           for name, xdrType, memType, length, offset in self._filespec]).itemsize
+        self._itemsize = -(-length // multiple) * multiple
+        return
 
     def GetRecordLength(self):
         """Get the length of the record as stored in the XDR file.
@@ -98,6 +123,9 @@ class ExtractedPropertyV3Parser(object):
     def GetRecordLength(self):
         return self._fieldSpec.GetRecordLength()
 
+    def GetCoordinateTableLength(self):
+        return 0
+
 class ExtractedPropertyV4Parser(object):
     def __init__(self, fieldCount, siteCount):
         self._fieldCount = fieldCount
@@ -132,11 +160,117 @@ class ExtractedPropertyV4Parser(object):
             return data + operand
         pass
 
+    def GetCoordinateTableLength(self):
+        return 0
+
+class ExtractedPropertyV5Parser(ExtractedPropertyV4Parser):
+    """Version 5 is version 4 with static geometry: the grid coordinates of
+    the sites are stored once, in a table after the headers, and the records
+    hold only the fields, for the sites in the order of the table.
+    """
+    def ParseFieldHeader(self, decoder):
+        self._fieldSpec = FieldSpec([('id', None, np.uint64, 1, None),
+                                     ('position', None, np.float32, (3,), None),
+                                     ('grid', None, np.uint32, (3,), None)],
+                                    hasGrid=False)
+        self._dataOffset = []
+
+        for iField in xrange(self._fieldCount):
+            name = decoder.unpack_string()
+            length = decoder.unpack_uint()
+            self._dataOffset.append(decoder.unpack_double())
+            self._fieldSpec.Append(name, length, '>f4', np.float32)
+            continue
+        return self._fieldSpec
+
+    def GetCoordinateTableLength(self):
+        return SiteCoordinatesLength * self._siteCount
+
+    def ParseCoordinateTable(self, table):
+        return np.frombuffer(table, dtype='>u4').reshape((self._siteCount, 3)).astype(np.uint32)
+
+class CompressedRecords(object):
+    """Compressed records are a header (timestep, record length and chunk
+    count), an index of the compressed and uncompressed length of each chunk,
+    then the chunks. Each chunk is byte-shuffled then deflated; together, they
+    hold the fields as in the uncompressed record, less the timestep.
+    """
+    def DecompressRecord(self, record):
+        decoder = xdrlib.Unpacker(record[:CompressedRecordHeaderLength])
+        decoder.unpack_uhyper()
+        decoder.unpack_uhyper()
+        chunkCount = decoder.unpack_uint()
+
+        indexEnd = CompressedRecordHeaderLength + ChunkIndexEntryLength * chunkCount
+        decoder = xdrlib.Unpacker(record[CompressedRecordHeaderLength:indexEnd])
+        chunks = []
+        pos = indexEnd
+        for iChunk in xrange(chunkCount):
+            compressedLength = decoder.unpack_uhyper()
+            uncompressedLength = decoder.unpack_uhyper()
+            if uncompressedLength:
+                shuffled = np.frombuffer(zlib.decompress(record[pos:pos + compressedLength]),
+                                         dtype=np.uint8)
+                # Undo the shuffle: the first bytes of all the values, then the second...
+                chunks.append(shuffled.reshape((ShuffleElementLength, -1)).T.tostring())
+                pass
+            pos += compressedLength
+            continue
+        return ''.join(chunks)
+
+class ExtractedPropertyV6Parser(CompressedRecords, ExtractedPropertyV5Parser):
+    """Version 6 is version 5 with compressed records.
+    """
+    pass
+
+class ExtractedPropertyV7Parser(ExtractedPropertyV5Parser):
+    """Version 7 is version 5 with each field's encoding in the field header:
+    floats, half-precision numbers, or two-byte fixed point numbers, scaled by
+    the step also in the header. Records are padded to four bytes per site.
+    """
+    Encodings = {0: '>f4', 1: '>f2', 2: '>i2'}
+
+    def parse(self, memoryMappedData):
+        result = np.recarray(self._siteCount, dtype=self._fieldSpec.GetMem())
+
+        for ((name, xdrType, memType, length, offset), dataOffset, step) in zip(self._fieldSpec, self._dataOffset, self._steps):
+            data = memoryMappedData.getfield((xdrType, length), offset).astype(memType)
+            if step:
+                data = data * step
+                pass
+            setattr(result, name, data + dataOffset)
+            continue
+        return result
+
+    def ParseFieldHeader(self, decoder):
+        self._fieldSpec = FieldSpec([('id', None, np.uint64, 1, None),
+                                     ('position', None, np.float32, (3,), None),
+                                     ('grid', None, np.uint32, (3,), None)],
+                                    hasGrid=False)
+        self._dataOffset = []
+        self._steps = []
+
+        for iField in xrange(self._fieldCount):
+            name = decoder.unpack_string()
+            length = decoder.unpack_uint()
+            self._dataOffset.append(decoder.unpack_double())
+            encoding = decoder.unpack_uint()
+            self._steps.append(decoder.unpack_double())
+            self._fieldSpec.Append(name, length, self.Encodings[encoding], np.float32)
+            continue
+        self._fieldSpec.PadTo(4)
+        return self._fieldSpec
+
+class ExtractedPropertyV8Parser(CompressedRecords, ExtractedPropertyV7Parser):
+    """Version 8 is version 7 with compressed records.
+    """
+    pass
+
 class ExtractedProperty(object):
     """Represent the contents of a HemeLB property extraction file.
     
     """
-    HandledVersions = [3,4]
+    HandledVersions = [3,4,5,6,7,8]
 
     def __init__(self, filename):
         """Read the file's headers and determine how many times and which times
@@ -182,6 +316,15 @@ class ExtractedProperty(object):
             self.parser = ExtractedPropertyV3Parser(self.fieldCount, self.siteCount)
         elif version == 4:
             self.parser = ExtractedPropertyV4Parser(self.fieldCount, self.siteCount)
+        elif version == 5:
+            self.parser = ExtractedPropertyV5Parser(self.fieldCount, self.siteCount)
+        elif version == 6:
+            self.parser = ExtractedPropertyV6Parser(self.fieldCount, self.siteCount)
+        elif version == 7:
+            self.parser = ExtractedPropertyV7Parser(self.fieldCount, self.siteCount)
+        elif version == 8:
+            self.parser = ExtractedPropertyV8Parser(self.fieldCount, self.siteCount)
+        self._compressed = version in (6, 8)
         return
 
     def _ReadFieldHeader(self):
@@ -204,6 +347,16 @@ class ExtractedProperty(object):
         self._rowLength = self._fieldSpec.GetRecordLength()
         self._recordLength = TimeStepDataLength + self._rowLength * self.siteCount
 
+        # With static geometry, the grid coordinates follow, once.
+        self._coordinateTableLength = self.parser.GetCoordinateTableLength()
+        self._grid = None
+        if self._coordinateTableLength:
+            table = self._file.read(self._coordinateTableLength)
+            assert len(table) == self._coordinateTableLength, \
+                "Did not read the correct length of the coordinate table in extraction file '{}'".format(self.filename)
+            self._grid = self.parser.ParseCoordinateTable(table)
+            pass
+
         return
 
     def _DetermineTimes(self):
@@ -211,7 +364,12 @@ class ExtractedProperty(object):
         which times are contained within it.
         """
         filesize = os.path.getsize(self.filename)
-        self._totalHeaderLength = MainHeaderLength + self._fieldHeaderLength
+        self._totalHeaderLength = MainHeaderLength + self._fieldHeaderLength + \
+            self._coordinateTableLength
+        if self._compressed:
+            self._DetermineCompressedTimes(filesize)
+            return
+
         bodysize = filesize - self._totalHeaderLength
         assert bodysize % self._recordLength == 0, \
             "Extraction file appears to have partial record(s), residual %s / %s , bodysize %s"%(bodysize % self._recordLength,self._recordLength,bodysize)
@@ -231,6 +389,35 @@ class ExtractedProperty(object):
 
         return
 
+    def _DetermineCompressedTimes(self, filesize):
+        """Walk the compressed records, which vary in length, noting where each
+        starts and its time.
+        """
+        times = []
+        self._recordOffsets = []
+        self._recordLengths = []
+        pos = self._totalHeaderLength
+        while pos < filesize:
+            self._file.seek(pos)
+            header = self._file.read(CompressedRecordHeaderLength)
+            assert len(header) == CompressedRecordHeaderLength, \
+                "Extraction file appears to have a partial record at %s" % pos
+            decoder = xdrlib.Unpacker(header)
+            times.append(decoder.unpack_uhyper())
+            recordLength = decoder.unpack_uhyper()
+            assert pos + recordLength <= filesize, \
+                "Extraction file appears to have a partial record at %s" % pos
+            self._recordOffsets.append(pos)
+            self._recordLengths.append(recordLength)
+            pos += recordLength
+            continue
+
+        times = np.array(times, dtype=int)
+        assert np.alltrue(np.argsort(times) == np.arange(len(times))), \
+            "Times in extraction file are not monotonically increasing!"
+        self.times = times
+        return
+
     def GetByIndex(self, idx):
         """Get the fields by time index. 
         """
@@ -258,7 +445,7 @@ class ExtractedProperty(object):
         """
         # Figure out the start position of the data for this timestep in the
         # file. This is made up of
-        #    - file headers
+        #    - file headers (and any coordinate table)
         #    - number of previous records * record length
         #    - stored timestep 
         start = self._totalHeaderLength + \
@@ -272,11 +459,22 @@ class ExtractedProperty(object):
         
         Fields are as specified in the file with the addition of 
         """
-        mapped = self._MemMap(idx)
+        if self._compressed:
+            with open(self.filename, 'rb') as f:
+                f.seek(self._recordOffsets[idx])
+                record = f.read(self._recordLengths[idx])
+            mapped = np.frombuffer(self.parser.DecompressRecord(record),
+                                   dtype=self._fieldSpec.GetXdr())
+        else:
+            mapped = self._MemMap(idx)
+            pass
 
         answer = self.parser.parse(mapped)
         
         answer.id = np.arange(self.siteCount)
+        if self._grid is not None:
+            answer.grid = self._grid
+            pass
         answer.position = self.voxelSizeMetres * answer.grid + self.originMetres
         return answer
 